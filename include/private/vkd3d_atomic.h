@@ -19,6 +19,7 @@
 #ifndef __VKD3D_ATOMIC_H
 #define __VKD3D_ATOMIC_H
 
+#include <stdbool.h>
 #include <stdint.h>
 
 #if defined(_MSC_VER)
@@ -93,6 +94,17 @@ FORCEINLINE uint32_t vkd3d_atomic_uint32_exchange_explicit(uint32_t *target, uin
     return result;
 }
 
+FORCEINLINE bool vkd3d_atomic_uint32_compare_exchange(uint32_t *target, uint32_t *expected, uint32_t desired,
+        vkd3d_memory_order success_order, vkd3d_memory_order fail_order)
+{
+    uint32_t result;
+    vkd3d_atomic_choose_intrinsic(success_order, result, InterlockedCompareExchange, (LONG*)target, desired, *expected);
+    if (result == *expected)
+        return true;
+    *expected = result;
+    return false;
+}
+
 FORCEINLINE uint32_t vkd3d_atomic_uint32_increment(uint32_t *target, vkd3d_memory_order order)
 {
     uint32_t result;
@@ -107,6 +119,51 @@ FORCEINLINE uint32_t vkd3d_atomic_uint32_decrement(uint32_t *target, vkd3d_memor
     return result;
 }
 
+FORCEINLINE uint64_t vkd3d_atomic_uint64_load_explicit(uint64_t *target, vkd3d_memory_order order)
+{
+    uint64_t value = *((volatile uint64_t*)target);
+    vkd3d_atomic_load_barrier(order);
+    return value;
+}
+
+FORCEINLINE void vkd3d_atomic_uint64_store_explicit(uint64_t *target, uint64_t value, vkd3d_memory_order order)
+{
+    switch (order)
+    {
+        case vkd3d_memory_order_release: vkd3d_atomic_rw_barrier(); // fallthrough...
+        case vkd3d_memory_order_relaxed: *((volatile uint64_t*)target) = value; break;
+        default:
+        case vkd3d_memory_order_seq_cst:
+            (void) InterlockedExchange64((LONG64*) target, value);
+    }
+}
+
+FORCEINLINE uint64_t vkd3d_atomic_uint64_add(uint64_t *target, uint64_t value, vkd3d_memory_order order)
+{
+    uint64_t result;
+    vkd3d_atomic_choose_intrinsic(order, result, InterlockedExchangeAdd64, (LONG64*)target, value);
+    return result + value;
+}
+
+FORCEINLINE void *vkd3d_atomic_ptr_load_explicit(void **target, vkd3d_memory_order order)
+{
+    void *value = *((void * volatile *)target);
+    vkd3d_atomic_load_barrier(order);
+    return value;
+}
+
+FORCEINLINE void vkd3d_atomic_ptr_store_explicit(void **target, void *value, vkd3d_memory_order order)
+{
+    switch (order)
+    {
+        case vkd3d_memory_order_release: vkd3d_atomic_rw_barrier(); // fallthrough...
+        case vkd3d_memory_order_relaxed: *((void * volatile *)target) = value; break;
+        default:
+        case vkd3d_memory_order_seq_cst:
+            (void) InterlockedExchangePointer(target, value);
+    }
+}
+
 #elif defined(__GNUC__) || defined(__clang__)
 
 #define vkd3d_memory_order_relaxed __ATOMIC_RELAXED
@@ -119,8 +176,15 @@ FORCEINLINE uint32_t vkd3d_atomic_uint32_decrement(uint32_t *target, vkd3d_memor
 # define vkd3d_atomic_uint32_load_explicit(target, order)            __atomic_load_n(target, order)
 # define vkd3d_atomic_uint32_store_explicit(target, value, order)    __atomic_store_n(target, value, order)
 # define vkd3d_atomic_uint32_exchange_explicit(target, value, order) __atomic_exchange_n(target, value, order)
+# define vkd3d_atomic_uint32_compare_exchange(target, expected, desired, success_order, fail_order) \
+        __atomic_compare_exchange_n(target, expected, desired, false, success_order, fail_order)
 # define vkd3d_atomic_uint32_increment(target, order)                __atomic_add_fetch(target, 1, order)
 # define vkd3d_atomic_uint32_decrement(target, order)                __atomic_sub_fetch(target, 1, order)
+# define vkd3d_atomic_uint64_load_explicit(target, order)            __atomic_load_n(target, order)
+# define vkd3d_atomic_uint64_store_explicit(target, value, order)    __atomic_store_n(target, value, order)
+# define vkd3d_atomic_uint64_add(target, value, order)               __atomic_add_fetch(target, value, order)
+# define vkd3d_atomic_ptr_load_explicit(target, order)               __atomic_load_n(target, order)
+# define vkd3d_atomic_ptr_store_explicit(target, value, order)       __atomic_store_n(target, value, order)
 
 # ifndef __MINGW32__
 #  define InterlockedIncrement(target) vkd3d_atomic_uint32_increment(target, vkd3d_memory_order_seq_cst)
@@ -26,6 +26,7 @@
 #include <stdint.h>
 #include <limits.h>
 #include <stdbool.h>
+#include <string.h>
 
 #ifdef _MSC_VER
 #include <intrin.h>
@@ -201,4 +202,37 @@ static inline void vkd3d_parse_version(const char *version, int *major, int *min
     *minor = atoi(version);
 }
 
+#define VKD3D_HASH_FNV1A_INIT   0xcbf29ce484222325ull
+#define VKD3D_HASH_FNV1A_PRIME  0x00000100000001b3ull
+
+static inline uint64_t vkd3d_hash_fnv1a_data(uint64_t hash, const void *data, size_t size)
+{
+    const uint8_t *bytes = data;
+    size_t i;
+
+    for (i = 0; i < size; ++i)
+        hash = (hash ^ bytes[i]) * VKD3D_HASH_FNV1A_PRIME;
+
+    return hash;
+}
+
+static inline uint64_t vkd3d_hash_fnv1a_u32(uint64_t hash, uint32_t value)
+{
+    return vkd3d_hash_fnv1a_data(hash, &value, sizeof(value));
+}
+
+static inline uint64_t vkd3d_hash_fnv1a_u64(uint64_t hash, uint64_t value)
+{
+    return vkd3d_hash_fnv1a_data(hash, &value, sizeof(value));
+}
+
+static inline uint64_t vkd3d_hash_fnv1a_string(uint64_t hash, const char *str)
+{
+    /* Include the terminator so that adjacent strings cannot alias. */
+    return str ? vkd3d_hash_fnv1a_data(hash, str, strlen(str) + 1) : vkd3d_hash_fnv1a_u32(hash, 0);
+}
+
+/* Monotonic clock, only meaningful for measuring intervals. */
+uint64_t vkd3d_get_current_time_ns(void) DECLSPEC_HIDDEN;
+
 #endif  /* __VKD3D_COMMON_H */
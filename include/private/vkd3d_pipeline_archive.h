@@ -0,0 +1,123 @@
+/*
+ * Copyright 2020 VKD3D contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef __VKD3D_PIPELINE_ARCHIVE_H
+#define __VKD3D_PIPELINE_ARCHIVE_H
+
+#include "vkd3d_common.h"
+#include <vkd3d.h>
+
+/* Pipeline archives are written by libvkd3d when VKD3D_PIPELINE_RECORD_PATH
+ * is set, and replayed by vkd3d-replay. An archive is a header followed by
+ * records. Every record is identified by the hash of its payload, and a
+ * record is written only once per archive, so shaders and root signatures
+ * shared by many pipeline states are stored once. Pipeline records refer to
+ * shaders and root signatures by hash, which always precede them.
+ *
+ * Payloads are stored in native byte order and padded to 8 bytes. */
+#define VKD3D_PIPELINE_ARCHIVE_MAGIC    0x41504b56u /* "VKPA" */
+#define VKD3D_PIPELINE_ARCHIVE_VERSION  1
+
+struct vkd3d_pipeline_archive_header
+{
+    uint32_t magic;
+    uint32_t version;
+};
+
+enum vkd3d_pipeline_archive_record_type
+{
+    VKD3D_PIPELINE_ARCHIVE_RECORD_SHADER            = 1,
+    VKD3D_PIPELINE_ARCHIVE_RECORD_ROOT_SIGNATURE    = 2,
+    VKD3D_PIPELINE_ARCHIVE_RECORD_GRAPHICS_PIPELINE = 3,
+    VKD3D_PIPELINE_ARCHIVE_RECORD_COMPUTE_PIPELINE  = 4,
+};
+
+struct vkd3d_pipeline_archive_record
+{
+    uint32_t type;
+    uint32_t size;
+    uint64_t hash;
+};
+
+enum vkd3d_pipeline_archive_shader_stage
+{
+    VKD3D_PIPELINE_ARCHIVE_VS,
+    VKD3D_PIPELINE_ARCHIVE_HS,
+    VKD3D_PIPELINE_ARCHIVE_DS,
+    VKD3D_PIPELINE_ARCHIVE_GS,
+    VKD3D_PIPELINE_ARCHIVE_PS,
+    VKD3D_PIPELINE_ARCHIVE_CS,
+    VKD3D_PIPELINE_ARCHIVE_STAGE_COUNT,
+};
+
+/* Semantic names are offsets into the string table which ends the payload. */
+struct vkd3d_pipeline_archive_input_element
+{
+    uint32_t semantic_name;
+    uint32_t semantic_index;
+    uint32_t format;
+    uint32_t input_slot;
+    uint32_t aligned_byte_offset;
+    uint32_t input_slot_class;
+    uint32_t instance_data_step_rate;
+};
+
+struct vkd3d_pipeline_archive_so_entry
+{
+    uint32_t stream;
+    uint32_t semantic_name;
+    uint32_t semantic_index;
+    uint32_t start_component;
+    uint32_t component_count;
+    uint32_t output_slot;
+};
+
+/* Followed by input_element_count input elements, so_entry_count stream
+ * output entries, so_stride_count strides, view_instance_count view instance
+ * locations and the string table. Shaders not used by the pipeline have a
+ * hash of 0. */
+struct vkd3d_pipeline_archive_pipeline
+{
+    uint64_t root_signature_hash;
+    uint64_t shader_hashes[VKD3D_PIPELINE_ARCHIVE_STAGE_COUNT];
+
+    D3D12_BLEND_DESC blend_state;
+    uint32_t sample_mask;
+    D3D12_RASTERIZER_DESC rasterizer_state;
+    D3D12_DEPTH_STENCIL_DESC1 depth_stencil_state;
+    uint32_t strip_cut_value;
+    uint32_t primitive_topology_type;
+    D3D12_RT_FORMAT_ARRAY rtv_formats;
+    uint32_t dsv_format;
+    DXGI_SAMPLE_DESC sample_desc;
+    uint32_t flags;
+
+    uint32_t input_element_count;
+    uint32_t so_entry_count;
+    uint32_t so_stride_count;
+    uint32_t so_rasterized_stream;
+    uint32_t view_instance_count;
+    uint32_t view_instancing_flags;
+};
+
+static inline size_t vkd3d_pipeline_archive_align(size_t size)
+{
+    return (size + 7) & ~(size_t)7;
+}
+
+#endif  /* __VKD3D_PIPELINE_ARCHIVE_H */
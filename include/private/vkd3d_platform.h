@@ -21,6 +21,8 @@
 
 #include "vkd3d_common.h"
 
+#include <stdio.h>
+
 #if defined(_WIN32)
 #define VKD3D_PATH_MAX _MAX_PATH
 #else
@@ -39,4 +41,28 @@ const char *vkd3d_dlerror(void) DECLSPEC_HIDDEN;
 
 bool vkd3d_get_program_name(char program_name[VKD3D_PATH_MAX]) DECLSPEC_HIDDEN;
 
+struct vkd3d_memory_mapped_file
+{
+    void *mapped;
+    size_t mapped_size;
+};
+
+/* Maps the whole file. Fails for missing or empty files. */
+bool vkd3d_file_map_read_only(const char *path, struct vkd3d_memory_mapped_file *file) DECLSPEC_HIDDEN;
+void vkd3d_file_unmap(struct vkd3d_memory_mapped_file *file) DECLSPEC_HIDDEN;
+
+/* Advisory inter-process lock on an open file. Only serializes cooperating
+ * writers, readers and mappings are not blocked. */
+bool vkd3d_file_lock(FILE *file) DECLSPEC_HIDDEN;
+void vkd3d_file_unlock(FILE *file) DECLSPEC_HIDDEN;
+
+/* Atomically replaces "to" with "from". */
+bool vkd3d_file_rename_overwrite(const char *from, const char *to) DECLSPEC_HIDDEN;
+
+/* Must not be used while any process has the truncated range mapped. */
+bool vkd3d_file_truncate(FILE *file, uint64_t size) DECLSPEC_HIDDEN;
+
+/* Number of online logical processors, at least 1. */
+unsigned int vkd3d_get_cpu_count(void) DECLSPEC_HIDDEN;
+
 #endif
\ No newline at end of file
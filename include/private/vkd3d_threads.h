@@ -21,6 +21,8 @@
 
 #include "vkd3d_memory.h"
 
+#include <errno.h>
+
 #if defined(_MSC_VER)
 
 #define WIN32_LEAN_AND_MEAN
@@ -143,16 +145,43 @@ static inline int pthread_cond_wait(pthread_cond_t *cond, pthread_mutex_t *lock)
     return ret ? 0 : -1;
 }
 
+/* Returns 0 when signaled, ETIMEDOUT on timeout. */
+static inline int vkd3d_cond_wait_timeout(pthread_cond_t *cond, pthread_mutex_t *lock, unsigned int timeout_ms)
+{
+    if (SleepConditionVariableCS(&cond->cond, &lock->lock, timeout_ms))
+        return 0;
+    return GetLastError() == ERROR_TIMEOUT ? ETIMEDOUT : -1;
+}
+
 static inline void vkd3d_set_thread_name(const char *name)
 {
     (void)name;
 }
 #else
 #include <pthread.h>
+#include <time.h>
+
 static inline void vkd3d_set_thread_name(const char *name)
 {
     pthread_setname_np(pthread_self(), name);
 }
+
+/* Returns 0 when signaled, ETIMEDOUT on timeout. */
+static inline int vkd3d_cond_wait_timeout(pthread_cond_t *cond, pthread_mutex_t *lock, unsigned int timeout_ms)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_sec += timeout_ms / 1000;
+    ts.tv_nsec += (timeout_ms % 1000) * 1000000;
+    if (ts.tv_nsec >= 1000000000)
+    {
+        ts.tv_nsec -= 1000000000;
+        ++ts.tv_sec;
+    }
+
+    return pthread_cond_timedwait(cond, lock, &ts);
+}
 #endif
 
 
@@ -50,6 +50,8 @@ enum vkd3d_structure_type
     /* 1.2 */
     VKD3D_STRUCTURE_TYPE_OPTIONAL_DEVICE_EXTENSIONS_INFO,
     VKD3D_STRUCTURE_TYPE_APPLICATION_INFO,
+    VKD3D_STRUCTURE_TYPE_PIPELINE_CACHE_INFO,
+    VKD3D_STRUCTURE_TYPE_PIPELINE_STATISTICS,
 
     VKD3D_FORCE_32_BIT_ENUM(VKD3D_STRUCTURE_TYPE),
 };
@@ -132,6 +134,17 @@ struct vkd3d_optional_device_extensions_info
     uint32_t extension_count;
 };
 
+/* Extends vkd3d_device_create_info. Available since 1.2. */
+struct vkd3d_pipeline_cache_info
+{
+    enum vkd3d_structure_type type;
+    const void *next;
+
+    /* Directory where the Vulkan pipeline cache is kept across runs.
+     * Takes precedence over VKD3D_PIPELINE_CACHE_PATH. */
+    const char *cache_path;
+};
+
 /* vkd3d_image_resource_create_info flags */
 #define VKD3D_RESOURCE_INITIAL_STATE_TRANSITION 0x00000001
 #define VKD3D_RESOURCE_PRESENT_STATE_TRANSITION 0x00000002
@@ -147,6 +160,54 @@ struct vkd3d_image_resource_create_info
     D3D12_RESOURCE_STATES present_state;
 };
 
+enum vkd3d_pipeline_timing
+{
+    VKD3D_PIPELINE_TIMING_DXBC_PARSE,
+    VKD3D_PIPELINE_TIMING_SPIRV_EMIT,
+    VKD3D_PIPELINE_TIMING_SHADER_MODULE_CREATE,
+    VKD3D_PIPELINE_TIMING_PIPELINE_CREATE,
+
+    VKD3D_PIPELINE_TIMING_COUNT,
+};
+
+#define VKD3D_PIPELINE_TIMING_HISTOGRAM_SIZE 16
+
+struct vkd3d_pipeline_timing_statistics
+{
+    uint64_t count;
+    uint64_t total_ns;
+    uint64_t max_ns;
+    /* Bucket 0 counts samples below 1us, bucket i samples in [2^(i-1), 2^i) us.
+     * The last bucket also counts everything above. */
+    uint64_t histogram[VKD3D_PIPELINE_TIMING_HISTOGRAM_SIZE];
+};
+
+struct vkd3d_pipeline_statistics
+{
+    enum vkd3d_structure_type type;
+    const void *next;
+
+    struct vkd3d_pipeline_timing_statistics timings[VKD3D_PIPELINE_TIMING_COUNT];
+
+    /* Lookups of Vulkan pipelines for the current draw state. */
+    uint64_t pipeline_variant_hits;
+    uint64_t pipeline_variant_misses;
+
+    uint64_t render_pass_hits;
+    uint64_t render_pass_misses;
+
+    /* Lookups of samplers for sampler descriptors and static samplers. */
+    uint64_t sampler_hits;
+    uint64_t sampler_misses;
+
+    /* Pipeline variants evicted by VKD3D_PIPELINE_VARIANT_LIMIT or
+     * VKD3D_PIPELINE_VARIANT_MEMORY_LIMIT. The live variant count and their
+     * estimated size in bytes are only tracked while a limit is set. */
+    uint64_t pipeline_variant_evictions;
+    uint64_t pipeline_variant_count;
+    uint64_t pipeline_variant_size;
+};
+
 #ifndef VKD3D_NO_PROTOTYPES
 
 HRESULT vkd3d_create_instance(const struct vkd3d_instance_create_info *create_info,
@@ -187,6 +248,8 @@ HRESULT vkd3d_serialize_versioned_root_signature(const D3D12_VERSIONED_ROOT_SIGN
 HRESULT vkd3d_create_versioned_root_signature_deserializer(const void *data, SIZE_T data_size,
         REFIID iid, void **deserializer);
 
+HRESULT vkd3d_get_pipeline_statistics(ID3D12Device *device, struct vkd3d_pipeline_statistics *statistics);
+
 #endif  /* VKD3D_NO_PROTOTYPES */
 
 /*
@@ -230,6 +293,9 @@ typedef HRESULT (*PFN_vkd3d_serialize_versioned_root_signature)(const D3D12_VERS
 typedef HRESULT (*PFN_vkd3d_create_versioned_root_signature_deserializer)(const void *data, SIZE_T data_size,
         REFIID iid, void **deserializer);
 
+typedef HRESULT (*PFN_vkd3d_get_pipeline_statistics)(ID3D12Device *device,
+        struct vkd3d_pipeline_statistics *statistics);
+
 #ifdef __cplusplus
 }
 #endif  /* __cplusplus */
@@ -35,6 +35,7 @@ enum vkd3d_shader_structure_type
     VKD3D_SHADER_STRUCTURE_TYPE_SCAN_INFO,
     VKD3D_SHADER_STRUCTURE_TYPE_TRANSFORM_FEEDBACK_INFO,
     VKD3D_SHADER_STRUCTURE_TYPE_DOMAIN_SHADER_COMPILE_ARGUMENTS,
+    VKD3D_SHADER_STRUCTURE_TYPE_COMPILE_TIMING_INFO,
 
     VKD3D_FORCE_32_BIT_ENUM(VKD3D_SHADER_STRUCTURE_TYPE),
 };
@@ -42,6 +43,7 @@ enum vkd3d_shader_structure_type
 enum vkd3d_shader_compiler_option
 {
     VKD3D_SHADER_STRIP_DEBUG = 0x00000001,
+    VKD3D_SHADER_OPTIMIZE    = 0x00000002,
 
     VKD3D_FORCE_32_BIT_ENUM(VKD3D_SHADER_COMPILER_OPTION),
 };
@@ -216,6 +218,21 @@ struct vkd3d_shader_transform_feedback_info
     unsigned int buffer_stride_count;
 };
 
+/* Extends vkd3d_shader_interface_info. Receives the time in nanoseconds
+ * which vkd3d_shader_compile_dxbc() spent decoding the DXBC and emitting
+ * SPIR-V. Has no effect on the generated code. Not filled in for DXIL.
+ * "scan_time_ns" is optional, and receives the part of the parse time spent
+ * scanning the decoded instructions. */
+struct vkd3d_shader_compile_timing_info
+{
+    enum vkd3d_shader_structure_type type;
+    const void *next;
+
+    uint64_t *parse_time_ns;
+    uint64_t *emit_time_ns;
+    uint64_t *scan_time_ns;
+};
+
 enum vkd3d_shader_target
 {
     VKD3D_SHADER_TARGET_NONE,
@@ -614,6 +631,18 @@ struct vkd3d_shader_signature
     unsigned int element_count;
 };
 
+/* Incremental state for the vkd3d_shader_hash_*() functions, a fast
+ * non-cryptographic 64-bit hash (XXH64). Opaque to applications; the hash of
+ * a byte stream does not depend on how it is split into update calls. */
+struct vkd3d_shader_hash_state
+{
+    uint64_t lanes[4];
+    uint64_t seed;
+    uint64_t total_size;
+    uint8_t buffer[32];
+    unsigned int buffer_size;
+};
+
 /* swizzle bits fields: wwzzyyxx */
 #define VKD3D_SWIZZLE_X (0u)
 #define VKD3D_SWIZZLE_Y (1u)
@@ -663,6 +692,19 @@ void vkd3d_shader_free_shader_signature(struct vkd3d_shader_signature *signature
 
 int vkd3d_shader_supports_dxil(void);
 
+void vkd3d_shader_hash_init(struct vkd3d_shader_hash_state *state, uint64_t seed);
+void vkd3d_shader_hash_update(struct vkd3d_shader_hash_state *state, const void *data, size_t size);
+uint64_t vkd3d_shader_hash_digest(const struct vkd3d_shader_hash_state *state);
+uint64_t vkd3d_shader_hash_data(const void *data, size_t size, uint64_t seed);
+
+/* Hash everything which affects the generated code, following the "next"
+ * chains. Both accept NULL. Fail with VKD3D_ERROR_INVALID_ARGUMENT for
+ * unknown extension structures. */
+int vkd3d_shader_hash_shader_interface(struct vkd3d_shader_hash_state *state,
+        const struct vkd3d_shader_interface_info *shader_interface_info);
+int vkd3d_shader_hash_compile_arguments(struct vkd3d_shader_hash_state *state,
+        const struct vkd3d_shader_compile_arguments *compile_args);
+
 #endif  /* VKD3D_SHADER_NO_PROTOTYPES */
 
 /*
@@ -694,6 +736,17 @@ typedef struct vkd3d_shader_signature_element * (*PFN_vkd3d_shader_find_signatur
         unsigned int semantic_index, unsigned int stream_index);
 typedef void (*PFN_vkd3d_shader_free_shader_signature)(struct vkd3d_shader_signature *signature);
 
+typedef void (*PFN_vkd3d_shader_hash_init)(struct vkd3d_shader_hash_state *state, uint64_t seed);
+typedef void (*PFN_vkd3d_shader_hash_update)(struct vkd3d_shader_hash_state *state,
+        const void *data, size_t size);
+typedef uint64_t (*PFN_vkd3d_shader_hash_digest)(const struct vkd3d_shader_hash_state *state);
+typedef uint64_t (*PFN_vkd3d_shader_hash_data)(const void *data, size_t size, uint64_t seed);
+
+typedef int (*PFN_vkd3d_shader_hash_shader_interface)(struct vkd3d_shader_hash_state *state,
+        const struct vkd3d_shader_interface_info *shader_interface_info);
+typedef int (*PFN_vkd3d_shader_hash_compile_arguments)(struct vkd3d_shader_hash_state *state,
+        const struct vkd3d_shader_compile_arguments *compile_args);
+
 #ifdef __cplusplus
 }
 #endif  /* __cplusplus */
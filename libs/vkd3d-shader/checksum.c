@@ -27,26 +27,15 @@
  * except that you don't need to include two pages of legalese
  * with every copy.
  *
- * To compute the message digest of a chunk of bytes, declare an
- * md5_ctx structure, pass it to md5_init, call md5_update as
- * needed on buffers full of bytes, and then call md5_final, which
- * will fill a supplied 16-byte array with the digest.
+ * The DXBC checksum is MD5 with a nonstandard final block, computed in one
+ * shot: complete blocks are transformed straight from the caller's buffer,
+ * and only the tail is copied out for padding.
  */
 
 #include "vkd3d_shader_private.h"
 
 #define DXBC_CHECKSUM_BLOCK_SIZE 64
 
-STATIC_ASSERT(sizeof(unsigned int) == 4);
-
-struct md5_ctx
-{
-    unsigned int i[2];
-    unsigned int buf[4];
-    unsigned char in[DXBC_CHECKSUM_BLOCK_SIZE];
-    unsigned char digest[16];
-};
-
 /* The four core functions - F1 is optimized somewhat */
 
 /* #define F1(x, y, z) (x & y | ~x & z) */
@@ -59,14 +48,23 @@ struct md5_ctx
 #define MD5STEP(f, w, x, y, z, data, s) \
         (w += f(x, y, z) + data,  w = w << s | w >> (32 - s),  w += x)
 
+/* F2 split into its two disjoint halves; the half which doesn't depend on
+ * the result of the previous step is added first, off the critical path. */
+#define MD5STEP_F2(w, x, y, z, data, s) \
+        (w += (y & ~z) + data,  w += x & z,  w = w << s | w >> (32 - s),  w += x)
+
 /*
  * The core of the MD5 algorithm, this alters an existing MD5 hash to
- * reflect the addition of 16 longwords of new data. md5_update blocks
- * the data and converts bytes into longwords for this routine.
+ * reflect the addition of one 64-byte block of new data.
  */
-static void md5_transform(unsigned int buf[4], const unsigned int in[16])
+static void md5_transform(uint32_t buf[4], const unsigned char *block)
 {
-    unsigned int a, b, c, d;
+    uint32_t a, b, c, d, in[16];
+    unsigned int i;
+
+    /* Compilers turn this into plain loads on little-endian targets. */
+    for (i = 0; i < 16; ++i, block += 4)
+        in[i] = block[0] | block[1] << 8 | block[2] << 16 | (uint32_t)block[3] << 24;
 
     a = buf[0];
     b = buf[1];
@@ -90,22 +88,22 @@ static void md5_transform(unsigned int buf[4], const unsigned int in[16])
     MD5STEP(F1, c, d, a, b, in[14] + 0xa679438e, 17);
     MD5STEP(F1, b, c, d, a, in[15] + 0x49b40821, 22);
 
-    MD5STEP(F2, a, b, c, d, in[1] + 0xf61e2562, 5);
-    MD5STEP(F2, d, a, b, c, in[6] + 0xc040b340, 9);
-    MD5STEP(F2, c, d, a, b, in[11] + 0x265e5a51, 14);
-    MD5STEP(F2, b, c, d, a, in[0] + 0xe9b6c7aa, 20);
-    MD5STEP(F2, a, b, c, d, in[5] + 0xd62f105d, 5);
-    MD5STEP(F2, d, a, b, c, in[10] + 0x02441453, 9);
-    MD5STEP(F2, c, d, a, b, in[15] + 0xd8a1e681, 14);
-    MD5STEP(F2, b, c, d, a, in[4] + 0xe7d3fbc8, 20);
-    MD5STEP(F2, a, b, c, d, in[9] + 0x21e1cde6, 5);
-    MD5STEP(F2, d, a, b, c, in[14] + 0xc33707d6, 9);
-    MD5STEP(F2, c, d, a, b, in[3] + 0xf4d50d87, 14);
-    MD5STEP(F2, b, c, d, a, in[8] + 0x455a14ed, 20);
-    MD5STEP(F2, a, b, c, d, in[13] + 0xa9e3e905, 5);
-    MD5STEP(F2, d, a, b, c, in[2] + 0xfcefa3f8, 9);
-    MD5STEP(F2, c, d, a, b, in[7] + 0x676f02d9, 14);
-    MD5STEP(F2, b, c, d, a, in[12] + 0x8d2a4c8a, 20);
+    MD5STEP_F2(a, b, c, d, in[1] + 0xf61e2562, 5);
+    MD5STEP_F2(d, a, b, c, in[6] + 0xc040b340, 9);
+    MD5STEP_F2(c, d, a, b, in[11] + 0x265e5a51, 14);
+    MD5STEP_F2(b, c, d, a, in[0] + 0xe9b6c7aa, 20);
+    MD5STEP_F2(a, b, c, d, in[5] + 0xd62f105d, 5);
+    MD5STEP_F2(d, a, b, c, in[10] + 0x02441453, 9);
+    MD5STEP_F2(c, d, a, b, in[15] + 0xd8a1e681, 14);
+    MD5STEP_F2(b, c, d, a, in[4] + 0xe7d3fbc8, 20);
+    MD5STEP_F2(a, b, c, d, in[9] + 0x21e1cde6, 5);
+    MD5STEP_F2(d, a, b, c, in[14] + 0xc33707d6, 9);
+    MD5STEP_F2(c, d, a, b, in[3] + 0xf4d50d87, 14);
+    MD5STEP_F2(b, c, d, a, in[8] + 0x455a14ed, 20);
+    MD5STEP_F2(a, b, c, d, in[13] + 0xa9e3e905, 5);
+    MD5STEP_F2(d, a, b, c, in[2] + 0xfcefa3f8, 9);
+    MD5STEP_F2(c, d, a, b, in[7] + 0x676f02d9, 14);
+    MD5STEP_F2(b, c, d, a, in[12] + 0x8d2a4c8a, 20);
 
     MD5STEP(F3, a, b, c, d, in[5] + 0xfffa3942, 4);
     MD5STEP(F3, d, a, b, c, in[8] + 0x8771f681, 11);
@@ -147,155 +145,59 @@ static void md5_transform(unsigned int buf[4], const unsigned int in[16])
     buf[3] += d;
 }
 
-/*
- * Note: this code is harmless on little-endian machines.
- */
-static void byte_reverse(unsigned char *buf, unsigned longs)
+static void dxbc_checksum_write_u32(unsigned char *p, uint32_t value)
 {
-    unsigned int t;
-
-    do
-    {
-        t = ((unsigned)buf[3] << 8 | buf[2]) << 16 |
-            ((unsigned)buf[1] << 8 | buf[0]);
-        *(unsigned int *)buf = t;
-        buf += 4;
-    } while (--longs);
-}
-
-/*
- * Start MD5 accumulation. Set bit count to 0 and buffer to mysterious
- * initialization constants.
- */
-static void md5_init(struct md5_ctx *ctx)
-{
-    ctx->buf[0] = 0x67452301;
-    ctx->buf[1] = 0xefcdab89;
-    ctx->buf[2] = 0x98badcfe;
-    ctx->buf[3] = 0x10325476;
-
-    ctx->i[0] = ctx->i[1] = 0;
-}
-
-/*
- * Update context to reflect the concatenation of another buffer full
- * of bytes.
- */
-static void md5_update(struct md5_ctx *ctx, const unsigned char *buf, unsigned int len)
-{
-    unsigned int t;
-
-    /* Update bitcount */
-    t = ctx->i[0];
-
-    if ((ctx->i[0] = t + (len << 3)) < t)
-        ctx->i[1]++;        /* Carry from low to high */
-
-    ctx->i[1] += len >> 29;
-    t = (t >> 3) & 0x3f;
-
-    /* Handle any leading odd-sized chunks */
-    if (t)
-    {
-        unsigned char *p = (unsigned char *)ctx->in + t;
-        t = DXBC_CHECKSUM_BLOCK_SIZE - t;
-
-        if (len < t)
-        {
-            memcpy(p, buf, len);
-            return;
-        }
-
-        memcpy(p, buf, t);
-        byte_reverse(ctx->in, 16);
-
-        md5_transform(ctx->buf, (unsigned int *)ctx->in);
-
-        buf += t;
-        len -= t;
-    }
-
-    /* Process data in 64-byte chunks */
-    while (len >= DXBC_CHECKSUM_BLOCK_SIZE)
-    {
-        memcpy(ctx->in, buf, DXBC_CHECKSUM_BLOCK_SIZE);
-        byte_reverse(ctx->in, 16);
-
-        md5_transform(ctx->buf, (unsigned int *)ctx->in);
-
-        buf += DXBC_CHECKSUM_BLOCK_SIZE;
-        len -= DXBC_CHECKSUM_BLOCK_SIZE;
-    }
-
-    /* Handle any remaining bytes of data. */
-    memcpy(ctx->in, buf, len);
+    p[0] = value;
+    p[1] = value >> 8;
+    p[2] = value >> 16;
+    p[3] = value >> 24;
 }
 
-static void dxbc_checksum_final(struct md5_ctx *ctx)
+/* Unlike standard MD5, the bit count goes in front of the remaining data,
+ * and the last word of the final block is derived from it as well. */
+static void dxbc_checksum_final(uint32_t buf[4], const unsigned char *tail,
+        unsigned int tail_size, uint32_t bit_count)
 {
-    unsigned int padding;
-    unsigned int length;
-    unsigned int count;
-    unsigned char *p;
-
-    /* Compute number of bytes mod 64 */
-    count = (ctx->i[0] >> 3) & 0x3F;
+    unsigned char block[DXBC_CHECKSUM_BLOCK_SIZE];
 
-    /* Set the first char of padding to 0x80.  This is safe since there is
-       always at least one byte free */
-    p = ctx->in + count;
-    *p++ = 0x80;
-    ++count;
-
-    /* Bytes of padding needed to make 64 bytes */
-    padding = DXBC_CHECKSUM_BLOCK_SIZE - count;
-
-    /* Pad out to 56 mod 64 */
-    if (padding < 8)
+    if (tail_size >= 56)
     {
-        /* Two lots of padding:  Pad the first block to 64 bytes */
-        memset(p, 0, padding);
-        byte_reverse(ctx->in, 16);
-        md5_transform(ctx->buf, (unsigned int *)ctx->in);
+        memcpy(block, tail, tail_size);
+        block[tail_size] = 0x80;
+        memset(block + tail_size + 1, 0, DXBC_CHECKSUM_BLOCK_SIZE - tail_size - 1);
+        md5_transform(buf, block);
 
-        /* Now fill the next block */
-        memset(ctx->in, 0, DXBC_CHECKSUM_BLOCK_SIZE);
+        memset(block, 0, DXBC_CHECKSUM_BLOCK_SIZE);
     }
     else
     {
-        /* Make place for bitcount at the beginning of the block */
-        memmove(&ctx->in[4], ctx->in, count);
-
-        /* Pad block to 60 bytes */
-        memset(p + 4, 0, padding - 4);
+        memcpy(block + 4, tail, tail_size);
+        block[tail_size + 4] = 0x80;
+        memset(block + tail_size + 5, 0, DXBC_CHECKSUM_BLOCK_SIZE - tail_size - 5);
     }
 
-    /* Append length in bits and transform */
-    length = ctx->i[0];
-    memcpy(&ctx->in[0], &length, sizeof(length));
-    byte_reverse(&ctx->in[4], 14);
-    length = ctx->i[0] >> 2 | 0x1;
-    memcpy(&ctx->in[DXBC_CHECKSUM_BLOCK_SIZE - 4], &length, sizeof(length));
-
-    md5_transform(ctx->buf, (unsigned int *)ctx->in);
-    byte_reverse((unsigned char *)ctx->buf, 4);
-    memcpy(ctx->digest, ctx->buf, 16);
+    dxbc_checksum_write_u32(block, bit_count);
+    dxbc_checksum_write_u32(block + DXBC_CHECKSUM_BLOCK_SIZE - 4, bit_count >> 2 | 0x1);
+    md5_transform(buf, block);
 }
 
 #define DXBC_CHECKSUM_SKIP_BYTE_COUNT 20
 
 void vkd3d_compute_dxbc_checksum(const void *dxbc, size_t size, uint32_t checksum[4])
 {
-    const uint8_t *ptr = dxbc;
-    struct md5_ctx ctx;
+    uint32_t buf[4] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476};
+    const unsigned char *ptr = dxbc;
+    uint32_t bit_count;
 
     assert(size > DXBC_CHECKSUM_SKIP_BYTE_COUNT);
     ptr += DXBC_CHECKSUM_SKIP_BYTE_COUNT;
     size -= DXBC_CHECKSUM_SKIP_BYTE_COUNT;
+    bit_count = size << 3;
+
+    for (; size >= DXBC_CHECKSUM_BLOCK_SIZE; size -= DXBC_CHECKSUM_BLOCK_SIZE, ptr += DXBC_CHECKSUM_BLOCK_SIZE)
+        md5_transform(buf, ptr);
 
-    md5_init(&ctx);
-    md5_update(&ctx, ptr, size);
-    dxbc_checksum_final(&ctx);
+    dxbc_checksum_final(buf, ptr, size, bit_count);
 
-    memcpy(checksum, ctx.digest, sizeof(ctx.digest));
+    memcpy(checksum, buf, sizeof(buf));
 }
@@ -0,0 +1,377 @@
+/*
+ * Copyright 2020 VKD3D contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "vkd3d_shader_private.h"
+#include "vkd3d_threads.h"
+#include "rbtree.h"
+
+#include <stdio.h>
+
+/* Shaders are dumped to VKD3D_SHADER_DUMP_PATH by a background thread, so
+ * that compiling threads do not wait for the disk. Files are named after the
+ * hash of their contents, which keeps names stable across runs, and files
+ * which already exist are not written again. SPIR-V files also carry the hash
+ * of the DXBC they were compiled from. When the queue is full, compiling
+ * threads wait for the writer rather than dropping dumps. */
+
+#define VKD3D_SHADER_DUMP_QUEUE_SIZE 64
+
+enum vkd3d_shader_dumper_state
+{
+    VKD3D_SHADER_DUMPER_UNINITIALIZED,
+    VKD3D_SHADER_DUMPER_DISABLED,
+    VKD3D_SHADER_DUMPER_ENABLED,
+};
+
+struct vkd3d_shader_dump_key
+{
+    uint64_t dxbc_hash;
+    uint64_t spirv_hash;
+};
+
+struct vkd3d_shader_dump_entry
+{
+    struct rb_entry entry;
+    struct vkd3d_shader_dump_key key;
+};
+
+struct vkd3d_shader_dump_request
+{
+    enum vkd3d_shader_type type;
+    struct vkd3d_shader_dump_key key;
+    bool spirv;
+    void *data;
+    size_t size;
+};
+
+struct vkd3d_shader_dumper
+{
+    char *path;
+
+    pthread_mutex_t mutex;
+    /* Signaled when requests are queued, and on shutdown. */
+    pthread_cond_t queue_cond;
+    /* Signaled when requests are dequeued or written. */
+    pthread_cond_t space_cond;
+    pthread_t thread;
+    bool thread_running;
+    bool shutdown;
+
+    struct vkd3d_shader_dump_request queue[VKD3D_SHADER_DUMP_QUEUE_SIZE];
+    unsigned int queue_head;
+    unsigned int queue_count;
+    unsigned int busy_count;
+
+    /* Everything queued by this process. Lives until the process exits. */
+    struct rb_tree dumped;
+};
+
+static struct vkd3d_shader_dumper vkd3d_shader_dumper;
+static spinlock_t vkd3d_shader_dumper_lock;
+static uint32_t vkd3d_shader_dumper_state;
+
+static int vkd3d_shader_dump_compare_key(const void *key, const struct rb_entry *entry)
+{
+    const struct vkd3d_shader_dump_entry *e = RB_ENTRY_VALUE(entry, const struct vkd3d_shader_dump_entry, entry);
+    const struct vkd3d_shader_dump_key *k = key;
+
+    if (k->dxbc_hash != e->key.dxbc_hash)
+        return k->dxbc_hash < e->key.dxbc_hash ? -1 : 1;
+    if (k->spirv_hash != e->key.spirv_hash)
+        return k->spirv_hash < e->key.spirv_hash ? -1 : 1;
+    return 0;
+}
+
+static void vkd3d_shader_dump_write(const char *path, const struct vkd3d_shader_dump_request *request)
+{
+    const char *prefix = shader_get_type_prefix(request->type);
+    char filename[1024], tmp_filename[1024 + 32];
+    bool ret;
+    FILE *f;
+
+    if (request->spirv)
+        snprintf(filename, ARRAY_SIZE(filename), "%s/vkd3d-shader-%s-%016"PRIx64"-%016"PRIx64".spv",
+                path, prefix, request->key.dxbc_hash, request->key.spirv_hash);
+    else
+        snprintf(filename, ARRAY_SIZE(filename), "%s/vkd3d-shader-%s-%016"PRIx64".dxbc",
+                path, prefix, request->key.dxbc_hash);
+
+    /* Dumped by an earlier run, or by another process. */
+    if ((f = fopen(filename, "rb")))
+    {
+        fclose(f);
+        return;
+    }
+
+    /* Written under a temporary name, so that other processes never see
+     * partial files. */
+    snprintf(tmp_filename, ARRAY_SIZE(tmp_filename), "%s.%016"PRIx64".tmp",
+            filename, vkd3d_get_current_time_ns());
+    if (!(f = fopen(tmp_filename, "wb")))
+    {
+        ERR("Failed to open %s for dumping shader.\n", tmp_filename);
+        return;
+    }
+
+    ret = fwrite(request->data, 1, request->size, f) == request->size;
+    if (fclose(f))
+        ret = false;
+
+    if (!ret)
+        ERR("Failed to write shader to %s.\n", tmp_filename);
+    /* Renaming fails on Windows if another process won the race. */
+    if (!ret || rename(tmp_filename, filename))
+        remove(tmp_filename);
+}
+
+static bool vkd3d_shader_dumper_dequeue(struct vkd3d_shader_dumper *dumper,
+        struct vkd3d_shader_dump_request *request)
+{
+    if (!dumper->queue_count)
+        return false;
+
+    *request = dumper->queue[dumper->queue_head];
+    dumper->queue_head = (dumper->queue_head + 1) % VKD3D_SHADER_DUMP_QUEUE_SIZE;
+    --dumper->queue_count;
+    ++dumper->busy_count;
+    pthread_cond_signal(&dumper->space_cond);
+    return true;
+}
+
+static void vkd3d_shader_dumper_write_request(struct vkd3d_shader_dumper *dumper,
+        struct vkd3d_shader_dump_request *request)
+{
+    pthread_mutex_unlock(&dumper->mutex);
+    vkd3d_shader_dump_write(dumper->path, request);
+    vkd3d_free(request->data);
+    pthread_mutex_lock(&dumper->mutex);
+
+    --dumper->busy_count;
+    pthread_cond_broadcast(&dumper->space_cond);
+}
+
+static void *vkd3d_shader_dumper_main(void *arg)
+{
+    struct vkd3d_shader_dumper *dumper = arg;
+    struct vkd3d_shader_dump_request request;
+
+    vkd3d_set_thread_name("vkd3d_shader_dump");
+
+    pthread_mutex_lock(&dumper->mutex);
+    for (;;)
+    {
+        while (!dumper->queue_count && !dumper->shutdown)
+            pthread_cond_wait(&dumper->queue_cond, &dumper->mutex);
+
+        if (!vkd3d_shader_dumper_dequeue(dumper, &request))
+            break;
+
+        vkd3d_shader_dumper_write_request(dumper, &request);
+    }
+
+    dumper->thread_running = false;
+    pthread_cond_broadcast(&dumper->space_cond);
+    pthread_mutex_unlock(&dumper->mutex);
+
+    return NULL;
+}
+
+/* Writes out whatever is still queued at exit. */
+static void vkd3d_shader_dumper_flush(void)
+{
+    struct vkd3d_shader_dumper *dumper = &vkd3d_shader_dumper;
+    struct vkd3d_shader_dump_request request;
+
+    pthread_mutex_lock(&dumper->mutex);
+    dumper->shutdown = true;
+    pthread_cond_broadcast(&dumper->queue_cond);
+    pthread_cond_broadcast(&dumper->space_cond);
+
+    while (vkd3d_shader_dumper_dequeue(dumper, &request))
+        vkd3d_shader_dumper_write_request(dumper, &request);
+
+    /* The writer may have been terminated in the middle of a write. */
+    while (dumper->busy_count)
+    {
+        if (vkd3d_cond_wait_timeout(&dumper->space_cond, &dumper->mutex, 1000))
+        {
+            WARN("Timed out waiting for shader dumps to be written.\n");
+            break;
+        }
+    }
+
+#ifdef _WIN32
+    /* Exit handlers of a DLL run after other threads have been terminated. */
+    pthread_mutex_unlock(&dumper->mutex);
+#else
+    while (dumper->thread_running)
+        pthread_cond_wait(&dumper->space_cond, &dumper->mutex);
+    pthread_mutex_unlock(&dumper->mutex);
+
+    pthread_join(dumper->thread, NULL);
+#endif
+}
+
+static bool vkd3d_shader_dumper_init(struct vkd3d_shader_dumper *dumper)
+{
+    const char *path;
+    size_t length;
+    int rc;
+
+    if (!(path = getenv("VKD3D_SHADER_DUMP_PATH")) || !*path)
+        return false;
+
+    length = strlen(path) + 1;
+    if (!(dumper->path = vkd3d_malloc(length)))
+        return false;
+    memcpy(dumper->path, path, length);
+
+    rb_init(&dumper->dumped, vkd3d_shader_dump_compare_key);
+
+    if ((rc = pthread_mutex_init(&dumper->mutex, NULL)))
+    {
+        ERR("Failed to initialize mutex, error %d.\n", rc);
+        goto fail;
+    }
+    if ((rc = pthread_cond_init(&dumper->queue_cond, NULL)))
+    {
+        ERR("Failed to initialize condition variable, error %d.\n", rc);
+        goto fail_destroy_mutex;
+    }
+    if ((rc = pthread_cond_init(&dumper->space_cond, NULL)))
+    {
+        ERR("Failed to initialize condition variable, error %d.\n", rc);
+        goto fail_destroy_queue_cond;
+    }
+
+    if ((rc = pthread_create(&dumper->thread, NULL, vkd3d_shader_dumper_main, dumper)))
+        WARN("Failed to create shader dump thread, error %d. Dumping synchronously.\n", rc);
+    dumper->thread_running = !rc;
+
+    if (dumper->thread_running && atexit(vkd3d_shader_dumper_flush))
+        WARN("Failed to register exit handler, shaders queued at exit may not be dumped.\n");
+
+    TRACE("Dumping shaders to '%s'.\n", dumper->path);
+    return true;
+
+fail_destroy_queue_cond:
+    pthread_cond_destroy(&dumper->queue_cond);
+fail_destroy_mutex:
+    pthread_mutex_destroy(&dumper->mutex);
+fail:
+    vkd3d_free(dumper->path);
+    dumper->path = NULL;
+    return false;
+}
+
+static struct vkd3d_shader_dumper *vkd3d_shader_get_dumper(void)
+{
+    uint32_t state;
+
+    if ((state = vkd3d_atomic_uint32_load_explicit(&vkd3d_shader_dumper_state,
+            vkd3d_memory_order_acquire)) == VKD3D_SHADER_DUMPER_UNINITIALIZED)
+    {
+        spinlock_acquire(&vkd3d_shader_dumper_lock);
+        if ((state = vkd3d_atomic_uint32_load_explicit(&vkd3d_shader_dumper_state,
+                vkd3d_memory_order_relaxed)) == VKD3D_SHADER_DUMPER_UNINITIALIZED)
+        {
+            state = vkd3d_shader_dumper_init(&vkd3d_shader_dumper)
+                    ? VKD3D_SHADER_DUMPER_ENABLED : VKD3D_SHADER_DUMPER_DISABLED;
+            vkd3d_atomic_uint32_store_explicit(&vkd3d_shader_dumper_state, state, vkd3d_memory_order_release);
+        }
+        spinlock_release(&vkd3d_shader_dumper_lock);
+    }
+
+    return state == VKD3D_SHADER_DUMPER_ENABLED ? &vkd3d_shader_dumper : NULL;
+}
+
+static void vkd3d_shader_dumper_enqueue(struct vkd3d_shader_dumper *dumper, enum vkd3d_shader_type type,
+        const struct vkd3d_shader_dump_key *key, bool spirv, const struct vkd3d_shader_code *code)
+{
+    struct vkd3d_shader_dump_request request;
+    struct vkd3d_shader_dump_entry *entry;
+
+    if (!(entry = vkd3d_malloc(sizeof(*entry))))
+        return;
+    entry->key = *key;
+
+    pthread_mutex_lock(&dumper->mutex);
+    if (rb_put(&dumper->dumped, &entry->key, &entry->entry) == -1)
+    {
+        pthread_mutex_unlock(&dumper->mutex);
+        vkd3d_free(entry);
+        return;
+    }
+    pthread_mutex_unlock(&dumper->mutex);
+
+    request.type = type;
+    request.key = *key;
+    request.spirv = spirv;
+    request.size = code->size;
+    if (!(request.data = vkd3d_malloc(code->size)))
+        return;
+    memcpy(request.data, code->code, code->size);
+
+    pthread_mutex_lock(&dumper->mutex);
+
+    while (dumper->queue_count == VKD3D_SHADER_DUMP_QUEUE_SIZE && !dumper->shutdown)
+        pthread_cond_wait(&dumper->space_cond, &dumper->mutex);
+
+    if (!dumper->thread_running || dumper->shutdown)
+    {
+        pthread_mutex_unlock(&dumper->mutex);
+        vkd3d_shader_dump_write(dumper->path, &request);
+        vkd3d_free(request.data);
+        return;
+    }
+
+    dumper->queue[(dumper->queue_head + dumper->queue_count) % VKD3D_SHADER_DUMP_QUEUE_SIZE] = request;
+    ++dumper->queue_count;
+    pthread_cond_signal(&dumper->queue_cond);
+
+    pthread_mutex_unlock(&dumper->mutex);
+}
+
+uint64_t vkd3d_shader_dump_shader(enum vkd3d_shader_type type, const struct vkd3d_shader_code *shader)
+{
+    struct vkd3d_shader_dumper *dumper;
+    struct vkd3d_shader_dump_key key;
+
+    if (!(dumper = vkd3d_shader_get_dumper()))
+        return 0;
+
+    key.dxbc_hash = vkd3d_shader_hash_data(shader->code, shader->size, 0);
+    key.spirv_hash = 0;
+    vkd3d_shader_dumper_enqueue(dumper, type, &key, false, shader);
+
+    return key.dxbc_hash;
+}
+
+void vkd3d_shader_dump_spirv_shader(enum vkd3d_shader_type type, uint64_t dxbc_hash,
+        const struct vkd3d_shader_code *shader)
+{
+    struct vkd3d_shader_dumper *dumper;
+    struct vkd3d_shader_dump_key key;
+
+    if (!(dumper = vkd3d_shader_get_dumper()))
+        return;
+
+    key.dxbc_hash = dxbc_hash;
+    key.spirv_hash = vkd3d_shader_hash_data(shader->code, shader->size, 0);
+    vkd3d_shader_dumper_enqueue(dumper, type, &key, true, shader);
+}
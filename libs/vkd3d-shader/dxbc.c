@@ -454,11 +454,7 @@ enum vkd3d_sm4_shader_data_type
     VKD3D_SM4_SHADER_DATA_MESSAGE                   = 0x4,
 };
 
-struct vkd3d_shader_src_param_entry
-{
-    struct list entry;
-    struct vkd3d_shader_src_param param;
-};
+#define VKD3D_SM4_PARAM_BLOCK_SIZE 0x10000
 
 struct vkd3d_sm4_data
 {
@@ -469,14 +465,14 @@ struct vkd3d_sm4_data
 
     struct vkd3d_shader_src_param src_param[6];
     struct vkd3d_shader_dst_param dst_param[2];
-    struct list src_free;
-    struct list src;
-    struct vkd3d_shader_immediate_constant_buffer icb;
+
+    /* Parameters of decoded instructions live until the parser is freed, so
+     * that instructions can be decoded once and consumed several times. */
+    struct vkd3d_shader_arena params;
 };
 
 struct vkd3d_sm4_opcode_info
 {
-    enum vkd3d_sm4_opcode opcode;
     enum VKD3D_SHADER_INSTRUCTION_HANDLER handler_idx;
     const char *dst_info;
     const char *src_info;
@@ -574,6 +570,7 @@ static void shader_sm4_read_shader_data(struct vkd3d_shader_instruction *ins,
         DWORD opcode, DWORD opcode_token, const DWORD *tokens, unsigned int token_count,
         struct vkd3d_sm4_data *priv)
 {
+    struct vkd3d_shader_immediate_constant_buffer *icb;
     enum vkd3d_sm4_shader_data_type type;
     unsigned int icb_size;
 
@@ -594,9 +591,16 @@ static void shader_sm4_read_shader_data(struct vkd3d_shader_instruction *ins,
         return;
     }
 
-    priv->icb.vec4_count = icb_size / 4;
-    memcpy(priv->icb.data, tokens, sizeof(*tokens) * icb_size);
-    ins->declaration.icb = &priv->icb;
+    if (!(icb = vkd3d_shader_arena_alloc(&priv->params,
+            offsetof(struct vkd3d_shader_immediate_constant_buffer, data[icb_size]))))
+    {
+        ERR("Failed to allocate immediate constant buffer.\n");
+        ins->handler_idx = VKD3DSIH_INVALID;
+        return;
+    }
+    icb->vec4_count = icb_size / 4;
+    memcpy(icb->data, tokens, sizeof(*tokens) * icb_size);
+    ins->declaration.icb = icb;
 }
 
 static void shader_sm4_read_dcl_resource(struct vkd3d_shader_instruction *ins,
@@ -986,254 +990,255 @@ static void shader_sm5_read_sync(struct vkd3d_shader_instruction *ins,
  * S -> VKD3D_DATA_SAMPLER
  * U -> VKD3D_DATA_UAV
  */
-static const struct vkd3d_sm4_opcode_info opcode_table[] =
+/* Indexed by opcode. Unused opcodes have no operand descriptions. */
+static const struct vkd3d_sm4_opcode_info opcode_table[VKD3D_SM4_OPCODE_MASK + 1] =
 {
-    {VKD3D_SM4_OP_ADD,                              VKD3DSIH_ADD,                              "f",    "ff"},
-    {VKD3D_SM4_OP_AND,                              VKD3DSIH_AND,                              "u",    "uu"},
-    {VKD3D_SM4_OP_BREAK,                            VKD3DSIH_BREAK,                            "",     ""},
-    {VKD3D_SM4_OP_BREAKC,                           VKD3DSIH_BREAKP,                           "",     "u",
+    [VKD3D_SM4_OP_ADD] = {                              VKD3DSIH_ADD,                              "f",    "ff"},
+    [VKD3D_SM4_OP_AND] = {                              VKD3DSIH_AND,                              "u",    "uu"},
+    [VKD3D_SM4_OP_BREAK] = {                            VKD3DSIH_BREAK,                            "",     ""},
+    [VKD3D_SM4_OP_BREAKC] = {                           VKD3DSIH_BREAKP,                           "",     "u",
             shader_sm4_read_conditional_op},
-    {VKD3D_SM4_OP_CASE,                             VKD3DSIH_CASE,                             "",     "u"},
-    {VKD3D_SM4_OP_CONTINUE,                         VKD3DSIH_CONTINUE,                         "",     ""},
-    {VKD3D_SM4_OP_CONTINUEC,                        VKD3DSIH_CONTINUEP,                        "",     "u",
+    [VKD3D_SM4_OP_CASE] = {                             VKD3DSIH_CASE,                             "",     "u"},
+    [VKD3D_SM4_OP_CONTINUE] = {                         VKD3DSIH_CONTINUE,                         "",     ""},
+    [VKD3D_SM4_OP_CONTINUEC] = {                        VKD3DSIH_CONTINUEP,                        "",     "u",
             shader_sm4_read_conditional_op},
-    {VKD3D_SM4_OP_CUT,                              VKD3DSIH_CUT,                              "",     ""},
-    {VKD3D_SM4_OP_DEFAULT,                          VKD3DSIH_DEFAULT,                          "",     ""},
-    {VKD3D_SM4_OP_DERIV_RTX,                        VKD3DSIH_DSX,                              "f",    "f"},
-    {VKD3D_SM4_OP_DERIV_RTY,                        VKD3DSIH_DSY,                              "f",    "f"},
-    {VKD3D_SM4_OP_DISCARD,                          VKD3DSIH_TEXKILL,                          "",     "u",
+    [VKD3D_SM4_OP_CUT] = {                              VKD3DSIH_CUT,                              "",     ""},
+    [VKD3D_SM4_OP_DEFAULT] = {                          VKD3DSIH_DEFAULT,                          "",     ""},
+    [VKD3D_SM4_OP_DERIV_RTX] = {                        VKD3DSIH_DSX,                              "f",    "f"},
+    [VKD3D_SM4_OP_DERIV_RTY] = {                        VKD3DSIH_DSY,                              "f",    "f"},
+    [VKD3D_SM4_OP_DISCARD] = {                          VKD3DSIH_TEXKILL,                          "",     "u",
             shader_sm4_read_conditional_op},
-    {VKD3D_SM4_OP_DIV,                              VKD3DSIH_DIV,                              "f",    "ff"},
-    {VKD3D_SM4_OP_DP2,                              VKD3DSIH_DP2,                              "f",    "ff"},
-    {VKD3D_SM4_OP_DP3,                              VKD3DSIH_DP3,                              "f",    "ff"},
-    {VKD3D_SM4_OP_DP4,                              VKD3DSIH_DP4,                              "f",    "ff"},
-    {VKD3D_SM4_OP_ELSE,                             VKD3DSIH_ELSE,                             "",     ""},
-    {VKD3D_SM4_OP_EMIT,                             VKD3DSIH_EMIT,                             "",     ""},
-    {VKD3D_SM4_OP_ENDIF,                            VKD3DSIH_ENDIF,                            "",     ""},
-    {VKD3D_SM4_OP_ENDLOOP,                          VKD3DSIH_ENDLOOP,                          "",     ""},
-    {VKD3D_SM4_OP_ENDSWITCH,                        VKD3DSIH_ENDSWITCH,                        "",     ""},
-    {VKD3D_SM4_OP_EQ,                               VKD3DSIH_EQ,                               "u",    "ff"},
-    {VKD3D_SM4_OP_EXP,                              VKD3DSIH_EXP,                              "f",    "f"},
-    {VKD3D_SM4_OP_FRC,                              VKD3DSIH_FRC,                              "f",    "f"},
-    {VKD3D_SM4_OP_FTOI,                             VKD3DSIH_FTOI,                             "i",    "f"},
-    {VKD3D_SM4_OP_FTOU,                             VKD3DSIH_FTOU,                             "u",    "f"},
-    {VKD3D_SM4_OP_GE,                               VKD3DSIH_GE,                               "u",    "ff"},
-    {VKD3D_SM4_OP_IADD,                             VKD3DSIH_IADD,                             "i",    "ii"},
-    {VKD3D_SM4_OP_IF,                               VKD3DSIH_IF,                               "",     "u",
+    [VKD3D_SM4_OP_DIV] = {                              VKD3DSIH_DIV,                              "f",    "ff"},
+    [VKD3D_SM4_OP_DP2] = {                              VKD3DSIH_DP2,                              "f",    "ff"},
+    [VKD3D_SM4_OP_DP3] = {                              VKD3DSIH_DP3,                              "f",    "ff"},
+    [VKD3D_SM4_OP_DP4] = {                              VKD3DSIH_DP4,                              "f",    "ff"},
+    [VKD3D_SM4_OP_ELSE] = {                             VKD3DSIH_ELSE,                             "",     ""},
+    [VKD3D_SM4_OP_EMIT] = {                             VKD3DSIH_EMIT,                             "",     ""},
+    [VKD3D_SM4_OP_ENDIF] = {                            VKD3DSIH_ENDIF,                            "",     ""},
+    [VKD3D_SM4_OP_ENDLOOP] = {                          VKD3DSIH_ENDLOOP,                          "",     ""},
+    [VKD3D_SM4_OP_ENDSWITCH] = {                        VKD3DSIH_ENDSWITCH,                        "",     ""},
+    [VKD3D_SM4_OP_EQ] = {                               VKD3DSIH_EQ,                               "u",    "ff"},
+    [VKD3D_SM4_OP_EXP] = {                              VKD3DSIH_EXP,                              "f",    "f"},
+    [VKD3D_SM4_OP_FRC] = {                              VKD3DSIH_FRC,                              "f",    "f"},
+    [VKD3D_SM4_OP_FTOI] = {                             VKD3DSIH_FTOI,                             "i",    "f"},
+    [VKD3D_SM4_OP_FTOU] = {                             VKD3DSIH_FTOU,                             "u",    "f"},
+    [VKD3D_SM4_OP_GE] = {                               VKD3DSIH_GE,                               "u",    "ff"},
+    [VKD3D_SM4_OP_IADD] = {                             VKD3DSIH_IADD,                             "i",    "ii"},
+    [VKD3D_SM4_OP_IF] = {                               VKD3DSIH_IF,                               "",     "u",
             shader_sm4_read_conditional_op},
-    {VKD3D_SM4_OP_IEQ,                              VKD3DSIH_IEQ,                              "u",    "ii"},
-    {VKD3D_SM4_OP_IGE,                              VKD3DSIH_IGE,                              "u",    "ii"},
-    {VKD3D_SM4_OP_ILT,                              VKD3DSIH_ILT,                              "u",    "ii"},
-    {VKD3D_SM4_OP_IMAD,                             VKD3DSIH_IMAD,                             "i",    "iii"},
-    {VKD3D_SM4_OP_IMAX,                             VKD3DSIH_IMAX,                             "i",    "ii"},
-    {VKD3D_SM4_OP_IMIN,                             VKD3DSIH_IMIN,                             "i",    "ii"},
-    {VKD3D_SM4_OP_IMUL,                             VKD3DSIH_IMUL,                             "ii",   "ii"},
-    {VKD3D_SM4_OP_INE,                              VKD3DSIH_INE,                              "u",    "ii"},
-    {VKD3D_SM4_OP_INEG,                             VKD3DSIH_INEG,                             "i",    "i"},
-    {VKD3D_SM4_OP_ISHL,                             VKD3DSIH_ISHL,                             "i",    "ii"},
-    {VKD3D_SM4_OP_ISHR,                             VKD3DSIH_ISHR,                             "i",    "ii"},
-    {VKD3D_SM4_OP_ITOF,                             VKD3DSIH_ITOF,                             "f",    "i"},
-    {VKD3D_SM4_OP_LABEL,                            VKD3DSIH_LABEL,                            "",     "O"},
-    {VKD3D_SM4_OP_LD,                               VKD3DSIH_LD,                               "u",    "iR"},
-    {VKD3D_SM4_OP_LD2DMS,                           VKD3DSIH_LD2DMS,                           "u",    "iRi"},
-    {VKD3D_SM4_OP_LOG,                              VKD3DSIH_LOG,                              "f",    "f"},
-    {VKD3D_SM4_OP_LOOP,                             VKD3DSIH_LOOP,                             "",     ""},
-    {VKD3D_SM4_OP_LT,                               VKD3DSIH_LT,                               "u",    "ff"},
-    {VKD3D_SM4_OP_MAD,                              VKD3DSIH_MAD,                              "f",    "fff"},
-    {VKD3D_SM4_OP_MIN,                              VKD3DSIH_MIN,                              "f",    "ff"},
-    {VKD3D_SM4_OP_MAX,                              VKD3DSIH_MAX,                              "f",    "ff"},
-    {VKD3D_SM4_OP_SHADER_DATA,                      VKD3DSIH_DCL_IMMEDIATE_CONSTANT_BUFFER,    "",     "",
+    [VKD3D_SM4_OP_IEQ] = {                              VKD3DSIH_IEQ,                              "u",    "ii"},
+    [VKD3D_SM4_OP_IGE] = {                              VKD3DSIH_IGE,                              "u",    "ii"},
+    [VKD3D_SM4_OP_ILT] = {                              VKD3DSIH_ILT,                              "u",    "ii"},
+    [VKD3D_SM4_OP_IMAD] = {                             VKD3DSIH_IMAD,                             "i",    "iii"},
+    [VKD3D_SM4_OP_IMAX] = {                             VKD3DSIH_IMAX,                             "i",    "ii"},
+    [VKD3D_SM4_OP_IMIN] = {                             VKD3DSIH_IMIN,                             "i",    "ii"},
+    [VKD3D_SM4_OP_IMUL] = {                             VKD3DSIH_IMUL,                             "ii",   "ii"},
+    [VKD3D_SM4_OP_INE] = {                              VKD3DSIH_INE,                              "u",    "ii"},
+    [VKD3D_SM4_OP_INEG] = {                             VKD3DSIH_INEG,                             "i",    "i"},
+    [VKD3D_SM4_OP_ISHL] = {                             VKD3DSIH_ISHL,                             "i",    "ii"},
+    [VKD3D_SM4_OP_ISHR] = {                             VKD3DSIH_ISHR,                             "i",    "ii"},
+    [VKD3D_SM4_OP_ITOF] = {                             VKD3DSIH_ITOF,                             "f",    "i"},
+    [VKD3D_SM4_OP_LABEL] = {                            VKD3DSIH_LABEL,                            "",     "O"},
+    [VKD3D_SM4_OP_LD] = {                               VKD3DSIH_LD,                               "u",    "iR"},
+    [VKD3D_SM4_OP_LD2DMS] = {                           VKD3DSIH_LD2DMS,                           "u",    "iRi"},
+    [VKD3D_SM4_OP_LOG] = {                              VKD3DSIH_LOG,                              "f",    "f"},
+    [VKD3D_SM4_OP_LOOP] = {                             VKD3DSIH_LOOP,                             "",     ""},
+    [VKD3D_SM4_OP_LT] = {                               VKD3DSIH_LT,                               "u",    "ff"},
+    [VKD3D_SM4_OP_MAD] = {                              VKD3DSIH_MAD,                              "f",    "fff"},
+    [VKD3D_SM4_OP_MIN] = {                              VKD3DSIH_MIN,                              "f",    "ff"},
+    [VKD3D_SM4_OP_MAX] = {                              VKD3DSIH_MAX,                              "f",    "ff"},
+    [VKD3D_SM4_OP_SHADER_DATA] = {                      VKD3DSIH_DCL_IMMEDIATE_CONSTANT_BUFFER,    "",     "",
             shader_sm4_read_shader_data},
-    {VKD3D_SM4_OP_MOV,                              VKD3DSIH_MOV,                              "f",    "f"},
-    {VKD3D_SM4_OP_MOVC,                             VKD3DSIH_MOVC,                             "f",    "uff"},
-    {VKD3D_SM4_OP_MUL,                              VKD3DSIH_MUL,                              "f",    "ff"},
-    {VKD3D_SM4_OP_NE,                               VKD3DSIH_NE,                               "u",    "ff"},
-    {VKD3D_SM4_OP_NOP,                              VKD3DSIH_NOP,                              "",     ""},
-    {VKD3D_SM4_OP_NOT,                              VKD3DSIH_NOT,                              "u",    "u"},
-    {VKD3D_SM4_OP_OR,                               VKD3DSIH_OR,                               "u",    "uu"},
-    {VKD3D_SM4_OP_RESINFO,                          VKD3DSIH_RESINFO,                          "f",    "iR"},
-    {VKD3D_SM4_OP_RET,                              VKD3DSIH_RET,                              "",     ""},
-    {VKD3D_SM4_OP_RETC,                             VKD3DSIH_RETP,                             "",     "u",
+    [VKD3D_SM4_OP_MOV] = {                              VKD3DSIH_MOV,                              "f",    "f"},
+    [VKD3D_SM4_OP_MOVC] = {                             VKD3DSIH_MOVC,                             "f",    "uff"},
+    [VKD3D_SM4_OP_MUL] = {                              VKD3DSIH_MUL,                              "f",    "ff"},
+    [VKD3D_SM4_OP_NE] = {                               VKD3DSIH_NE,                               "u",    "ff"},
+    [VKD3D_SM4_OP_NOP] = {                              VKD3DSIH_NOP,                              "",     ""},
+    [VKD3D_SM4_OP_NOT] = {                              VKD3DSIH_NOT,                              "u",    "u"},
+    [VKD3D_SM4_OP_OR] = {                               VKD3DSIH_OR,                               "u",    "uu"},
+    [VKD3D_SM4_OP_RESINFO] = {                          VKD3DSIH_RESINFO,                          "f",    "iR"},
+    [VKD3D_SM4_OP_RET] = {                              VKD3DSIH_RET,                              "",     ""},
+    [VKD3D_SM4_OP_RETC] = {                             VKD3DSIH_RETP,                             "",     "u",
             shader_sm4_read_conditional_op},
-    {VKD3D_SM4_OP_ROUND_NE,                         VKD3DSIH_ROUND_NE,                         "f",    "f"},
-    {VKD3D_SM4_OP_ROUND_NI,                         VKD3DSIH_ROUND_NI,                         "f",    "f"},
-    {VKD3D_SM4_OP_ROUND_PI,                         VKD3DSIH_ROUND_PI,                         "f",    "f"},
-    {VKD3D_SM4_OP_ROUND_Z,                          VKD3DSIH_ROUND_Z,                          "f",    "f"},
-    {VKD3D_SM4_OP_RSQ,                              VKD3DSIH_RSQ,                              "f",    "f"},
-    {VKD3D_SM4_OP_SAMPLE,                           VKD3DSIH_SAMPLE,                           "u",    "fRS"},
-    {VKD3D_SM4_OP_SAMPLE_C,                         VKD3DSIH_SAMPLE_C,                         "f",    "fRSf"},
-    {VKD3D_SM4_OP_SAMPLE_C_LZ,                      VKD3DSIH_SAMPLE_C_LZ,                      "f",    "fRSf"},
-    {VKD3D_SM4_OP_SAMPLE_LOD,                       VKD3DSIH_SAMPLE_LOD,                       "u",    "fRSf"},
-    {VKD3D_SM4_OP_SAMPLE_GRAD,                      VKD3DSIH_SAMPLE_GRAD,                      "u",    "fRSff"},
-    {VKD3D_SM4_OP_SAMPLE_B,                         VKD3DSIH_SAMPLE_B,                         "u",    "fRSf"},
-    {VKD3D_SM4_OP_SQRT,                             VKD3DSIH_SQRT,                             "f",    "f"},
-    {VKD3D_SM4_OP_SWITCH,                           VKD3DSIH_SWITCH,                           "",     "i"},
-    {VKD3D_SM4_OP_SINCOS,                           VKD3DSIH_SINCOS,                           "ff",   "f"},
-    {VKD3D_SM4_OP_UDIV,                             VKD3DSIH_UDIV,                             "uu",   "uu"},
-    {VKD3D_SM4_OP_ULT,                              VKD3DSIH_ULT,                              "u",    "uu"},
-    {VKD3D_SM4_OP_UGE,                              VKD3DSIH_UGE,                              "u",    "uu"},
-    {VKD3D_SM4_OP_UMUL,                             VKD3DSIH_UMUL,                             "uu",   "uu"},
-    {VKD3D_SM4_OP_UMAX,                             VKD3DSIH_UMAX,                             "u",    "uu"},
-    {VKD3D_SM4_OP_UMIN,                             VKD3DSIH_UMIN,                             "u",    "uu"},
-    {VKD3D_SM4_OP_USHR,                             VKD3DSIH_USHR,                             "u",    "uu"},
-    {VKD3D_SM4_OP_UTOF,                             VKD3DSIH_UTOF,                             "f",    "u"},
-    {VKD3D_SM4_OP_XOR,                              VKD3DSIH_XOR,                              "u",    "uu"},
-    {VKD3D_SM4_OP_DCL_RESOURCE,                     VKD3DSIH_DCL,                              "R",    "",
+    [VKD3D_SM4_OP_ROUND_NE] = {                         VKD3DSIH_ROUND_NE,                         "f",    "f"},
+    [VKD3D_SM4_OP_ROUND_NI] = {                         VKD3DSIH_ROUND_NI,                         "f",    "f"},
+    [VKD3D_SM4_OP_ROUND_PI] = {                         VKD3DSIH_ROUND_PI,                         "f",    "f"},
+    [VKD3D_SM4_OP_ROUND_Z] = {                          VKD3DSIH_ROUND_Z,                          "f",    "f"},
+    [VKD3D_SM4_OP_RSQ] = {                              VKD3DSIH_RSQ,                              "f",    "f"},
+    [VKD3D_SM4_OP_SAMPLE] = {                           VKD3DSIH_SAMPLE,                           "u",    "fRS"},
+    [VKD3D_SM4_OP_SAMPLE_C] = {                         VKD3DSIH_SAMPLE_C,                         "f",    "fRSf"},
+    [VKD3D_SM4_OP_SAMPLE_C_LZ] = {                      VKD3DSIH_SAMPLE_C_LZ,                      "f",    "fRSf"},
+    [VKD3D_SM4_OP_SAMPLE_LOD] = {                       VKD3DSIH_SAMPLE_LOD,                       "u",    "fRSf"},
+    [VKD3D_SM4_OP_SAMPLE_GRAD] = {                      VKD3DSIH_SAMPLE_GRAD,                      "u",    "fRSff"},
+    [VKD3D_SM4_OP_SAMPLE_B] = {                         VKD3DSIH_SAMPLE_B,                         "u",    "fRSf"},
+    [VKD3D_SM4_OP_SQRT] = {                             VKD3DSIH_SQRT,                             "f",    "f"},
+    [VKD3D_SM4_OP_SWITCH] = {                           VKD3DSIH_SWITCH,                           "",     "i"},
+    [VKD3D_SM4_OP_SINCOS] = {                           VKD3DSIH_SINCOS,                           "ff",   "f"},
+    [VKD3D_SM4_OP_UDIV] = {                             VKD3DSIH_UDIV,                             "uu",   "uu"},
+    [VKD3D_SM4_OP_ULT] = {                              VKD3DSIH_ULT,                              "u",    "uu"},
+    [VKD3D_SM4_OP_UGE] = {                              VKD3DSIH_UGE,                              "u",    "uu"},
+    [VKD3D_SM4_OP_UMUL] = {                             VKD3DSIH_UMUL,                             "uu",   "uu"},
+    [VKD3D_SM4_OP_UMAX] = {                             VKD3DSIH_UMAX,                             "u",    "uu"},
+    [VKD3D_SM4_OP_UMIN] = {                             VKD3DSIH_UMIN,                             "u",    "uu"},
+    [VKD3D_SM4_OP_USHR] = {                             VKD3DSIH_USHR,                             "u",    "uu"},
+    [VKD3D_SM4_OP_UTOF] = {                             VKD3DSIH_UTOF,                             "f",    "u"},
+    [VKD3D_SM4_OP_XOR] = {                              VKD3DSIH_XOR,                              "u",    "uu"},
+    [VKD3D_SM4_OP_DCL_RESOURCE] = {                     VKD3DSIH_DCL,                              "R",    "",
             shader_sm4_read_dcl_resource},
-    {VKD3D_SM4_OP_DCL_CONSTANT_BUFFER,              VKD3DSIH_DCL_CONSTANT_BUFFER,              "",     "",
+    [VKD3D_SM4_OP_DCL_CONSTANT_BUFFER] = {              VKD3DSIH_DCL_CONSTANT_BUFFER,              "",     "",
             shader_sm4_read_dcl_constant_buffer},
-    {VKD3D_SM4_OP_DCL_SAMPLER,                      VKD3DSIH_DCL_SAMPLER,                      "",     "",
+    [VKD3D_SM4_OP_DCL_SAMPLER] = {                      VKD3DSIH_DCL_SAMPLER,                      "",     "",
             shader_sm4_read_dcl_sampler},
-    {VKD3D_SM4_OP_DCL_INDEX_RANGE,                  VKD3DSIH_DCL_INDEX_RANGE,                  "",     "",
+    [VKD3D_SM4_OP_DCL_INDEX_RANGE] = {                  VKD3DSIH_DCL_INDEX_RANGE,                  "",     "",
             shader_sm4_read_dcl_index_range},
-    {VKD3D_SM4_OP_DCL_OUTPUT_TOPOLOGY,              VKD3DSIH_DCL_OUTPUT_TOPOLOGY,              "",     "",
+    [VKD3D_SM4_OP_DCL_OUTPUT_TOPOLOGY] = {              VKD3DSIH_DCL_OUTPUT_TOPOLOGY,              "",     "",
             shader_sm4_read_dcl_output_topology},
-    {VKD3D_SM4_OP_DCL_INPUT_PRIMITIVE,              VKD3DSIH_DCL_INPUT_PRIMITIVE,              "",     "",
+    [VKD3D_SM4_OP_DCL_INPUT_PRIMITIVE] = {              VKD3DSIH_DCL_INPUT_PRIMITIVE,              "",     "",
             shader_sm4_read_dcl_input_primitive},
-    {VKD3D_SM4_OP_DCL_VERTICES_OUT,                 VKD3DSIH_DCL_VERTICES_OUT,                 "",     "",
+    [VKD3D_SM4_OP_DCL_VERTICES_OUT] = {                 VKD3DSIH_DCL_VERTICES_OUT,                 "",     "",
             shader_sm4_read_declaration_count},
-    {VKD3D_SM4_OP_DCL_INPUT,                        VKD3DSIH_DCL_INPUT,                        "",     "",
+    [VKD3D_SM4_OP_DCL_INPUT] = {                        VKD3DSIH_DCL_INPUT,                        "",     "",
             shader_sm4_read_declaration_dst},
-    {VKD3D_SM4_OP_DCL_INPUT_SGV,                    VKD3DSIH_DCL_INPUT_SGV,                    "",     "",
+    [VKD3D_SM4_OP_DCL_INPUT_SGV] = {                    VKD3DSIH_DCL_INPUT_SGV,                    "",     "",
             shader_sm4_read_declaration_register_semantic},
-    {VKD3D_SM4_OP_DCL_INPUT_SIV,                    VKD3DSIH_DCL_INPUT_SIV,                    "",     "",
+    [VKD3D_SM4_OP_DCL_INPUT_SIV] = {                    VKD3DSIH_DCL_INPUT_SIV,                    "",     "",
             shader_sm4_read_declaration_register_semantic},
-    {VKD3D_SM4_OP_DCL_INPUT_PS,                     VKD3DSIH_DCL_INPUT_PS,                     "",     "",
+    [VKD3D_SM4_OP_DCL_INPUT_PS] = {                     VKD3DSIH_DCL_INPUT_PS,                     "",     "",
             shader_sm4_read_dcl_input_ps},
-    {VKD3D_SM4_OP_DCL_INPUT_PS_SGV,                 VKD3DSIH_DCL_INPUT_PS_SGV,                 "",     "",
+    [VKD3D_SM4_OP_DCL_INPUT_PS_SGV] = {                 VKD3DSIH_DCL_INPUT_PS_SGV,                 "",     "",
             shader_sm4_read_declaration_register_semantic},
-    {VKD3D_SM4_OP_DCL_INPUT_PS_SIV,                 VKD3DSIH_DCL_INPUT_PS_SIV,                 "",     "",
+    [VKD3D_SM4_OP_DCL_INPUT_PS_SIV] = {                 VKD3DSIH_DCL_INPUT_PS_SIV,                 "",     "",
             shader_sm4_read_dcl_input_ps_siv},
-    {VKD3D_SM4_OP_DCL_OUTPUT,                       VKD3DSIH_DCL_OUTPUT,                       "",     "",
+    [VKD3D_SM4_OP_DCL_OUTPUT] = {                       VKD3DSIH_DCL_OUTPUT,                       "",     "",
             shader_sm4_read_declaration_dst},
-    {VKD3D_SM4_OP_DCL_OUTPUT_SIV,                   VKD3DSIH_DCL_OUTPUT_SIV,                   "",     "",
+    [VKD3D_SM4_OP_DCL_OUTPUT_SIV] = {                   VKD3DSIH_DCL_OUTPUT_SIV,                   "",     "",
             shader_sm4_read_declaration_register_semantic},
-    {VKD3D_SM4_OP_DCL_TEMPS,                        VKD3DSIH_DCL_TEMPS,                        "",     "",
+    [VKD3D_SM4_OP_DCL_TEMPS] = {                        VKD3DSIH_DCL_TEMPS,                        "",     "",
             shader_sm4_read_declaration_count},
-    {VKD3D_SM4_OP_DCL_INDEXABLE_TEMP,               VKD3DSIH_DCL_INDEXABLE_TEMP,               "",     "",
+    [VKD3D_SM4_OP_DCL_INDEXABLE_TEMP] = {               VKD3DSIH_DCL_INDEXABLE_TEMP,               "",     "",
             shader_sm4_read_dcl_indexable_temp},
-    {VKD3D_SM4_OP_DCL_GLOBAL_FLAGS,                 VKD3DSIH_DCL_GLOBAL_FLAGS,                 "",     "",
+    [VKD3D_SM4_OP_DCL_GLOBAL_FLAGS] = {                 VKD3DSIH_DCL_GLOBAL_FLAGS,                 "",     "",
             shader_sm4_read_dcl_global_flags},
-    {VKD3D_SM4_OP_LOD,                              VKD3DSIH_LOD,                              "f",    "fRS"},
-    {VKD3D_SM4_OP_GATHER4,                          VKD3DSIH_GATHER4,                          "u",    "fRS"},
-    {VKD3D_SM4_OP_SAMPLE_POS,                       VKD3DSIH_SAMPLE_POS,                       "f",    "Ru"},
-    {VKD3D_SM4_OP_SAMPLE_INFO,                      VKD3DSIH_SAMPLE_INFO,                      "f",    "R"},
-    {VKD3D_SM5_OP_HS_DECLS,                         VKD3DSIH_HS_DECLS,                         "",     ""},
-    {VKD3D_SM5_OP_HS_CONTROL_POINT_PHASE,           VKD3DSIH_HS_CONTROL_POINT_PHASE,           "",     ""},
-    {VKD3D_SM5_OP_HS_FORK_PHASE,                    VKD3DSIH_HS_FORK_PHASE,                    "",     ""},
-    {VKD3D_SM5_OP_HS_JOIN_PHASE,                    VKD3DSIH_HS_JOIN_PHASE,                    "",     ""},
-    {VKD3D_SM5_OP_EMIT_STREAM,                      VKD3DSIH_EMIT_STREAM,                      "",     "f"},
-    {VKD3D_SM5_OP_CUT_STREAM,                       VKD3DSIH_CUT_STREAM,                       "",     "f"},
-    {VKD3D_SM5_OP_FCALL,                            VKD3DSIH_FCALL,                            "",     "O",
+    [VKD3D_SM4_OP_LOD] = {                              VKD3DSIH_LOD,                              "f",    "fRS"},
+    [VKD3D_SM4_OP_GATHER4] = {                          VKD3DSIH_GATHER4,                          "u",    "fRS"},
+    [VKD3D_SM4_OP_SAMPLE_POS] = {                       VKD3DSIH_SAMPLE_POS,                       "f",    "Ru"},
+    [VKD3D_SM4_OP_SAMPLE_INFO] = {                      VKD3DSIH_SAMPLE_INFO,                      "f",    "R"},
+    [VKD3D_SM5_OP_HS_DECLS] = {                         VKD3DSIH_HS_DECLS,                         "",     ""},
+    [VKD3D_SM5_OP_HS_CONTROL_POINT_PHASE] = {           VKD3DSIH_HS_CONTROL_POINT_PHASE,           "",     ""},
+    [VKD3D_SM5_OP_HS_FORK_PHASE] = {                    VKD3DSIH_HS_FORK_PHASE,                    "",     ""},
+    [VKD3D_SM5_OP_HS_JOIN_PHASE] = {                    VKD3DSIH_HS_JOIN_PHASE,                    "",     ""},
+    [VKD3D_SM5_OP_EMIT_STREAM] = {                      VKD3DSIH_EMIT_STREAM,                      "",     "f"},
+    [VKD3D_SM5_OP_CUT_STREAM] = {                       VKD3DSIH_CUT_STREAM,                       "",     "f"},
+    [VKD3D_SM5_OP_FCALL] = {                            VKD3DSIH_FCALL,                            "",     "O",
             shader_sm5_read_fcall},
-    {VKD3D_SM5_OP_BUFINFO,                          VKD3DSIH_BUFINFO,                          "i",    "U"},
-    {VKD3D_SM5_OP_DERIV_RTX_COARSE,                 VKD3DSIH_DSX_COARSE,                       "f",    "f"},
-    {VKD3D_SM5_OP_DERIV_RTX_FINE,                   VKD3DSIH_DSX_FINE,                         "f",    "f"},
-    {VKD3D_SM5_OP_DERIV_RTY_COARSE,                 VKD3DSIH_DSY_COARSE,                       "f",    "f"},
-    {VKD3D_SM5_OP_DERIV_RTY_FINE,                   VKD3DSIH_DSY_FINE,                         "f",    "f"},
-    {VKD3D_SM5_OP_GATHER4_C,                        VKD3DSIH_GATHER4_C,                        "f",    "fRSf"},
-    {VKD3D_SM5_OP_GATHER4_PO,                       VKD3DSIH_GATHER4_PO,                       "f",    "fiRS"},
-    {VKD3D_SM5_OP_GATHER4_PO_C,                     VKD3DSIH_GATHER4_PO_C,                     "f",    "fiRSf"},
-    {VKD3D_SM5_OP_RCP,                              VKD3DSIH_RCP,                              "f",    "f"},
-    {VKD3D_SM5_OP_F32TOF16,                         VKD3DSIH_F32TOF16,                         "u",    "f"},
-    {VKD3D_SM5_OP_F16TOF32,                         VKD3DSIH_F16TOF32,                         "f",    "u"},
-    {VKD3D_SM5_OP_COUNTBITS,                        VKD3DSIH_COUNTBITS,                        "u",    "u"},
-    {VKD3D_SM5_OP_FIRSTBIT_HI,                      VKD3DSIH_FIRSTBIT_HI,                      "u",    "u"},
-    {VKD3D_SM5_OP_FIRSTBIT_LO,                      VKD3DSIH_FIRSTBIT_LO,                      "u",    "u"},
-    {VKD3D_SM5_OP_FIRSTBIT_SHI,                     VKD3DSIH_FIRSTBIT_SHI,                     "u",    "i"},
-    {VKD3D_SM5_OP_UBFE,                             VKD3DSIH_UBFE,                             "u",    "iiu"},
-    {VKD3D_SM5_OP_IBFE,                             VKD3DSIH_IBFE,                             "i",    "iii"},
-    {VKD3D_SM5_OP_BFI,                              VKD3DSIH_BFI,                              "u",    "iiuu"},
-    {VKD3D_SM5_OP_BFREV,                            VKD3DSIH_BFREV,                            "u",    "u"},
-    {VKD3D_SM5_OP_SWAPC,                            VKD3DSIH_SWAPC,                            "ff",   "uff"},
-    {VKD3D_SM5_OP_DCL_STREAM,                       VKD3DSIH_DCL_STREAM,                       "",     "O"},
-    {VKD3D_SM5_OP_DCL_FUNCTION_BODY,                VKD3DSIH_DCL_FUNCTION_BODY,                "",     "",
+    [VKD3D_SM5_OP_BUFINFO] = {                          VKD3DSIH_BUFINFO,                          "i",    "U"},
+    [VKD3D_SM5_OP_DERIV_RTX_COARSE] = {                 VKD3DSIH_DSX_COARSE,                       "f",    "f"},
+    [VKD3D_SM5_OP_DERIV_RTX_FINE] = {                   VKD3DSIH_DSX_FINE,                         "f",    "f"},
+    [VKD3D_SM5_OP_DERIV_RTY_COARSE] = {                 VKD3DSIH_DSY_COARSE,                       "f",    "f"},
+    [VKD3D_SM5_OP_DERIV_RTY_FINE] = {                   VKD3DSIH_DSY_FINE,                         "f",    "f"},
+    [VKD3D_SM5_OP_GATHER4_C] = {                        VKD3DSIH_GATHER4_C,                        "f",    "fRSf"},
+    [VKD3D_SM5_OP_GATHER4_PO] = {                       VKD3DSIH_GATHER4_PO,                       "f",    "fiRS"},
+    [VKD3D_SM5_OP_GATHER4_PO_C] = {                     VKD3DSIH_GATHER4_PO_C,                     "f",    "fiRSf"},
+    [VKD3D_SM5_OP_RCP] = {                              VKD3DSIH_RCP,                              "f",    "f"},
+    [VKD3D_SM5_OP_F32TOF16] = {                         VKD3DSIH_F32TOF16,                         "u",    "f"},
+    [VKD3D_SM5_OP_F16TOF32] = {                         VKD3DSIH_F16TOF32,                         "f",    "u"},
+    [VKD3D_SM5_OP_COUNTBITS] = {                        VKD3DSIH_COUNTBITS,                        "u",    "u"},
+    [VKD3D_SM5_OP_FIRSTBIT_HI] = {                      VKD3DSIH_FIRSTBIT_HI,                      "u",    "u"},
+    [VKD3D_SM5_OP_FIRSTBIT_LO] = {                      VKD3DSIH_FIRSTBIT_LO,                      "u",    "u"},
+    [VKD3D_SM5_OP_FIRSTBIT_SHI] = {                     VKD3DSIH_FIRSTBIT_SHI,                     "u",    "i"},
+    [VKD3D_SM5_OP_UBFE] = {                             VKD3DSIH_UBFE,                             "u",    "iiu"},
+    [VKD3D_SM5_OP_IBFE] = {                             VKD3DSIH_IBFE,                             "i",    "iii"},
+    [VKD3D_SM5_OP_BFI] = {                              VKD3DSIH_BFI,                              "u",    "iiuu"},
+    [VKD3D_SM5_OP_BFREV] = {                            VKD3DSIH_BFREV,                            "u",    "u"},
+    [VKD3D_SM5_OP_SWAPC] = {                            VKD3DSIH_SWAPC,                            "ff",   "uff"},
+    [VKD3D_SM5_OP_DCL_STREAM] = {                       VKD3DSIH_DCL_STREAM,                       "",     "O"},
+    [VKD3D_SM5_OP_DCL_FUNCTION_BODY] = {                VKD3DSIH_DCL_FUNCTION_BODY,                "",     "",
             shader_sm5_read_dcl_function_body},
-    {VKD3D_SM5_OP_DCL_FUNCTION_TABLE,               VKD3DSIH_DCL_FUNCTION_TABLE,               "",     "",
+    [VKD3D_SM5_OP_DCL_FUNCTION_TABLE] = {               VKD3DSIH_DCL_FUNCTION_TABLE,               "",     "",
             shader_sm5_read_dcl_function_table},
-    {VKD3D_SM5_OP_DCL_INTERFACE,                    VKD3DSIH_DCL_INTERFACE,                    "",     "",
+    [VKD3D_SM5_OP_DCL_INTERFACE] = {                    VKD3DSIH_DCL_INTERFACE,                    "",     "",
             shader_sm5_read_dcl_interface},
-    {VKD3D_SM5_OP_DCL_INPUT_CONTROL_POINT_COUNT,    VKD3DSIH_DCL_INPUT_CONTROL_POINT_COUNT,    "",     "",
+    [VKD3D_SM5_OP_DCL_INPUT_CONTROL_POINT_COUNT] = {    VKD3DSIH_DCL_INPUT_CONTROL_POINT_COUNT,    "",     "",
             shader_sm5_read_control_point_count},
-    {VKD3D_SM5_OP_DCL_OUTPUT_CONTROL_POINT_COUNT,   VKD3DSIH_DCL_OUTPUT_CONTROL_POINT_COUNT,   "",     "",
+    [VKD3D_SM5_OP_DCL_OUTPUT_CONTROL_POINT_COUNT] = {   VKD3DSIH_DCL_OUTPUT_CONTROL_POINT_COUNT,   "",     "",
             shader_sm5_read_control_point_count},
-    {VKD3D_SM5_OP_DCL_TESSELLATOR_DOMAIN,           VKD3DSIH_DCL_TESSELLATOR_DOMAIN,           "",     "",
+    [VKD3D_SM5_OP_DCL_TESSELLATOR_DOMAIN] = {           VKD3DSIH_DCL_TESSELLATOR_DOMAIN,           "",     "",
             shader_sm5_read_dcl_tessellator_domain},
-    {VKD3D_SM5_OP_DCL_TESSELLATOR_PARTITIONING,     VKD3DSIH_DCL_TESSELLATOR_PARTITIONING,     "",     "",
+    [VKD3D_SM5_OP_DCL_TESSELLATOR_PARTITIONING] = {     VKD3DSIH_DCL_TESSELLATOR_PARTITIONING,     "",     "",
             shader_sm5_read_dcl_tessellator_partitioning},
-    {VKD3D_SM5_OP_DCL_TESSELLATOR_OUTPUT_PRIMITIVE, VKD3DSIH_DCL_TESSELLATOR_OUTPUT_PRIMITIVE, "",     "",
+    [VKD3D_SM5_OP_DCL_TESSELLATOR_OUTPUT_PRIMITIVE] = { VKD3DSIH_DCL_TESSELLATOR_OUTPUT_PRIMITIVE, "",     "",
             shader_sm5_read_dcl_tessellator_output_primitive},
-    {VKD3D_SM5_OP_DCL_HS_MAX_TESSFACTOR,            VKD3DSIH_DCL_HS_MAX_TESSFACTOR,            "",     "",
+    [VKD3D_SM5_OP_DCL_HS_MAX_TESSFACTOR] = {            VKD3DSIH_DCL_HS_MAX_TESSFACTOR,            "",     "",
             shader_sm5_read_dcl_hs_max_tessfactor},
-    {VKD3D_SM5_OP_DCL_HS_FORK_PHASE_INSTANCE_COUNT, VKD3DSIH_DCL_HS_FORK_PHASE_INSTANCE_COUNT, "",     "",
+    [VKD3D_SM5_OP_DCL_HS_FORK_PHASE_INSTANCE_COUNT] = { VKD3DSIH_DCL_HS_FORK_PHASE_INSTANCE_COUNT, "",     "",
             shader_sm4_read_declaration_count},
-    {VKD3D_SM5_OP_DCL_HS_JOIN_PHASE_INSTANCE_COUNT, VKD3DSIH_DCL_HS_JOIN_PHASE_INSTANCE_COUNT, "",     "",
+    [VKD3D_SM5_OP_DCL_HS_JOIN_PHASE_INSTANCE_COUNT] = { VKD3DSIH_DCL_HS_JOIN_PHASE_INSTANCE_COUNT, "",     "",
             shader_sm4_read_declaration_count},
-    {VKD3D_SM5_OP_DCL_THREAD_GROUP,                 VKD3DSIH_DCL_THREAD_GROUP,                 "",     "",
+    [VKD3D_SM5_OP_DCL_THREAD_GROUP] = {                 VKD3DSIH_DCL_THREAD_GROUP,                 "",     "",
             shader_sm5_read_dcl_thread_group},
-    {VKD3D_SM5_OP_DCL_UAV_TYPED,                    VKD3DSIH_DCL_UAV_TYPED,                    "",     "",
+    [VKD3D_SM5_OP_DCL_UAV_TYPED] = {                    VKD3DSIH_DCL_UAV_TYPED,                    "",     "",
             shader_sm4_read_dcl_resource},
-    {VKD3D_SM5_OP_DCL_UAV_RAW,                      VKD3DSIH_DCL_UAV_RAW,                      "",     "",
+    [VKD3D_SM5_OP_DCL_UAV_RAW] = {                      VKD3DSIH_DCL_UAV_RAW,                      "",     "",
             shader_sm5_read_dcl_uav_raw},
-    {VKD3D_SM5_OP_DCL_UAV_STRUCTURED,               VKD3DSIH_DCL_UAV_STRUCTURED,               "",     "",
+    [VKD3D_SM5_OP_DCL_UAV_STRUCTURED] = {               VKD3DSIH_DCL_UAV_STRUCTURED,               "",     "",
             shader_sm5_read_dcl_uav_structured},
-    {VKD3D_SM5_OP_DCL_TGSM_RAW,                     VKD3DSIH_DCL_TGSM_RAW,                     "",     "",
+    [VKD3D_SM5_OP_DCL_TGSM_RAW] = {                     VKD3DSIH_DCL_TGSM_RAW,                     "",     "",
             shader_sm5_read_dcl_tgsm_raw},
-    {VKD3D_SM5_OP_DCL_TGSM_STRUCTURED,              VKD3DSIH_DCL_TGSM_STRUCTURED,              "",     "",
+    [VKD3D_SM5_OP_DCL_TGSM_STRUCTURED] = {              VKD3DSIH_DCL_TGSM_STRUCTURED,              "",     "",
             shader_sm5_read_dcl_tgsm_structured},
-    {VKD3D_SM5_OP_DCL_RESOURCE_RAW,                 VKD3DSIH_DCL_RESOURCE_RAW,                 "",     "",
+    [VKD3D_SM5_OP_DCL_RESOURCE_RAW] = {                 VKD3DSIH_DCL_RESOURCE_RAW,                 "",     "",
             shader_sm5_read_dcl_resource_raw},
-    {VKD3D_SM5_OP_DCL_RESOURCE_STRUCTURED,          VKD3DSIH_DCL_RESOURCE_STRUCTURED,          "",     "",
+    [VKD3D_SM5_OP_DCL_RESOURCE_STRUCTURED] = {          VKD3DSIH_DCL_RESOURCE_STRUCTURED,          "",     "",
             shader_sm5_read_dcl_resource_structured},
-    {VKD3D_SM5_OP_LD_UAV_TYPED,                     VKD3DSIH_LD_UAV_TYPED,                     "u",    "iU"},
-    {VKD3D_SM5_OP_STORE_UAV_TYPED,                  VKD3DSIH_STORE_UAV_TYPED,                  "U",    "iu"},
-    {VKD3D_SM5_OP_LD_RAW,                           VKD3DSIH_LD_RAW,                           "u",    "iU"},
-    {VKD3D_SM5_OP_STORE_RAW,                        VKD3DSIH_STORE_RAW,                        "U",    "uu"},
-    {VKD3D_SM5_OP_LD_STRUCTURED,                    VKD3DSIH_LD_STRUCTURED,                    "u",    "iiR"},
-    {VKD3D_SM5_OP_STORE_STRUCTURED,                 VKD3DSIH_STORE_STRUCTURED,                 "U",    "iiu"},
-    {VKD3D_SM5_OP_ATOMIC_AND,                       VKD3DSIH_ATOMIC_AND,                       "U",    "iu"},
-    {VKD3D_SM5_OP_ATOMIC_OR,                        VKD3DSIH_ATOMIC_OR,                        "U",    "iu"},
-    {VKD3D_SM5_OP_ATOMIC_XOR,                       VKD3DSIH_ATOMIC_XOR,                       "U",    "iu"},
-    {VKD3D_SM5_OP_ATOMIC_CMP_STORE,                 VKD3DSIH_ATOMIC_CMP_STORE,                 "U",    "iuu"},
-    {VKD3D_SM5_OP_ATOMIC_IADD,                      VKD3DSIH_ATOMIC_IADD,                      "U",    "ii"},
-    {VKD3D_SM5_OP_ATOMIC_IMAX,                      VKD3DSIH_ATOMIC_IMAX,                      "U",    "ii"},
-    {VKD3D_SM5_OP_ATOMIC_IMIN,                      VKD3DSIH_ATOMIC_IMIN,                      "U",    "ii"},
-    {VKD3D_SM5_OP_ATOMIC_UMAX,                      VKD3DSIH_ATOMIC_UMAX,                      "U",    "iu"},
-    {VKD3D_SM5_OP_ATOMIC_UMIN,                      VKD3DSIH_ATOMIC_UMIN,                      "U",    "iu"},
-    {VKD3D_SM5_OP_IMM_ATOMIC_ALLOC,                 VKD3DSIH_IMM_ATOMIC_ALLOC,                 "u",    "U"},
-    {VKD3D_SM5_OP_IMM_ATOMIC_CONSUME,               VKD3DSIH_IMM_ATOMIC_CONSUME,               "u",    "U"},
-    {VKD3D_SM5_OP_IMM_ATOMIC_IADD,                  VKD3DSIH_IMM_ATOMIC_IADD,                  "uU",   "ii"},
-    {VKD3D_SM5_OP_IMM_ATOMIC_AND,                   VKD3DSIH_IMM_ATOMIC_AND,                   "uU",   "iu"},
-    {VKD3D_SM5_OP_IMM_ATOMIC_OR,                    VKD3DSIH_IMM_ATOMIC_OR,                    "uU",   "iu"},
-    {VKD3D_SM5_OP_IMM_ATOMIC_XOR,                   VKD3DSIH_IMM_ATOMIC_XOR,                   "uU",   "iu"},
-    {VKD3D_SM5_OP_IMM_ATOMIC_EXCH,                  VKD3DSIH_IMM_ATOMIC_EXCH,                  "uU",   "iu"},
-    {VKD3D_SM5_OP_IMM_ATOMIC_CMP_EXCH,              VKD3DSIH_IMM_ATOMIC_CMP_EXCH,              "uU",   "iuu"},
-    {VKD3D_SM5_OP_IMM_ATOMIC_IMAX,                  VKD3DSIH_IMM_ATOMIC_IMAX,                  "iU",   "ii"},
-    {VKD3D_SM5_OP_IMM_ATOMIC_IMIN,                  VKD3DSIH_IMM_ATOMIC_IMIN,                  "iU",   "ii"},
-    {VKD3D_SM5_OP_IMM_ATOMIC_UMAX,                  VKD3DSIH_IMM_ATOMIC_UMAX,                  "uU",   "iu"},
-    {VKD3D_SM5_OP_IMM_ATOMIC_UMIN,                  VKD3DSIH_IMM_ATOMIC_UMIN,                  "uU",   "iu"},
-    {VKD3D_SM5_OP_SYNC,                             VKD3DSIH_SYNC,                             "",     "",
+    [VKD3D_SM5_OP_LD_UAV_TYPED] = {                     VKD3DSIH_LD_UAV_TYPED,                     "u",    "iU"},
+    [VKD3D_SM5_OP_STORE_UAV_TYPED] = {                  VKD3DSIH_STORE_UAV_TYPED,                  "U",    "iu"},
+    [VKD3D_SM5_OP_LD_RAW] = {                           VKD3DSIH_LD_RAW,                           "u",    "iU"},
+    [VKD3D_SM5_OP_STORE_RAW] = {                        VKD3DSIH_STORE_RAW,                        "U",    "uu"},
+    [VKD3D_SM5_OP_LD_STRUCTURED] = {                    VKD3DSIH_LD_STRUCTURED,                    "u",    "iiR"},
+    [VKD3D_SM5_OP_STORE_STRUCTURED] = {                 VKD3DSIH_STORE_STRUCTURED,                 "U",    "iiu"},
+    [VKD3D_SM5_OP_ATOMIC_AND] = {                       VKD3DSIH_ATOMIC_AND,                       "U",    "iu"},
+    [VKD3D_SM5_OP_ATOMIC_OR] = {                        VKD3DSIH_ATOMIC_OR,                        "U",    "iu"},
+    [VKD3D_SM5_OP_ATOMIC_XOR] = {                       VKD3DSIH_ATOMIC_XOR,                       "U",    "iu"},
+    [VKD3D_SM5_OP_ATOMIC_CMP_STORE] = {                 VKD3DSIH_ATOMIC_CMP_STORE,                 "U",    "iuu"},
+    [VKD3D_SM5_OP_ATOMIC_IADD] = {                      VKD3DSIH_ATOMIC_IADD,                      "U",    "ii"},
+    [VKD3D_SM5_OP_ATOMIC_IMAX] = {                      VKD3DSIH_ATOMIC_IMAX,                      "U",    "ii"},
+    [VKD3D_SM5_OP_ATOMIC_IMIN] = {                      VKD3DSIH_ATOMIC_IMIN,                      "U",    "ii"},
+    [VKD3D_SM5_OP_ATOMIC_UMAX] = {                      VKD3DSIH_ATOMIC_UMAX,                      "U",    "iu"},
+    [VKD3D_SM5_OP_ATOMIC_UMIN] = {                      VKD3DSIH_ATOMIC_UMIN,                      "U",    "iu"},
+    [VKD3D_SM5_OP_IMM_ATOMIC_ALLOC] = {                 VKD3DSIH_IMM_ATOMIC_ALLOC,                 "u",    "U"},
+    [VKD3D_SM5_OP_IMM_ATOMIC_CONSUME] = {               VKD3DSIH_IMM_ATOMIC_CONSUME,               "u",    "U"},
+    [VKD3D_SM5_OP_IMM_ATOMIC_IADD] = {                  VKD3DSIH_IMM_ATOMIC_IADD,                  "uU",   "ii"},
+    [VKD3D_SM5_OP_IMM_ATOMIC_AND] = {                   VKD3DSIH_IMM_ATOMIC_AND,                   "uU",   "iu"},
+    [VKD3D_SM5_OP_IMM_ATOMIC_OR] = {                    VKD3DSIH_IMM_ATOMIC_OR,                    "uU",   "iu"},
+    [VKD3D_SM5_OP_IMM_ATOMIC_XOR] = {                   VKD3DSIH_IMM_ATOMIC_XOR,                   "uU",   "iu"},
+    [VKD3D_SM5_OP_IMM_ATOMIC_EXCH] = {                  VKD3DSIH_IMM_ATOMIC_EXCH,                  "uU",   "iu"},
+    [VKD3D_SM5_OP_IMM_ATOMIC_CMP_EXCH] = {              VKD3DSIH_IMM_ATOMIC_CMP_EXCH,              "uU",   "iuu"},
+    [VKD3D_SM5_OP_IMM_ATOMIC_IMAX] = {                  VKD3DSIH_IMM_ATOMIC_IMAX,                  "iU",   "ii"},
+    [VKD3D_SM5_OP_IMM_ATOMIC_IMIN] = {                  VKD3DSIH_IMM_ATOMIC_IMIN,                  "iU",   "ii"},
+    [VKD3D_SM5_OP_IMM_ATOMIC_UMAX] = {                  VKD3DSIH_IMM_ATOMIC_UMAX,                  "uU",   "iu"},
+    [VKD3D_SM5_OP_IMM_ATOMIC_UMIN] = {                  VKD3DSIH_IMM_ATOMIC_UMIN,                  "uU",   "iu"},
+    [VKD3D_SM5_OP_SYNC] = {                             VKD3DSIH_SYNC,                             "",     "",
             shader_sm5_read_sync},
-    {VKD3D_SM5_OP_EVAL_SAMPLE_INDEX,                VKD3DSIH_EVAL_SAMPLE_INDEX,                "f",    "fi"},
-    {VKD3D_SM5_OP_EVAL_CENTROID,                    VKD3DSIH_EVAL_CENTROID,                    "f",    "f"},
-    {VKD3D_SM5_OP_DCL_GS_INSTANCES,                 VKD3DSIH_DCL_GS_INSTANCES,                 "",     "",
+    [VKD3D_SM5_OP_EVAL_SAMPLE_INDEX] = {                VKD3DSIH_EVAL_SAMPLE_INDEX,                "f",    "fi"},
+    [VKD3D_SM5_OP_EVAL_CENTROID] = {                    VKD3DSIH_EVAL_CENTROID,                    "f",    "f"},
+    [VKD3D_SM5_OP_DCL_GS_INSTANCES] = {                 VKD3DSIH_DCL_GS_INSTANCES,                 "",     "",
             shader_sm4_read_declaration_count},
-    {VKD3D_SM5_OP_GATHER4_FEEDBACK,                 VKD3DSIH_GATHER4_FEEDBACK,                 "fu",   "fRS"},
-    {VKD3D_SM5_OP_GATHER4_C_FEEDBACK,               VKD3DSIH_GATHER4_C_FEEDBACK,               "fu",   "fRSf"},
-    {VKD3D_SM5_OP_GATHER4_PO_FEEDBACK,              VKD3DSIH_GATHER4_PO_FEEDBACK,              "fu",   "fiRS"},
-    {VKD3D_SM5_OP_GATHER4_PO_C_FEEDBACK,            VKD3DSIH_GATHER4_PO_C_FEEDBACK,            "fu",   "fiRSf"},
-    {VKD3D_SM5_OP_LD_FEEDBACK,                      VKD3DSIH_LD_FEEDBACK,                      "uu",   "iR"},
-    {VKD3D_SM5_OP_LD_MS_FEEDBACK,                   VKD3DSIH_LD2DMS_FEEDBACK,                  "uu",   "iRi"},
-    {VKD3D_SM5_OP_LD_UAV_TYPED_FEEDBACK,            VKD3DSIH_LD_UAV_TYPED_FEEDBACK,            "uu",   "iU"},
-    {VKD3D_SM5_OP_LD_RAW_FEEDBACK,                  VKD3DSIH_LD_RAW_FEEDBACK,                  "uu",   "iR"},
-    {VKD3D_SM5_OP_LD_STRUCTURED_FEEDBACK,           VKD3DSIH_LD_STRUCTURED_FEEDBACK,           "uu",   "iiR"},
-    {VKD3D_SM5_OP_SAMPLE_L_FEEDBACK,                VKD3DSIH_SAMPLE_LOD_FEEDBACK,              "fu",   "fRSf"},
-    {VKD3D_SM5_OP_SAMPLE_C_LZ_FEEDBACK,             VKD3DSIH_SAMPLE_C_LZ_FEEDBACK,             "fu",   "fRSf"},
-    {VKD3D_SM5_OP_SAMPLE_CLAMP_FEEDBACK,            VKD3DSIH_SAMPLE_FEEDBACK,                  "fu",   "fRSf"},
-    {VKD3D_SM5_OP_SAMPLE_B_CLAMP_FEEDBACK,          VKD3DSIH_SAMPLE_B_FEEDBACK,                "fu",   "fRSff"},
-    {VKD3D_SM5_OP_SAMPLE_D_CLAMP_FEEDBACK,          VKD3DSIH_SAMPLE_GRAD_FEEDBACK,             "fu",   "fRSfff"},
-    {VKD3D_SM5_OP_SAMPLE_C_CLAMP_FEEDBACK,          VKD3DSIH_SAMPLE_C_FEEDBACK,                "fu",   "fRSff"},
-    {VKD3D_SM5_OP_CHECK_ACCESS_FULLY_MAPPED,        VKD3DSIH_CHECK_ACCESS_FULLY_MAPPED,        "u",    "u"},
+    [VKD3D_SM5_OP_GATHER4_FEEDBACK] = {                 VKD3DSIH_GATHER4_FEEDBACK,                 "fu",   "fRS"},
+    [VKD3D_SM5_OP_GATHER4_C_FEEDBACK] = {               VKD3DSIH_GATHER4_C_FEEDBACK,               "fu",   "fRSf"},
+    [VKD3D_SM5_OP_GATHER4_PO_FEEDBACK] = {              VKD3DSIH_GATHER4_PO_FEEDBACK,              "fu",   "fiRS"},
+    [VKD3D_SM5_OP_GATHER4_PO_C_FEEDBACK] = {            VKD3DSIH_GATHER4_PO_C_FEEDBACK,            "fu",   "fiRSf"},
+    [VKD3D_SM5_OP_LD_FEEDBACK] = {                      VKD3DSIH_LD_FEEDBACK,                      "uu",   "iR"},
+    [VKD3D_SM5_OP_LD_MS_FEEDBACK] = {                   VKD3DSIH_LD2DMS_FEEDBACK,                  "uu",   "iRi"},
+    [VKD3D_SM5_OP_LD_UAV_TYPED_FEEDBACK] = {            VKD3DSIH_LD_UAV_TYPED_FEEDBACK,            "uu",   "iU"},
+    [VKD3D_SM5_OP_LD_RAW_FEEDBACK] = {                  VKD3DSIH_LD_RAW_FEEDBACK,                  "uu",   "iR"},
+    [VKD3D_SM5_OP_LD_STRUCTURED_FEEDBACK] = {           VKD3DSIH_LD_STRUCTURED_FEEDBACK,           "uu",   "iiR"},
+    [VKD3D_SM5_OP_SAMPLE_L_FEEDBACK] = {                VKD3DSIH_SAMPLE_LOD_FEEDBACK,              "fu",   "fRSf"},
+    [VKD3D_SM5_OP_SAMPLE_C_LZ_FEEDBACK] = {             VKD3DSIH_SAMPLE_C_LZ_FEEDBACK,             "fu",   "fRSf"},
+    [VKD3D_SM5_OP_SAMPLE_CLAMP_FEEDBACK] = {            VKD3DSIH_SAMPLE_FEEDBACK,                  "fu",   "fRSf"},
+    [VKD3D_SM5_OP_SAMPLE_B_CLAMP_FEEDBACK] = {          VKD3DSIH_SAMPLE_B_FEEDBACK,                "fu",   "fRSff"},
+    [VKD3D_SM5_OP_SAMPLE_D_CLAMP_FEEDBACK] = {          VKD3DSIH_SAMPLE_GRAD_FEEDBACK,             "fu",   "fRSfff"},
+    [VKD3D_SM5_OP_SAMPLE_C_CLAMP_FEEDBACK] = {          VKD3DSIH_SAMPLE_C_FEEDBACK,                "fu",   "fRSff"},
+    [VKD3D_SM5_OP_CHECK_ACCESS_FULLY_MAPPED] = {        VKD3DSIH_CHECK_ACCESS_FULLY_MAPPED,        "u",    "u"},
 };
 
 static const enum vkd3d_shader_register_type register_type_table[] =
@@ -1284,14 +1289,10 @@ static const enum vkd3d_shader_register_type register_type_table[] =
 
 static const struct vkd3d_sm4_opcode_info *get_opcode_info(enum vkd3d_sm4_opcode opcode)
 {
-    unsigned int i;
-
-    for (i = 0; i < sizeof(opcode_table) / sizeof(*opcode_table); ++i)
-    {
-        if (opcode == opcode_table[i].opcode) return &opcode_table[i];
-    }
+    if (opcode >= ARRAY_SIZE(opcode_table) || !opcode_table[opcode].dst_info)
+        return NULL;
 
-    return NULL;
+    return &opcode_table[opcode];
 }
 
 static void map_register(const struct vkd3d_sm4_data *priv, struct vkd3d_shader_register *reg)
@@ -1422,45 +1423,22 @@ void *shader_sm4_init(const DWORD *byte_code, size_t byte_code_size,
         priv->output_map[e->register_index] = e->semantic_index;
     }
 
-    list_init(&priv->src_free);
-    list_init(&priv->src);
+    vkd3d_shader_arena_init(&priv->params, VKD3D_SM4_PARAM_BLOCK_SIZE);
 
     return priv;
 }
 
 void shader_sm4_free(void *data)
 {
-    struct vkd3d_shader_src_param_entry *e1, *e2;
     struct vkd3d_sm4_data *priv = data;
 
-    list_move_head(&priv->src_free, &priv->src);
-    LIST_FOR_EACH_ENTRY_SAFE(e1, e2, &priv->src_free, struct vkd3d_shader_src_param_entry, entry)
-    {
-        vkd3d_free(e1);
-    }
+    vkd3d_shader_arena_free(&priv->params);
     vkd3d_free(priv);
 }
 
 static struct vkd3d_shader_src_param *get_src_param(struct vkd3d_sm4_data *priv)
 {
-    struct vkd3d_shader_src_param_entry *e;
-    struct list *elem;
-
-    if (!list_empty(&priv->src_free))
-    {
-        elem = list_head(&priv->src_free);
-        list_remove(elem);
-    }
-    else
-    {
-        if (!(e = vkd3d_malloc(sizeof(*e))))
-            return NULL;
-        elem = &e->entry;
-    }
-
-    list_add_tail(&priv->src, elem);
-    e = LIST_ENTRY(elem, struct vkd3d_shader_src_param_entry, entry);
-    return &e->param;
+    return vkd3d_shader_arena_alloc(&priv->params, sizeof(struct vkd3d_shader_src_param));
 }
 
 void shader_sm4_read_header(void *data, const DWORD **ptr, struct vkd3d_shader_version *shader_version)
@@ -1800,8 +1778,6 @@ void shader_sm4_read_instruction(void *data, const DWORD **ptr, struct vkd3d_sha
     const DWORD *p;
     DWORD precise;
 
-    list_move_head(&priv->src_free, &priv->src);
-
     if (*ptr >= priv->end)
     {
         WARN("End of byte-code, failed to read opcode.\n");
@@ -1893,6 +1869,18 @@ void shader_sm4_read_instruction(void *data, const DWORD **ptr, struct vkd3d_sha
         }
     }
 
+    if (ins->handler_idx == VKD3DSIH_INVALID)
+        return;
+
+    /* The scratch parameters are overwritten by the next instruction. */
+    if ((ins->dst_count && !(ins->dst = vkd3d_shader_arena_copy(&priv->params,
+            priv->dst_param, ins->dst_count * sizeof(*ins->dst))))
+            || (ins->src_count && !(ins->src = vkd3d_shader_arena_copy(&priv->params,
+            priv->src_param, ins->src_count * sizeof(*ins->src)))))
+    {
+        ERR("Failed to allocate instruction parameters.\n");
+        ins->handler_idx = VKD3DSIH_INVALID;
+    }
     return;
 
 fail:
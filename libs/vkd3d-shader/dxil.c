@@ -19,6 +19,12 @@
 #include "vkd3d_shader_private.h"
 #include <dxil_spirv_c.h>
 
+struct dxil_remap_userdata
+{
+    const struct vkd3d_shader_interface_info *shader_interface_info;
+    struct vkd3d_shader_binding_index binding_index;
+};
+
 static bool dxil_match_shader_visibility(enum vkd3d_shader_visibility visibility,
                                          dxil_spv_shader_stage stage)
 {
@@ -73,81 +79,67 @@ static bool dxil_resource_is_in_range(const struct vkd3d_shader_resource_binding
 static dxil_spv_bool dxil_srv_remap(void *userdata, const dxil_spv_d3d_binding *d3d_binding,
                                     dxil_spv_vulkan_binding *vk_binding)
 {
-    const struct vkd3d_shader_interface_info *shader_interface_info = userdata;
-    unsigned int binding_count = shader_interface_info->binding_count;
-    unsigned int i, resource_flags;
+    struct dxil_remap_userdata *remap = userdata;
+    const struct vkd3d_shader_interface_info *shader_interface_info = remap->shader_interface_info;
+    const struct vkd3d_shader_resource_binding *binding;
+    unsigned int resource_flags;
     resource_flags = dxil_resource_flags_from_kind(d3d_binding->kind);
 
-    for (i = 0; i < binding_count; i++)
-    {
-        const struct vkd3d_shader_resource_binding *binding = &shader_interface_info->bindings[i];
-        if (binding->type == VKD3D_SHADER_DESCRIPTOR_TYPE_SRV &&
-            dxil_resource_is_in_range(binding, d3d_binding) &&
-            (binding->flags & resource_flags) != 0 &&
-            dxil_match_shader_visibility(binding->shader_visibility, d3d_binding->stage))
-        {
-            memset(vk_binding, 0, sizeof(*vk_binding));
+    if (!(binding = vkd3d_shader_binding_index_find(&remap->binding_index, VKD3D_SHADER_DESCRIPTOR_TYPE_SRV,
+            d3d_binding->register_space, d3d_binding->register_index, resource_flags, 0)))
+        return DXIL_SPV_FALSE;
 
-            if (binding->flags & VKD3D_SHADER_BINDING_FLAG_BINDLESS)
-            {
-                vk_binding->bindless.use_heap = DXIL_SPV_TRUE;
-                vk_binding->bindless.heap_root_offset = binding->descriptor_offset +
-                        d3d_binding->register_index - binding->register_index;
-                vk_binding->bindless.root_constant_word = binding->descriptor_table +
-                        (shader_interface_info->descriptor_tables.offset / sizeof(uint32_t));
-                vk_binding->set = binding->binding.set;
-                vk_binding->binding = binding->binding.binding;
-            }
-            else
-            {
-                vk_binding->set = binding->binding.set;
-                vk_binding->binding = binding->binding.binding + d3d_binding->register_index - binding->register_index;
-            }
+    memset(vk_binding, 0, sizeof(*vk_binding));
 
-            return DXIL_SPV_TRUE;
-        }
+    if (binding->flags & VKD3D_SHADER_BINDING_FLAG_BINDLESS)
+    {
+        vk_binding->bindless.use_heap = DXIL_SPV_TRUE;
+        vk_binding->bindless.heap_root_offset = binding->descriptor_offset +
+                d3d_binding->register_index - binding->register_index;
+        vk_binding->bindless.root_constant_word = binding->descriptor_table +
+                (shader_interface_info->descriptor_tables.offset / sizeof(uint32_t));
+        vk_binding->set = binding->binding.set;
+        vk_binding->binding = binding->binding.binding;
+    }
+    else
+    {
+        vk_binding->set = binding->binding.set;
+        vk_binding->binding = binding->binding.binding + d3d_binding->register_index - binding->register_index;
     }
 
-    return DXIL_SPV_FALSE;
+    return DXIL_SPV_TRUE;
 }
 
 static dxil_spv_bool dxil_sampler_remap(void *userdata, const dxil_spv_d3d_binding *d3d_binding,
                                         dxil_spv_vulkan_binding *vk_binding)
 {
-    const struct vkd3d_shader_interface_info *shader_interface_info = userdata;
-    unsigned int binding_count = shader_interface_info->binding_count;
-    unsigned int i;
+    struct dxil_remap_userdata *remap = userdata;
+    const struct vkd3d_shader_interface_info *shader_interface_info = remap->shader_interface_info;
+    const struct vkd3d_shader_resource_binding *binding;
 
-    for (i = 0; i < binding_count; i++)
-    {
-        const struct vkd3d_shader_resource_binding *binding = &shader_interface_info->bindings[i];
-        if (binding->type == VKD3D_SHADER_DESCRIPTOR_TYPE_SAMPLER &&
-            dxil_resource_is_in_range(binding, d3d_binding) &&
-            dxil_match_shader_visibility(binding->shader_visibility, d3d_binding->stage))
-        {
-            memset(vk_binding, 0, sizeof(*vk_binding));
+    if (!(binding = vkd3d_shader_binding_index_find(&remap->binding_index, VKD3D_SHADER_DESCRIPTOR_TYPE_SAMPLER,
+            d3d_binding->register_space, d3d_binding->register_index, 0, 0)))
+        return DXIL_SPV_FALSE;
 
-            if (binding->flags & VKD3D_SHADER_BINDING_FLAG_BINDLESS)
-            {
-                vk_binding->bindless.use_heap = DXIL_SPV_TRUE;
-                vk_binding->bindless.heap_root_offset = binding->descriptor_offset +
-                        d3d_binding->register_index - binding->register_index;
-                vk_binding->bindless.root_constant_word = binding->descriptor_table +
-                        (shader_interface_info->descriptor_tables.offset / sizeof(uint32_t));
-                vk_binding->set = binding->binding.set;
-                vk_binding->binding = binding->binding.binding;
-            }
-            else
-            {
-                vk_binding->set = binding->binding.set;
-                vk_binding->binding = binding->binding.binding + d3d_binding->register_index - binding->register_index;
-            }
+    memset(vk_binding, 0, sizeof(*vk_binding));
 
-            return DXIL_SPV_TRUE;
-        }
+    if (binding->flags & VKD3D_SHADER_BINDING_FLAG_BINDLESS)
+    {
+        vk_binding->bindless.use_heap = DXIL_SPV_TRUE;
+        vk_binding->bindless.heap_root_offset = binding->descriptor_offset +
+                d3d_binding->register_index - binding->register_index;
+        vk_binding->bindless.root_constant_word = binding->descriptor_table +
+                (shader_interface_info->descriptor_tables.offset / sizeof(uint32_t));
+        vk_binding->set = binding->binding.set;
+        vk_binding->binding = binding->binding.binding;
+    }
+    else
+    {
+        vk_binding->set = binding->binding.set;
+        vk_binding->binding = binding->binding.binding + d3d_binding->register_index - binding->register_index;
     }
 
-    return DXIL_SPV_FALSE;
+    return DXIL_SPV_TRUE;
 }
 
 static dxil_spv_bool dxil_input_remap(void *userdata, const dxil_spv_d3d_vertex_input *d3d_input,
@@ -210,10 +202,13 @@ static dxil_spv_bool dxil_output_remap(void *userdata, const dxil_spv_d3d_stream
     return DXIL_SPV_TRUE;
 }
 
+/* Not indexed: the buffer and the counter are taken from the last matching
+ * bindings, in shader interface order. */
 static dxil_spv_bool dxil_uav_remap(void *userdata, const dxil_spv_uav_d3d_binding *d3d_binding,
                                     dxil_spv_uav_vulkan_binding *vk_binding)
 {
-    const struct vkd3d_shader_interface_info *shader_interface_info = userdata;
+    struct dxil_remap_userdata *remap = userdata;
+    const struct vkd3d_shader_interface_info *shader_interface_info = remap->shader_interface_info;
     unsigned int binding_count = shader_interface_info->binding_count;
     const struct vkd3d_shader_resource_binding *binding;
     unsigned int i, resource_flags;
@@ -284,8 +279,9 @@ static dxil_spv_bool dxil_uav_remap(void *userdata, const dxil_spv_uav_d3d_bindi
 static dxil_spv_bool dxil_cbv_remap(void *userdata, const dxil_spv_d3d_binding *d3d_binding,
                                     dxil_spv_cbv_vulkan_binding *vk_binding)
 {
-    const struct vkd3d_shader_interface_info *shader_interface_info = userdata;
-    unsigned int binding_count = shader_interface_info->binding_count;
+    struct dxil_remap_userdata *remap = userdata;
+    const struct vkd3d_shader_interface_info *shader_interface_info = remap->shader_interface_info;
+    const struct vkd3d_shader_resource_binding *binding;
     unsigned int i;
 
     /* Try to map to root constant -> push constant.
@@ -304,38 +300,31 @@ static dxil_spv_bool dxil_cbv_remap(void *userdata, const dxil_spv_d3d_binding *
     }
 
     /* Fall back to regular CBV -> UBO. */
-    for (i = 0; i < binding_count; i++)
-    {
-        const struct vkd3d_shader_resource_binding *binding = &shader_interface_info->bindings[i];
-        if (binding->type == VKD3D_SHADER_DESCRIPTOR_TYPE_CBV &&
-            dxil_resource_is_in_range(binding, d3d_binding) &&
-            dxil_match_shader_visibility(binding->shader_visibility, d3d_binding->stage))
-        {
-            memset(vk_binding, 0, sizeof(*vk_binding));
+    if (!(binding = vkd3d_shader_binding_index_find(&remap->binding_index, VKD3D_SHADER_DESCRIPTOR_TYPE_CBV,
+            d3d_binding->register_space, d3d_binding->register_index, 0, 0)))
+        return DXIL_SPV_FALSE;
 
-            if (binding->flags & VKD3D_SHADER_BINDING_FLAG_BINDLESS)
-            {
-                vk_binding->vulkan.uniform_binding.bindless.use_heap = DXIL_SPV_TRUE;
-                vk_binding->vulkan.uniform_binding.bindless.heap_root_offset =
-                        binding->descriptor_offset + d3d_binding->register_index - binding->register_index;
-                vk_binding->vulkan.uniform_binding.bindless.root_constant_word =
-                        binding->descriptor_table +
-                        (shader_interface_info->descriptor_tables.offset / sizeof(uint32_t));
-                vk_binding->vulkan.uniform_binding.set = binding->binding.set;
-                vk_binding->vulkan.uniform_binding.binding = binding->binding.binding;
-            }
-            else
-            {
-                vk_binding->vulkan.uniform_binding.set = binding->binding.set;
-                vk_binding->vulkan.uniform_binding.binding =
-                        binding->binding.binding + d3d_binding->register_index - binding->register_index;
-            }
+    memset(vk_binding, 0, sizeof(*vk_binding));
 
-            return DXIL_SPV_TRUE;
-        }
+    if (binding->flags & VKD3D_SHADER_BINDING_FLAG_BINDLESS)
+    {
+        vk_binding->vulkan.uniform_binding.bindless.use_heap = DXIL_SPV_TRUE;
+        vk_binding->vulkan.uniform_binding.bindless.heap_root_offset =
+                binding->descriptor_offset + d3d_binding->register_index - binding->register_index;
+        vk_binding->vulkan.uniform_binding.bindless.root_constant_word =
+                binding->descriptor_table +
+                (shader_interface_info->descriptor_tables.offset / sizeof(uint32_t));
+        vk_binding->vulkan.uniform_binding.set = binding->binding.set;
+        vk_binding->vulkan.uniform_binding.binding = binding->binding.binding;
+    }
+    else
+    {
+        vk_binding->vulkan.uniform_binding.set = binding->binding.set;
+        vk_binding->vulkan.uniform_binding.binding =
+                binding->binding.binding + d3d_binding->register_index - binding->register_index;
     }
 
-    return DXIL_SPV_FALSE;
+    return DXIL_SPV_TRUE;
 }
 
 int vkd3d_shader_compile_dxil(const struct vkd3d_shader_code *dxbc,
@@ -344,6 +333,7 @@ int vkd3d_shader_compile_dxil(const struct vkd3d_shader_code *dxbc,
         const struct vkd3d_shader_compile_arguments *compiler_args)
 {
     const struct vkd3d_shader_transform_feedback_info *xfb_info;
+    struct dxil_remap_userdata remap_userdata;
     unsigned int root_constant_words = 0;
     dxil_spv_converter converter = NULL;
     enum vkd3d_shader_type shader_type;
@@ -351,8 +341,12 @@ int vkd3d_shader_compile_dxil(const struct vkd3d_shader_code *dxbc,
     dxil_spv_compiled_spirv compiled;
     unsigned int i, max_size;
     int ret = VKD3D_OK;
+    uint64_t dxbc_hash;
     void *code;
 
+    remap_userdata.shader_interface_info = shader_interface_info;
+    memset(&remap_userdata.binding_index, 0, sizeof(remap_userdata.binding_index));
+
     if (dxil_spv_parse_dxil_blob(dxbc->code, dxbc->size, &blob) != DXIL_SPV_SUCCESS)
     {
         ret = VKD3D_ERROR_INVALID_SHADER;
@@ -384,7 +378,10 @@ int vkd3d_shader_compile_dxil(const struct vkd3d_shader_code *dxbc,
             goto end;
     }
 
-    vkd3d_shader_dump_shader(shader_type, dxbc);
+    dxbc_hash = vkd3d_shader_dump_shader(shader_type, dxbc);
+
+    vkd3d_shader_binding_index_init(&remap_userdata.binding_index, shader_interface_info,
+            vkd3d_shader_visibility_from_shader_type(shader_type));
 
     if (dxil_spv_create_converter(blob, &converter) != DXIL_SPV_SUCCESS)
     {
@@ -514,10 +511,10 @@ int vkd3d_shader_compile_dxil(const struct vkd3d_shader_code *dxbc,
     }
 
     dxil_spv_converter_set_root_constant_word_count(converter, root_constant_words);
-    dxil_spv_converter_set_srv_remapper(converter, dxil_srv_remap, (void *)shader_interface_info);
-    dxil_spv_converter_set_sampler_remapper(converter, dxil_sampler_remap, (void *)shader_interface_info);
-    dxil_spv_converter_set_uav_remapper(converter, dxil_uav_remap, (void *)shader_interface_info);
-    dxil_spv_converter_set_cbv_remapper(converter, dxil_cbv_remap, (void *)shader_interface_info);
+    dxil_spv_converter_set_srv_remapper(converter, dxil_srv_remap, &remap_userdata);
+    dxil_spv_converter_set_sampler_remapper(converter, dxil_sampler_remap, &remap_userdata);
+    dxil_spv_converter_set_uav_remapper(converter, dxil_uav_remap, &remap_userdata);
+    dxil_spv_converter_set_cbv_remapper(converter, dxil_cbv_remap, &remap_userdata);
     dxil_spv_converter_set_vertex_input_remapper(converter, dxil_input_remap, (void *)shader_interface_info);
 
     xfb_info = vkd3d_find_struct(shader_interface_info->next, TRANSFORM_FEEDBACK_INFO);
@@ -546,9 +543,10 @@ int vkd3d_shader_compile_dxil(const struct vkd3d_shader_code *dxbc,
     spirv->code = code;
     spirv->size = compiled.size;
 
-    vkd3d_shader_dump_spirv_shader(shader_type, spirv);
+    vkd3d_shader_dump_spirv_shader(shader_type, dxbc_hash, spirv);
 
 end:
+    vkd3d_shader_binding_index_cleanup(&remap_userdata.binding_index);
     dxil_spv_converter_free(converter);
     dxil_spv_parsed_blob_free(blob);
     return ret;
@@ -0,0 +1,389 @@
+/*
+ * Copyright 2020 VKD3D contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/*
+ * XXH64, as specified by the xxHash project. The input is consumed in 32-byte
+ * stripes by four independent accumulators, which keeps the multipliers of
+ * each lane busy in parallel and lets compilers vectorize the stripe loop.
+ */
+
+#include "vkd3d_shader_private.h"
+
+#define XXH_PRIME64_1 0x9e3779b185ebca87ull
+#define XXH_PRIME64_2 0xc2b2ae3d27d4eb4full
+#define XXH_PRIME64_3 0x165667b19e3779f9ull
+#define XXH_PRIME64_4 0x85ebca77c2b2ae63ull
+#define XXH_PRIME64_5 0x27d4eb2f165667c5ull
+
+#define XXH_STRIPE_SIZE 32
+
+STATIC_ASSERT(sizeof(((struct vkd3d_shader_hash_state *)0)->buffer) == XXH_STRIPE_SIZE);
+
+static inline uint64_t xxh_rotl64(uint64_t x, unsigned int r)
+{
+    return x << r | x >> (64 - r);
+}
+
+static inline uint64_t xxh_read64(const uint8_t *p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t xxh_read32(const uint8_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t xxh_round(uint64_t acc, uint64_t input)
+{
+    acc += input * XXH_PRIME64_2;
+    acc = xxh_rotl64(acc, 31);
+    return acc * XXH_PRIME64_1;
+}
+
+static inline uint64_t xxh_merge_round(uint64_t acc, uint64_t lane)
+{
+    acc ^= xxh_round(0, lane);
+    return acc * XXH_PRIME64_1 + XXH_PRIME64_4;
+}
+
+static const uint8_t *xxh_consume_stripes(uint64_t lanes[4], const uint8_t *p, const uint8_t *end)
+{
+    uint64_t v1 = lanes[0], v2 = lanes[1], v3 = lanes[2], v4 = lanes[3];
+
+    while (end - p >= XXH_STRIPE_SIZE)
+    {
+        v1 = xxh_round(v1, xxh_read64(p));
+        v2 = xxh_round(v2, xxh_read64(p + 8));
+        v3 = xxh_round(v3, xxh_read64(p + 16));
+        v4 = xxh_round(v4, xxh_read64(p + 24));
+        p += XXH_STRIPE_SIZE;
+    }
+
+    lanes[0] = v1;
+    lanes[1] = v2;
+    lanes[2] = v3;
+    lanes[3] = v4;
+    return p;
+}
+
+void vkd3d_shader_hash_init(struct vkd3d_shader_hash_state *state, uint64_t seed)
+{
+    state->lanes[0] = seed + XXH_PRIME64_1 + XXH_PRIME64_2;
+    state->lanes[1] = seed + XXH_PRIME64_2;
+    state->lanes[2] = seed;
+    state->lanes[3] = seed - XXH_PRIME64_1;
+    state->seed = seed;
+    state->total_size = 0;
+    state->buffer_size = 0;
+}
+
+void vkd3d_shader_hash_update(struct vkd3d_shader_hash_state *state, const void *data, size_t size)
+{
+    const uint8_t *p = data, *end = p + size;
+    size_t count;
+
+    if (!size)
+        return;
+
+    state->total_size += size;
+
+    if (state->buffer_size + size < XXH_STRIPE_SIZE)
+    {
+        memcpy(state->buffer + state->buffer_size, p, size);
+        state->buffer_size += size;
+        return;
+    }
+
+    if (state->buffer_size)
+    {
+        count = XXH_STRIPE_SIZE - state->buffer_size;
+        memcpy(state->buffer + state->buffer_size, p, count);
+        xxh_consume_stripes(state->lanes, state->buffer, state->buffer + XXH_STRIPE_SIZE);
+        state->buffer_size = 0;
+        p += count;
+    }
+
+    p = xxh_consume_stripes(state->lanes, p, end);
+
+    if ((state->buffer_size = end - p))
+        memcpy(state->buffer, p, state->buffer_size);
+}
+
+static uint64_t xxh_finalize(uint64_t h, const uint8_t *p, size_t size)
+{
+    while (size >= 8)
+    {
+        h ^= xxh_round(0, xxh_read64(p));
+        h = xxh_rotl64(h, 27) * XXH_PRIME64_1 + XXH_PRIME64_4;
+        p += 8;
+        size -= 8;
+    }
+
+    if (size >= 4)
+    {
+        h ^= xxh_read32(p) * XXH_PRIME64_1;
+        h = xxh_rotl64(h, 23) * XXH_PRIME64_2 + XXH_PRIME64_3;
+        p += 4;
+        size -= 4;
+    }
+
+    while (size--)
+    {
+        h ^= *p++ * XXH_PRIME64_5;
+        h = xxh_rotl64(h, 11) * XXH_PRIME64_1;
+    }
+
+    h ^= h >> 33;
+    h *= XXH_PRIME64_2;
+    h ^= h >> 29;
+    h *= XXH_PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+static uint64_t xxh_digest(const uint64_t lanes[4], uint64_t seed, uint64_t total_size)
+{
+    uint64_t h;
+
+    if (total_size < XXH_STRIPE_SIZE)
+        return seed + XXH_PRIME64_5 + total_size;
+
+    h = xxh_rotl64(lanes[0], 1) + xxh_rotl64(lanes[1], 7)
+            + xxh_rotl64(lanes[2], 12) + xxh_rotl64(lanes[3], 18);
+    h = xxh_merge_round(h, lanes[0]);
+    h = xxh_merge_round(h, lanes[1]);
+    h = xxh_merge_round(h, lanes[2]);
+    h = xxh_merge_round(h, lanes[3]);
+    return h + total_size;
+}
+
+uint64_t vkd3d_shader_hash_digest(const struct vkd3d_shader_hash_state *state)
+{
+    uint64_t h = xxh_digest(state->lanes, state->seed, state->total_size);
+
+    return xxh_finalize(h, state->buffer, state->buffer_size);
+}
+
+uint64_t vkd3d_shader_hash_data(const void *data, size_t size, uint64_t seed)
+{
+    struct vkd3d_shader_hash_state state;
+    const uint8_t *p;
+
+    /* Skip the copy through the stripe buffer for one-shot hashing. */
+    vkd3d_shader_hash_init(&state, seed);
+    if (!size)
+        return vkd3d_shader_hash_digest(&state);
+    p = xxh_consume_stripes(state.lanes, data, (const uint8_t *)data + size);
+
+    return xxh_finalize(xxh_digest(state.lanes, seed, size), p, (const uint8_t *)data + size - p);
+}
+
+static void vkd3d_shader_hash_u32_array(struct vkd3d_shader_hash_state *state,
+        const uint32_t *values, unsigned int count)
+{
+    vkd3d_shader_hash_update(state, values, count * sizeof(*values));
+}
+
+static void vkd3d_shader_hash_string(struct vkd3d_shader_hash_state *state, const char *str)
+{
+    uint32_t zero = 0;
+
+    if (str)
+        vkd3d_shader_hash_update(state, str, strlen(str) + 1);
+    else
+        vkd3d_shader_hash_update(state, &zero, sizeof(zero));
+}
+
+static void vkd3d_shader_hash_xfb_info(struct vkd3d_shader_hash_state *state,
+        const struct vkd3d_shader_transform_feedback_info *xfb_info)
+{
+    const struct vkd3d_shader_transform_feedback_element *e;
+    uint32_t values[5];
+    unsigned int i;
+
+    vkd3d_shader_hash_u32_array(state, &xfb_info->element_count, 1);
+    for (i = 0; i < xfb_info->element_count; ++i)
+    {
+        e = &xfb_info->elements[i];
+        vkd3d_shader_hash_string(state, e->semantic_name);
+        values[0] = e->stream_index;
+        values[1] = e->semantic_index;
+        values[2] = e->component_index;
+        values[3] = e->component_count;
+        values[4] = e->output_slot;
+        vkd3d_shader_hash_u32_array(state, values, ARRAY_SIZE(values));
+    }
+
+    vkd3d_shader_hash_u32_array(state, &xfb_info->buffer_stride_count, 1);
+    vkd3d_shader_hash_u32_array(state, xfb_info->buffer_strides, xfb_info->buffer_stride_count);
+}
+
+int vkd3d_shader_hash_shader_interface(struct vkd3d_shader_hash_state *state,
+        const struct vkd3d_shader_interface_info *shader_interface_info)
+{
+    const struct vkd3d_shader_push_constant_buffer *p;
+    const struct vkd3d_shader_resource_binding *b;
+    const struct vkd3d_struct *ext;
+    uint32_t values[10];
+    unsigned int i;
+
+    if (!shader_interface_info)
+    {
+        values[0] = 0;
+        vkd3d_shader_hash_u32_array(state, values, 1);
+        return VKD3D_OK;
+    }
+
+    values[0] = shader_interface_info->flags;
+    values[1] = shader_interface_info->descriptor_tables.offset;
+    values[2] = shader_interface_info->descriptor_tables.count;
+    values[3] = shader_interface_info->binding_count;
+    vkd3d_shader_hash_u32_array(state, values, 4);
+
+    /* Bindings are gathered into one block each, so that large root
+     * signatures go through the stripe loop rather than byte by byte. */
+    for (i = 0; i < shader_interface_info->binding_count; ++i)
+    {
+        b = &shader_interface_info->bindings[i];
+        values[0] = b->type;
+        values[1] = b->register_space;
+        values[2] = b->register_index;
+        values[3] = b->register_count;
+        values[4] = b->descriptor_table;
+        values[5] = b->descriptor_offset;
+        values[6] = b->shader_visibility;
+        values[7] = b->flags;
+        values[8] = b->binding.set;
+        values[9] = b->binding.binding;
+        vkd3d_shader_hash_u32_array(state, values, 10);
+    }
+
+    vkd3d_shader_hash_u32_array(state, &shader_interface_info->push_constant_buffer_count, 1);
+    for (i = 0; i < shader_interface_info->push_constant_buffer_count; ++i)
+    {
+        p = &shader_interface_info->push_constant_buffers[i];
+        values[0] = p->register_space;
+        values[1] = p->register_index;
+        values[2] = p->shader_visibility;
+        values[3] = p->offset;
+        values[4] = p->size;
+        vkd3d_shader_hash_u32_array(state, values, 5);
+    }
+
+    if (shader_interface_info->push_constant_ubo_binding)
+    {
+        values[0] = shader_interface_info->push_constant_ubo_binding->set;
+        values[1] = shader_interface_info->push_constant_ubo_binding->binding;
+        vkd3d_shader_hash_u32_array(state, values, 2);
+    }
+
+    for (ext = shader_interface_info->next; ext; ext = ext->next)
+    {
+        /* Only reports statistics. */
+        if (ext->type == VKD3D_SHADER_STRUCTURE_TYPE_COMPILE_TIMING_INFO)
+            continue;
+
+        values[0] = ext->type;
+        vkd3d_shader_hash_u32_array(state, values, 1);
+
+        switch (ext->type)
+        {
+            case VKD3D_SHADER_STRUCTURE_TYPE_TRANSFORM_FEEDBACK_INFO:
+                vkd3d_shader_hash_xfb_info(state, (const void *)ext);
+                break;
+
+            default:
+                WARN("Unhandled shader interface structure type %#x.\n", ext->type);
+                return VKD3D_ERROR_INVALID_ARGUMENT;
+        }
+    }
+
+    return VKD3D_OK;
+}
+
+int vkd3d_shader_hash_compile_arguments(struct vkd3d_shader_hash_state *state,
+        const struct vkd3d_shader_compile_arguments *compile_args)
+{
+    const struct vkd3d_shader_domain_shader_compile_arguments *ds_args;
+    const struct vkd3d_shader_parameter *parameter;
+    const struct vkd3d_struct *ext;
+    uint32_t values[4];
+    unsigned int i;
+
+    if (!compile_args)
+    {
+        values[0] = 0;
+        vkd3d_shader_hash_u32_array(state, values, 1);
+        return VKD3D_OK;
+    }
+
+    values[0] = compile_args->target;
+    values[1] = compile_args->target_extension_count;
+    vkd3d_shader_hash_u32_array(state, values, 2);
+    for (i = 0; i < compile_args->target_extension_count; ++i)
+    {
+        values[0] = compile_args->target_extensions[i];
+        vkd3d_shader_hash_u32_array(state, values, 1);
+    }
+
+    vkd3d_shader_hash_u32_array(state, &compile_args->parameter_count, 1);
+    for (i = 0; i < compile_args->parameter_count; ++i)
+    {
+        parameter = &compile_args->parameters[i];
+        values[0] = parameter->name;
+        values[1] = parameter->type;
+        values[2] = parameter->data_type;
+        if (parameter->type == VKD3D_SHADER_PARAMETER_TYPE_IMMEDIATE_CONSTANT)
+            values[3] = parameter->immediate_constant.u32;
+        else
+            values[3] = parameter->specialization_constant.id;
+        vkd3d_shader_hash_u32_array(state, values, 4);
+    }
+
+    values[0] = compile_args->dual_source_blending;
+    values[1] = compile_args->output_swizzle_count;
+    vkd3d_shader_hash_u32_array(state, values, 2);
+    vkd3d_shader_hash_u32_array(state, compile_args->output_swizzles, compile_args->output_swizzle_count);
+
+    for (ext = compile_args->next; ext; ext = ext->next)
+    {
+        values[0] = ext->type;
+        vkd3d_shader_hash_u32_array(state, values, 1);
+
+        switch (ext->type)
+        {
+            case VKD3D_SHADER_STRUCTURE_TYPE_DOMAIN_SHADER_COMPILE_ARGUMENTS:
+                ds_args = (const void *)ext;
+                values[0] = ds_args->output_primitive;
+                values[1] = ds_args->partitioning;
+                vkd3d_shader_hash_u32_array(state, values, 2);
+                break;
+
+            default:
+                WARN("Unhandled compile arguments structure type %#x.\n", ext->type);
+                return VKD3D_ERROR_INVALID_ARGUMENT;
+        }
+    }
+
+    return VKD3D_OK;
+}
@@ -94,15 +94,10 @@ struct vkd3d_spirv_chunk
     uint32_t words[];
 };
 
+/* Inserted chunks are allocated from the compiler arena. */
 static void vkd3d_spirv_stream_clear(struct vkd3d_spirv_stream *stream)
 {
-    struct vkd3d_spirv_chunk *c1, *c2;
-
     stream->word_count = 0;
-
-    LIST_FOR_EACH_ENTRY_SAFE(c1, c2, &stream->inserted_chunks, struct vkd3d_spirv_chunk, entry)
-        vkd3d_free(c1);
-
     list_init(&stream->inserted_chunks);
 }
 
@@ -118,12 +113,12 @@ static size_t vkd3d_spirv_stream_current_location(struct vkd3d_spirv_stream *str
     return stream->word_count;
 }
 
-static void vkd3d_spirv_stream_insert(struct vkd3d_spirv_stream *stream,
+static void vkd3d_spirv_stream_insert(struct vkd3d_spirv_stream *stream, struct vkd3d_shader_arena *arena,
         size_t location, const uint32_t *words, unsigned int word_count)
 {
     struct vkd3d_spirv_chunk *chunk, *current;
 
-    if (!(chunk = vkd3d_malloc(offsetof(struct vkd3d_spirv_chunk, words[word_count]))))
+    if (!(chunk = vkd3d_shader_arena_alloc(arena, offsetof(struct vkd3d_spirv_chunk, words[word_count]))))
         return;
 
     chunk->location = location;
@@ -183,6 +178,8 @@ static bool vkd3d_spirv_stream_append(struct vkd3d_spirv_stream *dst_stream,
 
 struct vkd3d_spirv_builder
 {
+    struct vkd3d_shader_arena *arena;
+
     SpvCapability *capabilities;
     size_t capabilities_size;
     size_t capability_count;
@@ -193,7 +190,7 @@ struct vkd3d_spirv_builder
 
     uint32_t current_id;
     uint32_t main_function_id;
-    struct rb_tree declarations;
+    struct vkd3d_shader_hash_map declarations;
     uint32_t type_sampler_id;
     uint32_t type_bool_id;
     uint32_t type_void_id;
@@ -353,7 +350,7 @@ static uint32_t vkd3d_spirv_build_once(struct vkd3d_spirv_builder *builder,
 
 struct vkd3d_spirv_declaration
 {
-    struct rb_entry entry;
+    struct vkd3d_shader_hash_map_entry entry;
 
     SpvOp op;
     unsigned int parameter_count;
@@ -361,24 +358,34 @@ struct vkd3d_spirv_declaration
     uint32_t id;
 };
 
-static int vkd3d_spirv_declaration_compare(const void *key, const struct rb_entry *e)
+static bool vkd3d_spirv_declaration_equal(const void *key, const struct vkd3d_shader_hash_map_entry *e)
 {
     const struct vkd3d_spirv_declaration *a = key;
-    const struct vkd3d_spirv_declaration *b = RB_ENTRY_VALUE(e, const struct vkd3d_spirv_declaration, entry);
+    const struct vkd3d_spirv_declaration *b = VKD3D_SHADER_HASH_MAP_ENTRY_VALUE(e,
+            const struct vkd3d_spirv_declaration, entry);
 
-    if (a->op != b->op)
-        return a->op - b->op;
-    if (a->parameter_count != b->parameter_count)
-        return a->parameter_count - b->parameter_count;
+    if (a->op != b->op || a->parameter_count != b->parameter_count)
+        return false;
     assert(a->parameter_count <= ARRAY_SIZE(a->parameters));
-    return memcmp(&a->parameters, &b->parameters, a->parameter_count * sizeof(*a->parameters));
+    return !memcmp(&a->parameters, &b->parameters, a->parameter_count * sizeof(*a->parameters));
 }
 
-static void vkd3d_spirv_declaration_free(struct rb_entry *entry, void *context)
+/* Also stores the hash in the declaration, for a subsequent insertion. */
+static struct vkd3d_spirv_declaration *vkd3d_spirv_find_declaration(struct vkd3d_spirv_builder *builder,
+        struct vkd3d_spirv_declaration *declaration)
 {
-    struct vkd3d_spirv_declaration *d = RB_ENTRY_VALUE(entry, struct vkd3d_spirv_declaration, entry);
+    struct vkd3d_shader_hash_map_entry *entry;
+    uint32_t hash = VKD3D_SHADER_HASH_INIT;
+    unsigned int i;
 
-    vkd3d_free(d);
+    hash = vkd3d_shader_hash_u32(hash, declaration->op);
+    for (i = 0; i < declaration->parameter_count; ++i)
+        hash = vkd3d_shader_hash_u32(hash, declaration->parameters[i]);
+    declaration->entry.hash = vkd3d_shader_hash_finalize(hash);
+
+    if (!(entry = vkd3d_shader_hash_map_get(&builder->declarations, declaration, declaration->entry.hash)))
+        return NULL;
+    return VKD3D_SHADER_HASH_MAP_ENTRY_VALUE(entry, struct vkd3d_spirv_declaration, entry);
 }
 
 static void vkd3d_spirv_insert_declaration(struct vkd3d_spirv_builder *builder,
@@ -388,23 +395,18 @@ static void vkd3d_spirv_insert_declaration(struct vkd3d_spirv_builder *builder,
 
     assert(declaration->parameter_count <= ARRAY_SIZE(declaration->parameters));
 
-    if (!(d = vkd3d_malloc(sizeof(*d))))
+    if (!(d = vkd3d_shader_arena_copy(builder->arena, declaration, sizeof(*d))))
         return;
-    memcpy(d, declaration, sizeof(*d));
-    if (rb_put(&builder->declarations, d, &d->entry) == -1)
-    {
+    if (vkd3d_shader_hash_map_put(&builder->declarations, d, &d->entry) == -1)
         ERR("Failed to insert declaration entry.\n");
-        vkd3d_free(d);
-    }
 }
 
 static uint32_t vkd3d_spirv_build_once_v(struct vkd3d_spirv_builder *builder,
         SpvOp op, const uint32_t *operands, unsigned int operand_count,
         vkd3d_spirv_build_v_pfn build_pfn)
 {
-    struct vkd3d_spirv_declaration declaration;
+    struct vkd3d_spirv_declaration declaration, *d;
     unsigned int i, param_idx = 0;
-    struct rb_entry *entry;
 
     if (operand_count > ARRAY_SIZE(declaration.parameters))
     {
@@ -417,8 +419,8 @@ static uint32_t vkd3d_spirv_build_once_v(struct vkd3d_spirv_builder *builder,
         declaration.parameters[param_idx++] = operands[i];
     declaration.parameter_count = param_idx;
 
-    if ((entry = rb_get(&builder->declarations, &declaration)))
-        return RB_ENTRY_VALUE(entry, struct vkd3d_spirv_declaration, entry)->id;
+    if ((d = vkd3d_spirv_find_declaration(builder, &declaration)))
+        return d->id;
 
     declaration.id = build_pfn(builder, operands, operand_count);
     vkd3d_spirv_insert_declaration(builder, &declaration);
@@ -428,15 +430,14 @@ static uint32_t vkd3d_spirv_build_once_v(struct vkd3d_spirv_builder *builder,
 static uint32_t vkd3d_spirv_build_once1(struct vkd3d_spirv_builder *builder,
         SpvOp op, uint32_t operand0, vkd3d_spirv_build1_pfn build_pfn)
 {
-    struct vkd3d_spirv_declaration declaration;
-    struct rb_entry *entry;
+    struct vkd3d_spirv_declaration declaration, *d;
 
     declaration.op = op;
     declaration.parameter_count = 1;
     declaration.parameters[0] = operand0;
 
-    if ((entry = rb_get(&builder->declarations, &declaration)))
-        return RB_ENTRY_VALUE(entry, struct vkd3d_spirv_declaration, entry)->id;
+    if ((d = vkd3d_spirv_find_declaration(builder, &declaration)))
+        return d->id;
 
     declaration.id = build_pfn(builder, operand0);
     vkd3d_spirv_insert_declaration(builder, &declaration);
@@ -447,9 +448,8 @@ static uint32_t vkd3d_spirv_build_once1v(struct vkd3d_spirv_builder *builder,
         SpvOp op, uint32_t operand0, const uint32_t *operands, unsigned int operand_count,
         vkd3d_spirv_build1v_pfn build_pfn)
 {
-    struct vkd3d_spirv_declaration declaration;
+    struct vkd3d_spirv_declaration declaration, *d;
     unsigned int i, param_idx = 0;
-    struct rb_entry *entry;
 
     if (operand_count >= ARRAY_SIZE(declaration.parameters))
     {
@@ -463,8 +463,8 @@ static uint32_t vkd3d_spirv_build_once1v(struct vkd3d_spirv_builder *builder,
         declaration.parameters[param_idx++] = operands[i];
     declaration.parameter_count = param_idx;
 
-    if ((entry = rb_get(&builder->declarations, &declaration)))
-        return RB_ENTRY_VALUE(entry, struct vkd3d_spirv_declaration, entry)->id;
+    if ((d = vkd3d_spirv_find_declaration(builder, &declaration)))
+        return d->id;
 
     declaration.id = build_pfn(builder, operand0, operands, operand_count);
     vkd3d_spirv_insert_declaration(builder, &declaration);
@@ -474,16 +474,15 @@ static uint32_t vkd3d_spirv_build_once1v(struct vkd3d_spirv_builder *builder,
 static uint32_t vkd3d_spirv_build_once2(struct vkd3d_spirv_builder *builder,
         SpvOp op, uint32_t operand0, uint32_t operand1, vkd3d_spirv_build2_pfn build_pfn)
 {
-    struct vkd3d_spirv_declaration declaration;
-    struct rb_entry *entry;
+    struct vkd3d_spirv_declaration declaration, *d;
 
     declaration.op = op;
     declaration.parameter_count = 2;
     declaration.parameters[0] = operand0;
     declaration.parameters[1] = operand1;
 
-    if ((entry = rb_get(&builder->declarations, &declaration)))
-        return RB_ENTRY_VALUE(entry, struct vkd3d_spirv_declaration, entry)->id;
+    if ((d = vkd3d_spirv_find_declaration(builder, &declaration)))
+        return d->id;
 
     declaration.id = build_pfn(builder, operand0, operand1);
     vkd3d_spirv_insert_declaration(builder, &declaration);
@@ -493,15 +492,14 @@ static uint32_t vkd3d_spirv_build_once2(struct vkd3d_spirv_builder *builder,
 static uint32_t vkd3d_spirv_build_once7(struct vkd3d_spirv_builder *builder,
         SpvOp op, const uint32_t *operands, vkd3d_spirv_build7_pfn build_pfn)
 {
-    struct vkd3d_spirv_declaration declaration;
-    struct rb_entry *entry;
+    struct vkd3d_spirv_declaration declaration, *d;
 
     declaration.op = op;
     declaration.parameter_count = 7;
     memcpy(&declaration.parameters, operands, declaration.parameter_count * sizeof(*operands));
 
-    if ((entry = rb_get(&builder->declarations, &declaration)))
-        return RB_ENTRY_VALUE(entry, struct vkd3d_spirv_declaration, entry)->id;
+    if ((d = vkd3d_spirv_find_declaration(builder, &declaration)))
+        return d->id;
 
     declaration.id = build_pfn(builder, operands[0], operands[1], operands[2],
             operands[3], operands[4], operands[5], operands[6]);
@@ -702,7 +700,7 @@ static void vkd3d_spirv_end_function_stream_insertion(struct vkd3d_spirv_builder
     builder->insertion_stream = builder->function_stream;
     builder->function_stream = builder->original_function_stream;
 
-    vkd3d_spirv_stream_insert(&builder->function_stream, builder->insertion_location,
+    vkd3d_spirv_stream_insert(&builder->function_stream, builder->arena, builder->insertion_location,
             insertion_stream->words, insertion_stream->word_count);
     vkd3d_spirv_stream_clear(insertion_stream);
     builder->insertion_location = ~(size_t)0;
@@ -1628,8 +1626,23 @@ static void vkd3d_spirv_decompose_sparse_result(struct vkd3d_spirv_builder *buil
     *result_id = vkd3d_spirv_build_op_composite_extract1(builder, result_type, val_id, 1);
 }
 
-static void vkd3d_spirv_builder_init(struct vkd3d_spirv_builder *builder)
+static void vkd3d_spirv_builder_begin(struct vkd3d_spirv_builder *builder)
 {
+    builder->insertion_location = ~(size_t)0;
+
+    builder->current_id = 1;
+
+    vkd3d_shader_hash_map_clear(&builder->declarations);
+
+    builder->main_function_id = vkd3d_spirv_alloc_id(builder);
+    vkd3d_spirv_build_op_name(builder, builder->main_function_id, "main");
+}
+
+static void vkd3d_spirv_builder_init(struct vkd3d_spirv_builder *builder, struct vkd3d_shader_arena *arena)
+{
+    builder->arena = arena;
+    vkd3d_shader_hash_map_init(&builder->declarations, vkd3d_spirv_declaration_equal);
+
     vkd3d_spirv_stream_init(&builder->debug_stream);
     vkd3d_spirv_stream_init(&builder->annotation_stream);
     vkd3d_spirv_stream_init(&builder->global_stream);
@@ -1637,14 +1650,40 @@ static void vkd3d_spirv_builder_init(struct vkd3d_spirv_builder *builder)
     vkd3d_spirv_stream_init(&builder->execution_mode_stream);
 
     vkd3d_spirv_stream_init(&builder->insertion_stream);
-    builder->insertion_location = ~(size_t)0;
 
-    builder->current_id = 1;
+    vkd3d_spirv_builder_begin(builder);
+}
 
-    rb_init(&builder->declarations, vkd3d_spirv_declaration_compare);
+/* Prepares the builder for another shader. Stream and array storage is kept,
+ * while declarations and inserted chunks go away with the arena. */
+static void vkd3d_spirv_builder_reset(struct vkd3d_spirv_builder *builder)
+{
+    vkd3d_spirv_stream_clear(&builder->debug_stream);
+    vkd3d_spirv_stream_clear(&builder->annotation_stream);
+    vkd3d_spirv_stream_clear(&builder->global_stream);
+    vkd3d_spirv_stream_clear(&builder->function_stream);
+    vkd3d_spirv_stream_clear(&builder->execution_mode_stream);
 
-    builder->main_function_id = vkd3d_spirv_alloc_id(builder);
-    vkd3d_spirv_build_op_name(builder, builder->main_function_id, "main");
+    vkd3d_spirv_stream_clear(&builder->insertion_stream);
+
+    builder->capability_count = 0;
+    builder->ext_instr_set_glsl_450 = 0;
+    builder->invocation_count = 0;
+    builder->execution_model = 0;
+    builder->type_sampler_id = 0;
+    builder->type_bool_id = 0;
+    builder->type_void_id = 0;
+    builder->main_function_location = 0;
+    builder->iface_element_count = 0;
+
+    vkd3d_spirv_builder_begin(builder);
+}
+
+static size_t vkd3d_spirv_builder_get_storage_size(const struct vkd3d_spirv_builder *builder)
+{
+    return (builder->debug_stream.capacity + builder->annotation_stream.capacity
+            + builder->global_stream.capacity + builder->function_stream.capacity
+            + builder->execution_mode_stream.capacity + builder->insertion_stream.capacity) * sizeof(uint32_t);
 }
 
 static void vkd3d_spirv_builder_begin_main_function(struct vkd3d_spirv_builder *builder)
@@ -1670,7 +1709,7 @@ static void vkd3d_spirv_builder_free(struct vkd3d_spirv_builder *builder)
 
     vkd3d_spirv_stream_free(&builder->insertion_stream);
 
-    rb_destroy(&builder->declarations, vkd3d_spirv_declaration_free, NULL);
+    vkd3d_shader_hash_map_free(&builder->declarations);
 
     vkd3d_free(builder->capabilities);
     vkd3d_free(builder->iface);
@@ -1888,7 +1927,7 @@ struct vkd3d_symbol_resource_data
 
 struct vkd3d_symbol
 {
-    struct rb_entry entry;
+    struct vkd3d_shader_hash_map_entry entry;
 
     enum
     {
@@ -1924,35 +1963,30 @@ struct vkd3d_sm51_symbol
     unsigned int resource_idx;
 };
 
-static int vkd3d_symbol_compare(const void *key, const struct rb_entry *entry)
+static bool vkd3d_symbol_equal(const void *key, const struct vkd3d_shader_hash_map_entry *entry)
 {
     const struct vkd3d_symbol *a = key;
-    const struct vkd3d_symbol *b = RB_ENTRY_VALUE(entry, const struct vkd3d_symbol, entry);
-
-    if (a->type != b->type)
-        return a->type - b->type;
-    return memcmp(&a->key, &b->key, sizeof(a->key));
-}
+    const struct vkd3d_symbol *b = VKD3D_SHADER_HASH_MAP_ENTRY_VALUE(entry, const struct vkd3d_symbol, entry);
 
-static int vkd3d_sm51_symbol_compare(const void *key, const struct rb_entry *entry)
-{
-    const struct vkd3d_sm51_symbol_key *a = key;
-    const struct vkd3d_sm51_symbol *b = RB_ENTRY_VALUE(entry, const struct vkd3d_sm51_symbol, entry);
-    return memcmp(a, &b->key, sizeof(*a));
+    return a->type == b->type && !memcmp(&a->key, &b->key, sizeof(a->key));
 }
 
-static void vkd3d_symbol_free(struct rb_entry *entry, void *context)
+static uint32_t vkd3d_symbol_hash(const struct vkd3d_symbol *symbol)
 {
-    struct vkd3d_symbol *s = RB_ENTRY_VALUE(entry, struct vkd3d_symbol, entry);
+    uint32_t hash = VKD3D_SHADER_HASH_INIT;
 
-    vkd3d_free(s);
+    /* Register and resource keys have the same layout. */
+    hash = vkd3d_shader_hash_u32(hash, symbol->type);
+    hash = vkd3d_shader_hash_u32(hash, symbol->key.reg.type);
+    hash = vkd3d_shader_hash_u32(hash, symbol->key.reg.idx);
+    return vkd3d_shader_hash_finalize(hash);
 }
 
-static void vkd3d_sm51_symbol_free(struct rb_entry *entry, void *context)
+static int vkd3d_sm51_symbol_compare(const void *key, const struct rb_entry *entry)
 {
-    struct vkd3d_sm51_symbol *s = RB_ENTRY_VALUE(entry, struct vkd3d_sm51_symbol, entry);
-
-    vkd3d_free(s);
+    const struct vkd3d_sm51_symbol_key *a = key;
+    const struct vkd3d_sm51_symbol *b = RB_ENTRY_VALUE(entry, const struct vkd3d_sm51_symbol, entry);
+    return memcmp(a, &b->key, sizeof(*a));
 }
 
 static void vkd3d_symbol_make_register(struct vkd3d_symbol *symbol,
@@ -1991,16 +2025,6 @@ static void vkd3d_symbol_make_resource(struct vkd3d_symbol *symbol,
     symbol->key.resource.idx = reg->idx[0].offset;
 }
 
-static struct vkd3d_symbol *vkd3d_symbol_dup(const struct vkd3d_symbol *symbol)
-{
-    struct vkd3d_symbol *s;
-
-    if (!(s = vkd3d_malloc(sizeof(*s))))
-        return NULL;
-
-    return memcpy(s, symbol, sizeof(*s));
-}
-
 static const char *debug_vkd3d_symbol(const struct vkd3d_symbol *symbol)
 {
     switch (symbol->type)
@@ -2112,10 +2136,11 @@ struct vkd3d_dxbc_compiler
 {
     struct vkd3d_shader_version shader_version;
     struct vkd3d_spirv_builder spirv_builder;
+    struct vkd3d_shader_arena arena;
 
     uint32_t options;
 
-    struct rb_tree symbol_table;
+    struct vkd3d_shader_hash_map symbol_table;
     uint32_t temp_id;
     unsigned int temp_count;
     struct vkd3d_hull_shader_variables hs;
@@ -2174,6 +2199,8 @@ struct vkd3d_dxbc_compiler
     struct vkd3d_shader_global_binding *global_bindings;
     size_t global_bindings_size;
     size_t global_binding_count;
+
+    struct vkd3d_shader_binding_index binding_index;
 };
 
 static bool shader_is_sm_5_1(const struct vkd3d_dxbc_compiler *compiler)
@@ -2188,6 +2215,103 @@ static bool is_control_point_phase(const struct vkd3d_shader_phase *phase)
 
 static void vkd3d_dxbc_compiler_emit_initial_declarations(struct vkd3d_dxbc_compiler *compiler);
 
+#define VKD3D_DXBC_COMPILER_ARENA_BLOCK_SIZE 0x8000
+
+/* Destroyed compilers are kept around and reused by later compilations, so
+ * that stream and array storage does not have to be grown from scratch for
+ * every shader. Compilers which grew large are freed instead. The lock only
+ * covers pushing and popping a pointer, and cached compilers are freed by an
+ * exit handler, which also runs when the library is unloaded. */
+#define VKD3D_DXBC_COMPILER_CACHE_SIZE 8
+#define VKD3D_DXBC_COMPILER_CACHE_MAX_STORAGE_SIZE 0x100000
+
+static spinlock_t vkd3d_dxbc_compiler_cache_lock;
+static struct vkd3d_dxbc_compiler *vkd3d_dxbc_compiler_cache[VKD3D_DXBC_COMPILER_CACHE_SIZE];
+static unsigned int vkd3d_dxbc_compiler_cache_count;
+static bool vkd3d_dxbc_compiler_cache_registered;
+static bool vkd3d_dxbc_compiler_cache_enabled;
+
+static struct vkd3d_dxbc_compiler *vkd3d_dxbc_compiler_alloc(void)
+{
+    struct vkd3d_dxbc_compiler *compiler = NULL;
+
+    spinlock_acquire(&vkd3d_dxbc_compiler_cache_lock);
+    if (vkd3d_dxbc_compiler_cache_count)
+        compiler = vkd3d_dxbc_compiler_cache[--vkd3d_dxbc_compiler_cache_count];
+    spinlock_release(&vkd3d_dxbc_compiler_cache_lock);
+
+    if (compiler)
+        return compiler;
+
+    if (!(compiler = vkd3d_malloc(sizeof(*compiler))))
+        return NULL;
+
+    memset(compiler, 0, sizeof(*compiler));
+
+    vkd3d_shader_arena_init(&compiler->arena, VKD3D_DXBC_COMPILER_ARENA_BLOCK_SIZE);
+    vkd3d_spirv_builder_init(&compiler->spirv_builder, &compiler->arena);
+    vkd3d_shader_hash_map_init(&compiler->symbol_table, vkd3d_symbol_equal);
+
+    return compiler;
+}
+
+static void vkd3d_dxbc_compiler_free(struct vkd3d_dxbc_compiler *compiler)
+{
+    vkd3d_free(compiler->control_flow_info);
+
+    vkd3d_spirv_builder_free(&compiler->spirv_builder);
+    vkd3d_shader_hash_map_free(&compiler->symbol_table);
+
+    vkd3d_free(compiler->shader_phases);
+    vkd3d_free(compiler->spec_constants);
+    vkd3d_free(compiler->global_bindings);
+    vkd3d_shader_binding_index_cleanup(&compiler->binding_index);
+
+    vkd3d_shader_arena_free(&compiler->arena);
+
+    vkd3d_free(compiler);
+}
+
+static void vkd3d_dxbc_compiler_cache_cleanup(void)
+{
+    struct vkd3d_dxbc_compiler *compilers[VKD3D_DXBC_COMPILER_CACHE_SIZE];
+    unsigned int i, count;
+
+    spinlock_acquire(&vkd3d_dxbc_compiler_cache_lock);
+    count = vkd3d_dxbc_compiler_cache_count;
+    memcpy(compilers, vkd3d_dxbc_compiler_cache, count * sizeof(*compilers));
+    vkd3d_dxbc_compiler_cache_count = 0;
+    spinlock_release(&vkd3d_dxbc_compiler_cache_lock);
+
+    for (i = 0; i < count; ++i)
+        vkd3d_dxbc_compiler_free(compilers[i]);
+}
+
+static void vkd3d_dxbc_compiler_reset(struct vkd3d_dxbc_compiler *compiler)
+{
+    struct vkd3d_dxbc_compiler old = *compiler;
+
+    memset(compiler, 0, sizeof(*compiler));
+
+    compiler->spirv_builder = old.spirv_builder;
+    compiler->arena = old.arena;
+    compiler->symbol_table = old.symbol_table;
+    compiler->control_flow_info = old.control_flow_info;
+    compiler->control_flow_info_size = old.control_flow_info_size;
+    compiler->shader_phases = old.shader_phases;
+    compiler->shader_phases_size = old.shader_phases_size;
+    compiler->spec_constants = old.spec_constants;
+    compiler->spec_constants_size = old.spec_constants_size;
+    compiler->global_bindings = old.global_bindings;
+    compiler->global_bindings_size = old.global_bindings_size;
+    compiler->binding_index.ranges = old.binding_index.ranges;
+    compiler->binding_index.ranges_size = old.binding_index.ranges_size;
+
+    vkd3d_shader_arena_reset(&compiler->arena);
+    vkd3d_spirv_builder_reset(&compiler->spirv_builder);
+    vkd3d_shader_hash_map_clear(&compiler->symbol_table);
+}
+
 struct vkd3d_dxbc_compiler *vkd3d_dxbc_compiler_create(const struct vkd3d_shader_version *shader_version,
         const struct vkd3d_shader_desc *shader_desc, uint32_t compiler_options,
         const struct vkd3d_shader_interface_info *shader_interface,
@@ -2200,24 +2324,21 @@ struct vkd3d_dxbc_compiler *vkd3d_dxbc_compiler_create(const struct vkd3d_shader
     unsigned int max_element_count;
     unsigned int i;
 
-    if (!(compiler = vkd3d_malloc(sizeof(*compiler))))
+    if (!(compiler = vkd3d_dxbc_compiler_alloc()))
         return NULL;
 
-    memset(compiler, 0, sizeof(*compiler));
-
     compiler->shader_version = *shader_version;
 
     max_element_count = max(output_signature->element_count, patch_constant_signature->element_count);
-    if (!(compiler->output_info = vkd3d_calloc(max_element_count, sizeof(*compiler->output_info))))
+    if (!(compiler->output_info = vkd3d_shader_arena_calloc(&compiler->arena,
+            max_element_count, sizeof(*compiler->output_info))))
     {
-        vkd3d_free(compiler);
+        vkd3d_dxbc_compiler_destroy(compiler);
         return NULL;
     }
 
-    vkd3d_spirv_builder_init(&compiler->spirv_builder);
     compiler->options = compiler_options;
 
-    rb_init(&compiler->symbol_table, vkd3d_symbol_compare);
     rb_init(&compiler->sm51_resource_table, vkd3d_sm51_symbol_compare);
 
     compiler->shader_type = shader_version->type;
@@ -2233,8 +2354,8 @@ struct vkd3d_dxbc_compiler *vkd3d_dxbc_compiler_create(const struct vkd3d_shader
         compiler->shader_interface = *shader_interface;
         if (shader_interface->push_constant_buffer_count)
         {
-            if (!(compiler->push_constants = vkd3d_calloc(shader_interface->push_constant_buffer_count,
-                    sizeof(*compiler->push_constants))))
+            if (!(compiler->push_constants = vkd3d_shader_arena_calloc(&compiler->arena,
+                    shader_interface->push_constant_buffer_count, sizeof(*compiler->push_constants))))
             {
                 vkd3d_dxbc_compiler_destroy(compiler);
                 return NULL;
@@ -2245,6 +2366,9 @@ struct vkd3d_dxbc_compiler *vkd3d_dxbc_compiler_create(const struct vkd3d_shader
     }
     compiler->compile_args = compile_args;
 
+    vkd3d_shader_binding_index_init(&compiler->binding_index, &compiler->shader_interface,
+            vkd3d_shader_visibility_from_shader_type(compiler->shader_type));
+
     compiler->scan_info = scan_info;
 
     vkd3d_dxbc_compiler_emit_initial_declarations(compiler);
@@ -2375,29 +2499,18 @@ static const struct vkd3d_shader_resource_binding *vkd3d_dxbc_compiler_get_resou
         enum vkd3d_shader_binding_flag binding_flag)
 {
     const struct vkd3d_shader_interface_info *shader_interface = &compiler->shader_interface;
+    const struct vkd3d_shader_resource_binding *binding;
     enum vkd3d_shader_descriptor_type descriptor_type;
-    unsigned int i, reg_space = 0, reg_idx = 0;
+    unsigned int reg_space = 0, reg_idx = 0;
 
     descriptor_type = vkd3d_shader_descriptor_type_from_register_type(reg->type);
 
     if (!vkd3d_get_binding_info_for_register(compiler, reg, &reg_space, &reg_idx))
         ERR("Failed to find binding for resource type %#x.\n", reg->type);
 
-    for (i = 0; i < shader_interface->binding_count; ++i)
-    {
-        const struct vkd3d_shader_resource_binding *current = &shader_interface->bindings[i];
-
-        if (!(current->flags & binding_flag))
-            continue;
-
-        if (!vkd3d_dxbc_compiler_check_shader_visibility(compiler, current->shader_visibility))
-            continue;
-
-        if (descriptor_type == current->type && reg_space == current->register_space && reg_idx >= current->register_index
-                && (current->register_count == VKD3D_SHADER_DESCRIPTOR_RANGE_UNBOUNDED
-                        || reg_idx < current->register_index + current->register_count))
-            return current;
-    }
+    if ((binding = vkd3d_shader_binding_index_find(&compiler->binding_index,
+            descriptor_type, reg_space, reg_idx, binding_flag, 0)))
+        return binding;
 
     if (shader_interface->binding_count)
         FIXME("Could not find binding for type %#x, register %u, space %u, shader type %#x, flag %#x.\n",
@@ -2461,12 +2574,24 @@ static void vkd3d_dxbc_compiler_put_symbol(struct vkd3d_dxbc_compiler *compiler,
 {
     struct vkd3d_symbol *s;
 
-    s = vkd3d_symbol_dup(symbol);
-    if (rb_put(&compiler->symbol_table, s, &s->entry) == -1)
+    if (!(s = vkd3d_shader_arena_copy(&compiler->arena, symbol, sizeof(*s))))
     {
-        ERR("Failed to insert symbol entry (%s).\n", debug_vkd3d_symbol(symbol));
-        vkd3d_free(s);
+        ERR("Failed to allocate symbol entry (%s).\n", debug_vkd3d_symbol(symbol));
+        return;
     }
+    s->entry.hash = vkd3d_symbol_hash(s);
+    if (vkd3d_shader_hash_map_put(&compiler->symbol_table, s, &s->entry) == -1)
+        ERR("Failed to insert symbol entry (%s).\n", debug_vkd3d_symbol(symbol));
+}
+
+static struct vkd3d_symbol *vkd3d_dxbc_compiler_find_symbol(const struct vkd3d_dxbc_compiler *compiler,
+        const struct vkd3d_symbol *key)
+{
+    struct vkd3d_shader_hash_map_entry *entry;
+
+    if (!(entry = vkd3d_shader_hash_map_get(&compiler->symbol_table, key, vkd3d_symbol_hash(key))))
+        return NULL;
+    return VKD3D_SHADER_HASH_MAP_ENTRY_VALUE(entry, struct vkd3d_symbol, entry);
 }
 
 static uint32_t vkd3d_dxbc_compiler_get_constant(struct vkd3d_dxbc_compiler *compiler,
@@ -2874,7 +2999,6 @@ static bool vkd3d_dxbc_compiler_find_register_info(const struct vkd3d_dxbc_compi
         const struct vkd3d_shader_register *reg, struct vkd3d_shader_register_info *register_info)
 {
     struct vkd3d_symbol reg_symbol, *symbol;
-    struct rb_entry *entry;
 
     assert(reg->type != VKD3DSPR_IMMCONST);
 
@@ -2894,13 +3018,12 @@ static bool vkd3d_dxbc_compiler_find_register_info(const struct vkd3d_dxbc_compi
     }
 
     vkd3d_symbol_make_register(&reg_symbol, reg);
-    if (!(entry = rb_get(&compiler->symbol_table, &reg_symbol)))
+    if (!(symbol = vkd3d_dxbc_compiler_find_symbol(compiler, &reg_symbol)))
     {
         memset(register_info, 0, sizeof(*register_info));
         return false;
     }
 
-    symbol = RB_ENTRY_VALUE(entry, struct vkd3d_symbol, entry);
     register_info->id = symbol->id;
     register_info->storage_class = symbol->info.reg.storage_class;
     register_info->member_idx = symbol->info.reg.member_idx;
@@ -4143,7 +4266,7 @@ static uint32_t vkd3d_dxbc_compiler_emit_input(struct vkd3d_dxbc_compiler *compi
     struct vkd3d_symbol reg_symbol;
     struct vkd3d_symbol tmp_symbol;
     SpvStorageClass storage_class;
-    struct rb_entry *entry = NULL;
+    const struct vkd3d_symbol *symbol = NULL;
     bool use_private_var = false;
     unsigned int write_mask;
     unsigned int array_size;
@@ -4218,11 +4341,11 @@ static uint32_t vkd3d_dxbc_compiler_emit_input(struct vkd3d_dxbc_compiler *compi
     if (builtin)
     {
         input_id = vkd3d_dxbc_compiler_emit_builtin_variable(compiler, builtin, storage_class, array_size);
-        entry = rb_get(&compiler->symbol_table, &reg_symbol);
+        symbol = vkd3d_dxbc_compiler_find_symbol(compiler, &reg_symbol);
     }
-    else if ((entry = rb_get(&compiler->symbol_table, &reg_symbol)))
+    else if ((symbol = vkd3d_dxbc_compiler_find_symbol(compiler, &reg_symbol)))
     {
-        input_id = RB_ENTRY_VALUE(entry, const struct vkd3d_symbol, entry)->id;
+        input_id = symbol->id;
 
         if (use_private_var)
         {
@@ -4252,9 +4375,9 @@ static uint32_t vkd3d_dxbc_compiler_emit_input(struct vkd3d_dxbc_compiler *compi
             tmp_symbol = reg_symbol;
             tmp_symbol.key.reg.type = VKD3DSPR_INPUT;
 
-            if ((entry = rb_get(&compiler->symbol_table, &tmp_symbol)))
+            if ((symbol = vkd3d_dxbc_compiler_find_symbol(compiler, &tmp_symbol)))
             {
-                tmp_symbol = *RB_ENTRY_VALUE(entry, const struct vkd3d_symbol, entry);
+                tmp_symbol = *symbol;
                 tmp_symbol.key.reg.type = VKD3DSPR_INCONTROLPOINT;
                 vkd3d_dxbc_compiler_put_symbol(compiler, &tmp_symbol);
 
@@ -4262,7 +4385,7 @@ static uint32_t vkd3d_dxbc_compiler_emit_input(struct vkd3d_dxbc_compiler *compi
             }
         }
 
-        if (!entry)
+        if (!symbol)
         {
             unsigned int location = reg_idx;
 
@@ -4283,7 +4406,7 @@ static uint32_t vkd3d_dxbc_compiler_emit_input(struct vkd3d_dxbc_compiler *compi
     if (reg->type == VKD3DSPR_PATCHCONST)
         vkd3d_spirv_build_op_decorate(builder, input_id, SpvDecorationPatch, NULL, 0);
 
-    if (entry || !use_private_var)
+    if (symbol || !use_private_var)
     {
         var_id = input_id;
     }
@@ -4294,7 +4417,7 @@ static uint32_t vkd3d_dxbc_compiler_emit_input(struct vkd3d_dxbc_compiler *compi
                 storage_class, VKD3D_TYPE_FLOAT, component_count, array_size);
     }
 
-    if (!entry)
+    if (!symbol)
     {
         vkd3d_symbol_set_register_info(&reg_symbol, var_id, storage_class,
                 use_private_var ? VKD3D_TYPE_FLOAT : component_type, write_mask);
@@ -4359,7 +4482,6 @@ static void vkd3d_dxbc_compiler_emit_input_register(struct vkd3d_dxbc_compiler *
     const struct vkd3d_shader_register *reg = &dst->reg;
     const struct vkd3d_spirv_builtin *builtin;
     struct vkd3d_symbol reg_symbol;
-    struct rb_entry *entry;
     uint32_t input_id;
 
     assert(!reg->idx[0].rel_addr);
@@ -4374,7 +4496,7 @@ static void vkd3d_dxbc_compiler_emit_input_register(struct vkd3d_dxbc_compiler *
 
     /* vPrim may be declared in multiple hull shader phases. */
     vkd3d_symbol_make_register(&reg_symbol, reg);
-    if ((entry = rb_get(&compiler->symbol_table, &reg_symbol)))
+    if (vkd3d_dxbc_compiler_find_symbol(compiler, &reg_symbol))
         return;
 
     input_id = vkd3d_dxbc_compiler_emit_builtin_variable(compiler, builtin, SpvStorageClassInput, 0);
@@ -4633,7 +4755,7 @@ static void vkd3d_dxbc_compiler_emit_output(struct vkd3d_dxbc_compiler *compiler
     const struct vkd3d_shader_phase *phase;
     struct vkd3d_symbol reg_symbol;
     SpvStorageClass storage_class;
-    struct rb_entry *entry = NULL;
+    const struct vkd3d_symbol *symbol = NULL;
     unsigned int signature_idx;
     bool use_private_variable;
     unsigned int write_mask;
@@ -4698,12 +4820,12 @@ static void vkd3d_dxbc_compiler_emit_output(struct vkd3d_dxbc_compiler *compiler
         {
             use_private_variable = true;
             write_mask = VKD3DSP_WRITEMASK_ALL;
-            entry = rb_get(&compiler->symbol_table, &reg_symbol);
+            symbol = vkd3d_dxbc_compiler_find_symbol(compiler, &reg_symbol);
         }
     }
-    else if (!use_private_variable && (entry = rb_get(&compiler->symbol_table, &reg_symbol)))
+    else if (!use_private_variable && (symbol = vkd3d_dxbc_compiler_find_symbol(compiler, &reg_symbol)))
     {
-        id = RB_ENTRY_VALUE(entry, const struct vkd3d_symbol, entry)->id;
+        id = symbol->id;
     }
     else
     {
@@ -4760,8 +4882,8 @@ static void vkd3d_dxbc_compiler_emit_output(struct vkd3d_dxbc_compiler *compiler
     if (use_private_variable)
         storage_class = SpvStorageClassPrivate;
 
-    if (entry || (entry = rb_get(&compiler->symbol_table, &reg_symbol)))
-        var_id = RB_ENTRY_VALUE(entry, const struct vkd3d_symbol, entry)->id;
+    if (symbol || (symbol = vkd3d_dxbc_compiler_find_symbol(compiler, &reg_symbol)))
+        var_id = symbol->id;
     else if (!use_private_variable)
         var_id = id;
     else if (is_patch_constant)
@@ -4769,7 +4891,7 @@ static void vkd3d_dxbc_compiler_emit_output(struct vkd3d_dxbc_compiler *compiler
     else
         var_id = vkd3d_dxbc_compiler_emit_variable(compiler, &builder->global_stream,
                 storage_class, VKD3D_TYPE_FLOAT, VKD3D_VEC4_SIZE);
-    if (!entry)
+    if (!symbol)
     {
         vkd3d_symbol_set_register_info(&reg_symbol, var_id, storage_class,
                 use_private_variable ? VKD3D_TYPE_FLOAT : component_type, write_mask);
@@ -5450,13 +5572,12 @@ static void vkd3d_dxbc_compiler_emit_dcl_constant_buffer(struct vkd3d_dxbc_compi
     if (shader_is_sm_5_1(compiler))
     {
         struct vkd3d_sm51_symbol *sym;
-        sym = vkd3d_calloc(1, sizeof(*sym));
+        sym = vkd3d_shader_arena_calloc(&compiler->arena, 1, sizeof(*sym));
         sym->key.idx = reg->idx[0].offset;
         sym->key.descriptor_type = VKD3D_SHADER_DESCRIPTOR_TYPE_CBV;
         sym->register_space = instruction->declaration.cb.register_space;
         sym->resource_idx = instruction->declaration.cb.register_index;
-        if (rb_put(&compiler->sm51_resource_table, &sym->key, &sym->entry) == -1)
-            vkd3d_free(sym);
+        rb_put(&compiler->sm51_resource_table, &sym->key, &sym->entry);
     }
 
     if ((push_cb = vkd3d_dxbc_compiler_find_push_constant_buffer(compiler, cb)))
@@ -5562,13 +5683,12 @@ static void vkd3d_dxbc_compiler_emit_dcl_sampler(struct vkd3d_dxbc_compiler *com
     if (shader_is_sm_5_1(compiler))
     {
         struct vkd3d_sm51_symbol *sym;
-        sym = vkd3d_calloc(1, sizeof(*sym));
+        sym = vkd3d_shader_arena_calloc(&compiler->arena, 1, sizeof(*sym));
         sym->key.idx = reg->idx[0].offset;
         sym->key.descriptor_type = VKD3D_SHADER_DESCRIPTOR_TYPE_SAMPLER;
         sym->register_space = instruction->declaration.sampler.register_space;
         sym->resource_idx = instruction->declaration.sampler.register_index;
-        if (rb_put(&compiler->sm51_resource_table, &sym->key, &sym->entry) == -1)
-            vkd3d_free(sym);
+        rb_put(&compiler->sm51_resource_table, &sym->key, &sym->entry);
     }
 
     binding = vkd3d_dxbc_compiler_get_resource_binding(compiler, reg,
@@ -5800,13 +5920,12 @@ static void vkd3d_dxbc_compiler_emit_dcl_resource(struct vkd3d_dxbc_compiler *co
     if (shader_is_sm_5_1(compiler))
     {
         struct vkd3d_sm51_symbol *sym;
-        sym = vkd3d_calloc(1, sizeof(*sym));
+        sym = vkd3d_shader_arena_calloc(&compiler->arena, 1, sizeof(*sym));
         sym->key.idx = semantic->reg.reg.idx[0].offset;
         sym->key.descriptor_type = semantic->reg.reg.type == VKD3DSPR_UAV ? VKD3D_SHADER_DESCRIPTOR_TYPE_UAV : VKD3D_SHADER_DESCRIPTOR_TYPE_SRV;
         sym->register_space = semantic->register_space;
         sym->resource_idx = semantic->register_index;
-        if (rb_put(&compiler->sm51_resource_table, &sym->key, &sym->entry) == -1)
-            vkd3d_free(sym);
+        rb_put(&compiler->sm51_resource_table, &sym->key, &sym->entry);
     }
 
     if (instruction->flags)
@@ -5824,13 +5943,12 @@ static void vkd3d_dxbc_compiler_emit_dcl_resource_raw(struct vkd3d_dxbc_compiler
     if (shader_is_sm_5_1(compiler))
     {
         struct vkd3d_sm51_symbol *sym;
-        sym = vkd3d_calloc(1, sizeof(*sym));
+        sym = vkd3d_shader_arena_calloc(&compiler->arena, 1, sizeof(*sym));
         sym->key.idx = resource->dst.reg.idx[0].offset;
         sym->key.descriptor_type = resource->dst.reg.type == VKD3DSPR_UAV ? VKD3D_SHADER_DESCRIPTOR_TYPE_UAV : VKD3D_SHADER_DESCRIPTOR_TYPE_SRV;
         sym->register_space = resource->register_space;
         sym->resource_idx = resource->register_index;
-        if (rb_put(&compiler->sm51_resource_table, &sym->key, &sym->entry) == -1)
-            vkd3d_free(sym);
+        rb_put(&compiler->sm51_resource_table, &sym->key, &sym->entry);
     }
 
     if (instruction->flags)
@@ -5850,13 +5968,12 @@ static void vkd3d_dxbc_compiler_emit_dcl_resource_structured(struct vkd3d_dxbc_c
     if (shader_is_sm_5_1(compiler))
     {
         struct vkd3d_sm51_symbol *sym;
-        sym = vkd3d_calloc(1, sizeof(*sym));
+        sym = vkd3d_shader_arena_calloc(&compiler->arena, 1, sizeof(*sym));
         sym->key.idx = resource->reg.reg.idx[0].offset;
         sym->key.descriptor_type = resource->reg.reg.type == VKD3DSPR_UAV ? VKD3D_SHADER_DESCRIPTOR_TYPE_UAV : VKD3D_SHADER_DESCRIPTOR_TYPE_SRV;
         sym->register_space = resource->register_space;
         sym->resource_idx = resource->register_index;
-        if (rb_put(&compiler->sm51_resource_table, &sym->key, &sym->entry) == -1)
-            vkd3d_free(sym);
+        rb_put(&compiler->sm51_resource_table, &sym->key, &sym->entry);
     }
 
     if (instruction->flags)
@@ -6195,7 +6312,6 @@ static void vkd3d_dxbc_compiler_leave_shader_phase(struct vkd3d_dxbc_compiler *c
     struct vkd3d_spirv_builder *builder = &compiler->spirv_builder;
     struct vkd3d_symbol reg_symbol, *symbol;
     struct vkd3d_shader_register reg;
-    struct rb_entry *entry;
     unsigned int i;
 
     vkd3d_spirv_build_op_function_end(builder);
@@ -6233,11 +6349,9 @@ static void vkd3d_dxbc_compiler_leave_shader_phase(struct vkd3d_dxbc_compiler *c
             reg.type = VKD3DSPR_OUTPUT;
             reg.idx[0].offset = e->register_index;
             vkd3d_symbol_make_register(&reg_symbol, &reg);
-            if ((entry = rb_get(&compiler->symbol_table, &reg_symbol)))
+            if ((symbol = vkd3d_dxbc_compiler_find_symbol(compiler, &reg_symbol)))
             {
-                rb_remove(&compiler->symbol_table, entry);
-
-                symbol = RB_ENTRY_VALUE(entry, struct vkd3d_symbol, entry);
+                vkd3d_shader_hash_map_remove(&compiler->symbol_table, &symbol->entry);
 
                 reg.type = VKD3DSPR_OUTCONTROLPOINT;
                 reg.idx[1].offset = reg.idx[0].offset;
@@ -6245,11 +6359,9 @@ static void vkd3d_dxbc_compiler_leave_shader_phase(struct vkd3d_dxbc_compiler *c
                 vkd3d_symbol_make_register(symbol, &reg);
                 symbol->info.reg.is_aggregate = false;
 
-                if (rb_put(&compiler->symbol_table, symbol, entry) == -1)
-                {
+                symbol->entry.hash = vkd3d_symbol_hash(symbol);
+                if (vkd3d_shader_hash_map_put(&compiler->symbol_table, symbol, &symbol->entry) == -1)
                     ERR("Failed to insert vocp symbol entry (%s).\n", debug_vkd3d_symbol(symbol));
-                    vkd3d_symbol_free(entry, NULL);
-                }
             }
         }
     }
@@ -6269,11 +6381,8 @@ static void vkd3d_dxbc_compiler_leave_shader_phase(struct vkd3d_dxbc_compiler *c
             reg.idx[0].offset = e->register_index;
             vkd3d_symbol_make_register(&reg_symbol, &reg);
 
-            if ((entry = rb_get(&compiler->symbol_table, &reg_symbol)))
-            {
-                rb_remove(&compiler->symbol_table, entry);
-                vkd3d_symbol_free(entry, NULL);
-            }
+            if ((symbol = vkd3d_dxbc_compiler_find_symbol(compiler, &reg_symbol)))
+                vkd3d_shader_hash_map_remove(&compiler->symbol_table, &symbol->entry);
         }
     }
 
@@ -6282,11 +6391,8 @@ static void vkd3d_dxbc_compiler_leave_shader_phase(struct vkd3d_dxbc_compiler *c
         reg.type = phase->type == VKD3DSIH_HS_FORK_PHASE ? VKD3DSPR_FORKINSTID : VKD3DSPR_JOININSTID;
         reg.idx[0].offset = ~0u;
         vkd3d_symbol_make_register(&reg_symbol, &reg);
-        if ((entry = rb_get(&compiler->symbol_table, &reg_symbol)))
-        {
-            rb_remove(&compiler->symbol_table, entry);
-            vkd3d_symbol_free(entry, NULL);
-        }
+        if ((symbol = vkd3d_dxbc_compiler_find_symbol(compiler, &reg_symbol)))
+            vkd3d_shader_hash_map_remove(&compiler->symbol_table, &symbol->entry);
     }
 }
 
@@ -7606,13 +7712,12 @@ struct vkd3d_shader_image
 static const struct vkd3d_symbol *vkd3d_dxbc_compiler_find_resource(struct vkd3d_dxbc_compiler *compiler,
         const struct vkd3d_shader_register *resource_reg)
 {
-    struct vkd3d_symbol resource_key;
-    struct rb_entry *entry;
+    struct vkd3d_symbol resource_key, *symbol;
 
     vkd3d_symbol_make_resource(&resource_key, resource_reg);
-    entry = rb_get(&compiler->symbol_table, &resource_key);
-    assert(entry);
-    return RB_ENTRY_VALUE(entry, struct vkd3d_symbol, entry);
+    symbol = vkd3d_dxbc_compiler_find_symbol(compiler, &resource_key);
+    assert(symbol);
+    return symbol;
 }
 
 static uint32_t vkd3d_dxbc_compiler_load_descriptor_table_offset(struct vkd3d_dxbc_compiler *compiler,
@@ -9459,25 +9564,33 @@ int vkd3d_dxbc_compiler_generate_spirv(struct vkd3d_dxbc_compiler *compiler,
     if (!vkd3d_spirv_compile_module(builder, spirv))
         return VKD3D_ERROR;
 
+    if (compiler->options & VKD3D_SHADER_OPTIMIZE)
+        vkd3d_spirv_optimize(spirv);
+
     return VKD3D_OK;
 }
 
 void vkd3d_dxbc_compiler_destroy(struct vkd3d_dxbc_compiler *compiler)
 {
-    vkd3d_free(compiler->control_flow_info);
-
-    vkd3d_free(compiler->output_info);
-
-    vkd3d_free(compiler->push_constants);
-
-    vkd3d_spirv_builder_free(&compiler->spirv_builder);
+    bool cached = false;
 
-    rb_destroy(&compiler->symbol_table, vkd3d_symbol_free, NULL);
-    rb_destroy(&compiler->sm51_resource_table, vkd3d_sm51_symbol_free, NULL);
+    if (vkd3d_spirv_builder_get_storage_size(&compiler->spirv_builder) <= VKD3D_DXBC_COMPILER_CACHE_MAX_STORAGE_SIZE)
+    {
+        vkd3d_dxbc_compiler_reset(compiler);
 
-    vkd3d_free(compiler->shader_phases);
-    vkd3d_free(compiler->spec_constants);
-    vkd3d_free(compiler->global_bindings);
+        spinlock_acquire(&vkd3d_dxbc_compiler_cache_lock);
+        /* Compilers are only cached once they are sure to be freed. */
+        if (!vkd3d_dxbc_compiler_cache_registered)
+        {
+            vkd3d_dxbc_compiler_cache_registered = true;
+            vkd3d_dxbc_compiler_cache_enabled = !atexit(vkd3d_dxbc_compiler_cache_cleanup);
+        }
+        if ((cached = vkd3d_dxbc_compiler_cache_enabled
+                && vkd3d_dxbc_compiler_cache_count < VKD3D_DXBC_COMPILER_CACHE_SIZE))
+            vkd3d_dxbc_compiler_cache[vkd3d_dxbc_compiler_cache_count++] = compiler;
+        spinlock_release(&vkd3d_dxbc_compiler_cache_lock);
+    }
 
-    vkd3d_free(compiler);
+    if (!cached)
+        vkd3d_dxbc_compiler_free(compiler);
 }
@@ -0,0 +1,898 @@
+/*
+ * Copyright 2020 VKD3D contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "vkd3d_shader_private.h"
+
+#include "spirv/unified1/spirv.h"
+
+/* A small optimizer for the SPIR-V generated by vkd3d_dxbc_compiler. It
+ * folds scalar 32-bit integer arithmetic on constants, removes Function and
+ * Private variables which are never read together with the stores to them,
+ * removes unused instructions, types and constants, and trims unused input
+ * variables from the entry point interface.
+ *
+ * The optimizer runs a fixed number of linear passes over the module, and
+ * larger modules are left alone. Result ids are never renumbered. Modules
+ * using opcodes the optimizer doesn't know about are returned unchanged. */
+
+#define VKD3D_SPIRV_OPT_MAX_WORD_COUNT 0x100000
+#define VKD3D_SPIRV_OPT_MAX_ID_BOUND   0x40000
+
+#define VKD3D_SPIRV_HEADER_WORD_COUNT  5
+
+enum vkd3d_spirv_opt_op_flag
+{
+    VKD3D_SPIRV_OPT_OP_RESULT     = 0x01, /* The result id is in word 1, or word 2 with a result type. */
+    VKD3D_SPIRV_OPT_OP_TYPE       = 0x02,
+    VKD3D_SPIRV_OPT_OP_REMOVABLE  = 0x04, /* No side effects, may be removed if the result is unused. */
+    VKD3D_SPIRV_OPT_OP_LITERALS   = 0x08, /* Operands following the result id are literals. */
+    VKD3D_SPIRV_OPT_OP_ANNOTATION = 0x10, /* Names or decorates the id in word 1. */
+};
+
+enum vkd3d_spirv_opt_instruction_flag
+{
+    VKD3D_SPIRV_OPT_INSTRUCTION_REMOVED = 0x01,
+    VKD3D_SPIRV_OPT_INSTRUCTION_FOLDED  = 0x02, /* Replaced by an OpConstant with the same result id. */
+    VKD3D_SPIRV_OPT_INSTRUCTION_QUEUED  = 0x04,
+};
+
+enum vkd3d_spirv_opt_id_flag
+{
+    VKD3D_SPIRV_OPT_ID_CONSTANT     = 0x01, /* A 32-bit scalar constant. */
+    VKD3D_SPIRV_OPT_ID_READ         = 0x02,
+    VKD3D_SPIRV_OPT_ID_DEAD_POINTER = 0x04,
+    VKD3D_SPIRV_OPT_ID_KEEP         = 0x08,
+};
+
+struct vkd3d_spirv_opt_instruction
+{
+    uint32_t offset;
+    uint8_t op_flags;
+    uint8_t flags;
+};
+
+struct vkd3d_spirv_optimizer
+{
+    const uint32_t *code;
+    size_t word_count;
+    uint32_t bound;
+
+    struct vkd3d_spirv_opt_instruction *instructions;
+    size_t instructions_size;
+    size_t instruction_count;
+    size_t function_start;
+    size_t entry_point;
+    unsigned int entry_point_interface;
+
+    /* Indexed by id. Definitions are instruction indices plus one. */
+    uint32_t *definitions;
+    uint32_t *use_counts;
+    uint32_t *constant_values;
+    uint8_t *id_flags;
+
+    uint32_t *worklist;
+    size_t worklist_count;
+};
+
+static bool vkd3d_spirv_opt_get_op_flags(SpvOp op, unsigned int *flags)
+{
+    static const unsigned int pure = VKD3D_SPIRV_OPT_OP_RESULT | VKD3D_SPIRV_OPT_OP_TYPE
+            | VKD3D_SPIRV_OPT_OP_REMOVABLE;
+
+    switch (op)
+    {
+        case SpvOpCapability:
+        case SpvOpExtension:
+        case SpvOpMemoryModel:
+            *flags = VKD3D_SPIRV_OPT_OP_LITERALS;
+            return true;
+
+        case SpvOpExtInstImport:
+            *flags = VKD3D_SPIRV_OPT_OP_RESULT | VKD3D_SPIRV_OPT_OP_LITERALS;
+            return true;
+
+        case SpvOpName:
+        case SpvOpMemberName:
+        case SpvOpDecorate:
+        case SpvOpMemberDecorate:
+            *flags = VKD3D_SPIRV_OPT_OP_ANNOTATION;
+            return true;
+
+        case SpvOpTypeVoid:
+        case SpvOpTypeBool:
+        case SpvOpTypeInt:
+        case SpvOpTypeFloat:
+        case SpvOpTypeVector:
+        case SpvOpTypeImage:
+        case SpvOpTypeSampler:
+        case SpvOpTypeSampledImage:
+        case SpvOpTypeArray:
+        case SpvOpTypeRuntimeArray:
+        case SpvOpTypeStruct:
+        case SpvOpTypePointer:
+        case SpvOpTypeFunction:
+            *flags = VKD3D_SPIRV_OPT_OP_RESULT | VKD3D_SPIRV_OPT_OP_REMOVABLE;
+            return true;
+
+        case SpvOpConstant:
+        case SpvOpSpecConstant:
+            *flags = pure | VKD3D_SPIRV_OPT_OP_LITERALS;
+            return true;
+
+        case SpvOpLabel:
+            *flags = VKD3D_SPIRV_OPT_OP_RESULT;
+            return true;
+
+        /* Removability of loads and variables depends on their operands. */
+        case SpvOpVariable:
+        case SpvOpLoad:
+        case SpvOpFunction:
+        case SpvOpFunctionParameter:
+        case SpvOpFunctionCall:
+        case SpvOpAtomicAnd:
+        case SpvOpAtomicCompareExchange:
+        case SpvOpAtomicExchange:
+        case SpvOpAtomicIAdd:
+        case SpvOpAtomicIDecrement:
+        case SpvOpAtomicIIncrement:
+        case SpvOpAtomicOr:
+        case SpvOpAtomicSMax:
+        case SpvOpAtomicSMin:
+        case SpvOpAtomicUMax:
+        case SpvOpAtomicUMin:
+        case SpvOpAtomicXor:
+            *flags = VKD3D_SPIRV_OPT_OP_RESULT | VKD3D_SPIRV_OPT_OP_TYPE;
+            return true;
+
+        case SpvOpEntryPoint:
+        case SpvOpExecutionMode:
+        case SpvOpFunctionEnd:
+        case SpvOpStore:
+        case SpvOpCopyMemory:
+        case SpvOpImageWrite:
+        case SpvOpControlBarrier:
+        case SpvOpMemoryBarrier:
+        case SpvOpEmitVertex:
+        case SpvOpEndPrimitive:
+        case SpvOpSelectionMerge:
+        case SpvOpLoopMerge:
+        case SpvOpBranch:
+        case SpvOpBranchConditional:
+        case SpvOpSwitch:
+        case SpvOpReturn:
+        case SpvOpKill:
+        case SpvOpDemoteToHelperInvocationEXT:
+            *flags = 0;
+            return true;
+
+        case SpvOpConstantComposite:
+        case SpvOpUndef:
+        case SpvOpAccessChain:
+        case SpvOpInBoundsAccessChain:
+        case SpvOpImageTexelPointer:
+        case SpvOpCompositeConstruct:
+        case SpvOpCompositeExtract:
+        case SpvOpCompositeInsert:
+        case SpvOpVectorShuffle:
+        case SpvOpConvertFToS:
+        case SpvOpConvertFToU:
+        case SpvOpConvertSToF:
+        case SpvOpConvertUToF:
+        case SpvOpBitcast:
+        case SpvOpFAdd:
+        case SpvOpFDiv:
+        case SpvOpFMul:
+        case SpvOpFNegate:
+        case SpvOpFOrdEqual:
+        case SpvOpFOrdGreaterThanEqual:
+        case SpvOpFOrdLessThan:
+        case SpvOpFUnordNotEqual:
+        case SpvOpIAdd:
+        case SpvOpISub:
+        case SpvOpIMul:
+        case SpvOpIEqual:
+        case SpvOpINotEqual:
+        case SpvOpSNegate:
+        case SpvOpSMulExtended:
+        case SpvOpSGreaterThanEqual:
+        case SpvOpSLessThan:
+        case SpvOpUDiv:
+        case SpvOpUMod:
+        case SpvOpUGreaterThanEqual:
+        case SpvOpULessThan:
+        case SpvOpULessThanEqual:
+        case SpvOpLogicalAnd:
+        case SpvOpSelect:
+        case SpvOpNot:
+        case SpvOpBitwiseAnd:
+        case SpvOpBitwiseOr:
+        case SpvOpBitwiseXor:
+        case SpvOpShiftLeftLogical:
+        case SpvOpShiftRightArithmetic:
+        case SpvOpShiftRightLogical:
+        case SpvOpBitCount:
+        case SpvOpBitFieldInsert:
+        case SpvOpBitFieldSExtract:
+        case SpvOpBitFieldUExtract:
+        case SpvOpBitReverse:
+        case SpvOpDot:
+        case SpvOpDPdx:
+        case SpvOpDPdxCoarse:
+        case SpvOpDPdxFine:
+        case SpvOpDPdy:
+        case SpvOpDPdyCoarse:
+        case SpvOpDPdyFine:
+        case SpvOpExtInst:
+        case SpvOpSampledImage:
+        case SpvOpImageSampleImplicitLod:
+        case SpvOpImageSampleExplicitLod:
+        case SpvOpImageSampleDrefImplicitLod:
+        case SpvOpImageSampleDrefExplicitLod:
+        case SpvOpImageFetch:
+        case SpvOpImageGather:
+        case SpvOpImageDrefGather:
+        case SpvOpImageRead:
+        case SpvOpImageQuerySizeLod:
+        case SpvOpImageQuerySize:
+        case SpvOpImageQueryLod:
+        case SpvOpImageQueryLevels:
+        case SpvOpImageQuerySamples:
+        case SpvOpImageSparseSampleImplicitLod:
+        case SpvOpImageSparseSampleExplicitLod:
+        case SpvOpImageSparseSampleDrefImplicitLod:
+        case SpvOpImageSparseSampleDrefExplicitLod:
+        case SpvOpImageSparseFetch:
+        case SpvOpImageSparseGather:
+        case SpvOpImageSparseDrefGather:
+        case SpvOpImageSparseTexelsResident:
+        case SpvOpImageSparseRead:
+            *flags = pure;
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+static const uint32_t *vkd3d_spirv_opt_get_words(const struct vkd3d_spirv_optimizer *opt, size_t index)
+{
+    return &opt->code[opt->instructions[index].offset];
+}
+
+static SpvOp vkd3d_spirv_opt_get_op(const struct vkd3d_spirv_optimizer *opt, size_t index)
+{
+    return vkd3d_spirv_opt_get_words(opt, index)[0] & SpvOpCodeMask;
+}
+
+static unsigned int vkd3d_spirv_opt_get_word_count(const struct vkd3d_spirv_optimizer *opt, size_t index)
+{
+    return vkd3d_spirv_opt_get_words(opt, index)[0] >> SpvWordCountShift;
+}
+
+static uint32_t vkd3d_spirv_opt_get_result_id(const struct vkd3d_spirv_optimizer *opt, size_t index)
+{
+    const struct vkd3d_spirv_opt_instruction *instruction = &opt->instructions[index];
+
+    if (!(instruction->op_flags & VKD3D_SPIRV_OPT_OP_RESULT))
+        return 0;
+    return opt->code[instruction->offset + (instruction->op_flags & VKD3D_SPIRV_OPT_OP_TYPE ? 2 : 1)];
+}
+
+static const struct vkd3d_spirv_opt_instruction *vkd3d_spirv_opt_get_definition(
+        const struct vkd3d_spirv_optimizer *opt, uint32_t id)
+{
+    if (!id || id >= opt->bound || !opt->definitions[id])
+        return NULL;
+    return &opt->instructions[opt->definitions[id] - 1];
+}
+
+static bool vkd3d_spirv_opt_is_access_chain(SpvOp op)
+{
+    return op == SpvOpAccessChain || op == SpvOpInBoundsAccessChain;
+}
+
+/* Returns true if word "i" of the instruction may refer to an id. Literal
+ * operands are mostly counted as well, which only makes the optimizer more
+ * conservative. */
+static bool vkd3d_spirv_opt_is_use(const struct vkd3d_spirv_optimizer *opt, size_t index, unsigned int i)
+{
+    const struct vkd3d_spirv_opt_instruction *instruction = &opt->instructions[index];
+    unsigned int op_flags = instruction->op_flags;
+
+    if (op_flags & VKD3D_SPIRV_OPT_OP_ANNOTATION)
+        return false;
+    if (index == opt->entry_point)
+        return i == 2;
+    if (op_flags & VKD3D_SPIRV_OPT_OP_TYPE)
+        return i == 1 || (i >= 3 && !(op_flags & VKD3D_SPIRV_OPT_OP_LITERALS)
+                && !(instruction->flags & VKD3D_SPIRV_OPT_INSTRUCTION_FOLDED));
+    if (op_flags & VKD3D_SPIRV_OPT_OP_RESULT)
+        return i >= 2 && !(op_flags & VKD3D_SPIRV_OPT_OP_LITERALS);
+    return !(op_flags & VKD3D_SPIRV_OPT_OP_LITERALS);
+}
+
+static bool vkd3d_spirv_opt_is_removable(const struct vkd3d_spirv_optimizer *opt, size_t index)
+{
+    const struct vkd3d_spirv_opt_instruction *instruction = &opt->instructions[index];
+    const uint32_t *words = vkd3d_spirv_opt_get_words(opt, index);
+    SpvStorageClass storage_class;
+
+    if (instruction->flags & VKD3D_SPIRV_OPT_INSTRUCTION_REMOVED)
+        return false;
+    if (instruction->flags & VKD3D_SPIRV_OPT_INSTRUCTION_FOLDED)
+        return true;
+
+    switch (vkd3d_spirv_opt_get_op(opt, index))
+    {
+        case SpvOpLoad:
+            /* Keep loads with memory operands, they may be volatile. */
+            return vkd3d_spirv_opt_get_word_count(opt, index) == 4;
+
+        case SpvOpVariable:
+            storage_class = words[3];
+            if (storage_class == SpvStorageClassFunction || storage_class == SpvStorageClassPrivate)
+                return true;
+            return storage_class == SpvStorageClassInput
+                    && !(opt->id_flags[words[2]] & VKD3D_SPIRV_OPT_ID_KEEP);
+
+        default:
+            return instruction->op_flags & VKD3D_SPIRV_OPT_OP_REMOVABLE;
+    }
+}
+
+static void vkd3d_spirv_opt_queue(struct vkd3d_spirv_optimizer *opt, size_t index)
+{
+    struct vkd3d_spirv_opt_instruction *instruction = &opt->instructions[index];
+
+    if (instruction->flags & VKD3D_SPIRV_OPT_INSTRUCTION_QUEUED)
+        return;
+    instruction->flags |= VKD3D_SPIRV_OPT_INSTRUCTION_QUEUED;
+    opt->worklist[opt->worklist_count++] = index;
+}
+
+static void vkd3d_spirv_opt_add_uses(struct vkd3d_spirv_optimizer *opt, size_t index)
+{
+    unsigned int i, word_count = vkd3d_spirv_opt_get_word_count(opt, index);
+    const uint32_t *words = vkd3d_spirv_opt_get_words(opt, index);
+
+    for (i = 1; i < word_count; ++i)
+    {
+        if (vkd3d_spirv_opt_is_use(opt, index, i) && vkd3d_spirv_opt_get_definition(opt, words[i]))
+            ++opt->use_counts[words[i]];
+    }
+}
+
+static void vkd3d_spirv_opt_remove_uses(struct vkd3d_spirv_optimizer *opt, size_t index)
+{
+    unsigned int i, word_count = vkd3d_spirv_opt_get_word_count(opt, index);
+    const uint32_t *words = vkd3d_spirv_opt_get_words(opt, index);
+    uint32_t id;
+
+    for (i = 1; i < word_count; ++i)
+    {
+        if (!vkd3d_spirv_opt_is_use(opt, index, i) || !vkd3d_spirv_opt_get_definition(opt, id = words[i]))
+            continue;
+
+        assert(opt->use_counts[id]);
+        if (!--opt->use_counts[id] && vkd3d_spirv_opt_is_removable(opt, opt->definitions[id] - 1))
+            vkd3d_spirv_opt_queue(opt, opt->definitions[id] - 1);
+    }
+}
+
+static void vkd3d_spirv_opt_remove_instruction(struct vkd3d_spirv_optimizer *opt, size_t index)
+{
+    vkd3d_spirv_opt_remove_uses(opt, index);
+    opt->instructions[index].flags |= VKD3D_SPIRV_OPT_INSTRUCTION_REMOVED;
+}
+
+static bool vkd3d_spirv_opt_parse_entry_point(struct vkd3d_spirv_optimizer *opt, size_t index)
+{
+    unsigned int i, word_count = vkd3d_spirv_opt_get_word_count(opt, index);
+    const uint32_t *words = vkd3d_spirv_opt_get_words(opt, index);
+
+    if (opt->entry_point != ~(size_t)0)
+    {
+        FIXME("Multiple entry points.\n");
+        return false;
+    }
+    opt->entry_point = index;
+
+    /* The name is a nul-terminated string padded to a word boundary. */
+    for (i = 3; i < word_count; ++i)
+    {
+        if (!(words[i] & 0xff000000))
+        {
+            opt->entry_point_interface = i + 1;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static bool vkd3d_spirv_opt_parse(struct vkd3d_spirv_optimizer *opt)
+{
+    struct vkd3d_spirv_opt_instruction *instruction;
+    unsigned int op_flags, word_count;
+    size_t offset, index;
+    uint32_t id;
+    SpvOp op;
+
+    opt->function_start = ~(size_t)0;
+    opt->entry_point = ~(size_t)0;
+
+    for (offset = VKD3D_SPIRV_HEADER_WORD_COUNT; offset < opt->word_count; offset += word_count)
+    {
+        op = opt->code[offset] & SpvOpCodeMask;
+        word_count = opt->code[offset] >> SpvWordCountShift;
+        if (!word_count || word_count > opt->word_count - offset)
+        {
+            WARN("Invalid word count %u at offset %#zx.\n", word_count, offset);
+            return false;
+        }
+
+        if (!vkd3d_spirv_opt_get_op_flags(op, &op_flags))
+        {
+            TRACE("Unhandled opcode %#x.\n", op);
+            return false;
+        }
+
+        if (!vkd3d_array_reserve((void **)&opt->instructions, &opt->instructions_size,
+                opt->instruction_count + 1, sizeof(*opt->instructions)))
+            return false;
+
+        index = opt->instruction_count++;
+        instruction = &opt->instructions[index];
+        instruction->offset = offset;
+        instruction->op_flags = op_flags;
+        instruction->flags = 0;
+
+        /* Every instruction the optimizer looks into has at least 4 words,
+         * except annotations, which have at least 3. */
+        if (word_count < 4 && (op == SpvOpVariable || op == SpvOpLoad || op == SpvOpEntryPoint
+                || op == SpvOpConstant || vkd3d_spirv_opt_is_access_chain(op)))
+            return false;
+        if (word_count < 3 && (op == SpvOpStore || (op_flags & VKD3D_SPIRV_OPT_OP_ANNOTATION)))
+            return false;
+        if (word_count < (op_flags & VKD3D_SPIRV_OPT_OP_TYPE ? 3 : 2) && (op_flags & VKD3D_SPIRV_OPT_OP_RESULT))
+            return false;
+
+        if ((id = vkd3d_spirv_opt_get_result_id(opt, index)))
+        {
+            if (id >= opt->bound || opt->definitions[id])
+            {
+                WARN("Invalid result id %u.\n", id);
+                return false;
+            }
+            opt->definitions[id] = index + 1;
+        }
+
+        if (op == SpvOpFunction && opt->function_start == ~(size_t)0)
+            opt->function_start = index;
+        else if (op == SpvOpEntryPoint && !vkd3d_spirv_opt_parse_entry_point(opt, index))
+            return false;
+        else if (op == SpvOpDecorate && opt->code[offset + 2] == SpvDecorationBuiltIn && word_count >= 4
+                && (opt->code[offset + 3] == SpvBuiltInSampleId || opt->code[offset + 3] == SpvBuiltInSamplePosition)
+                && opt->code[offset + 1] < opt->bound)
+        {
+            /* Reading these built-ins enables sample shading. */
+            opt->id_flags[opt->code[offset + 1]] |= VKD3D_SPIRV_OPT_ID_KEEP;
+        }
+    }
+
+    return opt->entry_point != ~(size_t)0 && opt->function_start != ~(size_t)0;
+}
+
+static bool vkd3d_spirv_opt_is_32_bit_scalar_type(const struct vkd3d_spirv_optimizer *opt,
+        uint32_t type_id, bool integer)
+{
+    const struct vkd3d_spirv_opt_instruction *definition;
+    const uint32_t *words;
+    SpvOp op;
+
+    if (!(definition = vkd3d_spirv_opt_get_definition(opt, type_id)))
+        return false;
+
+    words = &opt->code[definition->offset];
+    op = words[0] & SpvOpCodeMask;
+    if (op != SpvOpTypeInt && (integer || op != SpvOpTypeFloat))
+        return false;
+    return (words[0] >> SpvWordCountShift) >= 3 && words[2] == 32;
+}
+
+static bool vkd3d_spirv_opt_get_constant(const struct vkd3d_spirv_optimizer *opt, uint32_t id, uint32_t *value)
+{
+    if (id >= opt->bound || !(opt->id_flags[id] & VKD3D_SPIRV_OPT_ID_CONSTANT))
+        return false;
+    *value = opt->constant_values[id];
+    return true;
+}
+
+static bool vkd3d_spirv_opt_fold_binary_op(SpvOp op, uint32_t a, uint32_t b, uint32_t *result)
+{
+    switch (op)
+    {
+        case SpvOpIAdd:
+            *result = a + b;
+            return true;
+        case SpvOpISub:
+            *result = a - b;
+            return true;
+        case SpvOpIMul:
+            *result = a * b;
+            return true;
+        case SpvOpBitwiseAnd:
+            *result = a & b;
+            return true;
+        case SpvOpBitwiseOr:
+            *result = a | b;
+            return true;
+        case SpvOpBitwiseXor:
+            *result = a ^ b;
+            return true;
+        case SpvOpShiftLeftLogical:
+            *result = a << b;
+            return b < 32;
+        case SpvOpShiftRightLogical:
+            *result = a >> b;
+            return b < 32;
+        case SpvOpShiftRightArithmetic:
+            *result = (a & 0x80000000u) && b ? ~(~a >> b) : a >> b;
+            return b < 32;
+        case SpvOpUDiv:
+            *result = b ? a / b : 0;
+            return b;
+        case SpvOpUMod:
+            *result = b ? a % b : 0;
+            return b;
+        default:
+            return false;
+    }
+}
+
+static bool vkd3d_spirv_opt_fold_instruction(const struct vkd3d_spirv_optimizer *opt,
+        size_t index, uint32_t *value)
+{
+    unsigned int word_count = vkd3d_spirv_opt_get_word_count(opt, index);
+    const uint32_t *words = vkd3d_spirv_opt_get_words(opt, index);
+    const struct vkd3d_spirv_opt_instruction *definition;
+    SpvOp op = vkd3d_spirv_opt_get_op(opt, index);
+    uint32_t a, b;
+
+    switch (op)
+    {
+        case SpvOpNot:
+        case SpvOpSNegate:
+            if (word_count != 4 || !vkd3d_spirv_opt_is_32_bit_scalar_type(opt, words[1], true)
+                    || !vkd3d_spirv_opt_get_constant(opt, words[3], &a))
+                return false;
+            *value = op == SpvOpNot ? ~a : 0u - a;
+            return true;
+
+        case SpvOpBitcast:
+            if (word_count != 4 || !vkd3d_spirv_opt_is_32_bit_scalar_type(opt, words[1], false))
+                return false;
+            return vkd3d_spirv_opt_get_constant(opt, words[3], value);
+
+        case SpvOpCompositeExtract:
+            if (word_count != 5 || !vkd3d_spirv_opt_is_32_bit_scalar_type(opt, words[1], false)
+                    || !(definition = vkd3d_spirv_opt_get_definition(opt, words[3]))
+                    || (opt->code[definition->offset] & SpvOpCodeMask) != SpvOpConstantComposite
+                    || (definition->flags & VKD3D_SPIRV_OPT_INSTRUCTION_REMOVED)
+                    || words[4] >= (opt->code[definition->offset] >> SpvWordCountShift) - 3)
+                return false;
+            return vkd3d_spirv_opt_get_constant(opt, opt->code[definition->offset + 3 + words[4]], value);
+
+        default:
+            if (word_count != 5 || !vkd3d_spirv_opt_is_32_bit_scalar_type(opt, words[1], true)
+                    || !vkd3d_spirv_opt_get_constant(opt, words[3], &a)
+                    || !vkd3d_spirv_opt_get_constant(opt, words[4], &b))
+                return false;
+            return vkd3d_spirv_opt_fold_binary_op(op, a, b, value);
+    }
+}
+
+/* Replaces instructions computing 32-bit scalar constants with OpConstant
+ * instructions, which are emitted at the end of the global declarations. */
+static void vkd3d_spirv_opt_fold_constants(struct vkd3d_spirv_optimizer *opt)
+{
+    struct vkd3d_spirv_opt_instruction *instruction;
+    uint32_t value, id;
+    const uint32_t *words;
+    size_t i;
+
+    for (i = 0; i < opt->function_start; ++i)
+    {
+        words = vkd3d_spirv_opt_get_words(opt, i);
+        if (vkd3d_spirv_opt_get_op(opt, i) == SpvOpConstant && vkd3d_spirv_opt_get_word_count(opt, i) == 4
+                && vkd3d_spirv_opt_is_32_bit_scalar_type(opt, words[1], false))
+        {
+            opt->id_flags[words[2]] |= VKD3D_SPIRV_OPT_ID_CONSTANT;
+            opt->constant_values[words[2]] = words[3];
+        }
+    }
+
+    for (i = opt->function_start; i < opt->instruction_count; ++i)
+    {
+        instruction = &opt->instructions[i];
+        if (!(instruction->op_flags & VKD3D_SPIRV_OPT_OP_REMOVABLE)
+                || !vkd3d_spirv_opt_fold_instruction(opt, i, &value))
+            continue;
+
+        /* The result type stays referenced by the new constant. */
+        vkd3d_spirv_opt_remove_uses(opt, i);
+        instruction->flags |= VKD3D_SPIRV_OPT_INSTRUCTION_FOLDED;
+        ++opt->use_counts[vkd3d_spirv_opt_get_words(opt, i)[1]];
+
+        id = vkd3d_spirv_opt_get_result_id(opt, i);
+        opt->id_flags[id] |= VKD3D_SPIRV_OPT_ID_CONSTANT;
+        opt->constant_values[id] = value;
+    }
+}
+
+/* Removes Function and Private variables which are only ever written,
+ * along with access chains into them and stores through those. */
+static void vkd3d_spirv_opt_remove_dead_stores(struct vkd3d_spirv_optimizer *opt)
+{
+    unsigned int i, word_count;
+    SpvStorageClass storage_class;
+    const uint32_t *words;
+    size_t index;
+    SpvOp op;
+
+    for (index = 0; index < opt->instruction_count; ++index)
+    {
+        if (opt->instructions[index].flags & VKD3D_SPIRV_OPT_INSTRUCTION_REMOVED)
+            continue;
+
+        op = vkd3d_spirv_opt_get_op(opt, index);
+        words = vkd3d_spirv_opt_get_words(opt, index);
+        word_count = vkd3d_spirv_opt_get_word_count(opt, index);
+        for (i = 1; i < word_count; ++i)
+        {
+            if ((op == SpvOpStore && i == 1) || (vkd3d_spirv_opt_is_access_chain(op) && i == 3))
+                continue;
+            if (vkd3d_spirv_opt_is_use(opt, index, i) && words[i] < opt->bound)
+                opt->id_flags[words[i]] |= VKD3D_SPIRV_OPT_ID_READ;
+        }
+    }
+
+    /* Definitions precede their uses in the module, so a reverse walk
+     * propagates reads through chains of access chains. */
+    for (index = opt->instruction_count; index > opt->function_start; --index)
+    {
+        words = vkd3d_spirv_opt_get_words(opt, index - 1);
+        if (vkd3d_spirv_opt_is_access_chain(vkd3d_spirv_opt_get_op(opt, index - 1))
+                && !(opt->instructions[index - 1].flags & VKD3D_SPIRV_OPT_INSTRUCTION_REMOVED)
+                && (opt->id_flags[words[2]] & VKD3D_SPIRV_OPT_ID_READ) && words[3] < opt->bound)
+            opt->id_flags[words[3]] |= VKD3D_SPIRV_OPT_ID_READ;
+    }
+
+    for (index = 0; index < opt->instruction_count; ++index)
+    {
+        if (opt->instructions[index].flags & VKD3D_SPIRV_OPT_INSTRUCTION_REMOVED)
+            continue;
+
+        words = vkd3d_spirv_opt_get_words(opt, index);
+        switch ((op = vkd3d_spirv_opt_get_op(opt, index)))
+        {
+            case SpvOpVariable:
+                storage_class = words[3];
+                if ((storage_class == SpvStorageClassFunction || storage_class == SpvStorageClassPrivate)
+                        && !(opt->id_flags[words[2]] & VKD3D_SPIRV_OPT_ID_READ))
+                {
+                    opt->id_flags[words[2]] |= VKD3D_SPIRV_OPT_ID_DEAD_POINTER;
+                    vkd3d_spirv_opt_remove_instruction(opt, index);
+                }
+                break;
+
+            case SpvOpAccessChain:
+            case SpvOpInBoundsAccessChain:
+                if (words[3] < opt->bound && (opt->id_flags[words[3]] & VKD3D_SPIRV_OPT_ID_DEAD_POINTER))
+                {
+                    opt->id_flags[words[2]] |= VKD3D_SPIRV_OPT_ID_DEAD_POINTER;
+                    vkd3d_spirv_opt_remove_instruction(opt, index);
+                }
+                break;
+
+            case SpvOpStore:
+                if (words[1] < opt->bound && (opt->id_flags[words[1]] & VKD3D_SPIRV_OPT_ID_DEAD_POINTER))
+                    vkd3d_spirv_opt_remove_instruction(opt, index);
+                break;
+
+            default:
+                break;
+        }
+    }
+}
+
+static void vkd3d_spirv_opt_eliminate_dead_code(struct vkd3d_spirv_optimizer *opt)
+{
+    uint32_t id;
+    size_t i;
+
+    for (i = 0; i < opt->instruction_count; ++i)
+    {
+        if ((id = vkd3d_spirv_opt_get_result_id(opt, i)) && !opt->use_counts[id]
+                && vkd3d_spirv_opt_is_removable(opt, i))
+            vkd3d_spirv_opt_queue(opt, i);
+    }
+
+    while (opt->worklist_count)
+    {
+        i = opt->worklist[--opt->worklist_count];
+        opt->instructions[i].flags &= ~VKD3D_SPIRV_OPT_INSTRUCTION_QUEUED;
+
+        /* Folding may have queued instructions which are used again. */
+        if (opt->use_counts[vkd3d_spirv_opt_get_result_id(opt, i)] || !vkd3d_spirv_opt_is_removable(opt, i))
+            continue;
+
+        vkd3d_spirv_opt_remove_instruction(opt, i);
+    }
+}
+
+static bool vkd3d_spirv_opt_is_id_removed(const struct vkd3d_spirv_optimizer *opt, uint32_t id)
+{
+    const struct vkd3d_spirv_opt_instruction *definition;
+
+    return (definition = vkd3d_spirv_opt_get_definition(opt, id))
+            && (definition->flags & (VKD3D_SPIRV_OPT_INSTRUCTION_REMOVED | VKD3D_SPIRV_OPT_INSTRUCTION_FOLDED));
+}
+
+static size_t vkd3d_spirv_opt_write_constants(const struct vkd3d_spirv_optimizer *opt, uint32_t *code)
+{
+    const uint32_t *words;
+    size_t i, offset = 0;
+    uint32_t id;
+
+    for (i = opt->function_start; i < opt->instruction_count; ++i)
+    {
+        if ((opt->instructions[i].flags & (VKD3D_SPIRV_OPT_INSTRUCTION_REMOVED | VKD3D_SPIRV_OPT_INSTRUCTION_FOLDED))
+                != VKD3D_SPIRV_OPT_INSTRUCTION_FOLDED)
+            continue;
+
+        words = vkd3d_spirv_opt_get_words(opt, i);
+        id = words[2];
+        code[offset++] = (4u << SpvWordCountShift) | SpvOpConstant;
+        code[offset++] = words[1];
+        code[offset++] = id;
+        code[offset++] = opt->constant_values[id];
+    }
+
+    return offset;
+}
+
+/* The output is never larger than the input: folded constants take 4 words
+ * and replace instructions taking at least 4 words. */
+static size_t vkd3d_spirv_opt_write_module(const struct vkd3d_spirv_optimizer *opt, uint32_t *code)
+{
+    const struct vkd3d_spirv_opt_instruction *instruction;
+    unsigned int i, word_count;
+    const uint32_t *words;
+    size_t index, offset;
+
+    memcpy(code, opt->code, VKD3D_SPIRV_HEADER_WORD_COUNT * sizeof(*code));
+    offset = VKD3D_SPIRV_HEADER_WORD_COUNT;
+
+    for (index = 0; index < opt->instruction_count; ++index)
+    {
+        instruction = &opt->instructions[index];
+        words = vkd3d_spirv_opt_get_words(opt, index);
+        word_count = vkd3d_spirv_opt_get_word_count(opt, index);
+
+        if (index == opt->function_start)
+            offset += vkd3d_spirv_opt_write_constants(opt, &code[offset]);
+
+        if (instruction->flags & (VKD3D_SPIRV_OPT_INSTRUCTION_REMOVED | VKD3D_SPIRV_OPT_INSTRUCTION_FOLDED))
+            continue;
+        if ((instruction->op_flags & VKD3D_SPIRV_OPT_OP_ANNOTATION) && vkd3d_spirv_opt_is_id_removed(opt, words[1]))
+            continue;
+
+        if (index == opt->entry_point)
+        {
+            size_t start = offset;
+
+            memcpy(&code[offset], words, opt->entry_point_interface * sizeof(*code));
+            offset += opt->entry_point_interface;
+            for (i = opt->entry_point_interface; i < word_count; ++i)
+            {
+                if (!vkd3d_spirv_opt_is_id_removed(opt, words[i]))
+                    code[offset++] = words[i];
+            }
+            code[start] = ((offset - start) << SpvWordCountShift) | SpvOpEntryPoint;
+            continue;
+        }
+
+        memcpy(&code[offset], words, word_count * sizeof(*code));
+        offset += word_count;
+    }
+
+    return offset;
+}
+
+static bool vkd3d_spirv_opt_init(struct vkd3d_spirv_optimizer *opt, const struct vkd3d_shader_code *spirv)
+{
+    memset(opt, 0, sizeof(*opt));
+    opt->code = spirv->code;
+    opt->word_count = spirv->size / sizeof(*opt->code);
+
+    if (opt->word_count <= VKD3D_SPIRV_HEADER_WORD_COUNT || opt->code[0] != SpvMagicNumber)
+        return false;
+
+    opt->bound = opt->code[3];
+    if (opt->word_count > VKD3D_SPIRV_OPT_MAX_WORD_COUNT || opt->bound > VKD3D_SPIRV_OPT_MAX_ID_BOUND)
+    {
+        TRACE("Skipping optimization of large module, %zu words, id bound %u.\n", opt->word_count, opt->bound);
+        return false;
+    }
+
+    if (!(opt->definitions = vkd3d_calloc(opt->bound, sizeof(*opt->definitions)))
+            || !(opt->use_counts = vkd3d_calloc(opt->bound, sizeof(*opt->use_counts)))
+            || !(opt->constant_values = vkd3d_calloc(opt->bound, sizeof(*opt->constant_values)))
+            || !(opt->id_flags = vkd3d_calloc(opt->bound, sizeof(*opt->id_flags))))
+        return false;
+
+    return true;
+}
+
+static void vkd3d_spirv_opt_cleanup(struct vkd3d_spirv_optimizer *opt)
+{
+    vkd3d_free(opt->worklist);
+    vkd3d_free(opt->id_flags);
+    vkd3d_free(opt->constant_values);
+    vkd3d_free(opt->use_counts);
+    vkd3d_free(opt->definitions);
+    vkd3d_free(opt->instructions);
+}
+
+void vkd3d_spirv_optimize(struct vkd3d_shader_code *spirv)
+{
+    struct vkd3d_spirv_optimizer opt;
+    size_t i, word_count;
+    uint32_t *code;
+
+    if (!vkd3d_spirv_opt_init(&opt, spirv) || !vkd3d_spirv_opt_parse(&opt))
+    {
+        vkd3d_spirv_opt_cleanup(&opt);
+        return;
+    }
+
+    if (!(opt.worklist = vkd3d_calloc(opt.instruction_count, sizeof(*opt.worklist)))
+            || !(code = vkd3d_malloc(opt.word_count * sizeof(*code))))
+    {
+        vkd3d_spirv_opt_cleanup(&opt);
+        return;
+    }
+
+    for (i = 0; i < opt.instruction_count; ++i)
+        vkd3d_spirv_opt_add_uses(&opt, i);
+
+    vkd3d_spirv_opt_fold_constants(&opt);
+    vkd3d_spirv_opt_remove_dead_stores(&opt);
+    vkd3d_spirv_opt_eliminate_dead_code(&opt);
+
+    word_count = vkd3d_spirv_opt_write_module(&opt, code);
+    assert(word_count <= opt.word_count);
+    TRACE("Optimized SPIR-V from %zu to %zu words.\n", opt.word_count, word_count);
+
+    vkd3d_spirv_opt_cleanup(&opt);
+
+    vkd3d_free((void *)spirv->code);
+    spirv->code = code;
+    spirv->size = word_count * sizeof(*code);
+}
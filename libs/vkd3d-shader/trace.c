@@ -1608,12 +1608,12 @@ static void shader_dump_instruction(struct vkd3d_string_buffer *buffer,
     shader_addline(buffer, "\n");
 }
 
-void vkd3d_shader_trace(void *data)
+void vkd3d_shader_trace(const struct vkd3d_shader_version *shader_version,
+        const struct vkd3d_shader_instruction_array *instructions)
 {
-    struct vkd3d_shader_version shader_version;
     struct vkd3d_string_buffer buffer;
     const char *p, *q;
-    const DWORD *ptr;
+    size_t i;
 
     if (!string_buffer_init(&buffer))
     {
@@ -1621,24 +1621,11 @@ void vkd3d_shader_trace(void *data)
         return;
     }
 
-    shader_sm4_read_header(data, &ptr, &shader_version);
     shader_addline(&buffer, "%s_%u_%u\n",
-            shader_get_type_prefix(shader_version.type), shader_version.major, shader_version.minor);
+            shader_get_type_prefix(shader_version->type), shader_version->major, shader_version->minor);
 
-    while (!shader_sm4_is_end(data, &ptr))
-    {
-        struct vkd3d_shader_instruction ins;
-
-        shader_sm4_read_instruction(data, &ptr, &ins);
-        if (ins.handler_idx == VKD3DSIH_INVALID)
-        {
-            WARN("Skipping unrecognized instruction.\n");
-            shader_addline(&buffer, "<unrecognized instruction>\n");
-            continue;
-        }
-
-        shader_dump_instruction(&buffer, &ins, &shader_version);
-    }
+    for (i = 0; i < instructions->count; ++i)
+        shader_dump_instruction(&buffer, &instructions->elements[i], shader_version);
 
     for (p = buffer.buffer; *p; p = q)
     {
@@ -20,62 +20,386 @@
 
 #include <stdio.h>
 
-static void vkd3d_shader_dump_blob(const char *path, const char *prefix, const void *data, size_t size,
-        unsigned int id, const char *ext)
+void vkd3d_shader_arena_init(struct vkd3d_shader_arena *arena, size_t block_size)
 {
-    char filename[1024];
-    FILE *f;
+    arena->blocks = NULL;
+    arena->block_size = block_size;
+}
+
+void *vkd3d_shader_arena_alloc_block(struct vkd3d_shader_arena *arena, size_t size)
+{
+    struct vkd3d_shader_arena_block *block;
+    size_t block_size;
+
+    block_size = max(size, arena->block_size);
+    if (!(block = vkd3d_malloc(offsetof(struct vkd3d_shader_arena_block, data) + block_size)))
+        return NULL;
+
+    block->size = block_size;
+    block->used = size;
+    block->next = arena->blocks;
+    arena->blocks = block;
+
+    return block->data;
+}
+
+/* Keeps one block around, so that a reused arena does not have to go back
+ * to the heap for small workloads. */
+void vkd3d_shader_arena_reset(struct vkd3d_shader_arena *arena)
+{
+    struct vkd3d_shader_arena_block *block, *next, *kept = NULL;
 
-    snprintf(filename, ARRAY_SIZE(filename), "%s/vkd3d-shader-%s-%u.%s", path, prefix, id, ext);
-    if ((f = fopen(filename, "wb")))
+    for (block = arena->blocks; block; block = next)
     {
-        if (fwrite(data, 1, size, f) != size)
-            ERR("Failed to write shader to %s.\n", filename);
-        if (fclose(f))
-            ERR("Failed to close stream %s.\n", filename);
+        next = block->next;
+
+        if (!kept && block->size == arena->block_size)
+            kept = block;
+        else
+            vkd3d_free(block);
     }
-    else
+
+    if ((arena->blocks = kept))
     {
-        ERR("Failed to open %s for dumping shader.\n", filename);
+        kept->next = NULL;
+        kept->used = 0;
     }
 }
 
-void vkd3d_shader_dump_shader(enum vkd3d_shader_type type, const struct vkd3d_shader_code *shader)
+void vkd3d_shader_arena_free(struct vkd3d_shader_arena *arena)
 {
-    static LONG shader_id = 0;
-    static bool enabled = true;
-    const char *path;
+    struct vkd3d_shader_arena_block *block;
 
-    if (!enabled)
-        return;
+    while ((block = arena->blocks))
+    {
+        arena->blocks = block->next;
+        vkd3d_free(block);
+    }
+}
+
+#define VKD3D_SHADER_HASH_MAP_MIN_CAPACITY 64
+
+void vkd3d_shader_hash_map_init(struct vkd3d_shader_hash_map *map, vkd3d_shader_hash_map_equal_func equal)
+{
+    map->slots = NULL;
+    map->capacity = 0;
+    map->count = 0;
+    map->equal = equal;
+}
+
+static void vkd3d_shader_hash_map_insert_slot(struct vkd3d_shader_hash_map *map,
+        uint32_t hash, struct vkd3d_shader_hash_map_entry *entry)
+{
+    size_t mask = map->capacity - 1;
+    size_t i;
+
+    for (i = hash & mask; map->slots[i].entry; i = (i + 1) & mask)
+        ;
 
-    if (!(path = getenv("VKD3D_SHADER_DUMP_PATH")))
+    map->slots[i].hash = hash;
+    map->slots[i].entry = entry;
+}
+
+static bool vkd3d_shader_hash_map_grow(struct vkd3d_shader_hash_map *map)
+{
+    struct vkd3d_shader_hash_map_slot *old_slots = map->slots;
+    size_t old_capacity = map->capacity, i;
+    size_t new_capacity;
+
+    new_capacity = max(old_capacity * 2, VKD3D_SHADER_HASH_MAP_MIN_CAPACITY);
+    if (!(map->slots = vkd3d_calloc(new_capacity, sizeof(*map->slots))))
     {
-        enabled = false;
-        return;
+        map->slots = old_slots;
+        return false;
     }
+    map->capacity = new_capacity;
+
+    for (i = 0; i < old_capacity; ++i)
+    {
+        if (old_slots[i].entry)
+            vkd3d_shader_hash_map_insert_slot(map, old_slots[i].hash, old_slots[i].entry);
+    }
+
+    vkd3d_free(old_slots);
+    return true;
+}
+
+/* Returns -1 if an entry with the same key is already present, like rb_put(). */
+int vkd3d_shader_hash_map_put(struct vkd3d_shader_hash_map *map, const void *key,
+        struct vkd3d_shader_hash_map_entry *entry)
+{
+    if (vkd3d_shader_hash_map_get(map, key, entry->hash))
+        return -1;
+
+    /* Keep the load factor at or below 3/4. */
+    if ((map->count + 1) * 4 > map->capacity * 3 && !vkd3d_shader_hash_map_grow(map))
+        return -1;
 
-    vkd3d_shader_dump_blob(path, shader_get_type_prefix(type), shader->code, shader->size,
-                           InterlockedIncrement(&shader_id) - 1, "dxbc");
+    vkd3d_shader_hash_map_insert_slot(map, entry->hash, entry);
+    ++map->count;
+    return 0;
 }
 
-void vkd3d_shader_dump_spirv_shader(enum vkd3d_shader_type type, const struct vkd3d_shader_code *shader)
+void vkd3d_shader_hash_map_remove(struct vkd3d_shader_hash_map *map, struct vkd3d_shader_hash_map_entry *entry)
 {
-    static LONG shader_id = 0;
-    static bool enabled = true;
-    const char *path;
+    size_t mask = map->capacity - 1;
+    size_t i, j, k;
 
-    if (!enabled)
+    if (!map->count)
         return;
 
-    if (!(path = getenv("VKD3D_SHADER_DUMP_PATH")))
+    for (i = entry->hash & mask; map->slots[i].entry != entry; i = (i + 1) & mask)
     {
-        enabled = false;
-        return;
+        if (!map->slots[i].entry)
+            return;
+    }
+
+    /* Shift following entries back instead of leaving a tombstone, so that
+     * an empty slot always terminates a probe sequence. */
+    for (j = (i + 1) & mask; map->slots[j].entry; j = (j + 1) & mask)
+    {
+        k = map->slots[j].hash & mask;
+        if (i <= j ? (i < k && k <= j) : (i < k || k <= j))
+            continue;
+
+        map->slots[i] = map->slots[j];
+        i = j;
+    }
+
+    map->slots[i].entry = NULL;
+    --map->count;
+}
+
+/* Keeps the slot storage, for reuse by the next user of the map. */
+void vkd3d_shader_hash_map_clear(struct vkd3d_shader_hash_map *map)
+{
+    if (map->count)
+        memset(map->slots, 0, map->capacity * sizeof(*map->slots));
+    map->count = 0;
+}
+
+void vkd3d_shader_hash_map_free(struct vkd3d_shader_hash_map *map)
+{
+    vkd3d_free(map->slots);
+    map->slots = NULL;
+    map->capacity = 0;
+    map->count = 0;
+}
+
+enum vkd3d_shader_visibility vkd3d_shader_visibility_from_shader_type(enum vkd3d_shader_type type)
+{
+    switch (type)
+    {
+        case VKD3D_SHADER_TYPE_VERTEX:
+            return VKD3D_SHADER_VISIBILITY_VERTEX;
+        case VKD3D_SHADER_TYPE_HULL:
+            return VKD3D_SHADER_VISIBILITY_HULL;
+        case VKD3D_SHADER_TYPE_DOMAIN:
+            return VKD3D_SHADER_VISIBILITY_DOMAIN;
+        case VKD3D_SHADER_TYPE_GEOMETRY:
+            return VKD3D_SHADER_VISIBILITY_GEOMETRY;
+        case VKD3D_SHADER_TYPE_PIXEL:
+            return VKD3D_SHADER_VISIBILITY_PIXEL;
+        case VKD3D_SHADER_TYPE_COMPUTE:
+            return VKD3D_SHADER_VISIBILITY_COMPUTE;
+        default:
+            ERR("Invalid shader type %#x.\n", type);
+            /* Only bindings visible to all stages will match. */
+            return VKD3D_SHADER_VISIBILITY_ALL;
     }
+}
 
-    vkd3d_shader_dump_blob(path, shader_get_type_prefix(type), shader->code, shader->size,
-                           InterlockedIncrement(&shader_id) - 1, "spv");
+static int vkd3d_shader_binding_range_compare(const void *a, const void *b)
+{
+    const struct vkd3d_shader_binding_range *range_a = a, *range_b = b;
+
+    if (range_a->register_space != range_b->register_space)
+        return range_a->register_space < range_b->register_space ? -1 : 1;
+    if (range_a->first != range_b->first)
+        return range_a->first < range_b->first ? -1 : 1;
+    return range_a->binding_idx < range_b->binding_idx ? -1 : range_a->binding_idx > range_b->binding_idx;
+}
+
+/* Small interfaces, and shaders with few resources, are cheaper to handle
+ * with a linear scan than by sorting the bindings. */
+#define VKD3D_SHADER_BINDING_INDEX_MIN_BINDING_COUNT 32
+#define VKD3D_SHADER_BINDING_INDEX_LINEAR_LOOKUP_COUNT 8
+
+void vkd3d_shader_binding_index_init(struct vkd3d_shader_binding_index *index,
+        const struct vkd3d_shader_interface_info *shader_interface,
+        enum vkd3d_shader_visibility visibility)
+{
+    index->bindings = shader_interface ? shader_interface->bindings : NULL;
+    index->binding_count = shader_interface ? shader_interface->binding_count : 0;
+    index->visibility = visibility;
+    index->linear_lookup_count = index->binding_count > VKD3D_SHADER_BINDING_INDEX_MIN_BINDING_COUNT
+            ? VKD3D_SHADER_BINDING_INDEX_LINEAR_LOOKUP_COUNT : UINT_MAX;
+    index->indexed = false;
+}
+
+void vkd3d_shader_binding_index_cleanup(struct vkd3d_shader_binding_index *index)
+{
+    vkd3d_free(index->ranges);
+    memset(index, 0, sizeof(*index));
+}
+
+static bool vkd3d_shader_binding_is_visible(const struct vkd3d_shader_resource_binding *binding,
+        enum vkd3d_shader_visibility visibility)
+{
+    return binding->shader_visibility == VKD3D_SHADER_VISIBILITY_ALL || binding->shader_visibility == visibility;
+}
+
+static bool vkd3d_shader_binding_index_build(struct vkd3d_shader_binding_index *index)
+{
+    size_t counts[VKD3D_SHADER_BINDING_INDEX_TYPE_COUNT] = {0};
+    const struct vkd3d_shader_resource_binding *binding;
+    struct vkd3d_shader_binding_range *range;
+    unsigned int i, type, max_last;
+    size_t count, j;
+
+    for (i = 0; i < index->binding_count; ++i)
+    {
+        binding = &index->bindings[i];
+        if (binding->type < VKD3D_SHADER_BINDING_INDEX_TYPE_COUNT && binding->register_count
+                && vkd3d_shader_binding_is_visible(binding, index->visibility))
+            ++counts[binding->type];
+    }
+
+    index->type_offsets[0] = 0;
+    for (type = 0; type < VKD3D_SHADER_BINDING_INDEX_TYPE_COUNT; ++type)
+        index->type_offsets[type + 1] = index->type_offsets[type] + counts[type];
+    count = index->type_offsets[VKD3D_SHADER_BINDING_INDEX_TYPE_COUNT];
+
+    if (!vkd3d_array_reserve((void **)&index->ranges, &index->ranges_size, count, sizeof(*index->ranges)))
+        return false;
+
+    memset(counts, 0, sizeof(counts));
+    for (i = 0; i < index->binding_count; ++i)
+    {
+        binding = &index->bindings[i];
+        if (binding->type >= VKD3D_SHADER_BINDING_INDEX_TYPE_COUNT || !binding->register_count
+                || !vkd3d_shader_binding_is_visible(binding, index->visibility))
+            continue;
+
+        range = &index->ranges[index->type_offsets[binding->type] + counts[binding->type]++];
+        range->register_space = binding->register_space;
+        range->first = binding->register_index;
+        if (binding->register_count == VKD3D_SHADER_DESCRIPTOR_RANGE_UNBOUNDED
+                || binding->register_count - 1 > UINT_MAX - binding->register_index)
+            range->last = UINT_MAX;
+        else
+            range->last = binding->register_index + binding->register_count - 1;
+        range->binding_idx = i;
+    }
+
+    for (type = 0; type < VKD3D_SHADER_BINDING_INDEX_TYPE_COUNT; ++type)
+    {
+        if (!(count = counts[type]))
+            continue;
+
+        range = &index->ranges[index->type_offsets[type]];
+        qsort(range, count, sizeof(*range), vkd3d_shader_binding_range_compare);
+
+        for (j = 0, max_last = 0; j < count; ++j)
+        {
+            if (!j || range[j].register_space != range[j - 1].register_space)
+                max_last = range[j].last;
+            else
+                max_last = max(max_last, range[j].last);
+            range[j].max_last = max_last;
+        }
+    }
+
+    return true;
+}
+
+static bool vkd3d_shader_binding_matches(const struct vkd3d_shader_resource_binding *binding,
+        unsigned int flags, unsigned int excluded_flags)
+{
+    return (!flags || (binding->flags & flags)) && !(binding->flags & excluded_flags);
+}
+
+static const struct vkd3d_shader_resource_binding *vkd3d_shader_binding_index_scan(
+        const struct vkd3d_shader_binding_index *index, enum vkd3d_shader_descriptor_type type,
+        unsigned int register_space, unsigned int register_index,
+        unsigned int flags, unsigned int excluded_flags)
+{
+    const struct vkd3d_shader_resource_binding *binding;
+    unsigned int i;
+
+    for (i = 0; i < index->binding_count; ++i)
+    {
+        binding = &index->bindings[i];
+        if (binding->type == type && binding->register_space == register_space
+                && register_index >= binding->register_index
+                && (binding->register_count == VKD3D_SHADER_DESCRIPTOR_RANGE_UNBOUNDED
+                || register_index - binding->register_index < binding->register_count)
+                && vkd3d_shader_binding_is_visible(binding, index->visibility)
+                && vkd3d_shader_binding_matches(binding, flags, excluded_flags))
+            return binding;
+    }
+
+    return NULL;
+}
+
+const struct vkd3d_shader_resource_binding *vkd3d_shader_binding_index_find(
+        struct vkd3d_shader_binding_index *index, enum vkd3d_shader_descriptor_type type,
+        unsigned int register_space, unsigned int register_index,
+        unsigned int flags, unsigned int excluded_flags)
+{
+    const struct vkd3d_shader_binding_range *ranges, *range, *match = NULL;
+    size_t lo, hi, mid;
+
+    if (type >= VKD3D_SHADER_BINDING_INDEX_TYPE_COUNT)
+        return NULL;
+
+    if (!index->indexed)
+    {
+        if (index->linear_lookup_count == UINT_MAX || index->linear_lookup_count--)
+            return vkd3d_shader_binding_index_scan(index, type, register_space, register_index,
+                    flags, excluded_flags);
+
+        if (!vkd3d_shader_binding_index_build(index))
+        {
+            WARN("Failed to build binding index.\n");
+            index->linear_lookup_count = UINT_MAX;
+            return vkd3d_shader_binding_index_scan(index, type, register_space, register_index,
+                    flags, excluded_flags);
+        }
+        index->indexed = true;
+    }
+
+    ranges = index->ranges;
+    lo = index->type_offsets[type];
+    hi = index->type_offsets[type + 1];
+
+    /* Find the first range starting after the register. */
+    while (lo < hi)
+    {
+        mid = lo + (hi - lo) / 2;
+        range = &ranges[mid];
+        if (range->register_space < register_space
+                || (range->register_space == register_space && range->first <= register_index))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    /* Walk back over the ranges which may still contain the register. */
+    while (lo-- > index->type_offsets[type])
+    {
+        range = &ranges[lo];
+        if (range->register_space != register_space || range->max_last < register_index)
+            break;
+        if (range->last < register_index
+                || !vkd3d_shader_binding_matches(&index->bindings[range->binding_idx], flags, excluded_flags))
+            continue;
+
+        if (!match || range->binding_idx < match->binding_idx)
+            match = range;
+    }
+
+    return match ? &index->bindings[match->binding_idx] : NULL;
 }
 
 struct vkd3d_shader_parser
@@ -83,15 +407,57 @@ struct vkd3d_shader_parser
     struct vkd3d_shader_desc shader_desc;
     struct vkd3d_shader_version shader_version;
     void *data;
-    const DWORD *ptr;
+    struct vkd3d_shader_instruction_array instructions;
 };
 
+static void vkd3d_shader_parser_destroy(struct vkd3d_shader_parser *parser)
+{
+    vkd3d_free(parser->instructions.elements);
+    shader_sm4_free(parser->data);
+    free_shader_desc(&parser->shader_desc);
+}
+
+static int vkd3d_shader_parser_read_instructions(struct vkd3d_shader_parser *parser)
+{
+    struct vkd3d_shader_instruction_array *instructions = &parser->instructions;
+    struct vkd3d_shader_instruction *instruction;
+    const DWORD *ptr;
+
+    shader_sm4_read_header(parser->data, &ptr, &parser->shader_version);
+
+    while (!shader_sm4_is_end(parser->data, &ptr))
+    {
+        if (!vkd3d_array_reserve((void **)&instructions->elements, &instructions->capacity,
+                instructions->count + 1, sizeof(*instructions->elements)))
+        {
+            ERR("Failed to allocate instructions.\n");
+            return VKD3D_ERROR_OUT_OF_MEMORY;
+        }
+
+        instruction = &instructions->elements[instructions->count];
+        shader_sm4_read_instruction(parser->data, &ptr, instruction);
+
+        if (instruction->handler_idx == VKD3DSIH_INVALID)
+        {
+            WARN("Encountered unrecognized or invalid instruction.\n");
+            return VKD3D_ERROR_INVALID_ARGUMENT;
+        }
+
+        ++instructions->count;
+    }
+
+    return VKD3D_OK;
+}
+
+/* Decodes the whole shader, see struct vkd3d_shader_instruction_array. */
 static int vkd3d_shader_parser_init(struct vkd3d_shader_parser *parser,
         const struct vkd3d_shader_code *dxbc)
 {
     struct vkd3d_shader_desc *shader_desc = &parser->shader_desc;
     int ret;
 
+    memset(&parser->instructions, 0, sizeof(parser->instructions));
+
     if ((ret = shader_extract_from_dxbc(dxbc->code, dxbc->size, shader_desc)) < 0)
     {
         WARN("Failed to extract shader, vkd3d result %d.\n", ret);
@@ -106,15 +472,17 @@ static int vkd3d_shader_parser_init(struct vkd3d_shader_parser *parser,
         return VKD3D_ERROR_INVALID_ARGUMENT;
     }
 
-    shader_sm4_read_header(parser->data, &parser->ptr, &parser->shader_version);
+    if ((ret = vkd3d_shader_parser_read_instructions(parser)) < 0)
+    {
+        vkd3d_shader_parser_destroy(parser);
+        return ret;
+    }
+
     return VKD3D_OK;
 }
 
-static void vkd3d_shader_parser_destroy(struct vkd3d_shader_parser *parser)
-{
-    shader_sm4_free(parser->data);
-    free_shader_desc(&parser->shader_desc);
-}
+static void vkd3d_shader_scan_instructions(const struct vkd3d_shader_instruction_array *instructions,
+        struct vkd3d_shader_scan_info *scan_info);
 
 static int vkd3d_shader_validate_compile_args(const struct vkd3d_shader_compile_arguments *compile_args)
 {
@@ -144,10 +512,13 @@ int vkd3d_shader_compile_dxbc(const struct vkd3d_shader_code *dxbc,
         const struct vkd3d_shader_interface_info *shader_interface_info,
         const struct vkd3d_shader_compile_arguments *compile_args)
 {
-    struct vkd3d_shader_instruction instruction;
+    const struct vkd3d_shader_compile_timing_info *timing_info = NULL;
     struct vkd3d_dxbc_compiler *spirv_compiler;
     struct vkd3d_shader_scan_info scan_info;
+    uint64_t start_time = 0, decode_time = 0, parse_time = 0;
     struct vkd3d_shader_parser parser;
+    uint64_t dxbc_hash;
+    size_t i;
     int ret;
 
     TRACE("dxbc {%p, %zu}, spirv %p, compiler_options %#x, shader_interface_info %p, compile_args %p.\n",
@@ -173,18 +544,26 @@ int vkd3d_shader_compile_dxbc(const struct vkd3d_shader_code *dxbc,
 #endif
     }
 
-    scan_info.type = VKD3D_SHADER_STRUCTURE_TYPE_SCAN_INFO;
-    scan_info.next = NULL;
-    if ((ret = vkd3d_shader_scan_dxbc(dxbc, &scan_info)) < 0)
-        return ret;
+    if (shader_interface_info && (timing_info = vkd3d_find_struct(shader_interface_info->next, COMPILE_TIMING_INFO)))
+        start_time = vkd3d_get_current_time_ns();
 
+    /* The scanner and the compiler share the decoded instructions, and
+     * scanning is accounted as parsing. */
     if ((ret = vkd3d_shader_parser_init(&parser, dxbc)) < 0)
         return ret;
 
-    vkd3d_shader_dump_shader(parser.shader_version.type, dxbc);
+    if (timing_info)
+        decode_time = vkd3d_get_current_time_ns();
+
+    vkd3d_shader_scan_instructions(&parser.instructions, &scan_info);
+
+    if (timing_info)
+        parse_time = vkd3d_get_current_time_ns();
+
+    dxbc_hash = vkd3d_shader_dump_shader(parser.shader_version.type, dxbc);
 
     if (TRACE_ON())
-        vkd3d_shader_trace(parser.data);
+        vkd3d_shader_trace(&parser.shader_version, &parser.instructions);
 
     if (!(spirv_compiler = vkd3d_dxbc_compiler_create(&parser.shader_version,
             &parser.shader_desc, compiler_options, shader_interface_info, compile_args, &scan_info)))
@@ -194,27 +573,25 @@ int vkd3d_shader_compile_dxbc(const struct vkd3d_shader_code *dxbc,
         return VKD3D_ERROR;
     }
 
-    while (!shader_sm4_is_end(parser.data, &parser.ptr))
+    for (i = 0; i < parser.instructions.count; ++i)
     {
-        shader_sm4_read_instruction(parser.data, &parser.ptr, &instruction);
-
-        if (instruction.handler_idx == VKD3DSIH_INVALID)
-        {
-            WARN("Encountered unrecognized or invalid instruction.\n");
-            vkd3d_dxbc_compiler_destroy(spirv_compiler);
-            vkd3d_shader_parser_destroy(&parser);
-            return VKD3D_ERROR_INVALID_ARGUMENT;
-        }
-
-        if ((ret = vkd3d_dxbc_compiler_handle_instruction(spirv_compiler, &instruction)) < 0)
+        if ((ret = vkd3d_dxbc_compiler_handle_instruction(spirv_compiler, &parser.instructions.elements[i])) < 0)
             break;
     }
 
     if (ret >= 0)
         ret = vkd3d_dxbc_compiler_generate_spirv(spirv_compiler, spirv);
 
+    if (timing_info)
+    {
+        *timing_info->parse_time_ns = parse_time - start_time;
+        *timing_info->emit_time_ns = vkd3d_get_current_time_ns() - parse_time;
+        if (timing_info->scan_time_ns)
+            *timing_info->scan_time_ns = parse_time - decode_time;
+    }
+
     if (ret == 0)
-        vkd3d_shader_dump_spirv_shader(parser.shader_version.type, spirv);
+        vkd3d_shader_dump_spirv_shader(parser.shader_version.type, dxbc_hash, spirv);
 
     vkd3d_dxbc_compiler_destroy(spirv_compiler);
     vkd3d_shader_parser_destroy(&parser);
@@ -307,10 +684,20 @@ static void vkd3d_shader_scan_instruction(struct vkd3d_shader_scan_info *scan_in
         vkd3d_shader_scan_record_uav_counter(scan_info, &instruction->src[0].reg);
 }
 
+static void vkd3d_shader_scan_instructions(const struct vkd3d_shader_instruction_array *instructions,
+        struct vkd3d_shader_scan_info *scan_info)
+{
+    size_t i;
+
+    memset(scan_info, 0, sizeof(*scan_info));
+
+    for (i = 0; i < instructions->count; ++i)
+        vkd3d_shader_scan_instruction(scan_info, &instructions->elements[i]);
+}
+
 int vkd3d_shader_scan_dxbc(const struct vkd3d_shader_code *dxbc,
         struct vkd3d_shader_scan_info *scan_info)
 {
-    struct vkd3d_shader_instruction instruction;
     struct vkd3d_shader_parser parser;
     int ret;
 
@@ -332,21 +719,7 @@ int vkd3d_shader_scan_dxbc(const struct vkd3d_shader_code *dxbc,
         if ((ret = vkd3d_shader_parser_init(&parser, dxbc)) < 0)
             return ret;
 
-        memset(scan_info, 0, sizeof(*scan_info));
-
-        while (!shader_sm4_is_end(parser.data, &parser.ptr))
-        {
-            shader_sm4_read_instruction(parser.data, &parser.ptr, &instruction);
-
-            if (instruction.handler_idx == VKD3DSIH_INVALID)
-            {
-                WARN("Encountered unrecognized or invalid instruction.\n");
-                vkd3d_shader_parser_destroy(&parser);
-                return VKD3D_ERROR_INVALID_ARGUMENT;
-            }
-
-            vkd3d_shader_scan_instruction(scan_info, &instruction);
-        }
+        vkd3d_shader_scan_instructions(&parser.instructions, scan_info);
 
         vkd3d_shader_parser_destroy(&parser);
         return VKD3D_OK;
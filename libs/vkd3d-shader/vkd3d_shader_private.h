@@ -825,7 +825,195 @@ static inline bool vkd3d_shader_register_is_output(const struct vkd3d_shader_reg
     return reg->type == VKD3DSPR_OUTPUT || reg->type == VKD3DSPR_COLOROUT;
 }
 
-void vkd3d_shader_trace(void *data) DECLSPEC_HIDDEN;
+struct vkd3d_shader_arena_block
+{
+    struct vkd3d_shader_arena_block *next;
+    size_t size;
+    size_t used;
+    uint64_t data[];
+};
+
+/* Bump allocator for data which lives as long as its owner. Allocations are
+ * never freed individually; the whole arena is reset or freed at once. */
+struct vkd3d_shader_arena
+{
+    struct vkd3d_shader_arena_block *blocks;
+    size_t block_size;
+};
+
+void vkd3d_shader_arena_init(struct vkd3d_shader_arena *arena, size_t block_size) DECLSPEC_HIDDEN;
+void *vkd3d_shader_arena_alloc_block(struct vkd3d_shader_arena *arena, size_t size) DECLSPEC_HIDDEN;
+void vkd3d_shader_arena_reset(struct vkd3d_shader_arena *arena) DECLSPEC_HIDDEN;
+void vkd3d_shader_arena_free(struct vkd3d_shader_arena *arena) DECLSPEC_HIDDEN;
+
+static inline void *vkd3d_shader_arena_alloc(struct vkd3d_shader_arena *arena, size_t size)
+{
+    struct vkd3d_shader_arena_block *block = arena->blocks;
+    void *ptr;
+
+    size = align(size, sizeof(*block->data));
+
+    if (!block || block->size - block->used < size)
+        return vkd3d_shader_arena_alloc_block(arena, size);
+
+    ptr = (uint8_t *)block->data + block->used;
+    block->used += size;
+    return ptr;
+}
+
+static inline void *vkd3d_shader_arena_calloc(struct vkd3d_shader_arena *arena, size_t count, size_t size)
+{
+    void *ptr;
+
+    if (size && count > ~(size_t)0 / size)
+        return NULL;
+
+    if ((ptr = vkd3d_shader_arena_alloc(arena, count * size)))
+        memset(ptr, 0, count * size);
+    return ptr;
+}
+
+static inline void *vkd3d_shader_arena_copy(struct vkd3d_shader_arena *arena, const void *data, size_t size)
+{
+    void *ptr;
+
+    if ((ptr = vkd3d_shader_arena_alloc(arena, size)))
+        memcpy(ptr, data, size);
+    return ptr;
+}
+
+struct vkd3d_shader_hash_map_entry
+{
+    uint32_t hash;
+};
+
+#define VKD3D_SHADER_HASH_MAP_ENTRY_VALUE(element, type, field) \
+    ((type *)((char *)(element) - offsetof(type, field)))
+
+typedef bool (*vkd3d_shader_hash_map_equal_func)(const void *key, const struct vkd3d_shader_hash_map_entry *entry);
+
+struct vkd3d_shader_hash_map_slot
+{
+    uint32_t hash;
+    struct vkd3d_shader_hash_map_entry *entry;
+};
+
+/* Open addressing hash map with linear probing. Entries are embedded in the
+ * caller's structures and carry their precomputed hash, so that lookups only
+ * compare keys whose hashes match, and growing never rehashes keys. */
+struct vkd3d_shader_hash_map
+{
+    struct vkd3d_shader_hash_map_slot *slots;
+    size_t capacity;
+    size_t count;
+    vkd3d_shader_hash_map_equal_func equal;
+};
+
+void vkd3d_shader_hash_map_init(struct vkd3d_shader_hash_map *map,
+        vkd3d_shader_hash_map_equal_func equal) DECLSPEC_HIDDEN;
+int vkd3d_shader_hash_map_put(struct vkd3d_shader_hash_map *map, const void *key,
+        struct vkd3d_shader_hash_map_entry *entry) DECLSPEC_HIDDEN;
+void vkd3d_shader_hash_map_remove(struct vkd3d_shader_hash_map *map,
+        struct vkd3d_shader_hash_map_entry *entry) DECLSPEC_HIDDEN;
+void vkd3d_shader_hash_map_clear(struct vkd3d_shader_hash_map *map) DECLSPEC_HIDDEN;
+void vkd3d_shader_hash_map_free(struct vkd3d_shader_hash_map *map) DECLSPEC_HIDDEN;
+
+static inline struct vkd3d_shader_hash_map_entry *vkd3d_shader_hash_map_get(
+        const struct vkd3d_shader_hash_map *map, const void *key, uint32_t hash)
+{
+    const struct vkd3d_shader_hash_map_slot *slot;
+    size_t mask = map->capacity - 1;
+    size_t i;
+
+    if (!map->count)
+        return NULL;
+
+    for (i = hash & mask;; i = (i + 1) & mask)
+    {
+        slot = &map->slots[i];
+        if (!slot->entry)
+            return NULL;
+        if (slot->hash == hash && map->equal(key, slot->entry))
+            return slot->entry;
+    }
+}
+
+/* Mixes 32-bit words; the final avalanche makes the low bits, which select
+ * the slot, depend on every input bit. */
+static inline uint32_t vkd3d_shader_hash_u32(uint32_t hash, uint32_t value)
+{
+    return (hash ^ value) * 0x01000193u;
+}
+
+static inline uint32_t vkd3d_shader_hash_finalize(uint32_t hash)
+{
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bu;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35u;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+#define VKD3D_SHADER_HASH_INIT 0x811c9dc5u
+
+/* Index over the resource bindings of a shader interface which are visible
+ * to one shader stage. Ranges are sorted by descriptor type, register space
+ * and first register, so that register lookups don't need to walk all the
+ * bindings of large root signatures. The ranges are only built once a few
+ * lookups have been made. */
+struct vkd3d_shader_binding_range
+{
+    unsigned int register_space;
+    unsigned int first;
+    unsigned int last;
+    /* Largest last register of this range and the preceding ranges in the
+     * same register space. */
+    unsigned int max_last;
+    unsigned int binding_idx;
+};
+
+#define VKD3D_SHADER_BINDING_INDEX_TYPE_COUNT (VKD3D_SHADER_DESCRIPTOR_TYPE_SAMPLER + 1)
+
+struct vkd3d_shader_binding_index
+{
+    const struct vkd3d_shader_resource_binding *bindings;
+    unsigned int binding_count;
+    enum vkd3d_shader_visibility visibility;
+
+    unsigned int linear_lookup_count;
+    bool indexed;
+    struct vkd3d_shader_binding_range *ranges;
+    size_t ranges_size;
+    size_t type_offsets[VKD3D_SHADER_BINDING_INDEX_TYPE_COUNT + 1];
+};
+
+enum vkd3d_shader_visibility vkd3d_shader_visibility_from_shader_type(enum vkd3d_shader_type type) DECLSPEC_HIDDEN;
+
+/* Storage is kept when an index is initialized again. */
+void vkd3d_shader_binding_index_init(struct vkd3d_shader_binding_index *index,
+        const struct vkd3d_shader_interface_info *shader_interface,
+        enum vkd3d_shader_visibility visibility) DECLSPEC_HIDDEN;
+void vkd3d_shader_binding_index_cleanup(struct vkd3d_shader_binding_index *index) DECLSPEC_HIDDEN;
+/* Returns the first binding, in shader interface order, which contains the
+ * register, has any of "flags" set unless "flags" is 0, and has none of
+ * "excluded_flags" set. */
+const struct vkd3d_shader_resource_binding *vkd3d_shader_binding_index_find(
+        struct vkd3d_shader_binding_index *index, enum vkd3d_shader_descriptor_type type,
+        unsigned int register_space, unsigned int register_index,
+        unsigned int flags, unsigned int excluded_flags) DECLSPEC_HIDDEN;
+
+/* Instructions decoded once from the token stream, and shared by the scanner
+ * and the SPIR-V compiler. Parameters are owned by the SM4 parser. */
+struct vkd3d_shader_instruction_array
+{
+    struct vkd3d_shader_instruction *elements;
+    size_t capacity;
+    size_t count;
+};
+
+void vkd3d_shader_trace(const struct vkd3d_shader_version *shader_version,
+        const struct vkd3d_shader_instruction_array *instructions) DECLSPEC_HIDDEN;
 
 const char *shader_get_type_prefix(enum vkd3d_shader_type type) DECLSPEC_HIDDEN;
 
@@ -859,10 +1047,16 @@ int vkd3d_dxbc_compiler_generate_spirv(struct vkd3d_dxbc_compiler *compiler,
         struct vkd3d_shader_code *spirv) DECLSPEC_HIDDEN;
 void vkd3d_dxbc_compiler_destroy(struct vkd3d_dxbc_compiler *compiler) DECLSPEC_HIDDEN;
 
+void vkd3d_spirv_optimize(struct vkd3d_shader_code *spirv) DECLSPEC_HIDDEN;
+
 void vkd3d_compute_dxbc_checksum(const void *dxbc, size_t size, uint32_t checksum[4]) DECLSPEC_HIDDEN;
 
-void vkd3d_shader_dump_spirv_shader(enum vkd3d_shader_type type, const struct vkd3d_shader_code *shader);
-void vkd3d_shader_dump_shader(enum vkd3d_shader_type type, const struct vkd3d_shader_code *shader);
+/* Returns the hash which names the dump, to be passed along with the SPIR-V
+ * compiled from the shader, or 0 if dumping is disabled. */
+uint64_t vkd3d_shader_dump_shader(enum vkd3d_shader_type type,
+        const struct vkd3d_shader_code *shader) DECLSPEC_HIDDEN;
+void vkd3d_shader_dump_spirv_shader(enum vkd3d_shader_type type, uint64_t dxbc_hash,
+        const struct vkd3d_shader_code *shader) DECLSPEC_HIDDEN;
 
 static inline enum vkd3d_component_type vkd3d_component_type_from_data_type(
         enum vkd3d_data_type data_type)
@@ -1230,6 +1230,19 @@ static bool d3d12_command_allocator_add_view(struct d3d12_command_allocator *all
     return true;
 }
 
+static bool d3d12_command_allocator_add_pipeline(struct d3d12_command_allocator *allocator,
+        struct vkd3d_compiled_pipeline *pipeline)
+{
+    if (!vkd3d_array_reserve((void **)&allocator->pipelines, &allocator->pipelines_size,
+            allocator->pipeline_count + 1, sizeof(*allocator->pipelines)))
+        return false;
+
+    allocator->pipelines[allocator->pipeline_count++] = pipeline;
+    vkd3d_compiled_pipeline_set_owner(pipeline, allocator->pipeline_owner);
+
+    return true;
+}
+
 static bool d3d12_command_allocator_add_buffer_view(struct d3d12_command_allocator *allocator,
         VkBufferView view)
 {
@@ -1441,6 +1454,11 @@ static void d3d12_command_allocator_free_resources(struct d3d12_command_allocato
     }
     allocator->view_count = 0;
 
+    vkd3d_compiled_pipelines_release(allocator->pipelines, allocator->pipeline_count, device);
+    allocator->pipeline_count = 0;
+    /* Variants marked with the previous owner are no longer referenced. */
+    allocator->pipeline_owner = vkd3d_pipeline_variant_budget_get_owner(&device->pipeline_variant_budget);
+
     for (i = 0; i < allocator->framebuffer_count; ++i)
     {
         VK_CALL(vkDestroyFramebuffer(device->vk_device, allocator->framebuffers[i], NULL));
@@ -1513,6 +1531,7 @@ static ULONG STDMETHODCALLTYPE d3d12_command_allocator_Release(ID3D12CommandAllo
         d3d12_command_allocator_free_resources(allocator, false);
         vkd3d_free(allocator->buffer_views);
         vkd3d_free(allocator->views);
+        vkd3d_free(allocator->pipelines);
         for (i = 0; i < VKD3D_DESCRIPTOR_POOL_TYPE_COUNT; i++)
         {
             vkd3d_free(allocator->descriptor_pool_caches[i].descriptor_pools);
@@ -1736,6 +1755,11 @@ static HRESULT d3d12_command_allocator_init(struct d3d12_command_allocator *allo
     allocator->views_size = 0;
     allocator->view_count = 0;
 
+    allocator->pipelines = NULL;
+    allocator->pipelines_size = 0;
+    allocator->pipeline_count = 0;
+    allocator->pipeline_owner = vkd3d_pipeline_variant_budget_get_owner(&device->pipeline_variant_budget);
+
     allocator->buffer_views = NULL;
     allocator->buffer_views_size = 0;
     allocator->buffer_view_count = 0;
@@ -1795,6 +1819,15 @@ static void d3d12_command_list_invalidate_current_pipeline(struct d3d12_command_
     list->current_pipeline = VK_NULL_HANDLE;
 }
 
+static void d3d12_command_list_invalidate_dynamic_state(struct d3d12_command_list *list)
+{
+    struct vkd3d_dynamic_state *dyn_state = &list->dynamic_state;
+
+    /* Internal pipelines overwrite all state which is static for them. */
+    dyn_state->dirty_flags = ~0u;
+    dyn_state->dirty_vertex_buffers = dyn_state->vertex_buffer_mask;
+}
+
 static bool d3d12_command_list_create_framebuffer(struct d3d12_command_list *list, VkRenderPass render_pass,
         uint32_t view_count, const VkImageView *views, VkExtent3D extent, VkFramebuffer *vk_framebuffer);
 
@@ -2958,7 +2991,10 @@ static bool d3d12_command_list_update_compute_pipeline(struct d3d12_command_list
 static bool d3d12_command_list_update_graphics_pipeline(struct d3d12_command_list *list)
 {
     const struct vkd3d_vk_device_procs *vk_procs = &list->device->vk_procs;
+    struct vkd3d_dynamic_state *dyn_state = &list->dynamic_state;
+    struct vkd3d_compiled_pipeline *variant;
     VkRenderPass vk_render_pass;
+    bool dynamic_vertex_strides;
     VkPipeline vk_pipeline;
     VkFormat dsv_format;
 
@@ -2974,9 +3010,18 @@ static bool d3d12_command_list_update_graphics_pipeline(struct d3d12_command_lis
     dsv_format = list->dsv.format ? list->dsv.format->vk_format : VK_FORMAT_UNDEFINED;
 
     if (!(vk_pipeline = d3d12_pipeline_state_get_or_create_pipeline(list->state,
-            &list->dynamic_state, dsv_format, &vk_render_pass)))
+            &list->dynamic_state, dsv_format, list->allocator->pipeline_owner, &vk_render_pass, &variant)))
         return false;
 
+    /* Keeps the pipeline alive until the command allocator is reset, even if
+     * the variant is evicted in the meantime. */
+    if (variant && !d3d12_command_allocator_add_pipeline(list->allocator, variant))
+    {
+        WARN("Failed to add pipeline variant.\n");
+        vkd3d_compiled_pipeline_release(variant, list->device);
+        return false;
+    }
+
     /* The render pass cache ensures that we use the same Vulkan render pass
      * object for compatible render passes. */
     if (list->pso_render_pass != vk_render_pass)
@@ -2994,6 +3039,16 @@ static bool d3d12_command_list_update_graphics_pipeline(struct d3d12_command_lis
     VK_CALL(vkCmdBindPipeline(list->vk_command_buffer, list->state->vk_bind_point, vk_pipeline));
     list->current_pipeline = vk_pipeline;
 
+    /* Strides are only dynamic state if the pipeline variant has them
+     * dynamic, and binding a pipeline with static strides discards them. */
+    dynamic_vertex_strides = d3d12_pipeline_state_has_dynamic_vertex_strides(list->state, dyn_state->vertex_strides);
+    if (dynamic_vertex_strides != dyn_state->dynamic_vertex_strides)
+    {
+        dyn_state->dynamic_vertex_strides = dynamic_vertex_strides;
+        dyn_state->dirty_vertex_buffers = dyn_state->vertex_buffer_mask;
+        dyn_state->dirty_flags |= VKD3D_DYNAMIC_STATE_VERTEX_BUFFER_STRIDE;
+    }
+
     return true;
 }
 
@@ -3618,24 +3673,75 @@ static bool d3d12_command_list_update_compute_state(struct d3d12_command_list *l
     return true;
 }
 
+static void d3d12_command_list_update_vertex_buffers(struct d3d12_command_list *list)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &list->device->vk_procs;
+    struct vkd3d_dynamic_state *dyn_state = &list->dynamic_state;
+    VkDeviceSize vk_strides[ARRAY_SIZE(dyn_state->vertex_strides)];
+    unsigned int i, first = 0, count = 0;
+    uint32_t mask;
+
+    /* Slots which were never set are left alone, binding them would
+     * require null descriptors. */
+    mask = dyn_state->dirty_vertex_buffers & dyn_state->vertex_buffer_mask;
+
+    for (i = 0; i <= ARRAY_SIZE(dyn_state->vertex_strides); ++i)
+    {
+        if (i < ARRAY_SIZE(dyn_state->vertex_strides) && (mask & (1u << i)))
+        {
+            if (!count)
+                first = i;
+            vk_strides[count++] = dyn_state->vertex_strides[i];
+            continue;
+        }
+
+        if (count)
+        {
+            VK_CALL(vkCmdBindVertexBuffers2EXT(list->vk_command_buffer, first, count,
+                    &dyn_state->vertex_buffers[first], &dyn_state->vertex_offsets[first], NULL,
+                    dyn_state->dynamic_vertex_strides ? vk_strides : NULL));
+            count = 0;
+        }
+    }
+
+    dyn_state->dirty_vertex_buffers = 0;
+}
+
 static void d3d12_command_list_update_dynamic_state(struct d3d12_command_list *list)
 {
     const struct vkd3d_vk_device_procs *vk_procs = &list->device->vk_procs;
     struct vkd3d_dynamic_state *dyn_state = &list->dynamic_state;
+    uint32_t dynamic_state_flags = list->state->graphics.dynamic_state_flags;
 
     /* Make sure we only update states that are dynamic in the pipeline */
-    dyn_state->dirty_flags &= list->state->graphics.dynamic_state_flags;
+    dyn_state->dirty_flags &= dynamic_state_flags;
 
     if (dyn_state->dirty_flags & VKD3D_DYNAMIC_STATE_VIEWPORT)
     {
-        VK_CALL(vkCmdSetViewport(list->vk_command_buffer,
-                0, dyn_state->viewport_count, dyn_state->viewports));
+        if (dynamic_state_flags & VKD3D_DYNAMIC_STATE_VIEWPORT_COUNT)
+        {
+            VK_CALL(vkCmdSetViewportWithCountEXT(list->vk_command_buffer,
+                    dyn_state->viewport_count, dyn_state->viewports));
+        }
+        else
+        {
+            VK_CALL(vkCmdSetViewport(list->vk_command_buffer,
+                    0, dyn_state->viewport_count, dyn_state->viewports));
+        }
     }
 
     if (dyn_state->dirty_flags & VKD3D_DYNAMIC_STATE_SCISSOR)
     {
-        VK_CALL(vkCmdSetScissor(list->vk_command_buffer,
-                0, dyn_state->viewport_count, dyn_state->scissors));
+        if (dynamic_state_flags & VKD3D_DYNAMIC_STATE_VIEWPORT_COUNT)
+        {
+            VK_CALL(vkCmdSetScissorWithCountEXT(list->vk_command_buffer,
+                    dyn_state->viewport_count, dyn_state->scissors));
+        }
+        else
+        {
+            VK_CALL(vkCmdSetScissor(list->vk_command_buffer,
+                    0, dyn_state->viewport_count, dyn_state->scissors));
+        }
     }
 
     if (dyn_state->dirty_flags & VKD3D_DYNAMIC_STATE_BLEND_CONSTANTS)
@@ -3656,6 +3762,15 @@ static void d3d12_command_list_update_dynamic_state(struct d3d12_command_list *l
                 dyn_state->min_depth_bounds, dyn_state->max_depth_bounds));
     }
 
+    if (dyn_state->dirty_flags & VKD3D_DYNAMIC_STATE_TOPOLOGY)
+    {
+        VK_CALL(vkCmdSetPrimitiveTopologyEXT(list->vk_command_buffer,
+                vk_topology_from_d3d12_topology(dyn_state->primitive_topology)));
+    }
+
+    if (dyn_state->dirty_flags & VKD3D_DYNAMIC_STATE_VERTEX_BUFFER_STRIDE)
+        d3d12_command_list_update_vertex_buffers(list);
+
     dyn_state->dirty_flags = 0;
 }
 
@@ -4082,6 +4197,7 @@ static void d3d12_command_list_copy_image(struct d3d12_command_list *list,
         }
 
         d3d12_command_list_invalidate_current_pipeline(list);
+        d3d12_command_list_invalidate_dynamic_state(list);
         d3d12_command_list_invalidate_root_parameters(list, VK_PIPELINE_BIND_POINT_GRAPHICS, true);
 
         memset(&dst_view_desc, 0, sizeof(dst_view_desc));
@@ -4740,8 +4856,14 @@ static void STDMETHODCALLTYPE d3d12_command_list_IASetPrimitiveTopology(d3d12_co
     if (dyn_state->primitive_topology == topology)
         return;
 
+    /* With a dynamic topology, the pipeline only depends on the topology class. */
+    if (!d3d12_pipeline_state_is_graphics(list->state) ||
+            d3d12_pipeline_state_get_static_topology(list->state, dyn_state->primitive_topology) !=
+            d3d12_pipeline_state_get_static_topology(list->state, topology))
+        d3d12_command_list_invalidate_current_pipeline(list);
+
     dyn_state->primitive_topology = topology;
-    d3d12_command_list_invalidate_current_pipeline(list);
+    dyn_state->dirty_flags |= VKD3D_DYNAMIC_STATE_TOPOLOGY;
 }
 
 static void STDMETHODCALLTYPE d3d12_command_list_RSSetViewports(d3d12_command_list_iface *iface,
@@ -4783,7 +4905,8 @@ static void STDMETHODCALLTYPE d3d12_command_list_RSSetViewports(d3d12_command_li
     {
         dyn_state->viewport_count = viewport_count;
         dyn_state->dirty_flags |= VKD3D_DYNAMIC_STATE_SCISSOR;
-        d3d12_command_list_invalidate_current_pipeline(list);
+        if (!list->device->vk_info.EXT_extended_dynamic_state)
+            d3d12_command_list_invalidate_current_pipeline(list);
     }
 
     dyn_state->dirty_flags |= VKD3D_DYNAMIC_STATE_VIEWPORT;
@@ -5456,6 +5579,7 @@ static void STDMETHODCALLTYPE d3d12_command_list_IASetVertexBuffers(d3d12_comman
     struct d3d12_resource *resource;
     bool invalidate = false;
     unsigned int i, stride;
+    uint32_t mask;
 
     TRACE("iface %p, start_slot %u, view_count %u, views %p.\n", iface, start_slot, view_count, views);
 
@@ -5491,6 +5615,25 @@ static void STDMETHODCALLTYPE d3d12_command_list_IASetVertexBuffers(d3d12_comman
         dyn_state->vertex_strides[start_slot + i] = stride;
     }
 
+    /* Strides are dynamic in every pipeline, so buffers are bound with
+     * their strides before the next draw instead. */
+    if (list->device->vk_info.EXT_extended_dynamic_state)
+    {
+        memcpy(&dyn_state->vertex_buffers[start_slot], buffers, view_count * sizeof(*buffers));
+        memcpy(&dyn_state->vertex_offsets[start_slot], offsets, view_count * sizeof(*offsets));
+        mask = (view_count < 32 ? (1u << view_count) - 1 : ~0u) << start_slot;
+        dyn_state->vertex_buffer_mask |= mask;
+        dyn_state->dirty_vertex_buffers |= mask;
+        dyn_state->dirty_flags |= VKD3D_DYNAMIC_STATE_VERTEX_BUFFER_STRIDE;
+
+        /* Strides which the bound pipeline cannot take dynamically select
+         * another variant. */
+        if (invalidate && !(dyn_state->dynamic_vertex_strides
+                && d3d12_pipeline_state_has_dynamic_vertex_strides(list->state, dyn_state->vertex_strides)))
+            d3d12_command_list_invalidate_current_pipeline(list);
+        return;
+    }
+
     if (view_count)
         VK_CALL(vkCmdBindVertexBuffers(list->vk_command_buffer, start_slot, view_count, buffers, offsets));
 
@@ -78,6 +78,7 @@ static const struct vkd3d_optional_extension_info optional_device_extensions[] =
     VK_EXTENSION(EXT_CUSTOM_BORDER_COLOR, EXT_custom_border_color),
     VK_EXTENSION(EXT_DEPTH_CLIP_ENABLE, EXT_depth_clip_enable),
     VK_EXTENSION(EXT_DESCRIPTOR_INDEXING, EXT_descriptor_indexing),
+    VK_EXTENSION(EXT_EXTENDED_DYNAMIC_STATE, EXT_extended_dynamic_state),
     VK_EXTENSION(EXT_INLINE_UNIFORM_BLOCK, EXT_inline_uniform_block),
     VK_EXTENSION(EXT_ROBUSTNESS_2, EXT_robustness2),
     VK_EXTENSION(EXT_SAMPLER_FILTER_MINMAX, EXT_sampler_filter_minmax),
@@ -387,6 +388,8 @@ static void vkd3d_init_debug_messenger_callback(struct vkd3d_instance *instance)
 static const struct vkd3d_debug_option vkd3d_config_options[] =
 {
     {"vk_debug", VKD3D_CONFIG_FLAG_VULKAN_DEBUG}, /* enable Vulkan debug extensions */
+    {"no_pipeline_precompile", VKD3D_CONFIG_FLAG_NO_PIPELINE_PRECOMPILE}, /* disable speculative pipeline compiles */
+    {"optimize_shaders", VKD3D_CONFIG_FLAG_OPTIMIZE_SHADERS}, /* run the SPIR-V optimizer */
 };
 
 static uint64_t vkd3d_init_config_flags(void)
@@ -659,6 +662,7 @@ static void vkd3d_physical_device_info_init(struct vkd3d_physical_device_info *i
     VkPhysicalDevicePushDescriptorPropertiesKHR *push_descriptor_properties;
     VkPhysicalDeviceShaderFloat16Int8FeaturesKHR *float16_int8_features;
     VkPhysicalDeviceShaderCoreProperties2AMD *shader_core_properties2;
+    VkPhysicalDeviceExtendedDynamicStateFeaturesEXT *extended_dynamic_state_features;
     VkPhysicalDeviceDepthClipEnableFeaturesEXT *depth_clip_features;
     VkPhysicalDeviceRobustness2PropertiesEXT *robustness2_properties;
     VkPhysicalDeviceShaderCorePropertiesAMD *shader_core_properties;
@@ -701,6 +705,7 @@ static void vkd3d_physical_device_info_init(struct vkd3d_physical_device_info *i
     shader_subgroup_extended_types_features = &info->subgroup_extended_types_features;
     robustness2_properties = &info->robustness2_properties;
     robustness2_features = &info->robustness2_features;
+    extended_dynamic_state_features = &info->extended_dynamic_state_features;
 
     info->features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
     info->properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
@@ -772,6 +777,12 @@ static void vkd3d_physical_device_info_init(struct vkd3d_physical_device_info *i
         vk_prepend_struct(&info->properties2, descriptor_indexing_properties);
     }
 
+    if (vulkan_info->EXT_extended_dynamic_state)
+    {
+        extended_dynamic_state_features->sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_FEATURES_EXT;
+        vk_prepend_struct(&info->features2, extended_dynamic_state_features);
+    }
+
     if (vulkan_info->EXT_inline_uniform_block)
     {
         inline_uniform_block_features->sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_INLINE_UNIFORM_BLOCK_FEATURES_EXT;
@@ -1132,6 +1143,7 @@ static void vkd3d_trace_physical_device_features(const struct vkd3d_physical_dev
     const VkPhysicalDeviceCustomBorderColorFeaturesEXT *border_color_features;
     const VkPhysicalDeviceDescriptorIndexingFeaturesEXT *descriptor_indexing;
     const VkPhysicalDeviceDepthClipEnableFeaturesEXT *depth_clip_features;
+    const VkPhysicalDeviceExtendedDynamicStateFeaturesEXT *extended_dynamic_state_features;
     const VkPhysicalDeviceFeatures *features = &info->features2.features;
     const VkPhysicalDeviceTransformFeedbackFeaturesEXT *xfb;
 
@@ -1247,6 +1259,10 @@ static void vkd3d_trace_physical_device_features(const struct vkd3d_physical_dev
     TRACE("  VkPhysicalDeviceDepthClipEnableFeaturesEXT:\n");
     TRACE("    depthClipEnable: %#x.\n", depth_clip_features->depthClipEnable);
 
+    extended_dynamic_state_features = &info->extended_dynamic_state_features;
+    TRACE("  VkPhysicalDeviceExtendedDynamicStateFeaturesEXT:\n");
+    TRACE("    extendedDynamicState: %#x.\n", extended_dynamic_state_features->extendedDynamicState);
+
     demote_features = &info->demote_features;
     TRACE("  VkPhysicalDeviceShaderDemoteToHelperInvocationFeaturesEXT:\n");
     TRACE("    shaderDemoteToHelperInvocation: %#x.\n", demote_features->shaderDemoteToHelperInvocation);
@@ -1368,6 +1384,8 @@ static HRESULT vkd3d_init_device_caps(struct d3d12_device *device,
         vulkan_info->EXT_conditional_rendering = false;
     if (!physical_device_info->depth_clip_features.depthClipEnable)
         vulkan_info->EXT_depth_clip_enable = false;
+    if (!physical_device_info->extended_dynamic_state_features.extendedDynamicState)
+        vulkan_info->EXT_extended_dynamic_state = false;
     if (!physical_device_info->demote_features.shaderDemoteToHelperInvocation)
         vulkan_info->EXT_shader_demote_to_helper_invocation = false;
     if (!physical_device_info->texel_buffer_alignment_features.texelBufferAlignment)
@@ -1784,10 +1802,14 @@ static HRESULT vkd3d_create_vk_device(struct d3d12_device *device,
     return hr;
 }
 
-static HRESULT d3d12_device_init_pipeline_cache(struct d3d12_device *device)
+static HRESULT d3d12_device_init_pipeline_cache(struct d3d12_device *device,
+        const struct vkd3d_device_create_info *create_info)
 {
     const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    const struct vkd3d_pipeline_cache_info *pipeline_cache_info;
     VkPipelineCacheCreateInfo cache_info;
+    const char *cache_dir;
+    void *initial_data;
     VkResult vr;
     int rc;
 
@@ -1797,18 +1819,37 @@ static HRESULT d3d12_device_init_pipeline_cache(struct d3d12_device *device)
         return hresult_from_errno(rc);
     }
 
+    if ((pipeline_cache_info = vkd3d_find_struct(create_info->next, PIPELINE_CACHE_INFO))
+            && pipeline_cache_info->cache_path)
+        cache_dir = pipeline_cache_info->cache_path;
+    else
+        cache_dir = getenv("VKD3D_PIPELINE_CACHE_PATH");
+
+    initial_data = vkd3d_persistent_pipeline_cache_init(&device->persistent_pipeline_cache,
+            device, cache_dir, &cache_info.initialDataSize);
+
     cache_info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
     cache_info.pNext = NULL;
     cache_info.flags = 0;
-    cache_info.initialDataSize = 0;
-    cache_info.pInitialData = NULL;
+    cache_info.pInitialData = initial_data;
     if ((vr = VK_CALL(vkCreatePipelineCache(device->vk_device, &cache_info, NULL,
-            &device->vk_pipeline_cache))) < 0)
+            &device->vk_pipeline_cache))) < 0 && initial_data)
+    {
+        WARN("Failed to create Vulkan pipeline cache from initial data, vr %d.\n", vr);
+        cache_info.initialDataSize = 0;
+        cache_info.pInitialData = NULL;
+        vr = VK_CALL(vkCreatePipelineCache(device->vk_device, &cache_info, NULL, &device->vk_pipeline_cache));
+    }
+    vkd3d_free(initial_data);
+
+    if (vr < 0)
     {
         ERR("Failed to create Vulkan pipeline cache, vr %d.\n", vr);
         device->vk_pipeline_cache = VK_NULL_HANDLE;
     }
 
+    vkd3d_persistent_pipeline_cache_start(&device->persistent_pipeline_cache, device);
+
     return S_OK;
 }
 
@@ -1816,6 +1857,8 @@ static void d3d12_device_destroy_pipeline_cache(struct d3d12_device *device)
 {
     const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
 
+    vkd3d_persistent_pipeline_cache_cleanup(&device->persistent_pipeline_cache, device);
+
     if (device->vk_pipeline_cache)
         VK_CALL(vkDestroyPipelineCache(device->vk_device, device->vk_pipeline_cache, NULL));
 
@@ -2151,13 +2194,22 @@ static void d3d12_device_destroy(struct d3d12_device *device)
 
     vkd3d_private_store_destroy(&device->private_store);
 
+    vkd3d_pipeline_compiler_cleanup(&device->pipeline_compiler, device);
     vkd3d_cleanup_format_info(device);
     vkd3d_meta_ops_cleanup(&device->meta_ops, device);
     vkd3d_bindless_state_cleanup(&device->bindless_state, device);
     vkd3d_destroy_null_resources(&device->null_resources, device);
     vkd3d_gpu_va_allocator_cleanup(&device->gpu_va_allocator);
     vkd3d_render_pass_cache_cleanup(&device->render_pass_cache, device);
+    vkd3d_root_signature_cache_cleanup(&device->root_signature_cache);
+    vkd3d_shader_module_cache_cleanup(&device->shader_module_cache);
+    vkd3d_sampler_cache_cleanup(&device->sampler_cache);
+    vkd3d_pipeline_variant_budget_cleanup(&device->pipeline_variant_budget);
     vkd3d_fence_worker_stop(&device->fence_worker, device);
+    vkd3d_shader_cache_cleanup(&device->shader_cache);
+    vkd3d_pipeline_stats_cleanup(&device->pipeline_stats, device);
+    vkd3d_pipeline_recorder_cleanup(&device->pipeline_recorder);
+    vkd3d_pipeline_index_cleanup(&device->pipeline_index);
     d3d12_device_destroy_pipeline_cache(device);
     d3d12_device_destroy_vkd3d_queues(device);
     VK_CALL(vkDestroyDevice(device->vk_device, NULL));
@@ -2265,54 +2317,18 @@ static HRESULT STDMETHODCALLTYPE d3d12_device_CreateCommandAllocator(d3d12_devic
             riid, command_allocator);
 }
 
-static void d3d12_promote_depth_stencil_desc(D3D12_DEPTH_STENCIL_DESC1 *out, const D3D12_DEPTH_STENCIL_DESC *in)
-{
-    out->DepthEnable = in->DepthEnable;
-    out->DepthWriteMask = in->DepthWriteMask;
-    out->DepthFunc = in->DepthFunc;
-    out->StencilEnable = in->StencilEnable;
-    out->StencilReadMask = in->StencilReadMask;
-    out->StencilWriteMask = in->StencilWriteMask;
-    out->FrontFace = in->FrontFace;
-    out->BackFace = in->BackFace;
-    out->DepthBoundsTestEnable = FALSE;
-}
-
 static HRESULT STDMETHODCALLTYPE d3d12_device_CreateGraphicsPipelineState(d3d12_device_iface *iface,
         const D3D12_GRAPHICS_PIPELINE_STATE_DESC *desc, REFIID riid, void **pipeline_state)
 {
     struct d3d12_device *device = impl_from_ID3D12Device(iface);
     struct d3d12_pipeline_state_desc pipeline_desc;
     struct d3d12_pipeline_state *object;
-    unsigned int i;
     HRESULT hr;
 
     TRACE("iface %p, desc %p, riid %s, pipeline_state %p.\n",
             iface, desc, debugstr_guid(riid), pipeline_state);
 
-    memset(&pipeline_desc, 0, sizeof(pipeline_desc));
-    pipeline_desc.root_signature = desc->pRootSignature;
-    pipeline_desc.vs = desc->VS;
-    pipeline_desc.ps = desc->PS;
-    pipeline_desc.ds = desc->DS;
-    pipeline_desc.hs = desc->HS;
-    pipeline_desc.gs = desc->GS;
-    pipeline_desc.stream_output = desc->StreamOutput;
-    pipeline_desc.blend_state = desc->BlendState;
-    pipeline_desc.sample_mask = desc->SampleMask;
-    pipeline_desc.rasterizer_state = desc->RasterizerState;
-    d3d12_promote_depth_stencil_desc(&pipeline_desc.depth_stencil_state, &desc->DepthStencilState);
-    pipeline_desc.input_layout = desc->InputLayout;
-    pipeline_desc.strip_cut_value = desc->IBStripCutValue;
-    pipeline_desc.primitive_topology_type = desc->PrimitiveTopologyType;
-    pipeline_desc.rtv_formats.NumRenderTargets = desc->NumRenderTargets;
-    for (i = 0; i < ARRAY_SIZE(desc->RTVFormats); i++)
-        pipeline_desc.rtv_formats.RTFormats[i] = desc->RTVFormats[i];
-    pipeline_desc.dsv_format = desc->DSVFormat;
-    pipeline_desc.sample_desc = desc->SampleDesc;
-    pipeline_desc.node_mask = desc->NodeMask;
-    pipeline_desc.cached_pso = desc->CachedPSO;
-    pipeline_desc.flags = desc->Flags;
+    d3d12_pipeline_state_desc_from_d3d12_graphics_desc(&pipeline_desc, desc);
 
     if (FAILED(hr = d3d12_pipeline_state_create(device,
             VK_PIPELINE_BIND_POINT_GRAPHICS, &pipeline_desc, &object)))
@@ -2333,12 +2349,7 @@ static HRESULT STDMETHODCALLTYPE d3d12_device_CreateComputePipelineState(d3d12_d
     TRACE("iface %p, desc %p, riid %s, pipeline_state %p.\n",
             iface, desc, debugstr_guid(riid), pipeline_state);
 
-    memset(&pipeline_desc, 0, sizeof(pipeline_desc));
-    pipeline_desc.root_signature = desc->pRootSignature;
-    pipeline_desc.cs = desc->CS;
-    pipeline_desc.node_mask = desc->NodeMask;
-    pipeline_desc.cached_pso = desc->CachedPSO;
-    pipeline_desc.flags = desc->Flags;
+    d3d12_pipeline_state_desc_from_d3d12_compute_desc(&pipeline_desc, desc);
 
     if (FAILED(hr = d3d12_pipeline_state_create(device,
             VK_PIPELINE_BIND_POINT_COMPUTE, &pipeline_desc, &object)))
@@ -3648,147 +3659,20 @@ static HRESULT STDMETHODCALLTYPE d3d12_device_SetResidencyPriority(d3d12_device_
     return S_OK;
 }
 
-static void d3d12_init_pipeline_state_desc(struct d3d12_pipeline_state_desc *desc)
-{
-    D3D12_DEPTH_STENCIL_DESC1 *ds_state = &desc->depth_stencil_state;
-    D3D12_RASTERIZER_DESC *rs_state = &desc->rasterizer_state;
-    D3D12_BLEND_DESC *blend_state = &desc->blend_state;
-    DXGI_SAMPLE_DESC *sample_desc = &desc->sample_desc;
-
-    memset(desc, 0, sizeof(*desc));
-    ds_state->DepthEnable = TRUE;
-    ds_state->DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ALL;
-    ds_state->DepthFunc = D3D12_COMPARISON_FUNC_LESS;
-    ds_state->StencilReadMask = D3D12_DEFAULT_STENCIL_READ_MASK;
-    ds_state->StencilWriteMask = D3D12_DEFAULT_STENCIL_WRITE_MASK;
-    ds_state->FrontFace.StencilFunc = ds_state->BackFace.StencilFunc = D3D12_COMPARISON_FUNC_ALWAYS;
-    ds_state->FrontFace.StencilDepthFailOp = ds_state->BackFace.StencilDepthFailOp = D3D12_STENCIL_OP_KEEP;
-    ds_state->FrontFace.StencilPassOp = ds_state->BackFace.StencilPassOp = D3D12_STENCIL_OP_KEEP;
-    ds_state->FrontFace.StencilFailOp = ds_state->BackFace.StencilFailOp = D3D12_STENCIL_OP_KEEP;
-
-    rs_state->FillMode = D3D12_FILL_MODE_SOLID;
-    rs_state->CullMode = D3D12_CULL_MODE_BACK;
-    rs_state->DepthClipEnable = TRUE;
-    rs_state->ConservativeRaster = D3D12_CONSERVATIVE_RASTERIZATION_MODE_OFF;
-
-    blend_state->RenderTarget[0].RenderTargetWriteMask = D3D12_COLOR_WRITE_ENABLE_ALL;
-
-    sample_desc->Count = 1;
-    sample_desc->Quality = 0;
-
-    desc->sample_mask = D3D12_DEFAULT_SAMPLE_MASK;
-}
-
-#define VKD3D_HANDLE_SUBOBJECT_EXPLICIT(type_enum, type_name, assignment) \
-    case D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_ ## type_enum: \
-    {\
-        const struct {\
-            D3D12_PIPELINE_STATE_SUBOBJECT_TYPE type; \
-            type_name data; \
-        } *subobject = (void *)stream_ptr; \
-        if (stream_ptr + sizeof(*subobject) > stream_end) \
-        { \
-            ERR("Invalid pipeline state stream.\n"); \
-            return E_INVALIDARG; \
-        } \
-        stream_ptr += align(sizeof(*subobject), sizeof(void*)); \
-        assignment; \
-        break;\
-    }
-
-#define VKD3D_HANDLE_SUBOBJECT(type_enum, type, left_side) \
-    VKD3D_HANDLE_SUBOBJECT_EXPLICIT(type_enum, type, left_side = subobject->data)
-
 static HRESULT STDMETHODCALLTYPE d3d12_device_CreatePipelineState(d3d12_device_iface *iface,
         const D3D12_PIPELINE_STATE_STREAM_DESC *desc, REFIID riid, void **pipeline_state)
 {
-    VkPipelineBindPoint pipeline_type = VK_PIPELINE_BIND_POINT_MAX_ENUM;
     struct d3d12_device *device = impl_from_ID3D12Device(iface);
-    D3D12_PIPELINE_STATE_SUBOBJECT_TYPE subobject_type;
     struct d3d12_pipeline_state_desc pipeline_desc;
-    const char *stream_ptr, *stream_end;
     struct d3d12_pipeline_state *object;
-    uint64_t defined_subobjects = 0;
-    bool is_graphics, is_compute;
-    uint64_t subobject_bit;
+    VkPipelineBindPoint pipeline_type;
     HRESULT hr;
 
     TRACE("iface %p, desc %p, riid %s, pipeline_state %p.\n",
             iface, desc, debugstr_guid(riid), pipeline_state);
 
-    /* Initialize defaults for undefined subobjects */
-    d3d12_init_pipeline_state_desc(&pipeline_desc);
-
-    /* Structs are packed, but padded so that their size
-     * is always a multiple of the size of a pointer. */
-    stream_ptr = desc->pPipelineStateSubobjectStream;
-    stream_end = stream_ptr + desc->SizeInBytes;
-
-    while (stream_ptr < stream_end)
-    {
-        if (stream_ptr + sizeof(subobject_type) > stream_end)
-        {
-            ERR("Invalid pipeline state stream.\n");
-            return E_INVALIDARG;
-        }
-
-        subobject_type = *(const D3D12_PIPELINE_STATE_SUBOBJECT_TYPE *)stream_ptr;
-        subobject_bit = 1ull << subobject_type;
-
-        if (defined_subobjects & subobject_bit)
-        {
-            ERR("Duplicate pipeline subobject type %u.\n", subobject_type);
-            return E_INVALIDARG;
-        }
-
-        defined_subobjects |= subobject_bit;
-
-        switch (subobject_type)
-        {
-            VKD3D_HANDLE_SUBOBJECT(ROOT_SIGNATURE, ID3D12RootSignature*, pipeline_desc.root_signature);
-            VKD3D_HANDLE_SUBOBJECT(VS, D3D12_SHADER_BYTECODE, pipeline_desc.vs);
-            VKD3D_HANDLE_SUBOBJECT(PS, D3D12_SHADER_BYTECODE, pipeline_desc.ps);
-            VKD3D_HANDLE_SUBOBJECT(DS, D3D12_SHADER_BYTECODE, pipeline_desc.ds);
-            VKD3D_HANDLE_SUBOBJECT(HS, D3D12_SHADER_BYTECODE, pipeline_desc.hs);
-            VKD3D_HANDLE_SUBOBJECT(GS, D3D12_SHADER_BYTECODE, pipeline_desc.gs);
-            VKD3D_HANDLE_SUBOBJECT(CS, D3D12_SHADER_BYTECODE, pipeline_desc.cs);
-            VKD3D_HANDLE_SUBOBJECT(STREAM_OUTPUT, D3D12_STREAM_OUTPUT_DESC, pipeline_desc.stream_output);
-            VKD3D_HANDLE_SUBOBJECT(BLEND, D3D12_BLEND_DESC, pipeline_desc.blend_state);
-            VKD3D_HANDLE_SUBOBJECT(SAMPLE_MASK, UINT, pipeline_desc.sample_mask);
-            VKD3D_HANDLE_SUBOBJECT(RASTERIZER, D3D12_RASTERIZER_DESC, pipeline_desc.rasterizer_state);
-            VKD3D_HANDLE_SUBOBJECT_EXPLICIT(DEPTH_STENCIL, D3D12_DEPTH_STENCIL_DESC,
-                    d3d12_promote_depth_stencil_desc(&pipeline_desc.depth_stencil_state, &subobject->data));
-            VKD3D_HANDLE_SUBOBJECT(INPUT_LAYOUT, D3D12_INPUT_LAYOUT_DESC, pipeline_desc.input_layout);
-            VKD3D_HANDLE_SUBOBJECT(IB_STRIP_CUT_VALUE, D3D12_INDEX_BUFFER_STRIP_CUT_VALUE, pipeline_desc.strip_cut_value);
-            VKD3D_HANDLE_SUBOBJECT(PRIMITIVE_TOPOLOGY, D3D12_PRIMITIVE_TOPOLOGY_TYPE, pipeline_desc.primitive_topology_type);
-            VKD3D_HANDLE_SUBOBJECT(RENDER_TARGET_FORMATS, D3D12_RT_FORMAT_ARRAY, pipeline_desc.rtv_formats);
-            VKD3D_HANDLE_SUBOBJECT(DEPTH_STENCIL_FORMAT, DXGI_FORMAT, pipeline_desc.dsv_format);
-            VKD3D_HANDLE_SUBOBJECT(SAMPLE_DESC, DXGI_SAMPLE_DESC, pipeline_desc.sample_desc);
-            VKD3D_HANDLE_SUBOBJECT(NODE_MASK, UINT, pipeline_desc.node_mask);
-            VKD3D_HANDLE_SUBOBJECT(CACHED_PSO, D3D12_CACHED_PIPELINE_STATE, pipeline_desc.cached_pso);
-            VKD3D_HANDLE_SUBOBJECT(FLAGS, D3D12_PIPELINE_STATE_FLAGS, pipeline_desc.flags);
-            VKD3D_HANDLE_SUBOBJECT(DEPTH_STENCIL1, D3D12_DEPTH_STENCIL_DESC1, pipeline_desc.depth_stencil_state);
-            VKD3D_HANDLE_SUBOBJECT(VIEW_INSTANCING, D3D12_VIEW_INSTANCING_DESC, pipeline_desc.view_instancing_desc);
-
-            default:
-                ERR("Unhandled pipeline subobject type %u.\n", subobject_type);
-                return E_INVALIDARG;
-        }
-    }
-
-    /* Deduce pipeline type from specified shaders */
-    is_graphics = pipeline_desc.vs.pShaderBytecode && pipeline_desc.vs.BytecodeLength;
-    is_compute = pipeline_desc.cs.pShaderBytecode && pipeline_desc.cs.BytecodeLength;
-
-    if (is_graphics == is_compute)
-    {
-        ERR("Cannot deduce pipeline type.\n");
-        return E_INVALIDARG;
-    }
-
-    pipeline_type = is_graphics
-        ? VK_PIPELINE_BIND_POINT_GRAPHICS
-        : VK_PIPELINE_BIND_POINT_COMPUTE;
+    if (FAILED(hr = d3d12_pipeline_state_desc_from_d3d12_stream_desc(&pipeline_desc, desc, &pipeline_type)))
+        return hr;
 
     if (FAILED(hr = d3d12_pipeline_state_create(device, pipeline_type, &pipeline_desc, &object)))
         return hr;
@@ -3797,9 +3681,6 @@ static HRESULT STDMETHODCALLTYPE d3d12_device_CreatePipelineState(d3d12_device_i
             &IID_ID3D12PipelineState, riid, pipeline_state);
 }
 
-#undef VKD3D_HANDLE_SUBOBJECT
-#undef VKD3D_HANDLE_SUBOBJECT_EXPLICIT
-
 static HRESULT STDMETHODCALLTYPE d3d12_device_OpenExistingHeapFromAddress(d3d12_device_iface *iface,
         void *address, REFIID riid, void **heap)
 {
@@ -4565,15 +4446,20 @@ static HRESULT d3d12_device_init(struct d3d12_device *device,
 
     device->vk_device = VK_NULL_HANDLE;
 
+    vkd3d_pipeline_stats_init(&device->pipeline_stats);
+
     if (FAILED(hr = vkd3d_create_vk_device(device, create_info)))
         goto out_free_instance;
 
-    if (FAILED(hr = d3d12_device_init_pipeline_cache(device)))
+    if (FAILED(hr = d3d12_device_init_pipeline_cache(device, create_info)))
         goto out_free_vk_resources;
 
-    if (FAILED(hr = vkd3d_private_store_init(&device->private_store)))
+    if (FAILED(hr = vkd3d_shader_cache_init(&device->shader_cache)))
         goto out_free_pipeline_cache;
 
+    if (FAILED(hr = vkd3d_private_store_init(&device->private_store)))
+        goto out_free_shader_cache;
+
     if (FAILED(hr = vkd3d_fence_worker_start(&device->fence_worker, device)))
         goto out_free_private_store;
 
@@ -4592,7 +4478,28 @@ static HRESULT d3d12_device_init(struct d3d12_device *device,
     if (FAILED(hr = vkd3d_meta_ops_init(&device->meta_ops, device)))
         goto out_cleanup_bindless_state;
 
-    vkd3d_render_pass_cache_init(&device->render_pass_cache);
+    if (FAILED(hr = vkd3d_render_pass_cache_init(&device->render_pass_cache)))
+        goto out_cleanup_meta_ops;
+
+    if (FAILED(hr = vkd3d_root_signature_cache_init(&device->root_signature_cache)))
+        goto out_cleanup_render_pass_cache;
+
+    if (FAILED(hr = vkd3d_shader_module_cache_init(&device->shader_module_cache)))
+        goto out_cleanup_root_signature_cache;
+
+    if (FAILED(hr = vkd3d_sampler_cache_init(&device->sampler_cache)))
+        goto out_cleanup_shader_module_cache;
+
+    if (FAILED(hr = vkd3d_pipeline_variant_budget_init(&device->pipeline_variant_budget)))
+        goto out_cleanup_sampler_cache;
+
+    if (FAILED(hr = vkd3d_pipeline_compiler_init(&device->pipeline_compiler, device)))
+        goto out_cleanup_pipeline_variant_budget;
+
+    vkd3d_pipeline_stats_start(&device->pipeline_stats, device);
+    vkd3d_pipeline_recorder_init(&device->pipeline_recorder);
+    vkd3d_pipeline_index_init(&device->pipeline_index);
+    vkd3d_render_pass_cache_prepopulate(&device->render_pass_cache, device);
     vkd3d_gpu_va_allocator_init(&device->gpu_va_allocator);
 
     if ((device->parent = create_info->parent))
@@ -4601,6 +4508,18 @@ static HRESULT d3d12_device_init(struct d3d12_device *device,
     d3d12_device_caps_init(device);
     return S_OK;
 
+out_cleanup_pipeline_variant_budget:
+    vkd3d_pipeline_variant_budget_cleanup(&device->pipeline_variant_budget);
+out_cleanup_sampler_cache:
+    vkd3d_sampler_cache_cleanup(&device->sampler_cache);
+out_cleanup_shader_module_cache:
+    vkd3d_shader_module_cache_cleanup(&device->shader_module_cache);
+out_cleanup_root_signature_cache:
+    vkd3d_root_signature_cache_cleanup(&device->root_signature_cache);
+out_cleanup_render_pass_cache:
+    vkd3d_render_pass_cache_cleanup(&device->render_pass_cache, device);
+out_cleanup_meta_ops:
+    vkd3d_meta_ops_cleanup(&device->meta_ops, device);
 out_cleanup_bindless_state:
     vkd3d_bindless_state_cleanup(&device->bindless_state, device);
 out_destroy_null_resources:
@@ -4611,6 +4530,8 @@ out_stop_fence_worker:
     vkd3d_fence_worker_stop(&device->fence_worker, device);
 out_free_private_store:
     vkd3d_private_store_destroy(&device->private_store);
+out_free_shader_cache:
+    vkd3d_shader_cache_cleanup(&device->shader_cache);
 out_free_pipeline_cache:
     d3d12_device_destroy_pipeline_cache(device);
 out_free_vk_resources:
@@ -4733,6 +4654,26 @@ VkPhysicalDevice vkd3d_get_vk_physical_device(ID3D12Device *device)
     return d3d12_device->vk_physical_device;
 }
 
+HRESULT vkd3d_get_pipeline_statistics(ID3D12Device *device, struct vkd3d_pipeline_statistics *statistics)
+{
+    struct d3d12_device *d3d12_device = impl_from_ID3D12Device((d3d12_device_iface *)device);
+
+    TRACE("device %p, statistics %p.\n", device, statistics);
+
+    if (statistics->type != VKD3D_STRUCTURE_TYPE_PIPELINE_STATISTICS)
+    {
+        WARN("Invalid structure type %#x.\n", statistics->type);
+        return E_INVALIDARG;
+    }
+    if (statistics->next)
+        WARN("Unhandled next %p.\n", statistics->next);
+
+    vkd3d_pipeline_stats_get(&d3d12_device->pipeline_stats, statistics);
+    vkd3d_pipeline_variant_budget_get_usage(&d3d12_device->pipeline_variant_budget,
+            &statistics->pipeline_variant_count, &statistics->pipeline_variant_size);
+    return S_OK;
+}
+
 struct vkd3d_instance *vkd3d_instance_from_device(ID3D12Device *device)
 {
     struct d3d12_device *d3d12_device = impl_from_ID3D12Device((d3d12_device_iface *)device);
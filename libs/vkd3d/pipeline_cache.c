@@ -0,0 +1,371 @@
+/*
+ * Copyright 2020 VKD3D contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "vkd3d_private.h"
+
+#include <stdio.h>
+
+/* The file holds a single VkPipelineCache blob. Writers serialize on a
+ * separate lock file, merge in whatever another process wrote since our last
+ * look, and replace the file with a rename so readers never see a partial
+ * write. */
+#define VKD3D_PIPELINE_CACHE_MAGIC              MAKE_MAGIC('V', 'K', 'P', 'C')
+#define VKD3D_PIPELINE_CACHE_VERSION            1
+#define VKD3D_PIPELINE_CACHE_WRITE_INTERVAL_MS  30000
+
+struct vkd3d_pipeline_cache_file_header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t vendor_id;
+    uint32_t device_id;
+    uint8_t pipeline_cache_uuid[VK_UUID_SIZE];
+    uint64_t build_hash;
+    uint64_t data_size;
+    uint64_t data_hash;
+};
+
+static void vkd3d_persistent_pipeline_cache_init_header(struct vkd3d_pipeline_cache_file_header *header,
+        struct d3d12_device *device)
+{
+    const VkPhysicalDeviceProperties *properties = &device->device_info.properties2.properties;
+
+    memset(header, 0, sizeof(*header));
+    header->magic = VKD3D_PIPELINE_CACHE_MAGIC;
+    header->version = VKD3D_PIPELINE_CACHE_VERSION;
+    header->vendor_id = properties->vendorID;
+    header->device_id = properties->deviceID;
+    memcpy(header->pipeline_cache_uuid, properties->pipelineCacheUUID, VK_UUID_SIZE);
+    header->build_hash = vkd3d_get_build_hash();
+}
+
+/* Returns the payload of a valid cache file, or NULL. */
+static const void *vkd3d_persistent_pipeline_cache_validate(const struct vkd3d_memory_mapped_file *file,
+        const struct vkd3d_pipeline_cache_file_header *expected, uint64_t *data_size, uint64_t *data_hash)
+{
+    const struct vkd3d_pipeline_cache_file_header *header = file->mapped;
+    const void *data = header + 1;
+
+    if (file->mapped_size < sizeof(*header) || header->magic != expected->magic
+            || header->version != expected->version || header->vendor_id != expected->vendor_id
+            || header->device_id != expected->device_id || header->build_hash != expected->build_hash
+            || memcmp(header->pipeline_cache_uuid, expected->pipeline_cache_uuid, VK_UUID_SIZE))
+    {
+        WARN("Ignoring pipeline cache file with mismatching header.\n");
+        return NULL;
+    }
+
+    if (header->data_size != file->mapped_size - sizeof(*header)
+            || vkd3d_hash_fnv1a_data(VKD3D_HASH_FNV1A_INIT, data, header->data_size) != header->data_hash)
+    {
+        WARN("Ignoring corrupt pipeline cache file.\n");
+        return NULL;
+    }
+
+    *data_size = header->data_size;
+    *data_hash = header->data_hash;
+    return data;
+}
+
+void *vkd3d_persistent_pipeline_cache_init(struct vkd3d_persistent_pipeline_cache *cache,
+        struct d3d12_device *device, const char *cache_dir, size_t *initial_data_size)
+{
+    struct vkd3d_pipeline_cache_file_header header;
+    struct vkd3d_memory_mapped_file file;
+    char program_name[VKD3D_PATH_MAX];
+    void *initial_data = NULL;
+    uint64_t size, hash;
+    const void *data;
+    int rc;
+
+    memset(cache, 0, sizeof(*cache));
+    *initial_data_size = 0;
+
+    if (!cache_dir || !*cache_dir)
+        return NULL;
+
+    if (!vkd3d_get_program_name(program_name) || !*program_name)
+        strcpy(program_name, "vkd3d");
+
+    vkd3d_persistent_pipeline_cache_init_header(&header, device);
+    hash = vkd3d_hash_fnv1a_data(VKD3D_HASH_FNV1A_INIT, &header, sizeof(header));
+    if (snprintf(cache->path, sizeof(cache->path), "%s/%s.%016"PRIx64".vkd3d-pipeline-cache",
+            cache_dir, program_name, hash) >= (int)sizeof(cache->path) - 8)
+    {
+        WARN("Pipeline cache path is too long.\n");
+        return NULL;
+    }
+
+    if ((rc = pthread_mutex_init(&cache->mutex, NULL)))
+    {
+        ERR("Failed to initialize mutex, error %d.\n", rc);
+        return NULL;
+    }
+
+    if ((rc = pthread_cond_init(&cache->cond, NULL)))
+    {
+        ERR("Failed to initialize condition variable, error %d.\n", rc);
+        pthread_mutex_destroy(&cache->mutex);
+        return NULL;
+    }
+
+    cache->enabled = true;
+    TRACE("Using pipeline cache '%s'.\n", cache->path);
+
+    if (!vkd3d_file_map_read_only(cache->path, &file))
+        return NULL;
+
+    if ((data = vkd3d_persistent_pipeline_cache_validate(&file, &header, &size, &hash))
+            && (initial_data = vkd3d_malloc(size)))
+    {
+        memcpy(initial_data, data, size);
+        *initial_data_size = size;
+        cache->disk_data_hash = hash;
+        TRACE("Loaded %"PRIu64" bytes of pipeline cache data.\n", size);
+    }
+
+    vkd3d_file_unmap(&file);
+    return initial_data;
+}
+
+static void *vkd3d_persistent_pipeline_cache_get_data(struct d3d12_device *device,
+        VkPipelineCache vk_pipeline_cache, size_t *size)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    void *data = NULL;
+    VkResult vr;
+
+    /* The cache may grow between the two calls, in which case VK_INCOMPLETE
+     * is returned and we simply try again. */
+    do
+    {
+        vkd3d_free(data);
+        data = NULL;
+
+        if ((vr = VK_CALL(vkGetPipelineCacheData(device->vk_device, vk_pipeline_cache, size, NULL))) < 0)
+            break;
+        if (!(data = vkd3d_malloc(*size + sizeof(struct vkd3d_pipeline_cache_file_header))))
+            return NULL;
+        vr = VK_CALL(vkGetPipelineCacheData(device->vk_device, vk_pipeline_cache,
+                size, (uint8_t *)data + sizeof(struct vkd3d_pipeline_cache_file_header)));
+    } while (vr == VK_INCOMPLETE);
+
+    if (vr < 0)
+    {
+        WARN("Failed to get pipeline cache data, vr %d.\n", vr);
+        vkd3d_free(data);
+        return NULL;
+    }
+
+    return data;
+}
+
+/* Merges the live cache with the current file contents into a temporary cache
+ * so that the device cache, which may be in concurrent use, is never a merge
+ * destination. */
+static VkPipelineCache vkd3d_persistent_pipeline_cache_merge_from_disk(struct vkd3d_persistent_pipeline_cache *cache,
+        struct d3d12_device *device, const struct vkd3d_pipeline_cache_file_header *header)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    VkPipelineCache vk_pipeline_cache = VK_NULL_HANDLE;
+    VkPipelineCacheCreateInfo cache_info;
+    struct vkd3d_memory_mapped_file file;
+    uint64_t size, hash;
+    const void *data;
+    VkResult vr;
+
+    if (!vkd3d_file_map_read_only(cache->path, &file))
+        return VK_NULL_HANDLE;
+
+    if (!(data = vkd3d_persistent_pipeline_cache_validate(&file, header, &size, &hash))
+            || hash == cache->disk_data_hash)
+    {
+        vkd3d_file_unmap(&file);
+        return VK_NULL_HANDLE;
+    }
+
+    TRACE("Merging %"PRIu64" bytes of pipeline cache data written by another process.\n", size);
+
+    cache_info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    cache_info.pNext = NULL;
+    cache_info.flags = 0;
+    cache_info.initialDataSize = size;
+    cache_info.pInitialData = data;
+    vr = VK_CALL(vkCreatePipelineCache(device->vk_device, &cache_info, NULL, &vk_pipeline_cache));
+    vkd3d_file_unmap(&file);
+    if (vr < 0)
+    {
+        WARN("Failed to create pipeline cache, vr %d.\n", vr);
+        return VK_NULL_HANDLE;
+    }
+
+    if ((vr = VK_CALL(vkMergePipelineCaches(device->vk_device, vk_pipeline_cache,
+            1, &device->vk_pipeline_cache))) < 0)
+    {
+        WARN("Failed to merge pipeline caches, vr %d.\n", vr);
+        VK_CALL(vkDestroyPipelineCache(device->vk_device, vk_pipeline_cache, NULL));
+        return VK_NULL_HANDLE;
+    }
+
+    return vk_pipeline_cache;
+}
+
+static void vkd3d_persistent_pipeline_cache_write(struct vkd3d_persistent_pipeline_cache *cache,
+        struct d3d12_device *device)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    struct vkd3d_pipeline_cache_file_header header;
+    char lock_path[VKD3D_PATH_MAX], tmp_path[VKD3D_PATH_MAX];
+    VkPipelineCache vk_merged_cache;
+    FILE *lock_file, *file;
+    size_t live_size, size;
+    bool written;
+    void *data;
+    VkResult vr;
+
+    /* Drivers only ever add to a pipeline cache, so an unchanged size means
+     * there is nothing new to write. */
+    if ((vr = VK_CALL(vkGetPipelineCacheData(device->vk_device, device->vk_pipeline_cache,
+            &live_size, NULL))) < 0 || live_size == cache->written_size)
+        return;
+
+    sprintf(lock_path, "%s.lock", cache->path);
+    sprintf(tmp_path, "%s.tmp", cache->path);
+
+    if (!(lock_file = fopen(lock_path, "ab")))
+    {
+        WARN("Failed to open pipeline cache lock file '%s'.\n", lock_path);
+        return;
+    }
+
+    if (!vkd3d_file_lock(lock_file))
+    {
+        WARN("Failed to lock pipeline cache.\n");
+        fclose(lock_file);
+        return;
+    }
+
+    vkd3d_persistent_pipeline_cache_init_header(&header, device);
+    vk_merged_cache = vkd3d_persistent_pipeline_cache_merge_from_disk(cache, device, &header);
+
+    data = vkd3d_persistent_pipeline_cache_get_data(device,
+            vk_merged_cache ? vk_merged_cache : device->vk_pipeline_cache, &size);
+    if (vk_merged_cache)
+        VK_CALL(vkDestroyPipelineCache(device->vk_device, vk_merged_cache, NULL));
+
+    if (data)
+    {
+        header.data_size = size;
+        header.data_hash = vkd3d_hash_fnv1a_data(VKD3D_HASH_FNV1A_INIT, (uint8_t *)data + sizeof(header), size);
+        memcpy(data, &header, sizeof(header));
+
+        written = (file = fopen(tmp_path, "wb"))
+                && fwrite(data, sizeof(header) + size, 1, file) == 1;
+        if (file && fclose(file))
+            written = false;
+
+        if (written && vkd3d_file_rename_overwrite(tmp_path, cache->path))
+        {
+            TRACE("Wrote %zu bytes of pipeline cache data.\n", size);
+            cache->disk_data_hash = header.data_hash;
+            cache->written_size = live_size;
+        }
+        else
+        {
+            WARN("Failed to write pipeline cache '%s'.\n", cache->path);
+            remove(tmp_path);
+        }
+
+        vkd3d_free(data);
+    }
+
+    vkd3d_file_unlock(lock_file);
+    fclose(lock_file);
+}
+
+static void *vkd3d_persistent_pipeline_cache_main(void *arg)
+{
+    struct vkd3d_persistent_pipeline_cache *cache = arg;
+    int rc;
+
+    vkd3d_set_thread_name("vkd3d_pso_cache");
+
+    pthread_mutex_lock(&cache->mutex);
+
+    while (!cache->should_exit)
+    {
+        rc = vkd3d_cond_wait_timeout(&cache->cond, &cache->mutex, VKD3D_PIPELINE_CACHE_WRITE_INTERVAL_MS);
+
+        if (rc == ETIMEDOUT && !cache->should_exit)
+        {
+            pthread_mutex_unlock(&cache->mutex);
+            vkd3d_persistent_pipeline_cache_write(cache, cache->device);
+            pthread_mutex_lock(&cache->mutex);
+        }
+        else if (rc && rc != ETIMEDOUT)
+        {
+            ERR("Failed to wait on condition variable, error %d.\n", rc);
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&cache->mutex);
+    return NULL;
+}
+
+void vkd3d_persistent_pipeline_cache_start(struct vkd3d_persistent_pipeline_cache *cache,
+        struct d3d12_device *device)
+{
+    if (!cache->enabled || !device->vk_pipeline_cache)
+        return;
+
+    cache->device = device;
+    cache->should_exit = false;
+
+    if (FAILED(vkd3d_create_thread(device->vkd3d_instance,
+            vkd3d_persistent_pipeline_cache_main, cache, &cache->thread)))
+    {
+        WARN("Failed to create pipeline cache thread, the cache is only written at shutdown.\n");
+        return;
+    }
+
+    cache->thread_started = true;
+}
+
+void vkd3d_persistent_pipeline_cache_cleanup(struct vkd3d_persistent_pipeline_cache *cache,
+        struct d3d12_device *device)
+{
+    if (!cache->enabled)
+        return;
+
+    if (cache->thread_started)
+    {
+        pthread_mutex_lock(&cache->mutex);
+        cache->should_exit = true;
+        pthread_cond_signal(&cache->cond);
+        pthread_mutex_unlock(&cache->mutex);
+
+        vkd3d_join_thread(device->vkd3d_instance, &cache->thread);
+    }
+
+    if (device->vk_pipeline_cache)
+        vkd3d_persistent_pipeline_cache_write(cache, device);
+
+    pthread_cond_destroy(&cache->cond);
+    pthread_mutex_destroy(&cache->mutex);
+}
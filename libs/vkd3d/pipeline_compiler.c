@@ -0,0 +1,338 @@
+/*
+ * Copyright 2020 VKD3D contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "vkd3d_private.h"
+
+struct vkd3d_pipeline_compile_job
+{
+    struct list entry;
+    struct d3d12_pipeline_state *state;
+    struct vkd3d_compiled_pipeline *pipeline;
+};
+
+static void *vkd3d_pipeline_compiler_main(void *arg)
+{
+    struct vkd3d_pipeline_compiler *compiler = arg;
+    struct vkd3d_pipeline_compile_job *job;
+    int rc;
+
+    vkd3d_set_thread_name("vkd3d_pipeline");
+
+    pthread_mutex_lock(&compiler->mutex);
+
+    for (;;)
+    {
+        if (list_empty(&compiler->jobs))
+        {
+            if (compiler->should_exit)
+                break;
+
+            if ((rc = pthread_cond_wait(&compiler->cond, &compiler->mutex)))
+            {
+                ERR("Failed to wait on condition variable, error %d.\n", rc);
+                break;
+            }
+            continue;
+        }
+
+        job = LIST_ENTRY(list_head(&compiler->jobs), struct vkd3d_pipeline_compile_job, entry);
+        list_remove(&job->entry);
+        compiler->active_state = job->state;
+        pthread_mutex_unlock(&compiler->mutex);
+
+        d3d12_pipeline_state_compile_variant(job->state, job->pipeline);
+        vkd3d_free(job);
+
+        pthread_mutex_lock(&compiler->mutex);
+        compiler->active_state = NULL;
+        pthread_cond_broadcast(&compiler->cond);
+    }
+
+    pthread_mutex_unlock(&compiler->mutex);
+    return NULL;
+}
+
+/* Called with the task mutex held, returns with it held. */
+static void vkd3d_pipeline_compiler_run_task_locked(struct vkd3d_pipeline_compiler *compiler,
+        struct vkd3d_pipeline_task *task)
+{
+    list_remove(&task->entry);
+    task->queued = false;
+    pthread_mutex_unlock(&compiler->task_mutex);
+
+    task->callback(task->userdata);
+
+    pthread_mutex_lock(&compiler->task_mutex);
+    /* The task may be freed as soon as the last one of its batch completes. */
+    if (!--*task->pending_count)
+        pthread_cond_broadcast(&compiler->task_done_cond);
+}
+
+static void *vkd3d_pipeline_worker_main(void *arg)
+{
+    struct vkd3d_pipeline_compiler *compiler = arg;
+    int rc;
+
+    vkd3d_set_thread_name("vkd3d_worker");
+
+    pthread_mutex_lock(&compiler->task_mutex);
+
+    for (;;)
+    {
+        if (list_empty(&compiler->tasks))
+        {
+            if (compiler->workers_should_exit)
+                break;
+
+            if ((rc = pthread_cond_wait(&compiler->task_cond, &compiler->task_mutex)))
+            {
+                ERR("Failed to wait on condition variable, error %d.\n", rc);
+                break;
+            }
+            continue;
+        }
+
+        vkd3d_pipeline_compiler_run_task_locked(compiler, LIST_ENTRY(list_head(&compiler->tasks),
+                struct vkd3d_pipeline_task, entry));
+    }
+
+    pthread_mutex_unlock(&compiler->task_mutex);
+    return NULL;
+}
+
+static HRESULT vkd3d_pipeline_compiler_init_workers(struct vkd3d_pipeline_compiler *compiler,
+        struct d3d12_device *device)
+{
+    unsigned int worker_count, i;
+    int rc;
+
+    list_init(&compiler->tasks);
+
+    if ((rc = pthread_mutex_init(&compiler->task_mutex, NULL)))
+    {
+        ERR("Failed to initialize mutex, error %d.\n", rc);
+        return hresult_from_errno(rc);
+    }
+
+    if ((rc = pthread_cond_init(&compiler->task_cond, NULL)))
+    {
+        ERR("Failed to initialize condition variable, error %d.\n", rc);
+        pthread_mutex_destroy(&compiler->task_mutex);
+        return hresult_from_errno(rc);
+    }
+
+    if ((rc = pthread_cond_init(&compiler->task_done_cond, NULL)))
+    {
+        ERR("Failed to initialize condition variable, error %d.\n", rc);
+        pthread_cond_destroy(&compiler->task_cond);
+        pthread_mutex_destroy(&compiler->task_mutex);
+        return hresult_from_errno(rc);
+    }
+
+    /* The thread which submits tasks runs them as well. */
+    worker_count = min(vkd3d_get_cpu_count() - 1, VKD3D_MAX_PIPELINE_WORKER_COUNT);
+
+    for (i = 0; i < worker_count; ++i)
+    {
+        if (FAILED(vkd3d_create_thread(device->vkd3d_instance,
+                vkd3d_pipeline_worker_main, compiler, &compiler->workers[i])))
+        {
+            WARN("Failed to create pipeline worker thread.\n");
+            break;
+        }
+
+        ++compiler->worker_count;
+    }
+
+    TRACE("Using %u pipeline worker threads.\n", compiler->worker_count);
+    return S_OK;
+}
+
+static void vkd3d_pipeline_compiler_cleanup_workers(struct vkd3d_pipeline_compiler *compiler,
+        struct d3d12_device *device)
+{
+    unsigned int i;
+
+    pthread_mutex_lock(&compiler->task_mutex);
+    compiler->workers_should_exit = true;
+    pthread_cond_broadcast(&compiler->task_cond);
+    pthread_mutex_unlock(&compiler->task_mutex);
+
+    for (i = 0; i < compiler->worker_count; ++i)
+        vkd3d_join_thread(device->vkd3d_instance, &compiler->workers[i]);
+
+    /* Submitters wait for their tasks to complete. */
+    assert(list_empty(&compiler->tasks));
+
+    pthread_cond_destroy(&compiler->task_done_cond);
+    pthread_cond_destroy(&compiler->task_cond);
+    pthread_mutex_destroy(&compiler->task_mutex);
+}
+
+HRESULT vkd3d_pipeline_compiler_init(struct vkd3d_pipeline_compiler *compiler, struct d3d12_device *device)
+{
+    HRESULT hr;
+    int rc;
+
+    memset(compiler, 0, sizeof(*compiler));
+    list_init(&compiler->jobs);
+    compiler->device = device;
+
+    if ((rc = pthread_mutex_init(&compiler->mutex, NULL)))
+    {
+        ERR("Failed to initialize mutex, error %d.\n", rc);
+        return hresult_from_errno(rc);
+    }
+
+    if ((rc = pthread_cond_init(&compiler->cond, NULL)))
+    {
+        ERR("Failed to initialize condition variable, error %d.\n", rc);
+        pthread_mutex_destroy(&compiler->mutex);
+        return hresult_from_errno(rc);
+    }
+
+    if (FAILED(hr = vkd3d_pipeline_compiler_init_workers(compiler, device)))
+    {
+        pthread_cond_destroy(&compiler->cond);
+        pthread_mutex_destroy(&compiler->mutex);
+        return hr;
+    }
+
+    if (device->vkd3d_instance->config_flags & VKD3D_CONFIG_FLAG_NO_PIPELINE_PRECOMPILE)
+        return S_OK;
+
+    /* Speculative compiles are an optimisation, run without them if no thread can be created. */
+    if (FAILED(vkd3d_create_thread(device->vkd3d_instance,
+            vkd3d_pipeline_compiler_main, compiler, &compiler->thread)))
+    {
+        WARN("Failed to create pipeline compiler thread.\n");
+        return S_OK;
+    }
+
+    compiler->thread_started = true;
+    return S_OK;
+}
+
+void vkd3d_pipeline_compiler_cleanup(struct vkd3d_pipeline_compiler *compiler, struct d3d12_device *device)
+{
+    if (compiler->thread_started)
+    {
+        pthread_mutex_lock(&compiler->mutex);
+        compiler->should_exit = true;
+        pthread_cond_broadcast(&compiler->cond);
+        pthread_mutex_unlock(&compiler->mutex);
+
+        vkd3d_join_thread(device->vkd3d_instance, &compiler->thread);
+    }
+
+    /* Every pipeline state cancels its own jobs on destruction. */
+    assert(list_empty(&compiler->jobs));
+
+    vkd3d_pipeline_compiler_cleanup_workers(compiler, device);
+
+    TRACE("Speculatively compiled %u pipelines, %u hits, %u misses, %u waits.\n",
+            compiler->speculative_count, compiler->hit_count, compiler->miss_count, compiler->wait_count);
+
+    pthread_cond_destroy(&compiler->cond);
+    pthread_mutex_destroy(&compiler->mutex);
+}
+
+bool vkd3d_pipeline_compiler_enqueue(struct vkd3d_pipeline_compiler *compiler,
+        struct d3d12_pipeline_state *state, struct vkd3d_compiled_pipeline *pipeline)
+{
+    struct vkd3d_pipeline_compile_job *job;
+
+    if (!compiler->thread_started)
+        return false;
+
+    if (!(job = vkd3d_malloc(sizeof(*job))))
+        return false;
+
+    job->state = state;
+    job->pipeline = pipeline;
+
+    pthread_mutex_lock(&compiler->mutex);
+    list_add_tail(&compiler->jobs, &job->entry);
+    pthread_cond_broadcast(&compiler->cond);
+    pthread_mutex_unlock(&compiler->mutex);
+
+    vkd3d_atomic_uint32_increment(&compiler->speculative_count, vkd3d_memory_order_relaxed);
+    return true;
+}
+
+void vkd3d_pipeline_compiler_cancel(struct vkd3d_pipeline_compiler *compiler,
+        const struct d3d12_pipeline_state *state)
+{
+    struct vkd3d_pipeline_compile_job *job, *next;
+
+    if (!compiler->thread_started)
+        return;
+
+    pthread_mutex_lock(&compiler->mutex);
+
+    LIST_FOR_EACH_ENTRY_SAFE(job, next, &compiler->jobs, struct vkd3d_pipeline_compile_job, entry)
+    {
+        if (job->state == state)
+        {
+            list_remove(&job->entry);
+            vkd3d_free(job);
+        }
+    }
+
+    while (compiler->active_state == state)
+        pthread_cond_wait(&compiler->cond, &compiler->mutex);
+
+    pthread_mutex_unlock(&compiler->mutex);
+}
+
+void vkd3d_pipeline_compiler_run_tasks(struct vkd3d_pipeline_compiler *compiler,
+        struct vkd3d_pipeline_task *tasks, unsigned int task_count)
+{
+    unsigned int pending_count = task_count;
+    unsigned int i;
+
+    if (!compiler->worker_count || task_count < 2)
+    {
+        for (i = 0; i < task_count; ++i)
+            tasks[i].callback(tasks[i].userdata);
+        return;
+    }
+
+    pthread_mutex_lock(&compiler->task_mutex);
+
+    for (i = 0; i < task_count; ++i)
+    {
+        tasks[i].queued = true;
+        tasks[i].pending_count = &pending_count;
+        list_add_tail(&compiler->tasks, &tasks[i].entry);
+    }
+    pthread_cond_broadcast(&compiler->task_cond);
+
+    /* Run whatever the workers did not pick up yet, so that a busy pool
+     * never stalls the calling thread. */
+    for (i = 0; i < task_count; ++i)
+    {
+        if (tasks[i].queued)
+            vkd3d_pipeline_compiler_run_task_locked(compiler, &tasks[i]);
+    }
+
+    while (pending_count)
+        pthread_cond_wait(&compiler->task_done_cond, &compiler->task_mutex);
+
+    pthread_mutex_unlock(&compiler->task_mutex);
+}
@@ -0,0 +1,208 @@
+/*
+ * Copyright 2020 VKD3D contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "vkd3d_private.h"
+
+#include <stdio.h>
+
+/* One line per distinct pipeline state, for example:
+ *
+ *   graphics 3f1c9a2b4d5e6f70 root_signature=0123456789abcdef vs=... ps=...
+ *
+ * The second field identifies the line. Shaders are listed by the hash which
+ * names their vkd3d-shader-<stage>-<hash>.dxbc dump, and the root signature by
+ * the hash used in VKD3D_PIPELINE_RECORD_PATH archives. */
+#define VKD3D_PIPELINE_INDEX_FILENAME "vkd3d-shader-index.txt"
+
+struct vkd3d_pipeline_index_entry
+{
+    struct rb_entry entry;
+    uint64_t hash;
+};
+
+static int vkd3d_pipeline_index_compare_key(const void *key, const struct rb_entry *entry)
+{
+    const struct vkd3d_pipeline_index_entry *e = RB_ENTRY_VALUE(entry, const struct vkd3d_pipeline_index_entry, entry);
+    uint64_t hash = *(const uint64_t *)key;
+
+    if (hash != e->hash)
+        return hash < e->hash ? -1 : 1;
+    return 0;
+}
+
+static void vkd3d_pipeline_index_free_entry(struct rb_entry *entry, void *context)
+{
+    vkd3d_free(RB_ENTRY_VALUE(entry, struct vkd3d_pipeline_index_entry, entry));
+}
+
+static bool vkd3d_pipeline_index_add_key(struct vkd3d_pipeline_index *index, uint64_t hash)
+{
+    struct vkd3d_pipeline_index_entry *entry;
+
+    if (!(entry = vkd3d_malloc(sizeof(*entry))))
+        return false;
+
+    entry->hash = hash;
+    if (rb_put(&index->pipelines, &entry->hash, &entry->entry) == -1)
+    {
+        vkd3d_free(entry);
+        return false;
+    }
+
+    return true;
+}
+
+/* Collects the pipelines listed by earlier runs, so that they are not
+ * listed again. */
+static void vkd3d_pipeline_index_load(struct vkd3d_pipeline_index *index, const char *path)
+{
+    char line[1024];
+    uint64_t hash;
+    FILE *f;
+
+    if (!(f = fopen(path, "r")))
+        return;
+
+    while (fgets(line, sizeof(line), f))
+    {
+        if (sscanf(line, "%*s %"SCNx64, &hash) == 1)
+            vkd3d_pipeline_index_add_key(index, hash);
+    }
+
+    fclose(f);
+}
+
+void vkd3d_pipeline_index_init(struct vkd3d_pipeline_index *index)
+{
+    char path[VKD3D_PATH_MAX];
+    const char *dump_path;
+    int rc;
+
+    memset(index, 0, sizeof(*index));
+    rb_init(&index->pipelines, vkd3d_pipeline_index_compare_key);
+
+    if (!(dump_path = getenv("VKD3D_SHADER_DUMP_PATH")) || !*dump_path)
+        return;
+
+    if (snprintf(path, sizeof(path), "%s/%s", dump_path, VKD3D_PIPELINE_INDEX_FILENAME) >= (int)sizeof(path))
+    {
+        WARN("Shader dump path '%s' is too long.\n", dump_path);
+        return;
+    }
+
+    if ((rc = pthread_mutex_init(&index->mutex, NULL)))
+    {
+        ERR("Failed to initialize mutex, error %d.\n", rc);
+        return;
+    }
+
+    vkd3d_pipeline_index_load(index, path);
+
+    if (!(index->file = fopen(path, "a")))
+    {
+        WARN("Failed to open pipeline index '%s'.\n", path);
+        rb_destroy(&index->pipelines, vkd3d_pipeline_index_free_entry, NULL);
+        pthread_mutex_destroy(&index->mutex);
+        return;
+    }
+
+    TRACE("Writing pipeline index to '%s'.\n", path);
+    index->enabled = true;
+}
+
+void vkd3d_pipeline_index_cleanup(struct vkd3d_pipeline_index *index)
+{
+    if (!index->enabled)
+        return;
+
+    rb_destroy(&index->pipelines, vkd3d_pipeline_index_free_entry, NULL);
+    fclose(index->file);
+    pthread_mutex_destroy(&index->mutex);
+}
+
+void vkd3d_pipeline_index_add_pipeline(struct vkd3d_pipeline_index *index,
+        VkPipelineBindPoint bind_point, const struct d3d12_pipeline_state_desc *desc,
+        uint64_t root_signature_hash)
+{
+    static const struct
+    {
+        const char *name;
+        size_t offset;
+    }
+    stages[] =
+    {
+        {"vs", offsetof(struct d3d12_pipeline_state_desc, vs)},
+        {"hs", offsetof(struct d3d12_pipeline_state_desc, hs)},
+        {"ds", offsetof(struct d3d12_pipeline_state_desc, ds)},
+        {"gs", offsetof(struct d3d12_pipeline_state_desc, gs)},
+        {"ps", offsetof(struct d3d12_pipeline_state_desc, ps)},
+        {"cs", offsetof(struct d3d12_pipeline_state_desc, cs)},
+    };
+    uint64_t shader_hashes[ARRAY_SIZE(stages)];
+    struct vkd3d_shader_hash_state state;
+    const D3D12_SHADER_BYTECODE *code;
+    char line[512];
+    uint64_t hash;
+    size_t length;
+    unsigned int i;
+    bool ret;
+
+    if (!index->enabled)
+        return;
+
+    vkd3d_shader_hash_init(&state, 0);
+    vkd3d_shader_hash_update(&state, &bind_point, sizeof(bind_point));
+    vkd3d_shader_hash_update(&state, &root_signature_hash, sizeof(root_signature_hash));
+    for (i = 0; i < ARRAY_SIZE(stages); ++i)
+    {
+        code = (const void *)((const uint8_t *)desc + stages[i].offset);
+        shader_hashes[i] = code->pShaderBytecode && code->BytecodeLength
+                ? vkd3d_shader_hash_data(code->pShaderBytecode, code->BytecodeLength, 0) : 0;
+        vkd3d_shader_hash_update(&state, &shader_hashes[i], sizeof(shader_hashes[i]));
+    }
+    hash = vkd3d_shader_hash_digest(&state);
+
+    length = snprintf(line, sizeof(line), "%s %016"PRIx64" root_signature=%016"PRIx64,
+            bind_point == VK_PIPELINE_BIND_POINT_COMPUTE ? "compute" : "graphics", hash, root_signature_hash);
+    for (i = 0; i < ARRAY_SIZE(stages); ++i)
+    {
+        if (shader_hashes[i])
+            length += snprintf(line + length, sizeof(line) - length, " %s=%016"PRIx64,
+                    stages[i].name, shader_hashes[i]);
+    }
+
+    pthread_mutex_lock(&index->mutex);
+
+    if (rb_get(&index->pipelines, &hash))
+    {
+        pthread_mutex_unlock(&index->mutex);
+        return;
+    }
+
+    /* Other processes may append to the same index. */
+    vkd3d_file_lock(index->file);
+    ret = fprintf(index->file, "%s\n", line) > 0 && !fflush(index->file);
+    vkd3d_file_unlock(index->file);
+
+    if (ret)
+        vkd3d_pipeline_index_add_key(index, hash);
+    else
+        WARN("Failed to write pipeline index entry.\n");
+
+    pthread_mutex_unlock(&index->mutex);
+}
@@ -0,0 +1,396 @@
+/*
+ * Copyright 2020 VKD3D contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "vkd3d_private.h"
+#include "vkd3d_pipeline_archive.h"
+
+#include <stdio.h>
+
+struct vkd3d_pipeline_record_key
+{
+    uint32_t type;
+    uint64_t hash;
+};
+
+struct vkd3d_pipeline_record_entry
+{
+    struct rb_entry entry;
+    struct vkd3d_pipeline_record_key key;
+};
+
+static int vkd3d_pipeline_recorder_compare_key(const void *key, const struct rb_entry *entry)
+{
+    const struct vkd3d_pipeline_record_entry *e = RB_ENTRY_VALUE(entry, const struct vkd3d_pipeline_record_entry, entry);
+    const struct vkd3d_pipeline_record_key *k = key;
+
+    if (k->type != e->key.type)
+        return k->type < e->key.type ? -1 : 1;
+    if (k->hash != e->key.hash)
+        return k->hash < e->key.hash ? -1 : 1;
+    return 0;
+}
+
+static void vkd3d_pipeline_recorder_free_entry(struct rb_entry *entry, void *context)
+{
+    vkd3d_free(RB_ENTRY_VALUE(entry, struct vkd3d_pipeline_record_entry, entry));
+}
+
+static bool vkd3d_pipeline_recorder_add_key(struct vkd3d_pipeline_recorder *recorder,
+        const struct vkd3d_pipeline_record_key *key)
+{
+    struct vkd3d_pipeline_record_entry *entry;
+
+    if (!(entry = vkd3d_malloc(sizeof(*entry))))
+        return false;
+
+    entry->key = *key;
+    if (rb_put(&recorder->records, &entry->key, &entry->entry) == -1)
+    {
+        vkd3d_free(entry);
+        return false;
+    }
+
+    return true;
+}
+
+/* Collects the records written by earlier runs, so that they are not
+ * written again. Returns the end of the last complete record, which is
+ * before the end of the file if a process was killed while appending, or 0 if
+ * the file is not a valid archive. */
+static size_t vkd3d_pipeline_recorder_load_archive(struct vkd3d_pipeline_recorder *recorder,
+        const struct vkd3d_memory_mapped_file *file)
+{
+    const struct vkd3d_pipeline_archive_header *header = file->mapped;
+    const struct vkd3d_pipeline_archive_record *record;
+    size_t next_offset, offset = sizeof(*header);
+    struct vkd3d_pipeline_record_key key;
+
+    if (file->mapped_size < sizeof(*header) || header->magic != VKD3D_PIPELINE_ARCHIVE_MAGIC
+            || header->version != VKD3D_PIPELINE_ARCHIVE_VERSION)
+        return 0;
+
+    while (offset + sizeof(*record) <= file->mapped_size)
+    {
+        record = (const void *)((const uint8_t *)file->mapped + offset);
+        next_offset = offset + sizeof(*record) + vkd3d_pipeline_archive_align(record->size);
+        if (next_offset > file->mapped_size)
+            break;
+
+        key.type = record->type;
+        key.hash = record->hash;
+        vkd3d_pipeline_recorder_add_key(recorder, &key);
+        offset = next_offset;
+    }
+
+    return offset;
+}
+
+void vkd3d_pipeline_recorder_init(struct vkd3d_pipeline_recorder *recorder)
+{
+    struct vkd3d_pipeline_archive_header header;
+    struct vkd3d_memory_mapped_file file;
+    size_t end, size;
+    const char *path;
+    bool valid;
+    int rc;
+
+    memset(recorder, 0, sizeof(*recorder));
+    rb_init(&recorder->records, vkd3d_pipeline_recorder_compare_key);
+
+    if (!(path = getenv("VKD3D_PIPELINE_RECORD_PATH")) || !*path)
+        return;
+
+    if ((rc = pthread_mutex_init(&recorder->mutex, NULL)))
+    {
+        ERR("Failed to initialize mutex, error %d.\n", rc);
+        return;
+    }
+
+    if (!(recorder->file = fopen(path, "ab")))
+    {
+        WARN("Failed to open pipeline archive '%s'.\n", path);
+        pthread_mutex_destroy(&recorder->mutex);
+        return;
+    }
+
+    vkd3d_file_lock(recorder->file);
+
+    if (vkd3d_file_map_read_only(path, &file))
+    {
+        end = vkd3d_pipeline_recorder_load_archive(recorder, &file);
+        size = file.mapped_size;
+        vkd3d_file_unmap(&file);
+
+        /* Drop the record torn by a process killed while appending, so that
+         * the records appended after it can be read back. Writers only map
+         * the archive under the lock. */
+        if ((valid = !!end) && end < size)
+        {
+            WARN("Truncating incomplete record at the end of pipeline archive '%s'.\n", path);
+            valid = vkd3d_file_truncate(recorder->file, end);
+        }
+    }
+    else
+    {
+        header.magic = VKD3D_PIPELINE_ARCHIVE_MAGIC;
+        header.version = VKD3D_PIPELINE_ARCHIVE_VERSION;
+        valid = fwrite(&header, sizeof(header), 1, recorder->file) == 1 && !fflush(recorder->file);
+    }
+
+    vkd3d_file_unlock(recorder->file);
+
+    if (!valid)
+    {
+        WARN("Not recording pipelines to '%s', which is not a valid pipeline archive.\n", path);
+        rb_destroy(&recorder->records, vkd3d_pipeline_recorder_free_entry, NULL);
+        fclose(recorder->file);
+        recorder->file = NULL;
+        pthread_mutex_destroy(&recorder->mutex);
+        return;
+    }
+
+    TRACE("Recording pipelines to '%s'.\n", path);
+    recorder->enabled = true;
+}
+
+void vkd3d_pipeline_recorder_cleanup(struct vkd3d_pipeline_recorder *recorder)
+{
+    if (!recorder->enabled)
+        return;
+
+    rb_destroy(&recorder->records, vkd3d_pipeline_recorder_free_entry, NULL);
+    fclose(recorder->file);
+    pthread_mutex_destroy(&recorder->mutex);
+}
+
+static void vkd3d_pipeline_recorder_write_record(struct vkd3d_pipeline_recorder *recorder,
+        uint32_t type, uint64_t hash, const void *data, size_t size)
+{
+    static const uint8_t padding[8];
+    struct vkd3d_pipeline_archive_record record;
+    struct vkd3d_pipeline_record_key key;
+    size_t padding_size;
+    bool ret;
+
+    if (size > UINT32_MAX)
+        return;
+
+    key.type = type;
+    key.hash = hash;
+
+    pthread_mutex_lock(&recorder->mutex);
+
+    if (rb_get(&recorder->records, &key))
+    {
+        pthread_mutex_unlock(&recorder->mutex);
+        return;
+    }
+
+    record.type = type;
+    record.size = size;
+    record.hash = hash;
+    padding_size = vkd3d_pipeline_archive_align(size) - size;
+
+    /* Other processes may append to the same archive. */
+    vkd3d_file_lock(recorder->file);
+    ret = fwrite(&record, sizeof(record), 1, recorder->file) == 1
+            && fwrite(data, 1, size, recorder->file) == size
+            && fwrite(padding, 1, padding_size, recorder->file) == padding_size
+            && !fflush(recorder->file);
+    vkd3d_file_unlock(recorder->file);
+
+    if (ret)
+        vkd3d_pipeline_recorder_add_key(recorder, &key);
+    else
+        WARN("Failed to write pipeline archive record.\n");
+
+    pthread_mutex_unlock(&recorder->mutex);
+}
+
+void vkd3d_pipeline_recorder_record_root_signature(struct vkd3d_pipeline_recorder *recorder,
+        uint64_t hash, const void *bytecode, size_t bytecode_length)
+{
+    if (!recorder->enabled)
+        return;
+
+    vkd3d_pipeline_recorder_write_record(recorder, VKD3D_PIPELINE_ARCHIVE_RECORD_ROOT_SIGNATURE,
+            hash, bytecode, bytecode_length);
+}
+
+static uint64_t vkd3d_pipeline_recorder_record_shader(struct vkd3d_pipeline_recorder *recorder,
+        const D3D12_SHADER_BYTECODE *code)
+{
+    uint64_t hash;
+
+    if (!code->pShaderBytecode || !code->BytecodeLength)
+        return 0;
+
+    hash = vkd3d_hash_fnv1a_data(VKD3D_HASH_FNV1A_INIT, code->pShaderBytecode, code->BytecodeLength);
+    vkd3d_pipeline_recorder_write_record(recorder, VKD3D_PIPELINE_ARCHIVE_RECORD_SHADER,
+            hash, code->pShaderBytecode, code->BytecodeLength);
+    return hash;
+}
+
+static uint32_t vkd3d_pipeline_recorder_add_string(char *strings, size_t *strings_size, const char *str)
+{
+    uint32_t offset = *strings_size;
+    size_t length;
+
+    if (!str)
+        return UINT32_MAX;
+
+    length = strlen(str) + 1;
+    if (strings)
+        memcpy(strings + offset, str, length);
+    *strings_size += length;
+    return offset;
+}
+
+/* Lays out the payload of a pipeline record. With a NULL "payload", only
+ * computes its size. */
+static size_t vkd3d_pipeline_recorder_build_pipeline(uint8_t *payload,
+        const struct d3d12_pipeline_state_desc *desc, uint64_t root_signature_hash,
+        const uint64_t *shader_hashes)
+{
+    const D3D12_STREAM_OUTPUT_DESC *so_desc = &desc->stream_output;
+    struct vkd3d_pipeline_archive_input_element *input_elements = NULL;
+    struct vkd3d_pipeline_archive_pipeline *pipeline = NULL;
+    struct vkd3d_pipeline_archive_so_entry *so_entries = NULL;
+    D3D12_VIEW_INSTANCE_LOCATION *view_instances = NULL;
+    size_t offset, strings_size = 0;
+    uint32_t *so_strides = NULL;
+    char *strings = NULL;
+    unsigned int i;
+
+    offset = sizeof(*pipeline);
+    if (payload)
+        input_elements = (void *)(payload + offset);
+    offset += desc->input_layout.NumElements * sizeof(*input_elements);
+    if (payload)
+        so_entries = (void *)(payload + offset);
+    offset += so_desc->NumEntries * sizeof(*so_entries);
+    if (payload)
+        so_strides = (void *)(payload + offset);
+    offset += so_desc->NumStrides * sizeof(*so_strides);
+    if (payload)
+        view_instances = (void *)(payload + offset);
+    offset += desc->view_instancing_desc.ViewInstanceCount * sizeof(*view_instances);
+    if (payload)
+        strings = (char *)(payload + offset);
+
+    for (i = 0; i < desc->input_layout.NumElements; ++i)
+    {
+        const D3D12_INPUT_ELEMENT_DESC *e = &desc->input_layout.pInputElementDescs[i];
+        uint32_t name = vkd3d_pipeline_recorder_add_string(strings, &strings_size, e->SemanticName);
+
+        if (!payload)
+            continue;
+
+        input_elements[i].semantic_name = name;
+        input_elements[i].semantic_index = e->SemanticIndex;
+        input_elements[i].format = e->Format;
+        input_elements[i].input_slot = e->InputSlot;
+        input_elements[i].aligned_byte_offset = e->AlignedByteOffset;
+        input_elements[i].input_slot_class = e->InputSlotClass;
+        input_elements[i].instance_data_step_rate = e->InstanceDataStepRate;
+    }
+
+    for (i = 0; i < so_desc->NumEntries; ++i)
+    {
+        const D3D12_SO_DECLARATION_ENTRY *e = &so_desc->pSODeclaration[i];
+        uint32_t name = vkd3d_pipeline_recorder_add_string(strings, &strings_size, e->SemanticName);
+
+        if (!payload)
+            continue;
+
+        so_entries[i].stream = e->Stream;
+        so_entries[i].semantic_name = name;
+        so_entries[i].semantic_index = e->SemanticIndex;
+        so_entries[i].start_component = e->StartComponent;
+        so_entries[i].component_count = e->ComponentCount;
+        so_entries[i].output_slot = e->OutputSlot;
+    }
+
+    if (!payload)
+        return offset + strings_size;
+
+    for (i = 0; i < so_desc->NumStrides; ++i)
+        so_strides[i] = so_desc->pBufferStrides[i];
+    for (i = 0; i < desc->view_instancing_desc.ViewInstanceCount; ++i)
+        view_instances[i] = desc->view_instancing_desc.pViewInstanceLocations[i];
+
+    pipeline = (void *)payload;
+    pipeline->root_signature_hash = root_signature_hash;
+    memcpy(pipeline->shader_hashes, shader_hashes, sizeof(pipeline->shader_hashes));
+    pipeline->blend_state = desc->blend_state;
+    pipeline->sample_mask = desc->sample_mask;
+    pipeline->rasterizer_state = desc->rasterizer_state;
+    pipeline->depth_stencil_state = desc->depth_stencil_state;
+    pipeline->strip_cut_value = desc->strip_cut_value;
+    pipeline->primitive_topology_type = desc->primitive_topology_type;
+    pipeline->rtv_formats = desc->rtv_formats;
+    pipeline->dsv_format = desc->dsv_format;
+    pipeline->sample_desc = desc->sample_desc;
+    pipeline->flags = desc->flags;
+    pipeline->input_element_count = desc->input_layout.NumElements;
+    pipeline->so_entry_count = so_desc->NumEntries;
+    pipeline->so_stride_count = so_desc->NumStrides;
+    pipeline->so_rasterized_stream = so_desc->RasterizedStream;
+    pipeline->view_instance_count = desc->view_instancing_desc.ViewInstanceCount;
+    pipeline->view_instancing_flags = desc->view_instancing_desc.Flags;
+
+    return offset + strings_size;
+}
+
+void vkd3d_pipeline_recorder_record_pipeline(struct vkd3d_pipeline_recorder *recorder,
+        VkPipelineBindPoint bind_point, const struct d3d12_pipeline_state_desc *desc,
+        uint64_t root_signature_hash)
+{
+    uint64_t shader_hashes[VKD3D_PIPELINE_ARCHIVE_STAGE_COUNT];
+    uint8_t *payload;
+    size_t size;
+
+    if (!recorder->enabled)
+        return;
+
+    /* Replay could not create the pipeline state. */
+    if (!root_signature_hash)
+    {
+        WARN("Not recording pipeline state without root signature.\n");
+        return;
+    }
+
+    shader_hashes[VKD3D_PIPELINE_ARCHIVE_VS] = vkd3d_pipeline_recorder_record_shader(recorder, &desc->vs);
+    shader_hashes[VKD3D_PIPELINE_ARCHIVE_HS] = vkd3d_pipeline_recorder_record_shader(recorder, &desc->hs);
+    shader_hashes[VKD3D_PIPELINE_ARCHIVE_DS] = vkd3d_pipeline_recorder_record_shader(recorder, &desc->ds);
+    shader_hashes[VKD3D_PIPELINE_ARCHIVE_GS] = vkd3d_pipeline_recorder_record_shader(recorder, &desc->gs);
+    shader_hashes[VKD3D_PIPELINE_ARCHIVE_PS] = vkd3d_pipeline_recorder_record_shader(recorder, &desc->ps);
+    shader_hashes[VKD3D_PIPELINE_ARCHIVE_CS] = vkd3d_pipeline_recorder_record_shader(recorder, &desc->cs);
+
+    size = vkd3d_pipeline_recorder_build_pipeline(NULL, desc, root_signature_hash, shader_hashes);
+    /* Zeroed, so that padding does not affect the hash. */
+    if (!(payload = vkd3d_calloc(1, size)))
+        return;
+    vkd3d_pipeline_recorder_build_pipeline(payload, desc, root_signature_hash, shader_hashes);
+
+    vkd3d_pipeline_recorder_write_record(recorder, bind_point == VK_PIPELINE_BIND_POINT_COMPUTE
+            ? VKD3D_PIPELINE_ARCHIVE_RECORD_COMPUTE_PIPELINE : VKD3D_PIPELINE_ARCHIVE_RECORD_GRAPHICS_PIPELINE,
+            vkd3d_hash_fnv1a_data(VKD3D_HASH_FNV1A_INIT, payload, size), payload, size);
+
+    vkd3d_free(payload);
+}
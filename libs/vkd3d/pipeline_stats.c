@@ -0,0 +1,294 @@
+/*
+ * Copyright 2020 VKD3D contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "vkd3d_private.h"
+
+#include <stdio.h>
+
+#define VKD3D_PIPELINE_STATS_DUMP_INTERVAL_MS 1000
+
+static const char *vkd3d_pipeline_timing_names[] =
+{
+    [VKD3D_PIPELINE_TIMING_DXBC_PARSE]           = "dxbc_parse",
+    [VKD3D_PIPELINE_TIMING_SPIRV_EMIT]           = "spirv_emit",
+    [VKD3D_PIPELINE_TIMING_SHADER_MODULE_CREATE] = "shader_module_create",
+    [VKD3D_PIPELINE_TIMING_PIPELINE_CREATE]      = "pipeline_create",
+};
+
+void vkd3d_pipeline_stats_init(struct vkd3d_pipeline_stats *stats)
+{
+    const char *path;
+
+    memset(stats, 0, sizeof(*stats));
+    spinlock_init(&stats->lock);
+
+    if (!(path = getenv("VKD3D_PIPELINE_STATS_FILE")) || !*path)
+        return;
+
+    if (strlen(path) + 4 >= sizeof(stats->dump_path))
+    {
+        WARN("Pipeline statistics path is too long.\n");
+        return;
+    }
+
+    strcpy(stats->dump_path, path);
+    stats->dump_enabled = true;
+    TRACE("Writing pipeline statistics to '%s'.\n", path);
+}
+
+static void vkd3d_pipeline_stats_write(const struct vkd3d_pipeline_stats *stats,
+        const struct vkd3d_pipeline_statistics *data)
+{
+    const struct vkd3d_pipeline_timing_statistics *timing;
+    char tmp_path[VKD3D_PATH_MAX];
+    unsigned int i, j;
+    FILE *file;
+
+    /* Write to a temporary file first so that readers never see a partial dump. */
+    sprintf(tmp_path, "%s.tmp", stats->dump_path);
+
+    if (!(file = fopen(tmp_path, "w")))
+    {
+        WARN("Failed to open '%s'.\n", tmp_path);
+        return;
+    }
+
+    for (i = 0; i < VKD3D_PIPELINE_TIMING_COUNT; ++i)
+    {
+        timing = &data->timings[i];
+        fprintf(file, "%s: count %"PRIu64", total %"PRIu64" us, avg %"PRIu64" us, max %"PRIu64" us\n",
+                vkd3d_pipeline_timing_names[i], timing->count, timing->total_ns / 1000,
+                timing->count ? timing->total_ns / timing->count / 1000 : 0, timing->max_ns / 1000);
+
+        fprintf(file, "  histogram:");
+        for (j = 0; j < VKD3D_PIPELINE_TIMING_HISTOGRAM_SIZE; ++j)
+            fprintf(file, " %"PRIu64, timing->histogram[j]);
+        fprintf(file, "\n");
+    }
+
+    fprintf(file, "pipeline_variants: hits %"PRIu64", misses %"PRIu64"\n",
+            data->pipeline_variant_hits, data->pipeline_variant_misses);
+    fprintf(file, "render_passes: hits %"PRIu64", misses %"PRIu64"\n",
+            data->render_pass_hits, data->render_pass_misses);
+    fprintf(file, "samplers: hits %"PRIu64", misses %"PRIu64"\n",
+            data->sampler_hits, data->sampler_misses);
+    fprintf(file, "pipeline_variant_evictions: %"PRIu64"\n", data->pipeline_variant_evictions);
+
+    if (fclose(file))
+    {
+        WARN("Failed to write '%s'.\n", tmp_path);
+        return;
+    }
+
+    if (!vkd3d_file_rename_overwrite(tmp_path, stats->dump_path))
+        WARN("Failed to rename '%s' to '%s'.\n", tmp_path, stats->dump_path);
+}
+
+/* Fills everything but the structure header. */
+void vkd3d_pipeline_stats_get(struct vkd3d_pipeline_stats *stats, struct vkd3d_pipeline_statistics *data)
+{
+    const struct vkd3d_pipeline_timing_statistics *src;
+    struct vkd3d_pipeline_timing_statistics *dst;
+    unsigned int i, j;
+
+    for (i = 0; i < VKD3D_PIPELINE_TIMING_COUNT; ++i)
+    {
+        src = &stats->data.timings[i];
+        dst = &data->timings[i];
+        dst->count = vkd3d_atomic_uint64_load_explicit(&src->count, vkd3d_memory_order_relaxed);
+        dst->total_ns = vkd3d_atomic_uint64_load_explicit(&src->total_ns, vkd3d_memory_order_relaxed);
+        dst->max_ns = vkd3d_atomic_uint64_load_explicit(&src->max_ns, vkd3d_memory_order_relaxed);
+        for (j = 0; j < VKD3D_PIPELINE_TIMING_HISTOGRAM_SIZE; ++j)
+            dst->histogram[j] = vkd3d_atomic_uint64_load_explicit(&src->histogram[j], vkd3d_memory_order_relaxed);
+    }
+
+#define LOAD_COUNTER(name) data->name = vkd3d_atomic_uint64_load_explicit(&stats->data.name, vkd3d_memory_order_relaxed)
+    LOAD_COUNTER(pipeline_variant_hits);
+    LOAD_COUNTER(pipeline_variant_misses);
+    LOAD_COUNTER(render_pass_hits);
+    LOAD_COUNTER(render_pass_misses);
+    LOAD_COUNTER(sampler_hits);
+    LOAD_COUNTER(sampler_misses);
+    LOAD_COUNTER(pipeline_variant_evictions);
+#undef LOAD_COUNTER
+}
+
+/* Writes VKD3D_PIPELINE_STATS_FILE periodically, so that threads which
+ * create pipelines never wait on file I/O. */
+static void *vkd3d_pipeline_stats_main(void *arg)
+{
+    struct vkd3d_pipeline_statistics data, written_data;
+    struct vkd3d_pipeline_stats *stats = arg;
+    int rc;
+
+    vkd3d_set_thread_name("vkd3d_pso_stats");
+
+    memset(&data, 0, sizeof(data));
+    memset(&written_data, 0, sizeof(written_data));
+
+    pthread_mutex_lock(&stats->mutex);
+
+    while (!stats->should_exit)
+    {
+        rc = vkd3d_cond_wait_timeout(&stats->cond, &stats->mutex, VKD3D_PIPELINE_STATS_DUMP_INTERVAL_MS);
+
+        if (rc == ETIMEDOUT && !stats->should_exit)
+        {
+            pthread_mutex_unlock(&stats->mutex);
+            vkd3d_pipeline_stats_get(stats, &data);
+            if (memcmp(&data, &written_data, sizeof(data)))
+            {
+                vkd3d_pipeline_stats_write(stats, &data);
+                written_data = data;
+            }
+            pthread_mutex_lock(&stats->mutex);
+        }
+        else if (rc && rc != ETIMEDOUT)
+        {
+            ERR("Failed to wait on condition variable, error %d.\n", rc);
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&stats->mutex);
+    return NULL;
+}
+
+void vkd3d_pipeline_stats_start(struct vkd3d_pipeline_stats *stats, struct d3d12_device *device)
+{
+    int rc;
+
+    if (!stats->dump_enabled)
+        return;
+
+    if ((rc = pthread_mutex_init(&stats->mutex, NULL)))
+    {
+        ERR("Failed to initialize mutex, error %d.\n", rc);
+        return;
+    }
+
+    if ((rc = pthread_cond_init(&stats->cond, NULL)))
+    {
+        ERR("Failed to initialize condition variable, error %d.\n", rc);
+        pthread_mutex_destroy(&stats->mutex);
+        return;
+    }
+
+    stats->should_exit = false;
+
+    if (FAILED(vkd3d_create_thread(device->vkd3d_instance, vkd3d_pipeline_stats_main, stats, &stats->thread)))
+    {
+        WARN("Failed to create pipeline statistics thread, statistics are only written at shutdown.\n");
+        pthread_cond_destroy(&stats->cond);
+        pthread_mutex_destroy(&stats->mutex);
+        return;
+    }
+
+    stats->thread_started = true;
+}
+
+void vkd3d_pipeline_stats_cleanup(struct vkd3d_pipeline_stats *stats, struct d3d12_device *device)
+{
+    struct vkd3d_pipeline_statistics data;
+
+    if (stats->thread_started)
+    {
+        pthread_mutex_lock(&stats->mutex);
+        stats->should_exit = true;
+        pthread_cond_signal(&stats->cond);
+        pthread_mutex_unlock(&stats->mutex);
+
+        vkd3d_join_thread(device->vkd3d_instance, &stats->thread);
+        pthread_cond_destroy(&stats->cond);
+        pthread_mutex_destroy(&stats->mutex);
+    }
+
+    vkd3d_pipeline_stats_get(stats, &data);
+
+    TRACE("Pipeline variant lookups: %"PRIu64" hits, %"PRIu64" misses.\n",
+            data.pipeline_variant_hits, data.pipeline_variant_misses);
+    TRACE("Render pass lookups: %"PRIu64" hits, %"PRIu64" misses.\n",
+            data.render_pass_hits, data.render_pass_misses);
+    TRACE("Sampler lookups: %"PRIu64" hits, %"PRIu64" misses.\n",
+            data.sampler_hits, data.sampler_misses);
+    TRACE("Pipeline variant evictions: %"PRIu64".\n", data.pipeline_variant_evictions);
+
+    if (stats->dump_enabled)
+        vkd3d_pipeline_stats_write(stats, &data);
+}
+
+static unsigned int vkd3d_pipeline_stats_get_bucket(uint64_t duration_ns)
+{
+    uint64_t duration_us = duration_ns / 1000;
+    unsigned int bucket = 0;
+
+    while (duration_us && bucket < VKD3D_PIPELINE_TIMING_HISTOGRAM_SIZE - 1)
+    {
+        duration_us >>= 1;
+        ++bucket;
+    }
+
+    return bucket;
+}
+
+void vkd3d_pipeline_stats_add_timing(struct vkd3d_pipeline_stats *stats,
+        enum vkd3d_pipeline_timing timing, uint64_t duration_ns)
+{
+    unsigned int bucket = vkd3d_pipeline_stats_get_bucket(duration_ns);
+    struct vkd3d_pipeline_timing_statistics *entry = &stats->data.timings[timing];
+
+    vkd3d_atomic_uint64_add(&entry->count, 1, vkd3d_memory_order_relaxed);
+    vkd3d_atomic_uint64_add(&entry->total_ns, duration_ns, vkd3d_memory_order_relaxed);
+    vkd3d_atomic_uint64_add(&entry->histogram[bucket], 1, vkd3d_memory_order_relaxed);
+
+    if (duration_ns <= vkd3d_atomic_uint64_load_explicit(&entry->max_ns, vkd3d_memory_order_relaxed))
+        return;
+
+    spinlock_acquire(&stats->lock);
+    if (duration_ns > entry->max_ns)
+        vkd3d_atomic_uint64_store_explicit(&entry->max_ns, duration_ns, vkd3d_memory_order_relaxed);
+    spinlock_release(&stats->lock);
+}
+
+static void vkd3d_pipeline_stats_add_lookup(uint64_t *hits, uint64_t *misses, bool hit)
+{
+    vkd3d_atomic_uint64_add(hit ? hits : misses, 1, vkd3d_memory_order_relaxed);
+}
+
+void vkd3d_pipeline_stats_add_pipeline_lookup(struct vkd3d_pipeline_stats *stats, bool hit)
+{
+    vkd3d_pipeline_stats_add_lookup(&stats->data.pipeline_variant_hits,
+            &stats->data.pipeline_variant_misses, hit);
+}
+
+void vkd3d_pipeline_stats_add_render_pass_lookup(struct vkd3d_pipeline_stats *stats, bool hit)
+{
+    vkd3d_pipeline_stats_add_lookup(&stats->data.render_pass_hits,
+            &stats->data.render_pass_misses, hit);
+}
+
+void vkd3d_pipeline_stats_add_sampler_lookup(struct vkd3d_pipeline_stats *stats, bool hit)
+{
+    vkd3d_pipeline_stats_add_lookup(&stats->data.sampler_hits,
+            &stats->data.sampler_misses, hit);
+}
+
+void vkd3d_pipeline_stats_add_pipeline_eviction(struct vkd3d_pipeline_stats *stats)
+{
+    vkd3d_atomic_uint64_add(&stats->data.pipeline_variant_evictions, 1, vkd3d_memory_order_relaxed);
+}
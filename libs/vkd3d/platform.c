@@ -22,6 +22,11 @@
 
 # include <dlfcn.h>
 # include <errno.h>
+# include <fcntl.h>
+# include <unistd.h>
+# include <sys/file.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
 
 vkd3d_module_t vkd3d_dlopen(const char *name)
 {
@@ -75,9 +80,76 @@ bool vkd3d_get_program_name(char program_name[VKD3D_PATH_MAX])
     return true;
 }
 
+bool vkd3d_file_map_read_only(const char *path, struct vkd3d_memory_mapped_file *file)
+{
+    struct stat st;
+    void *mapped;
+    int fd;
+
+    file->mapped = NULL;
+    file->mapped_size = 0;
+
+    if ((fd = open(path, O_RDONLY)) < 0)
+        return false;
+
+    if (fstat(fd, &st) < 0 || !st.st_size)
+    {
+        close(fd);
+        return false;
+    }
+
+    mapped = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED)
+        return false;
+
+    file->mapped = mapped;
+    file->mapped_size = st.st_size;
+    return true;
+}
+
+void vkd3d_file_unmap(struct vkd3d_memory_mapped_file *file)
+{
+    if (file->mapped)
+        munmap(file->mapped, file->mapped_size);
+    file->mapped = NULL;
+    file->mapped_size = 0;
+}
+
+bool vkd3d_file_lock(FILE *file)
+{
+    int ret;
+
+    while ((ret = flock(fileno(file), LOCK_EX)) < 0 && errno == EINTR)
+        ;
+    return !ret;
+}
+
+void vkd3d_file_unlock(FILE *file)
+{
+    flock(fileno(file), LOCK_UN);
+}
+
+bool vkd3d_file_rename_overwrite(const char *from, const char *to)
+{
+    return !rename(from, to);
+}
+
+bool vkd3d_file_truncate(FILE *file, uint64_t size)
+{
+    return !fflush(file) && !ftruncate(fileno(file), size);
+}
+
+unsigned int vkd3d_get_cpu_count(void)
+{
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? count : 1;
+}
+
 #elif defined(_WIN32)
 
 # include <windows.h>
+# include <io.h>
 
 vkd3d_module_t vkd3d_dlopen(const char *name)
 {
@@ -123,6 +195,90 @@ bool vkd3d_get_program_name(char program_name[VKD3D_PATH_MAX])
     return true;
 }
 
+bool vkd3d_file_map_read_only(const char *path, struct vkd3d_memory_mapped_file *file)
+{
+    LARGE_INTEGER size;
+    HANDLE handle, mapping;
+    void *mapped;
+
+    file->mapped = NULL;
+    file->mapped_size = 0;
+
+    handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+            NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (handle == INVALID_HANDLE_VALUE)
+        return false;
+
+    if (!GetFileSizeEx(handle, &size) || !size.QuadPart || (uint64_t)size.QuadPart > SIZE_MAX)
+    {
+        CloseHandle(handle);
+        return false;
+    }
+
+    mapping = CreateFileMappingA(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(handle);
+    if (!mapping)
+        return false;
+
+    /* The view keeps the mapping object alive. */
+    mapped = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, size.QuadPart);
+    CloseHandle(mapping);
+    if (!mapped)
+        return false;
+
+    file->mapped = mapped;
+    file->mapped_size = size.QuadPart;
+    return true;
+}
+
+void vkd3d_file_unmap(struct vkd3d_memory_mapped_file *file)
+{
+    if (file->mapped)
+        UnmapViewOfFile(file->mapped);
+    file->mapped = NULL;
+    file->mapped_size = 0;
+}
+
+/* Byte range locks are mandatory on Windows, so lock a single byte far past
+ * any real file data to get advisory semantics. */
+#define VKD3D_FILE_LOCK_OFFSET_HIGH 0x7fffffffu
+
+bool vkd3d_file_lock(FILE *file)
+{
+    OVERLAPPED overlapped;
+
+    memset(&overlapped, 0, sizeof(overlapped));
+    overlapped.OffsetHigh = VKD3D_FILE_LOCK_OFFSET_HIGH;
+    return LockFileEx((HANDLE)_get_osfhandle(_fileno(file)), LOCKFILE_EXCLUSIVE_LOCK, 0, 1, 0, &overlapped);
+}
+
+void vkd3d_file_unlock(FILE *file)
+{
+    OVERLAPPED overlapped;
+
+    memset(&overlapped, 0, sizeof(overlapped));
+    overlapped.OffsetHigh = VKD3D_FILE_LOCK_OFFSET_HIGH;
+    UnlockFileEx((HANDLE)_get_osfhandle(_fileno(file)), 0, 1, 0, &overlapped);
+}
+
+bool vkd3d_file_rename_overwrite(const char *from, const char *to)
+{
+    return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING);
+}
+
+bool vkd3d_file_truncate(FILE *file, uint64_t size)
+{
+    return !fflush(file) && !_chsize_s(_fileno(file), size);
+}
+
+unsigned int vkd3d_get_cpu_count(void)
+{
+    SYSTEM_INFO info;
+
+    GetSystemInfo(&info);
+    return max(info.dwNumberOfProcessors, 1);
+}
+
 #else
 
 vkd3d_module_t vkd3d_dlopen(const char *name)
@@ -152,4 +308,39 @@ bool vkd3d_get_program_name(char program_name[VKD3D_PATH_MAX])
     return false;
 }
 
+bool vkd3d_file_map_read_only(const char *path, struct vkd3d_memory_mapped_file *file)
+{
+    file->mapped = NULL;
+    file->mapped_size = 0;
+    return false;
+}
+
+void vkd3d_file_unmap(struct vkd3d_memory_mapped_file *file)
+{
+}
+
+bool vkd3d_file_lock(FILE *file)
+{
+    return false;
+}
+
+void vkd3d_file_unlock(FILE *file)
+{
+}
+
+bool vkd3d_file_rename_overwrite(const char *from, const char *to)
+{
+    return !rename(from, to);
+}
+
+bool vkd3d_file_truncate(FILE *file, uint64_t size)
+{
+    return false;
+}
+
+unsigned int vkd3d_get_cpu_count(void)
+{
+    return 1;
+}
+
 #endif
\ No newline at end of file
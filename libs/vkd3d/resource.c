@@ -2766,7 +2766,7 @@ static void vkd3d_view_destroy(struct vkd3d_view *view, struct d3d12_device *dev
             VK_CALL(vkDestroyImageView(device->vk_device, view->vk_image_view, NULL));
             break;
         case VKD3D_VIEW_TYPE_SAMPLER:
-            VK_CALL(vkDestroySampler(device->vk_device, view->vk_sampler, NULL));
+            vkd3d_sampler_cache_release(&device->sampler_cache, device, view->vk_sampler);
             break;
         default:
             WARN("Unhandled view type %d.\n", view->type);
@@ -3923,22 +3923,6 @@ static bool d3d12_sampler_needs_border_color(D3D12_TEXTURE_ADDRESS_MODE u,
         w == D3D12_TEXTURE_ADDRESS_MODE_BORDER;
 }
 
-static VkBorderColor vk_static_border_color_from_d3d12(D3D12_STATIC_BORDER_COLOR border_color)
-{
-    switch (border_color)
-    {
-        case D3D12_STATIC_BORDER_COLOR_TRANSPARENT_BLACK:
-            return VK_BORDER_COLOR_FLOAT_TRANSPARENT_BLACK;
-        case D3D12_STATIC_BORDER_COLOR_OPAQUE_BLACK:
-            return VK_BORDER_COLOR_FLOAT_OPAQUE_BLACK;
-        case D3D12_STATIC_BORDER_COLOR_OPAQUE_WHITE:
-            return VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
-        default:
-            WARN("Unhandled static border color %u.\n", border_color);
-            return VK_BORDER_COLOR_FLOAT_TRANSPARENT_BLACK;
-    }
-}
-
 static VkBorderColor vk_border_color_from_d3d12(struct d3d12_device *device, const float *border_color)
 {
     unsigned int i;
@@ -3970,14 +3954,21 @@ static VkBorderColor vk_border_color_from_d3d12(struct d3d12_device *device, con
     return VK_BORDER_COLOR_FLOAT_CUSTOM_EXT;
 }
 
-HRESULT d3d12_create_static_sampler(struct d3d12_device *device,
-        const D3D12_STATIC_SAMPLER_DESC *desc, VkSampler *vk_sampler)
+static HRESULT vkd3d_create_vk_sampler(struct d3d12_device *device,
+        const D3D12_SAMPLER_DESC *desc, VkSampler *vk_sampler)
 {
     const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    VkSamplerCustomBorderColorCreateInfoEXT border_color_info;
     VkSamplerReductionModeCreateInfoEXT reduction_desc;
     VkSamplerCreateInfo sampler_desc;
     VkResult vr;
 
+    border_color_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CUSTOM_BORDER_COLOR_CREATE_INFO_EXT;
+    border_color_info.pNext = NULL;
+    memcpy(border_color_info.customBorderColor.float32, desc->BorderColor,
+            sizeof(border_color_info.customBorderColor.float32));
+    border_color_info.format = VK_FORMAT_UNDEFINED;
+
     reduction_desc.sType = VK_STRUCTURE_TYPE_SAMPLER_REDUCTION_MODE_CREATE_INFO_EXT;
     reduction_desc.pNext = NULL;
     reduction_desc.reductionMode = vk_reduction_mode_from_d3d12(D3D12_DECODE_FILTER_REDUCTION(desc->Filter));
@@ -4002,7 +3993,10 @@ HRESULT d3d12_create_static_sampler(struct d3d12_device *device,
     sampler_desc.unnormalizedCoordinates = VK_FALSE;
 
     if (d3d12_sampler_needs_border_color(desc->AddressU, desc->AddressV, desc->AddressW))
-        sampler_desc.borderColor = vk_static_border_color_from_d3d12(desc->BorderColor);
+        sampler_desc.borderColor = vk_border_color_from_d3d12(device, desc->BorderColor);
+
+    if (sampler_desc.borderColor == VK_BORDER_COLOR_FLOAT_CUSTOM_EXT)
+        vk_prepend_struct(&sampler_desc, &border_color_info);
 
     if (reduction_desc.reductionMode != VK_SAMPLER_REDUCTION_MODE_WEIGHTED_AVERAGE_EXT && device->vk_info.EXT_sampler_filter_minmax)
         vk_prepend_struct(&sampler_desc, &reduction_desc);
@@ -4013,57 +4007,198 @@ HRESULT d3d12_create_static_sampler(struct d3d12_device *device,
     return hresult_from_vk_result(vr);
 }
 
-static HRESULT d3d12_create_sampler(struct d3d12_device *device,
+/* Clears the fields which do not affect sampling, so that equivalent
+ * descriptors share a cache entry. */
+static void vkd3d_sampler_desc_normalize(D3D12_SAMPLER_DESC *desc)
+{
+    if (!D3D12_DECODE_IS_ANISOTROPIC_FILTER(desc->Filter))
+        desc->MaxAnisotropy = 0;
+    if (!D3D12_DECODE_IS_COMPARISON_FILTER(desc->Filter))
+        desc->ComparisonFunc = 0;
+    if (!d3d12_sampler_needs_border_color(desc->AddressU, desc->AddressV, desc->AddressW))
+        memset(desc->BorderColor, 0, sizeof(desc->BorderColor));
+}
+
+static void vkd3d_sampler_desc_from_static(D3D12_SAMPLER_DESC *desc, const D3D12_STATIC_SAMPLER_DESC *static_desc)
+{
+    static const float border_colors[][4] =
+    {
+        [D3D12_STATIC_BORDER_COLOR_TRANSPARENT_BLACK] = {0.0f, 0.0f, 0.0f, 0.0f},
+        [D3D12_STATIC_BORDER_COLOR_OPAQUE_BLACK]      = {0.0f, 0.0f, 0.0f, 1.0f},
+        [D3D12_STATIC_BORDER_COLOR_OPAQUE_WHITE]      = {1.0f, 1.0f, 1.0f, 1.0f},
+    };
+
+    desc->Filter = static_desc->Filter;
+    desc->AddressU = static_desc->AddressU;
+    desc->AddressV = static_desc->AddressV;
+    desc->AddressW = static_desc->AddressW;
+    desc->MipLODBias = static_desc->MipLODBias;
+    desc->MaxAnisotropy = static_desc->MaxAnisotropy;
+    desc->ComparisonFunc = static_desc->ComparisonFunc;
+    desc->MinLOD = static_desc->MinLOD;
+    desc->MaxLOD = static_desc->MaxLOD;
+
+    if (static_desc->BorderColor < ARRAY_SIZE(border_colors))
+    {
+        memcpy(desc->BorderColor, border_colors[static_desc->BorderColor], sizeof(desc->BorderColor));
+    }
+    else
+    {
+        WARN("Unhandled static border color %u.\n", static_desc->BorderColor);
+        memset(desc->BorderColor, 0, sizeof(desc->BorderColor));
+    }
+}
+
+struct vkd3d_sampler_cache_entry
+{
+    struct rb_entry desc_entry;
+    struct rb_entry handle_entry;
+    D3D12_SAMPLER_DESC desc;
+    VkSampler vk_sampler;
+    unsigned int refcount;
+};
+
+static int vkd3d_sampler_cache_compare_desc(const void *key, const struct rb_entry *entry)
+{
+    const struct vkd3d_sampler_cache_entry *e = RB_ENTRY_VALUE(entry, const struct vkd3d_sampler_cache_entry, desc_entry);
+
+    return memcmp(key, &e->desc, sizeof(e->desc));
+}
+
+static int vkd3d_sampler_cache_compare_handle(const void *key, const struct rb_entry *entry)
+{
+    const struct vkd3d_sampler_cache_entry *e = RB_ENTRY_VALUE(entry, const struct vkd3d_sampler_cache_entry, handle_entry);
+    const VkSampler *vk_sampler = key;
+
+    if (*vk_sampler != e->vk_sampler)
+        return *vk_sampler < e->vk_sampler ? -1 : 1;
+    return 0;
+}
+
+HRESULT vkd3d_sampler_cache_init(struct vkd3d_sampler_cache *cache)
+{
+    int rc;
+
+    rb_init(&cache->desc_tree, vkd3d_sampler_cache_compare_desc);
+    rb_init(&cache->handle_tree, vkd3d_sampler_cache_compare_handle);
+
+    if ((rc = pthread_mutex_init(&cache->mutex, NULL)))
+    {
+        ERR("Failed to initialize mutex, error %d.\n", rc);
+        return hresult_from_errno(rc);
+    }
+
+    return S_OK;
+}
+
+void vkd3d_sampler_cache_cleanup(struct vkd3d_sampler_cache *cache)
+{
+    /* Descriptor heaps and root signatures hold a device reference, so the
+     * cache is empty by now. */
+    assert(!cache->desc_tree.root);
+    pthread_mutex_destroy(&cache->mutex);
+}
+
+/* Returns a reference to a sampler for the normalized descriptor. Samplers
+ * are created with the lock held, so that concurrent requests for the same
+ * descriptor never create duplicates which count against
+ * maxSamplerAllocationCount. */
+static HRESULT vkd3d_sampler_cache_get(struct vkd3d_sampler_cache *cache, struct d3d12_device *device,
         const D3D12_SAMPLER_DESC *desc, VkSampler *vk_sampler)
+{
+    struct vkd3d_sampler_cache_entry *entry;
+    struct rb_entry *rb_entry;
+    HRESULT hr;
+
+    pthread_mutex_lock(&cache->mutex);
+
+    if ((rb_entry = rb_get(&cache->desc_tree, desc)))
+    {
+        entry = RB_ENTRY_VALUE(rb_entry, struct vkd3d_sampler_cache_entry, desc_entry);
+        ++entry->refcount;
+        *vk_sampler = entry->vk_sampler;
+        pthread_mutex_unlock(&cache->mutex);
+
+        vkd3d_pipeline_stats_add_sampler_lookup(&device->pipeline_stats, true);
+        return S_OK;
+    }
+
+    if (!(entry = vkd3d_malloc(sizeof(*entry))))
+    {
+        pthread_mutex_unlock(&cache->mutex);
+        return E_OUTOFMEMORY;
+    }
+
+    if (FAILED(hr = vkd3d_create_vk_sampler(device, desc, &entry->vk_sampler)))
+    {
+        pthread_mutex_unlock(&cache->mutex);
+        vkd3d_free(entry);
+        return hr;
+    }
+
+    entry->desc = *desc;
+    entry->refcount = 1;
+    rb_put(&cache->desc_tree, &entry->desc, &entry->desc_entry);
+    rb_put(&cache->handle_tree, &entry->vk_sampler, &entry->handle_entry);
+    *vk_sampler = entry->vk_sampler;
+
+    pthread_mutex_unlock(&cache->mutex);
+
+    vkd3d_pipeline_stats_add_sampler_lookup(&device->pipeline_stats, false);
+    return S_OK;
+}
+
+void vkd3d_sampler_cache_release(struct vkd3d_sampler_cache *cache, struct d3d12_device *device,
+        VkSampler vk_sampler)
 {
     const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
-    VkSamplerCustomBorderColorCreateInfoEXT border_color_info;
-    VkSamplerReductionModeCreateInfoEXT reduction_desc;
-    VkSamplerCreateInfo sampler_desc;
-    VkResult vr;
+    struct vkd3d_sampler_cache_entry *entry;
+    struct rb_entry *rb_entry;
 
-    border_color_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CUSTOM_BORDER_COLOR_CREATE_INFO_EXT;
-    border_color_info.pNext = NULL;
-    memcpy(border_color_info.customBorderColor.float32, desc->BorderColor,
-            sizeof(border_color_info.customBorderColor.float32));
-    border_color_info.format = VK_FORMAT_UNDEFINED;
+    if (vk_sampler == VK_NULL_HANDLE)
+        return;
 
-    reduction_desc.sType = VK_STRUCTURE_TYPE_SAMPLER_REDUCTION_MODE_CREATE_INFO_EXT;
-    reduction_desc.pNext = NULL;
-    reduction_desc.reductionMode = vk_reduction_mode_from_d3d12(D3D12_DECODE_FILTER_REDUCTION(desc->Filter));
+    pthread_mutex_lock(&cache->mutex);
 
-    sampler_desc.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
-    sampler_desc.pNext = NULL;
-    sampler_desc.flags = 0;
-    sampler_desc.magFilter = vk_filter_from_d3d12(D3D12_DECODE_MAG_FILTER(desc->Filter));
-    sampler_desc.minFilter = vk_filter_from_d3d12(D3D12_DECODE_MIN_FILTER(desc->Filter));
-    sampler_desc.mipmapMode = vk_mipmap_mode_from_d3d12(D3D12_DECODE_MIP_FILTER(desc->Filter));
-    sampler_desc.addressModeU = vk_address_mode_from_d3d12(desc->AddressU);
-    sampler_desc.addressModeV = vk_address_mode_from_d3d12(desc->AddressV);
-    sampler_desc.addressModeW = vk_address_mode_from_d3d12(desc->AddressW);
-    sampler_desc.mipLodBias = desc->MipLODBias;
-    sampler_desc.anisotropyEnable = D3D12_DECODE_IS_ANISOTROPIC_FILTER(desc->Filter);
-    sampler_desc.maxAnisotropy = desc->MaxAnisotropy;
-    sampler_desc.compareEnable = D3D12_DECODE_IS_COMPARISON_FILTER(desc->Filter);
-    sampler_desc.compareOp = sampler_desc.compareEnable ? vk_compare_op_from_d3d12(desc->ComparisonFunc) : 0;
-    sampler_desc.minLod = desc->MinLOD;
-    sampler_desc.maxLod = desc->MaxLOD;
-    sampler_desc.borderColor = VK_BORDER_COLOR_FLOAT_TRANSPARENT_BLACK;
-    sampler_desc.unnormalizedCoordinates = VK_FALSE;
+    if (!(rb_entry = rb_get(&cache->handle_tree, &vk_sampler)))
+    {
+        ERR("Releasing unknown sampler.\n");
+        pthread_mutex_unlock(&cache->mutex);
+        return;
+    }
 
-    if (d3d12_sampler_needs_border_color(desc->AddressU, desc->AddressV, desc->AddressW))
-        sampler_desc.borderColor = vk_border_color_from_d3d12(device, desc->BorderColor);
+    entry = RB_ENTRY_VALUE(rb_entry, struct vkd3d_sampler_cache_entry, handle_entry);
+    if (--entry->refcount)
+    {
+        pthread_mutex_unlock(&cache->mutex);
+        return;
+    }
 
-    if (sampler_desc.borderColor == VK_BORDER_COLOR_FLOAT_CUSTOM_EXT)
-        vk_prepend_struct(&sampler_desc, &border_color_info);
+    rb_remove(&cache->desc_tree, &entry->desc_entry);
+    rb_remove(&cache->handle_tree, &entry->handle_entry);
+    pthread_mutex_unlock(&cache->mutex);
 
-    if (reduction_desc.reductionMode != VK_SAMPLER_REDUCTION_MODE_WEIGHTED_AVERAGE_EXT && device->vk_info.EXT_sampler_filter_minmax)
-        vk_prepend_struct(&sampler_desc, &reduction_desc);
+    VK_CALL(vkDestroySampler(device->vk_device, entry->vk_sampler, NULL));
+    vkd3d_free(entry);
+}
 
-    if ((vr = VK_CALL(vkCreateSampler(device->vk_device, &sampler_desc, NULL, vk_sampler))) < 0)
-        WARN("Failed to create Vulkan sampler, vr %d.\n", vr);
+HRESULT d3d12_create_static_sampler(struct d3d12_device *device,
+        const D3D12_STATIC_SAMPLER_DESC *desc, VkSampler *vk_sampler)
+{
+    D3D12_SAMPLER_DESC sampler_desc;
 
-    return hresult_from_vk_result(vr);
+    vkd3d_sampler_desc_from_static(&sampler_desc, desc);
+    vkd3d_sampler_desc_normalize(&sampler_desc);
+    return vkd3d_sampler_cache_get(&device->sampler_cache, device, &sampler_desc, vk_sampler);
+}
+
+static HRESULT d3d12_create_sampler(struct d3d12_device *device,
+        const D3D12_SAMPLER_DESC *desc, VkSampler *vk_sampler)
+{
+    D3D12_SAMPLER_DESC sampler_desc = *desc;
+
+    vkd3d_sampler_desc_normalize(&sampler_desc);
+    return vkd3d_sampler_cache_get(&device->sampler_cache, device, &sampler_desc, vk_sampler);
 }
 
 void d3d12_desc_create_sampler(struct d3d12_desc *sampler,
@@ -0,0 +1,418 @@
+/*
+ * Copyright 2020 VKD3D contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "vkd3d_private.h"
+
+#include <stdio.h>
+
+/* The cache file is a header followed by a stream of self-describing records.
+ * Records are only ever appended, under an inter-process file lock, so any
+ * number of processes may share one file. A record torn by a crashed writer is
+ * skipped on load by scanning ahead for the next record magic. Once the file
+ * reaches VKD3D_SHADER_CACHE_MAX_SIZE no more records are appended. */
+#define VKD3D_SHADER_CACHE_MAGIC            MAKE_MAGIC('V', 'K', 'S', 'C')
+#define VKD3D_SHADER_CACHE_RECORD_MAGIC     MAKE_MAGIC('V', 'K', 'S', 'R')
+#define VKD3D_SHADER_CACHE_VERSION          2
+#define VKD3D_SHADER_CACHE_ALIGNMENT        sizeof(uint64_t)
+#define VKD3D_SHADER_CACHE_DEFAULT_MAX_SIZE ((uint64_t)256 << 20)
+
+struct vkd3d_shader_cache_file_header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t build_hash;
+};
+
+struct vkd3d_shader_cache_record
+{
+    uint32_t magic;
+    uint32_t code_size;
+    struct vkd3d_shader_cache_key key;
+    uint64_t code_hash;
+    /* uint32_t code[]; padded to VKD3D_SHADER_CACHE_ALIGNMENT */
+};
+
+STATIC_ASSERT(sizeof(struct vkd3d_shader_cache_file_header) % VKD3D_SHADER_CACHE_ALIGNMENT == 0);
+STATIC_ASSERT(sizeof(struct vkd3d_shader_cache_record) % VKD3D_SHADER_CACHE_ALIGNMENT == 0);
+
+struct vkd3d_shader_cache_entry
+{
+    struct rb_entry entry;
+    struct vkd3d_shader_cache_key key;
+    uint64_t code_hash;
+    bool validated;
+    struct vkd3d_shader_code code;
+};
+
+static int vkd3d_shader_cache_compare_key(const void *key, const struct rb_entry *entry)
+{
+    const struct vkd3d_shader_cache_entry *e = RB_ENTRY_VALUE(entry, const struct vkd3d_shader_cache_entry, entry);
+    const struct vkd3d_shader_cache_key *k = key;
+
+    if (k->dxbc_hash != e->key.dxbc_hash)
+        return k->dxbc_hash < e->key.dxbc_hash ? -1 : 1;
+    if (k->args_hash != e->key.args_hash)
+        return k->args_hash < e->key.args_hash ? -1 : 1;
+    return 0;
+}
+
+static void vkd3d_shader_cache_free_entry(struct rb_entry *entry, void *context)
+{
+    vkd3d_free(RB_ENTRY_VALUE(entry, struct vkd3d_shader_cache_entry, entry));
+}
+
+static uint64_t vkd3d_shader_cache_get_build_hash(void)
+{
+    return vkd3d_hash_fnv1a_u32(vkd3d_get_build_hash(), VKD3D_SHADER_CACHE_VERSION);
+}
+
+bool vkd3d_shader_cache_key_init(struct vkd3d_shader_cache_key *key, const struct vkd3d_shader_code *dxbc,
+        uint32_t compiler_options, const struct vkd3d_shader_interface_info *shader_interface,
+        const struct vkd3d_shader_compile_arguments *compile_args)
+{
+    struct vkd3d_shader_hash_state state;
+    uint64_t size = dxbc->size;
+
+    key->dxbc_hash = vkd3d_shader_hash_data(dxbc->code, dxbc->size, 0);
+
+    vkd3d_shader_hash_init(&state, 0);
+    vkd3d_shader_hash_update(&state, &size, sizeof(size));
+    vkd3d_shader_hash_update(&state, &compiler_options, sizeof(compiler_options));
+    if (vkd3d_shader_hash_shader_interface(&state, shader_interface) < 0)
+        return false;
+    if (vkd3d_shader_hash_compile_arguments(&state, compile_args) < 0)
+        return false;
+    key->args_hash = vkd3d_shader_hash_digest(&state);
+
+    return true;
+}
+
+static bool vkd3d_shader_cache_validate_entry(struct vkd3d_shader_cache_entry *entry)
+{
+    if (!entry->validated)
+        entry->validated = vkd3d_shader_hash_data(entry->code.code, entry->code.size, 0) == entry->code_hash;
+    return entry->validated;
+}
+
+static void vkd3d_shader_cache_insert(struct vkd3d_shader_cache *cache,
+        struct vkd3d_shader_cache_entry *entry)
+{
+    struct vkd3d_shader_cache_entry *existing;
+    struct rb_entry *rb_entry;
+
+    /* Records are duplicated when processes compile the same shader
+     * concurrently, or when a shader is written again after its record was
+     * torn. Keep the first valid one. */
+    if ((rb_entry = rb_get(&cache->tree, &entry->key)))
+    {
+        existing = RB_ENTRY_VALUE(rb_entry, struct vkd3d_shader_cache_entry, entry);
+        if (vkd3d_shader_cache_validate_entry(existing))
+        {
+            vkd3d_free(entry);
+            return;
+        }
+        rb_remove(&cache->tree, rb_entry);
+        vkd3d_free(existing);
+    }
+
+    rb_put(&cache->tree, &entry->key, &entry->entry);
+}
+
+static void vkd3d_shader_cache_load_mapped_file(struct vkd3d_shader_cache *cache)
+{
+    const struct vkd3d_shader_cache_file_header *header = cache->mapped_file.mapped;
+    size_t offset, size = cache->mapped_file.mapped_size;
+    const struct vkd3d_shader_cache_record *record, *next_record;
+    const uint8_t *data = cache->mapped_file.mapped;
+    struct vkd3d_shader_cache_entry *entry;
+    unsigned int entry_count = 0;
+    bool corrupt = false;
+    size_t next_offset;
+
+    if (size < sizeof(*header) || header->magic != VKD3D_SHADER_CACHE_MAGIC
+            || header->version != VKD3D_SHADER_CACHE_VERSION
+            || header->build_hash != vkd3d_shader_cache_get_build_hash())
+    {
+        WARN("Ignoring shader cache with mismatching header.\n");
+        return;
+    }
+
+    offset = sizeof(*header);
+    while (offset < size && size - offset >= sizeof(*record))
+    {
+        record = (const void *)(data + offset);
+
+        if (record->magic != VKD3D_SHADER_CACHE_RECORD_MAGIC || !record->code_size
+                || record->code_size % sizeof(uint32_t)
+                || record->code_size > size - offset - sizeof(*record))
+        {
+            corrupt = true;
+            offset += VKD3D_SHADER_CACHE_ALIGNMENT;
+            continue;
+        }
+
+        /* A record torn by a crashed writer spans into the record appended
+         * after it, which would then be lost. Records which are not followed
+         * by another record are validated here, the others lazily on first
+         * use. */
+        next_offset = offset + sizeof(*record) + align(record->code_size, VKD3D_SHADER_CACHE_ALIGNMENT);
+        next_record = (const void *)(data + next_offset);
+        if (next_offset < size && (size - next_offset < sizeof(next_record->magic)
+                || next_record->magic != VKD3D_SHADER_CACHE_RECORD_MAGIC)
+                && vkd3d_shader_hash_data(record + 1, record->code_size, 0) != record->code_hash)
+        {
+            corrupt = true;
+            offset += VKD3D_SHADER_CACHE_ALIGNMENT;
+            continue;
+        }
+
+        if (!(entry = vkd3d_malloc(sizeof(*entry))))
+            break;
+
+        entry->key = record->key;
+        entry->code_hash = record->code_hash;
+        entry->validated = false;
+        entry->code.code = record + 1;
+        entry->code.size = record->code_size;
+        vkd3d_shader_cache_insert(cache, entry);
+
+        offset = next_offset;
+        ++entry_count;
+    }
+
+    if (corrupt)
+        WARN("Skipped corrupt records in shader cache.\n");
+
+    TRACE("Loaded %u shader cache records.\n", entry_count);
+}
+
+static bool vkd3d_shader_cache_open_file(struct vkd3d_shader_cache *cache, const char *path)
+{
+    struct vkd3d_shader_cache_file_header header;
+    bool ret = true;
+    long size;
+
+    if (!(cache->file = fopen(path, "ab")))
+    {
+        WARN("Failed to open shader cache '%s'.\n", path);
+        return false;
+    }
+
+    if (!vkd3d_file_lock(cache->file))
+    {
+        WARN("Failed to lock shader cache '%s'.\n", path);
+        fclose(cache->file);
+        cache->file = NULL;
+        return false;
+    }
+
+    /* Whoever creates the file writes the header. */
+    if (!fseek(cache->file, 0, SEEK_END) && (size = ftell(cache->file)) == 0)
+    {
+        header.magic = VKD3D_SHADER_CACHE_MAGIC;
+        header.version = VKD3D_SHADER_CACHE_VERSION;
+        header.build_hash = vkd3d_shader_cache_get_build_hash();
+        ret = fwrite(&header, sizeof(header), 1, cache->file) == 1 && !fflush(cache->file);
+    }
+
+    vkd3d_file_unlock(cache->file);
+
+    if (!ret)
+    {
+        WARN("Failed to write shader cache header.\n");
+        fclose(cache->file);
+        cache->file = NULL;
+    }
+
+    return ret;
+}
+
+HRESULT vkd3d_shader_cache_init(struct vkd3d_shader_cache *cache)
+{
+    char program_name[VKD3D_PATH_MAX], path[VKD3D_PATH_MAX];
+    const char *cache_dir, *max_size;
+    int rc;
+
+    memset(cache, 0, sizeof(*cache));
+    rb_init(&cache->tree, vkd3d_shader_cache_compare_key);
+
+    if ((rc = pthread_mutex_init(&cache->mutex, NULL)))
+    {
+        ERR("Failed to initialize mutex, error %d.\n", rc);
+        return hresult_from_errno(rc);
+    }
+
+    if (!(cache_dir = getenv("VKD3D_SHADER_CACHE_PATH")) || !*cache_dir)
+        return S_OK;
+
+    cache->max_size = VKD3D_SHADER_CACHE_DEFAULT_MAX_SIZE;
+    if ((max_size = getenv("VKD3D_SHADER_CACHE_MAX_SIZE")))
+        cache->max_size = (uint64_t)strtoull(max_size, NULL, 0) << 20;
+
+    if (!vkd3d_get_program_name(program_name) || !*program_name)
+        strcpy(program_name, "vkd3d");
+
+    /* The build hash is part of the name so that upgrading vkd3d never has to
+     * truncate a file which other processes might still have mapped. */
+    if (snprintf(path, sizeof(path), "%s/%s.%016"PRIx64".vkd3d-shader-cache",
+            cache_dir, program_name, vkd3d_shader_cache_get_build_hash()) >= (int)sizeof(path))
+    {
+        WARN("Shader cache path is too long.\n");
+        return S_OK;
+    }
+
+    if (!vkd3d_shader_cache_open_file(cache, path))
+        return S_OK;
+
+    if (vkd3d_file_map_read_only(path, &cache->mapped_file))
+        vkd3d_shader_cache_load_mapped_file(cache);
+
+    TRACE("Using shader cache '%s'.\n", path);
+    cache->enabled = true;
+    return S_OK;
+}
+
+void vkd3d_shader_cache_cleanup(struct vkd3d_shader_cache *cache)
+{
+    rb_destroy(&cache->tree, vkd3d_shader_cache_free_entry, NULL);
+    vkd3d_file_unmap(&cache->mapped_file);
+    if (cache->file)
+        fclose(cache->file);
+    pthread_mutex_destroy(&cache->mutex);
+}
+
+bool vkd3d_shader_cache_find(struct vkd3d_shader_cache *cache, const struct vkd3d_shader_cache_key *key,
+        struct vkd3d_shader_code *spirv)
+{
+    struct vkd3d_shader_cache_entry *entry;
+    struct rb_entry *rb_entry;
+    bool found = false;
+
+    if (!cache->enabled)
+        return false;
+
+    pthread_mutex_lock(&cache->mutex);
+
+    if ((rb_entry = rb_get(&cache->tree, key)))
+    {
+        entry = RB_ENTRY_VALUE(rb_entry, struct vkd3d_shader_cache_entry, entry);
+
+        if (!vkd3d_shader_cache_validate_entry(entry))
+        {
+            WARN("Shader cache record %016"PRIx64":%016"PRIx64" is corrupt.\n",
+                    key->dxbc_hash, key->args_hash);
+            rb_remove(&cache->tree, rb_entry);
+            vkd3d_free(entry);
+        }
+        else
+        {
+            *spirv = entry->code;
+            found = true;
+        }
+    }
+
+    pthread_mutex_unlock(&cache->mutex);
+
+    return found;
+}
+
+static void vkd3d_shader_cache_append_record_locked(struct vkd3d_shader_cache *cache,
+        const struct vkd3d_shader_cache_entry *entry)
+{
+    static const uint8_t zero_padding[VKD3D_SHADER_CACHE_ALIGNMENT];
+    struct vkd3d_shader_cache_record record;
+    size_t padding, record_size;
+    bool ret, full = false;
+    long size;
+
+    record.magic = VKD3D_SHADER_CACHE_RECORD_MAGIC;
+    record.code_size = entry->code.size;
+    record.key = entry->key;
+    record.code_hash = entry->code_hash;
+    record_size = sizeof(record) + align(entry->code.size, VKD3D_SHADER_CACHE_ALIGNMENT);
+
+    if (!vkd3d_file_lock(cache->file))
+    {
+        WARN("Failed to lock shader cache.\n");
+        return;
+    }
+
+    if ((ret = !fseek(cache->file, 0, SEEK_END) && (size = ftell(cache->file)) >= 0))
+    {
+        if ((full = align(size, VKD3D_SHADER_CACHE_ALIGNMENT) + record_size > cache->max_size))
+            ret = false;
+        /* Re-align after a record torn by a crashed writer. */
+        else if ((padding = align(size, VKD3D_SHADER_CACHE_ALIGNMENT) - size))
+            ret = fwrite(zero_padding, padding, 1, cache->file) == 1;
+    }
+
+    padding = align(entry->code.size, VKD3D_SHADER_CACHE_ALIGNMENT) - entry->code.size;
+    ret = ret && fwrite(&record, sizeof(record), 1, cache->file) == 1
+            && fwrite(entry->code.code, entry->code.size, 1, cache->file) == 1
+            && (!padding || fwrite(zero_padding, padding, 1, cache->file) == 1)
+            && !fflush(cache->file);
+
+    vkd3d_file_unlock(cache->file);
+
+    if (!ret)
+    {
+        if (full)
+            WARN("Shader cache is full, disabling shader cache writes.\n");
+        else
+            WARN("Failed to write shader cache record, disabling shader cache writes.\n");
+        fclose(cache->file);
+        cache->file = NULL;
+    }
+}
+
+void vkd3d_shader_cache_put(struct vkd3d_shader_cache *cache, const struct vkd3d_shader_cache_key *key,
+        const struct vkd3d_shader_code *spirv)
+{
+    struct vkd3d_shader_cache_entry *entry;
+    void *code;
+
+    if (!cache->enabled || spirv->size > UINT32_MAX)
+        return;
+
+    if (!(entry = vkd3d_malloc(sizeof(*entry) + spirv->size)))
+        return;
+
+    code = entry + 1;
+    memcpy(code, spirv->code, spirv->size);
+    entry->key = *key;
+    entry->code_hash = vkd3d_shader_hash_data(code, spirv->size, 0);
+    entry->validated = true;
+    entry->code.code = code;
+    entry->code.size = spirv->size;
+
+    pthread_mutex_lock(&cache->mutex);
+
+    /* Another thread may have compiled the same shader concurrently. */
+    if (rb_get(&cache->tree, key))
+    {
+        pthread_mutex_unlock(&cache->mutex);
+        vkd3d_free(entry);
+        return;
+    }
+
+    rb_put(&cache->tree, &entry->key, &entry->entry);
+    if (cache->file)
+        vkd3d_shader_cache_append_record_locked(cache, entry);
+
+    pthread_mutex_unlock(&cache->mutex);
+}
@@ -68,7 +68,7 @@ static void d3d12_root_signature_cleanup(struct d3d12_root_signature *root_signa
     VK_CALL(vkDestroyDescriptorSetLayout(device->vk_device, root_signature->vk_root_descriptor_layout, NULL));
 
     for (i = 0; i < root_signature->static_sampler_count; ++i)
-        VK_CALL(vkDestroySampler(device->vk_device, root_signature->static_samplers[i], NULL));
+        vkd3d_sampler_cache_release(&device->sampler_cache, device, root_signature->static_samplers[i]);
 
     vkd3d_free(root_signature->parameters);
     vkd3d_free(root_signature->bindings);
@@ -79,7 +79,21 @@ static void d3d12_root_signature_cleanup(struct d3d12_root_signature *root_signa
 static ULONG STDMETHODCALLTYPE d3d12_root_signature_Release(ID3D12RootSignature *iface)
 {
     struct d3d12_root_signature *root_signature = impl_from_ID3D12RootSignature(iface);
-    ULONG refcount = InterlockedDecrement(&root_signature->refcount);
+    struct vkd3d_root_signature_cache *cache = &root_signature->device->root_signature_cache;
+    ULONG refcount;
+
+    /* Cache lookups take their reference with the lock held. */
+    if (root_signature->blob)
+    {
+        pthread_mutex_lock(&cache->mutex);
+        if (!(refcount = InterlockedDecrement(&root_signature->refcount)))
+            rb_remove(&cache->tree, &root_signature->cache_entry);
+        pthread_mutex_unlock(&cache->mutex);
+    }
+    else
+    {
+        refcount = InterlockedDecrement(&root_signature->refcount);
+    }
 
     TRACE("%p decreasing refcount to %u.\n", root_signature, refcount);
 
@@ -88,6 +102,7 @@ static ULONG STDMETHODCALLTYPE d3d12_root_signature_Release(ID3D12RootSignature
         struct d3d12_device *device = root_signature->device;
         vkd3d_private_store_destroy(&root_signature->private_store);
         d3d12_root_signature_cleanup(root_signature, device);
+        vkd3d_free(root_signature->blob);
         vkd3d_free(root_signature);
         d3d12_device_release(device);
     }
@@ -1051,10 +1066,105 @@ fail:
     return hr;
 }
 
+/* vkd3d_root_signature_cache */
+struct vkd3d_root_signature_cache_key
+{
+    uint64_t hash;
+    const void *blob;
+    size_t blob_size;
+};
+
+static int vkd3d_root_signature_cache_compare_key(const void *key, const struct rb_entry *entry)
+{
+    const struct d3d12_root_signature *e = RB_ENTRY_VALUE(entry, const struct d3d12_root_signature, cache_entry);
+    const struct vkd3d_root_signature_cache_key *k = key;
+
+    if (k->hash != e->blob_hash)
+        return k->hash < e->blob_hash ? -1 : 1;
+    if (k->blob_size != e->blob_size)
+        return k->blob_size < e->blob_size ? -1 : 1;
+    return memcmp(k->blob, e->blob, k->blob_size);
+}
+
+HRESULT vkd3d_root_signature_cache_init(struct vkd3d_root_signature_cache *cache)
+{
+    int rc;
+
+    rb_init(&cache->tree, vkd3d_root_signature_cache_compare_key);
+
+    if ((rc = pthread_mutex_init(&cache->mutex, NULL)))
+    {
+        ERR("Failed to initialize mutex, error %d.\n", rc);
+        return hresult_from_errno(rc);
+    }
+
+    return S_OK;
+}
+
+void vkd3d_root_signature_cache_cleanup(struct vkd3d_root_signature_cache *cache)
+{
+    /* Root signatures hold a device reference, so the cache is empty by now. */
+    assert(!cache->tree.root);
+    pthread_mutex_destroy(&cache->mutex);
+}
+
+static struct d3d12_root_signature *vkd3d_root_signature_cache_find(struct vkd3d_root_signature_cache *cache,
+        const struct vkd3d_root_signature_cache_key *key)
+{
+    struct d3d12_root_signature *root_signature = NULL;
+    struct rb_entry *entry;
+
+    pthread_mutex_lock(&cache->mutex);
+    if ((entry = rb_get(&cache->tree, key)))
+    {
+        root_signature = RB_ENTRY_VALUE(entry, struct d3d12_root_signature, cache_entry);
+        d3d12_root_signature_AddRef(&root_signature->ID3D12RootSignature_iface);
+    }
+    pthread_mutex_unlock(&cache->mutex);
+
+    return root_signature;
+}
+
+/* Returns the root signature to use, which is "object" unless another thread
+ * inserted an identical one first. */
+static struct d3d12_root_signature *vkd3d_root_signature_cache_insert(struct vkd3d_root_signature_cache *cache,
+        const struct vkd3d_root_signature_cache_key *key, struct d3d12_root_signature *object)
+{
+    struct d3d12_root_signature *existing;
+    void *blob;
+
+    /* The root signature simply stays out of the cache if this fails. */
+    if (!(blob = vkd3d_malloc(key->blob_size)))
+        return object;
+    memcpy(blob, key->blob, key->blob_size);
+
+    if ((existing = vkd3d_root_signature_cache_find(cache, key)))
+    {
+        vkd3d_free(blob);
+        d3d12_root_signature_Release(&object->ID3D12RootSignature_iface);
+        return existing;
+    }
+
+    pthread_mutex_lock(&cache->mutex);
+    if (!rb_get(&cache->tree, key))
+    {
+        object->blob = blob;
+        object->blob_size = key->blob_size;
+        rb_put(&cache->tree, key, &object->cache_entry);
+        blob = NULL;
+    }
+    pthread_mutex_unlock(&cache->mutex);
+
+    vkd3d_free(blob);
+    return object;
+}
+
 HRESULT d3d12_root_signature_create(struct d3d12_device *device,
         const void *bytecode, size_t bytecode_length, struct d3d12_root_signature **root_signature)
 {
+    struct vkd3d_root_signature_cache *cache = &device->root_signature_cache;
     const struct vkd3d_shader_code dxbc = {bytecode, bytecode_length};
+    struct vkd3d_root_signature_cache_key key;
     union
     {
         D3D12_VERSIONED_ROOT_SIGNATURE_DESC d3d12;
@@ -1064,6 +1174,17 @@ HRESULT d3d12_root_signature_create(struct d3d12_device *device,
     HRESULT hr;
     int ret;
 
+    key.hash = vkd3d_hash_fnv1a_data(VKD3D_HASH_FNV1A_INIT, bytecode, bytecode_length);
+    key.blob = bytecode;
+    key.blob_size = bytecode_length;
+
+    if ((object = vkd3d_root_signature_cache_find(cache, &key)))
+    {
+        TRACE("Reusing root signature %p.\n", object);
+        *root_signature = object;
+        return S_OK;
+    }
+
     if ((ret = vkd3d_parse_root_signature_v_1_0(&dxbc, &root_signature_desc.vkd3d)) < 0)
     {
         WARN("Failed to parse root signature, vkd3d result %d.\n", ret);
@@ -1084,9 +1205,14 @@ HRESULT d3d12_root_signature_create(struct d3d12_device *device,
         return hr;
     }
 
+    /* Pipeline state records refer to their root signature by this hash. */
+    object->blob_hash = key.hash;
+    vkd3d_pipeline_recorder_record_root_signature(&device->pipeline_recorder,
+            key.hash, bytecode, bytecode_length);
+
     TRACE("Created root signature %p.\n", object);
 
-    *root_signature = object;
+    *root_signature = vkd3d_root_signature_cache_insert(cache, &key, object);
 
     return S_OK;
 }
@@ -1107,12 +1233,38 @@ static unsigned int d3d12_root_signature_get_shader_interface_flags(const struct
 /* vkd3d_render_pass_cache */
 struct vkd3d_render_pass_entry
 {
+    struct vkd3d_render_pass_entry *next;
     struct vkd3d_render_pass_key key;
     VkRenderPass vk_render_pass;
 };
 
 STATIC_ASSERT(sizeof(struct vkd3d_render_pass_key) == 48);
 
+static struct vkd3d_render_pass_entry **vkd3d_render_pass_cache_get_bucket(struct vkd3d_render_pass_cache *cache,
+        const struct vkd3d_render_pass_key *key)
+{
+    uint32_t hash = vkd3d_hash_fnv1a_data(VKD3D_HASH_FNV1A_INIT, key, sizeof(*key));
+
+    return &cache->buckets[hash % ARRAY_SIZE(cache->buckets)];
+}
+
+/* Entries are fully initialised before being published at the head of a
+ * bucket and live as long as the device, so lookups take no locks. */
+static struct vkd3d_render_pass_entry *vkd3d_render_pass_cache_lookup(struct vkd3d_render_pass_entry **bucket,
+        const struct vkd3d_render_pass_key *key)
+{
+    struct vkd3d_render_pass_entry *current;
+
+    for (current = vkd3d_atomic_ptr_load_explicit((void **)bucket, vkd3d_memory_order_acquire);
+            current; current = current->next)
+    {
+        if (!memcmp(&current->key, key, sizeof(*key)))
+            return current;
+    }
+
+    return NULL;
+}
+
 static VkImageLayout vkd3d_render_pass_get_depth_stencil_layout(const struct vkd3d_render_pass_key *key)
 {
     if (!key->depth_enable && !key->stencil_enable)
@@ -1129,7 +1281,8 @@ static VkImageLayout vkd3d_render_pass_get_depth_stencil_layout(const struct vkd
 }
 
 static HRESULT vkd3d_render_pass_cache_create_pass_locked(struct vkd3d_render_pass_cache *cache,
-        struct d3d12_device *device, const struct vkd3d_render_pass_key *key, VkRenderPass *vk_render_pass)
+        struct d3d12_device *device, struct vkd3d_render_pass_entry **bucket,
+        const struct vkd3d_render_pass_key *key, VkRenderPass *vk_render_pass)
 {
     VkAttachmentReference attachment_references[D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT + 1];
     VkAttachmentDescription attachments[D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT + 1];
@@ -1144,15 +1297,12 @@ static HRESULT vkd3d_render_pass_cache_create_pass_locked(struct vkd3d_render_pa
     unsigned int rt_count;
     VkResult vr;
 
-    if (!vkd3d_array_reserve((void **)&cache->render_passes, &cache->render_passes_size,
-            cache->render_pass_count + 1, sizeof(*cache->render_passes)))
+    if (!(entry = vkd3d_malloc(sizeof(*entry))))
     {
         *vk_render_pass = VK_NULL_HANDLE;
         return E_OUTOFMEMORY;
     }
 
-    entry = &cache->render_passes[cache->render_pass_count];
-
     entry->key = *key;
 
     have_depth_stencil = key->depth_enable || key->stencil_enable;
@@ -1251,12 +1401,15 @@ static HRESULT vkd3d_render_pass_cache_create_pass_locked(struct vkd3d_render_pa
     if ((vr = VK_CALL(vkCreateRenderPass(device->vk_device, &pass_info, NULL, vk_render_pass))) >= 0)
     {
         entry->vk_render_pass = *vk_render_pass;
+        entry->next = *bucket;
+        vkd3d_atomic_ptr_store_explicit((void **)bucket, entry, vkd3d_memory_order_release);
         ++cache->render_pass_count;
     }
     else
     {
         WARN("Failed to create Vulkan render pass, vr %d.\n", vr);
         *vk_render_pass = VK_NULL_HANDLE;
+        vkd3d_free(entry);
     }
 
     return hresult_from_vk_result(vr);
@@ -1265,59 +1418,128 @@ static HRESULT vkd3d_render_pass_cache_create_pass_locked(struct vkd3d_render_pa
 HRESULT vkd3d_render_pass_cache_find(struct vkd3d_render_pass_cache *cache,
         struct d3d12_device *device, const struct vkd3d_render_pass_key *key, VkRenderPass *vk_render_pass)
 {
-    bool found = false;
+    struct vkd3d_render_pass_entry **bucket, *entry;
     HRESULT hr = S_OK;
-    unsigned int i;
     int rc;
 
-    if ((rc = pthread_mutex_lock(&device->mutex)))
+    bucket = vkd3d_render_pass_cache_get_bucket(cache, key);
+    if ((entry = vkd3d_render_pass_cache_lookup(bucket, key)))
+    {
+        *vk_render_pass = entry->vk_render_pass;
+        vkd3d_pipeline_stats_add_render_pass_lookup(&device->pipeline_stats, true);
+        return S_OK;
+    }
+
+    if ((rc = pthread_mutex_lock(&cache->mutex)))
     {
         ERR("Failed to lock mutex, error %d.\n", rc);
         *vk_render_pass = VK_NULL_HANDLE;
         return hresult_from_errno(rc);
     }
 
-    for (i = 0; i < cache->render_pass_count; ++i)
-    {
-        struct vkd3d_render_pass_entry *current = &cache->render_passes[i];
-
-        if (!memcmp(&current->key, key, sizeof(*key)))
-        {
-            *vk_render_pass = current->vk_render_pass;
-            found = true;
-            break;
-        }
-    }
+    /* Another thread may have created the render pass in the meantime. */
+    if ((entry = vkd3d_render_pass_cache_lookup(bucket, key)))
+        *vk_render_pass = entry->vk_render_pass;
+    else
+        hr = vkd3d_render_pass_cache_create_pass_locked(cache, device, bucket, key, vk_render_pass);
 
-    if (!found)
-        hr = vkd3d_render_pass_cache_create_pass_locked(cache, device, key, vk_render_pass);
+    pthread_mutex_unlock(&cache->mutex);
 
-    pthread_mutex_unlock(&device->mutex);
+    vkd3d_pipeline_stats_add_render_pass_lookup(&device->pipeline_stats, !!entry);
 
     return hr;
 }
 
-void vkd3d_render_pass_cache_init(struct vkd3d_render_pass_cache *cache)
+HRESULT vkd3d_render_pass_cache_init(struct vkd3d_render_pass_cache *cache)
 {
-    cache->render_passes = NULL;
+    int rc;
+
+    memset(cache->buckets, 0, sizeof(cache->buckets));
     cache->render_pass_count = 0;
-    cache->render_passes_size = 0;
+
+    if ((rc = pthread_mutex_init(&cache->mutex, NULL)))
+    {
+        ERR("Failed to initialize mutex, error %d.\n", rc);
+        return hresult_from_errno(rc);
+    }
+
+    return S_OK;
+}
+
+/* Creates render passes for the render target and depth formats most
+ * applications start with, so that the first pipelines using them do not
+ * have to. Keys match those built by d3d12_graphics_pipeline_state_create_render_pass(). */
+void vkd3d_render_pass_cache_prepopulate(struct vkd3d_render_pass_cache *cache, struct d3d12_device *device)
+{
+    const struct vkd3d_format *rt_format, *ds_format;
+    struct vkd3d_render_pass_key key;
+    VkRenderPass vk_render_pass;
+    unsigned int i, j;
+
+    static const DXGI_FORMAT rt_formats[] =
+    {
+        DXGI_FORMAT_UNKNOWN,
+        DXGI_FORMAT_R8G8B8A8_UNORM,
+        DXGI_FORMAT_R8G8B8A8_UNORM_SRGB,
+        DXGI_FORMAT_B8G8R8A8_UNORM,
+        DXGI_FORMAT_B8G8R8A8_UNORM_SRGB,
+        DXGI_FORMAT_R10G10B10A2_UNORM,
+        DXGI_FORMAT_R16G16B16A16_FLOAT,
+    };
+    static const DXGI_FORMAT ds_formats[] =
+    {
+        DXGI_FORMAT_UNKNOWN,
+        DXGI_FORMAT_D32_FLOAT,
+        DXGI_FORMAT_D24_UNORM_S8_UINT,
+    };
+
+    for (i = 0; i < ARRAY_SIZE(rt_formats); ++i)
+    {
+        for (j = 0; j < ARRAY_SIZE(ds_formats); ++j)
+        {
+            rt_format = rt_formats[i] ? vkd3d_get_format(device, rt_formats[i], false) : NULL;
+            ds_format = ds_formats[j] ? vkd3d_get_format(device, ds_formats[j], true) : NULL;
+            if ((rt_formats[i] && !rt_format) || (ds_formats[j] && !ds_format) || (!rt_format && !ds_format))
+                continue;
+
+            memset(&key, 0, sizeof(key));
+            if (rt_format)
+                key.vk_formats[key.attachment_count++] = rt_format->vk_format;
+            if (ds_format)
+            {
+                key.depth_enable = true;
+                key.depth_write = true;
+                key.vk_formats[key.attachment_count++] = ds_format->vk_format;
+            }
+            key.sample_count = VK_SAMPLE_COUNT_1_BIT;
+
+            if (FAILED(vkd3d_render_pass_cache_find(cache, device, &key, &vk_render_pass)))
+                WARN("Failed to create render pass for formats %#x, %#x.\n", rt_formats[i], ds_formats[j]);
+        }
+    }
+
+    TRACE("Render pass cache holds %zu render passes.\n", cache->render_pass_count);
 }
 
 void vkd3d_render_pass_cache_cleanup(struct vkd3d_render_pass_cache *cache,
         struct d3d12_device *device)
 {
     const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    struct vkd3d_render_pass_entry *current, *next;
     unsigned int i;
 
-    for (i = 0; i < cache->render_pass_count; ++i)
+    for (i = 0; i < ARRAY_SIZE(cache->buckets); ++i)
     {
-        struct vkd3d_render_pass_entry *current = &cache->render_passes[i];
-        VK_CALL(vkDestroyRenderPass(device->vk_device, current->vk_render_pass, NULL));
+        for (current = cache->buckets[i]; current; current = next)
+        {
+            next = current->next;
+            VK_CALL(vkDestroyRenderPass(device->vk_device, current->vk_render_pass, NULL));
+            vkd3d_free(current);
+        }
+        cache->buckets[i] = NULL;
     }
 
-    vkd3d_free(cache->render_passes);
-    cache->render_passes = NULL;
+    pthread_mutex_destroy(&cache->mutex);
 }
 
 struct vkd3d_pipeline_key
@@ -1326,16 +1548,64 @@ struct vkd3d_pipeline_key
     uint32_t viewport_count;
     uint32_t strides[D3D12_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT];
     VkFormat dsv_format;
+    /* Set when strides are compiled into a pipeline state which otherwise
+     * has dynamic strides. Not a bool, to keep the key free of padding. */
+    uint32_t static_strides;
+};
+
+enum vkd3d_compiled_pipeline_status
+{
+    VKD3D_COMPILED_PIPELINE_PENDING,
+    VKD3D_COMPILED_PIPELINE_READY,
+    VKD3D_COMPILED_PIPELINE_FAILED,
+    /* Dropped by the variant budget. The Vulkan pipeline is kept until the
+     * last command allocator using it releases it. */
+    VKD3D_COMPILED_PIPELINE_EVICTED,
 };
 
 struct vkd3d_compiled_pipeline
 {
-    struct list entry;
+    /* Immutable once the entry is published. */
+    struct vkd3d_compiled_pipeline *next;
     struct vkd3d_pipeline_key key;
+    /* Compiled by the pipeline compiler rather than by a draw. */
+    bool speculative;
+
+    /* Written before the status is released as VKD3D_COMPILED_PIPELINE_READY. */
     VkPipeline vk_pipeline;
     VkRenderPass vk_render_pass;
+    uint32_t status;
+    uint32_t used;
+
+    /* Only used with a variant budget. The budget holds a reference to
+     * variants on its LRU list, and command allocators hold one for each
+     * variant recorded into them. References are taken without the budget
+     * mutex, but only while the Vulkan pipeline is alive, and dropped with
+     * the mutex held. */
+    uint32_t refcount;
+    /* Budget clock of the last use, and the command allocator which took the
+     * last reference. */
+    uint64_t last_used;
+    uint64_t owner;
+
+    /* Protected by the budget mutex. */
+    struct list budget_entry;
+    uint64_t size;
+    uint64_t queued_time;
+    /* The pipeline state was destroyed while the variant was still used. */
+    bool orphaned;
 };
 
+static void vkd3d_compiled_pipeline_destroy(struct vkd3d_compiled_pipeline *pipeline,
+        struct d3d12_device *device);
+
+static HRESULT d3d12_pipeline_state_serialize(struct d3d12_pipeline_state *state, void **blob, size_t *blob_size);
+static VkPipeline d3d12_pipeline_state_create_variant(struct d3d12_pipeline_state *state,
+        const struct vkd3d_pipeline_key *key, VkPipelineCache vk_cache, VkRenderPass *vk_render_pass);
+static HRESULT vkd3d_create_compute_pipeline_from_module(struct d3d12_device *device,
+        const struct vkd3d_shader_module *module, VkPipelineLayout vk_pipeline_layout,
+        VkPipelineCache vk_cache, VkPipeline *vk_pipeline);
+
 /* ID3D12PipelineState */
 static inline struct d3d12_pipeline_state *impl_from_ID3D12PipelineState(ID3D12PipelineState *iface)
 {
@@ -1378,20 +1648,26 @@ static void d3d12_pipeline_state_destroy_graphics(struct d3d12_pipeline_state *s
         struct d3d12_device *device)
 {
     struct d3d12_graphics_pipeline_state *graphics = &state->graphics;
-    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
-    struct vkd3d_compiled_pipeline *current, *e;
+    struct vkd3d_compiled_pipeline *current, *next;
     unsigned int i;
 
+    if (graphics->has_speculative_pipeline)
+        vkd3d_pipeline_compiler_cancel(&device->pipeline_compiler, state);
+
     for (i = 0; i < graphics->stage_count; ++i)
-    {
-        VK_CALL(vkDestroyShaderModule(device->vk_device, graphics->stages[i].module, NULL));
-    }
+        vkd3d_shader_module_release(graphics->modules[i], device);
 
-    LIST_FOR_EACH_ENTRY_SAFE(current, e, &graphics->compiled_pipelines, struct vkd3d_compiled_pipeline, entry)
+    for (i = 0; i < ARRAY_SIZE(graphics->compiled_pipelines); ++i)
     {
-        VK_CALL(vkDestroyPipeline(device->vk_device, current->vk_pipeline, NULL));
-        vkd3d_free(current);
+        for (current = graphics->compiled_pipelines[i]; current; current = next)
+        {
+            next = current->next;
+            vkd3d_compiled_pipeline_destroy(current, device);
+        }
     }
+
+    pthread_cond_destroy(&graphics->pipeline_cond);
+    pthread_mutex_destroy(&graphics->pipeline_mutex);
 }
 
 static ULONG STDMETHODCALLTYPE d3d12_pipeline_state_Release(ID3D12PipelineState *iface)
@@ -1411,7 +1687,13 @@ static ULONG STDMETHODCALLTYPE d3d12_pipeline_state_Release(ID3D12PipelineState
         if (d3d12_pipeline_state_is_graphics(state))
             d3d12_pipeline_state_destroy_graphics(state, device);
         else if (d3d12_pipeline_state_is_compute(state))
+        {
             VK_CALL(vkDestroyPipeline(device->vk_device, state->compute.vk_pipeline, NULL));
+            vkd3d_shader_module_release(state->compute.module, device);
+        }
+
+        if (state->vk_pso_cache)
+            VK_CALL(vkDestroyPipelineCache(device->vk_device, state->vk_pso_cache, NULL));
 
         vkd3d_free(state);
 
@@ -1479,14 +1761,24 @@ static HRESULT STDMETHODCALLTYPE d3d12_pipeline_state_GetDevice(ID3D12PipelineSt
 static HRESULT STDMETHODCALLTYPE d3d12_pipeline_state_GetCachedBlob(ID3D12PipelineState *iface,
         ID3DBlob **blob)
 {
+    struct d3d12_pipeline_state *state = impl_from_ID3D12PipelineState(iface);
     struct d3d_blob *blob_object;
+    size_t data_size;
+    void *data;
     HRESULT hr;
 
-    FIXME_ONCE("iface %p, blob %p semi-stub!\n", iface, blob);
+    TRACE("iface %p, blob %p.\n", iface, blob);
+
+    if (FAILED(hr = d3d12_pipeline_state_serialize(state, &data, &data_size)))
+    {
+        ERR("Failed to serialize pipeline state, hr %#x.\n", hr);
+        return hr;
+    }
 
-    if (FAILED(hr = d3d_blob_create(NULL, 0, &blob_object)))
+    if (FAILED(hr = d3d_blob_create(data, data_size, &blob_object)))
     {
         ERR("Failed to create blob, hr %#x.", hr);
+        vkd3d_free(data);
         return hr;
     }
 
@@ -1519,148 +1811,1058 @@ struct d3d12_pipeline_state *unsafe_impl_from_ID3D12PipelineState(ID3D12Pipeline
     return impl_from_ID3D12PipelineState(iface);
 }
 
-static HRESULT create_shader_stage(struct d3d12_device *device,
-        struct VkPipelineShaderStageCreateInfo *stage_desc, enum VkShaderStageFlagBits stage,
-        const D3D12_SHADER_BYTECODE *code, const struct vkd3d_shader_interface_info *shader_interface,
-        const struct vkd3d_shader_compile_arguments *compile_args)
+/* A pipeline blob holds everything needed to recreate a pipeline state
+ * without going through the DXBC -> SPIR-V translation: the SPIR-V of each
+ * stage and Vulkan pipeline cache data for its pipelines. Blobs are only valid
+ * for the device, driver and vkd3d build they were created with, and for the
+ * pipeline description they were created from. */
+#define VKD3D_PIPELINE_BLOB_MAGIC       MAKE_MAGIC('V', 'K', 'P', 'B')
+#define VKD3D_PIPELINE_BLOB_VERSION     1
+#define VKD3D_PIPELINE_BLOB_ALIGNMENT   sizeof(uint64_t)
+
+struct vkd3d_pipeline_blob_device_info
 {
-    struct vkd3d_shader_code dxbc = {code->pShaderBytecode, code->BytecodeLength};
-    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
-    struct VkShaderModuleCreateInfo shader_desc;
-    struct vkd3d_shader_code spirv = {0};
-    VkResult vr;
-    int ret;
+    uint32_t vendor_id;
+    uint32_t device_id;
+    uint8_t pipeline_cache_uuid[VK_UUID_SIZE];
+    uint64_t build_hash;
+};
 
-    stage_desc->sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    stage_desc->pNext = NULL;
-    stage_desc->flags = 0;
-    stage_desc->stage = stage;
-    stage_desc->pName = "main";
-    stage_desc->pSpecializationInfo = NULL;
+struct vkd3d_pipeline_blob_header
+{
+    uint32_t magic;
+    uint32_t version;
+    struct vkd3d_pipeline_blob_device_info device_info;
+    uint64_t desc_hash;
+    uint64_t data_size;
+    /* struct vkd3d_pipeline_blob_chunk chunks[]; */
+};
 
-    shader_desc.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    shader_desc.pNext = NULL;
-    shader_desc.flags = 0;
+enum vkd3d_pipeline_blob_chunk_type
+{
+    VKD3D_PIPELINE_BLOB_CHUNK_TYPE_PIPELINE_CACHE = 1,
+    VKD3D_PIPELINE_BLOB_CHUNK_TYPE_SPIRV          = 2,
+};
 
-    if ((ret = vkd3d_shader_compile_dxbc(&dxbc, &spirv, 0, shader_interface, compile_args)) < 0)
-    {
-        WARN("Failed to compile shader, vkd3d result %d.\n", ret);
-        return hresult_from_vkd3d_result(ret);
-    }
-    shader_desc.codeSize = spirv.size;
-    shader_desc.pCode = spirv.code;
+struct vkd3d_pipeline_blob_chunk
+{
+    uint32_t type; /* vkd3d_pipeline_blob_chunk_type */
+    uint32_t stage; /* VkShaderStageFlagBits, for SPIR-V chunks */
+    uint64_t size;
+    uint64_t data_hash;
+    /* uint8_t data[]; padded to VKD3D_PIPELINE_BLOB_ALIGNMENT */
+};
 
-    vr = VK_CALL(vkCreateShaderModule(device->vk_device, &shader_desc, NULL, &stage_desc->module));
-    vkd3d_shader_free_shader_code(&spirv);
-    if (vr < 0)
+STATIC_ASSERT(sizeof(struct vkd3d_pipeline_blob_header) % VKD3D_PIPELINE_BLOB_ALIGNMENT == 0);
+STATIC_ASSERT(sizeof(struct vkd3d_pipeline_blob_chunk) % VKD3D_PIPELINE_BLOB_ALIGNMENT == 0);
+
+/* Parsed contents of a pipeline blob. Pointers reference the blob itself,
+ * which is not required to be aligned. */
+struct vkd3d_pipeline_blob
+{
+    const void *cache_data;
+    size_t cache_data_size;
+
+    struct
     {
-        WARN("Failed to create Vulkan shader module, vr %d.\n", vr);
-        return hresult_from_vk_result(vr);
-    }
+        VkShaderStageFlagBits stage;
+        struct vkd3d_shader_code code;
+    } spirv[VKD3D_MAX_SHADER_STAGES];
+    unsigned int spirv_count;
+};
 
-    return S_OK;
+static void vkd3d_pipeline_blob_init_device_info(struct vkd3d_pipeline_blob_device_info *info,
+        const struct d3d12_device *device)
+{
+    const VkPhysicalDeviceProperties *properties = &device->device_info.properties2.properties;
+
+    memset(info, 0, sizeof(*info));
+    info->vendor_id = properties->vendorID;
+    info->device_id = properties->deviceID;
+    memcpy(info->pipeline_cache_uuid, properties->pipelineCacheUUID, VK_UUID_SIZE);
+    info->build_hash = vkd3d_get_build_hash();
 }
 
-static HRESULT vkd3d_create_compute_pipeline(struct d3d12_device *device,
-        const D3D12_SHADER_BYTECODE *code, const struct vkd3d_shader_interface_info *shader_interface,
-        VkPipelineLayout vk_pipeline_layout, VkPipeline *vk_pipeline)
+static HRESULT vkd3d_pipeline_blob_check_device_info(const struct vkd3d_pipeline_blob_device_info *info,
+        const struct d3d12_device *device)
 {
-    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
-    VkComputePipelineCreateInfo pipeline_info;
-    VkResult vr;
-    HRESULT hr;
+    struct vkd3d_pipeline_blob_device_info expected;
 
-    pipeline_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
-    pipeline_info.pNext = NULL;
-    pipeline_info.flags = 0;
-    if (FAILED(hr = create_shader_stage(device, &pipeline_info.stage,
-            VK_SHADER_STAGE_COMPUTE_BIT, code, shader_interface, NULL)))
-        return hr;
-    pipeline_info.layout = vk_pipeline_layout;
-    pipeline_info.basePipelineHandle = VK_NULL_HANDLE;
-    pipeline_info.basePipelineIndex = -1;
+    vkd3d_pipeline_blob_init_device_info(&expected, device);
 
-    vr = VK_CALL(vkCreateComputePipelines(device->vk_device,
-            VK_NULL_HANDLE, 1, &pipeline_info, NULL, vk_pipeline));
-    VK_CALL(vkDestroyShaderModule(device->vk_device, pipeline_info.stage.module, NULL));
-    if (vr < 0)
+    if (info->vendor_id != expected.vendor_id || info->device_id != expected.device_id)
     {
-        WARN("Failed to create Vulkan compute pipeline, hr %#x.", hr);
-        return hresult_from_vk_result(vr);
+        WARN("Blob was created for device %04x:%04x, current device is %04x:%04x.\n",
+                info->vendor_id, info->device_id, expected.vendor_id, expected.device_id);
+        return D3D12_ERROR_ADAPTER_NOT_FOUND;
+    }
+
+    if (info->build_hash != expected.build_hash
+            || memcmp(info->pipeline_cache_uuid, expected.pipeline_cache_uuid, VK_UUID_SIZE))
+    {
+        WARN("Blob was created with a different driver or vkd3d build.\n");
+        return D3D12_ERROR_DRIVER_VERSION_MISMATCH;
     }
 
     return S_OK;
 }
 
-static HRESULT d3d12_pipeline_state_init_compute(struct d3d12_pipeline_state *state,
-        struct d3d12_device *device, const struct d3d12_pipeline_state_desc *desc)
+static uint64_t vkd3d_hash_shader_bytecode(uint64_t hash, const D3D12_SHADER_BYTECODE *code)
 {
-    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
-    struct vkd3d_shader_interface_info shader_interface;
-    const struct d3d12_root_signature *root_signature;
-    HRESULT hr;
+    hash = vkd3d_hash_fnv1a_u64(hash, code->pShaderBytecode ? code->BytecodeLength : 0);
+    if (code->pShaderBytecode)
+        hash = vkd3d_hash_fnv1a_data(hash, code->pShaderBytecode, code->BytecodeLength);
+    return hash;
+}
 
-    state->ID3D12PipelineState_iface.lpVtbl = &d3d12_pipeline_state_vtbl;
-    state->refcount = 1;
+static uint64_t vkd3d_hash_root_signature(uint64_t hash, const struct d3d12_root_signature *root_signature)
+{
+    if (!root_signature)
+        return vkd3d_hash_fnv1a_u32(hash, 0);
+
+    /* Everything that ends up in the shader interface, and thus in the SPIR-V. */
+    hash = vkd3d_hash_fnv1a_u32(hash, root_signature->d3d12_flags);
+    hash = vkd3d_hash_fnv1a_u32(hash, root_signature->flags);
+    hash = vkd3d_hash_fnv1a_u32(hash, root_signature->descriptor_table_offset);
+    hash = vkd3d_hash_fnv1a_u32(hash, root_signature->descriptor_table_count);
+    hash = vkd3d_hash_fnv1a_u32(hash, root_signature->binding_count);
+    hash = vkd3d_hash_fnv1a_data(hash, root_signature->bindings,
+            root_signature->binding_count * sizeof(*root_signature->bindings));
+    hash = vkd3d_hash_fnv1a_u32(hash, root_signature->root_constant_count);
+    hash = vkd3d_hash_fnv1a_data(hash, root_signature->root_constants,
+            root_signature->root_constant_count * sizeof(*root_signature->root_constants));
+    hash = vkd3d_hash_fnv1a_data(hash, &root_signature->push_constant_ubo_binding,
+            sizeof(root_signature->push_constant_ubo_binding));
+    return hash;
+}
 
-    if (!(root_signature = unsafe_impl_from_ID3D12RootSignature(desc->root_signature)))
-    {
-        WARN("Root signature is NULL.\n");
-        return E_INVALIDARG;
-    }
+static uint64_t vkd3d_hash_stencil_op_desc(uint64_t hash, const D3D12_DEPTH_STENCILOP_DESC *desc)
+{
+    hash = vkd3d_hash_fnv1a_u32(hash, desc->StencilFailOp);
+    hash = vkd3d_hash_fnv1a_u32(hash, desc->StencilDepthFailOp);
+    hash = vkd3d_hash_fnv1a_u32(hash, desc->StencilPassOp);
+    return vkd3d_hash_fnv1a_u32(hash, desc->StencilFunc);
+}
 
-    shader_interface.type = VKD3D_SHADER_STRUCTURE_TYPE_SHADER_INTERFACE_INFO;
-    shader_interface.next = NULL;
-    shader_interface.flags = d3d12_root_signature_get_shader_interface_flags(root_signature);
-    shader_interface.descriptor_tables.offset = root_signature->descriptor_table_offset;
-    shader_interface.descriptor_tables.count = root_signature->descriptor_table_count;
-    shader_interface.bindings = root_signature->bindings;
-    shader_interface.binding_count = root_signature->binding_count;
-    shader_interface.push_constant_buffers = root_signature->root_constants;
-    shader_interface.push_constant_buffer_count = root_signature->root_constant_count;
-    shader_interface.push_constant_ubo_binding = &root_signature->push_constant_ubo_binding;
+/* Structures containing BYTE members are hashed member by member,
+ * since padding bytes may come straight from the application. */
+static uint64_t d3d12_pipeline_state_desc_get_hash(const struct d3d12_pipeline_state_desc *desc,
+        VkPipelineBindPoint bind_point)
+{
+    const D3D12_DEPTH_STENCIL_DESC1 *ds_desc = &desc->depth_stencil_state;
+    const D3D12_STREAM_OUTPUT_DESC *so_desc = &desc->stream_output;
+    uint64_t hash = VKD3D_HASH_FNV1A_INIT;
+    unsigned int i;
 
-    if (FAILED(hr = vkd3d_create_compute_pipeline(device, &desc->cs, &shader_interface,
-            root_signature->vk_pipeline_layout, &state->compute.vk_pipeline)))
+    hash = vkd3d_hash_fnv1a_u32(hash, bind_point);
+    hash = vkd3d_hash_root_signature(hash, unsafe_impl_from_ID3D12RootSignature(desc->root_signature));
+
+    if (bind_point == VK_PIPELINE_BIND_POINT_COMPUTE)
+        return vkd3d_hash_shader_bytecode(hash, &desc->cs);
+
+    hash = vkd3d_hash_shader_bytecode(hash, &desc->vs);
+    hash = vkd3d_hash_shader_bytecode(hash, &desc->hs);
+    hash = vkd3d_hash_shader_bytecode(hash, &desc->ds);
+    hash = vkd3d_hash_shader_bytecode(hash, &desc->gs);
+    hash = vkd3d_hash_shader_bytecode(hash, &desc->ps);
+
+    hash = vkd3d_hash_fnv1a_u32(hash, so_desc->NumEntries);
+    for (i = 0; i < so_desc->NumEntries; ++i)
     {
-        WARN("Failed to create Vulkan compute pipeline, hr %#x.\n", hr);
-        return hr;
+        const D3D12_SO_DECLARATION_ENTRY *e = &so_desc->pSODeclaration[i];
+
+        hash = vkd3d_hash_fnv1a_u32(hash, e->Stream);
+        hash = vkd3d_hash_fnv1a_string(hash, e->SemanticName);
+        hash = vkd3d_hash_fnv1a_u32(hash, e->SemanticIndex);
+        hash = vkd3d_hash_fnv1a_u32(hash, e->StartComponent);
+        hash = vkd3d_hash_fnv1a_u32(hash, e->ComponentCount);
+        hash = vkd3d_hash_fnv1a_u32(hash, e->OutputSlot);
     }
+    hash = vkd3d_hash_fnv1a_u32(hash, so_desc->NumStrides);
+    hash = vkd3d_hash_fnv1a_data(hash, so_desc->pBufferStrides, so_desc->NumStrides * sizeof(*so_desc->pBufferStrides));
+    hash = vkd3d_hash_fnv1a_u32(hash, so_desc->RasterizedStream);
 
-    if (FAILED(hr = vkd3d_private_store_init(&state->private_store)))
+    hash = vkd3d_hash_fnv1a_u32(hash, desc->blend_state.AlphaToCoverageEnable);
+    hash = vkd3d_hash_fnv1a_u32(hash, desc->blend_state.IndependentBlendEnable);
+    for (i = 0; i < ARRAY_SIZE(desc->blend_state.RenderTarget); ++i)
     {
-        VK_CALL(vkDestroyPipeline(device->vk_device, state->compute.vk_pipeline, NULL));
-        return hr;
+        const D3D12_RENDER_TARGET_BLEND_DESC *rt = &desc->blend_state.RenderTarget[i];
+
+        hash = vkd3d_hash_fnv1a_u32(hash, rt->BlendEnable);
+        hash = vkd3d_hash_fnv1a_u32(hash, rt->LogicOpEnable);
+        hash = vkd3d_hash_fnv1a_u32(hash, rt->SrcBlend);
+        hash = vkd3d_hash_fnv1a_u32(hash, rt->DestBlend);
+        hash = vkd3d_hash_fnv1a_u32(hash, rt->BlendOp);
+        hash = vkd3d_hash_fnv1a_u32(hash, rt->SrcBlendAlpha);
+        hash = vkd3d_hash_fnv1a_u32(hash, rt->DestBlendAlpha);
+        hash = vkd3d_hash_fnv1a_u32(hash, rt->BlendOpAlpha);
+        hash = vkd3d_hash_fnv1a_u32(hash, rt->LogicOp);
+        hash = vkd3d_hash_fnv1a_u32(hash, rt->RenderTargetWriteMask);
     }
+    hash = vkd3d_hash_fnv1a_u32(hash, desc->sample_mask);
+    hash = vkd3d_hash_fnv1a_data(hash, &desc->rasterizer_state, sizeof(desc->rasterizer_state));
+
+    hash = vkd3d_hash_fnv1a_u32(hash, ds_desc->DepthEnable);
+    hash = vkd3d_hash_fnv1a_u32(hash, ds_desc->DepthWriteMask);
+    hash = vkd3d_hash_fnv1a_u32(hash, ds_desc->DepthFunc);
+    hash = vkd3d_hash_fnv1a_u32(hash, ds_desc->StencilEnable);
+    hash = vkd3d_hash_fnv1a_u32(hash, ds_desc->StencilReadMask);
+    hash = vkd3d_hash_fnv1a_u32(hash, ds_desc->StencilWriteMask);
+    hash = vkd3d_hash_stencil_op_desc(hash, &ds_desc->FrontFace);
+    hash = vkd3d_hash_stencil_op_desc(hash, &ds_desc->BackFace);
+    hash = vkd3d_hash_fnv1a_u32(hash, ds_desc->DepthBoundsTestEnable);
+
+    hash = vkd3d_hash_fnv1a_u32(hash, desc->input_layout.NumElements);
+    for (i = 0; i < desc->input_layout.NumElements; ++i)
+    {
+        const D3D12_INPUT_ELEMENT_DESC *e = &desc->input_layout.pInputElementDescs[i];
 
-    state->vk_bind_point = VK_PIPELINE_BIND_POINT_COMPUTE;
-    d3d12_device_add_ref(state->device = device);
+        hash = vkd3d_hash_fnv1a_string(hash, e->SemanticName);
+        hash = vkd3d_hash_fnv1a_u32(hash, e->SemanticIndex);
+        hash = vkd3d_hash_fnv1a_u32(hash, e->Format);
+        hash = vkd3d_hash_fnv1a_u32(hash, e->InputSlot);
+        hash = vkd3d_hash_fnv1a_u32(hash, e->AlignedByteOffset);
+        hash = vkd3d_hash_fnv1a_u32(hash, e->InputSlotClass);
+        hash = vkd3d_hash_fnv1a_u32(hash, e->InstanceDataStepRate);
+    }
 
-    return S_OK;
+    hash = vkd3d_hash_fnv1a_u32(hash, desc->strip_cut_value);
+    hash = vkd3d_hash_fnv1a_u32(hash, desc->primitive_topology_type);
+    hash = vkd3d_hash_fnv1a_data(hash, &desc->rtv_formats, sizeof(desc->rtv_formats));
+    hash = vkd3d_hash_fnv1a_u32(hash, desc->dsv_format);
+    hash = vkd3d_hash_fnv1a_data(hash, &desc->sample_desc, sizeof(desc->sample_desc));
+    hash = vkd3d_hash_fnv1a_u32(hash, desc->view_instancing_desc.ViewInstanceCount);
+    hash = vkd3d_hash_fnv1a_data(hash, desc->view_instancing_desc.pViewInstanceLocations,
+            desc->view_instancing_desc.ViewInstanceCount * sizeof(*desc->view_instancing_desc.pViewInstanceLocations));
+    hash = vkd3d_hash_fnv1a_u32(hash, desc->view_instancing_desc.Flags);
+
+    return hash;
 }
 
-static enum VkPolygonMode vk_polygon_mode_from_d3d12(D3D12_FILL_MODE mode)
+static HRESULT vkd3d_pipeline_blob_parse(struct vkd3d_pipeline_blob *blob, const struct d3d12_device *device,
+        const void *data, size_t data_size, uint64_t desc_hash)
 {
-    switch (mode)
+    struct vkd3d_pipeline_blob_header header;
+    struct vkd3d_pipeline_blob_chunk chunk;
+    const uint8_t *ptr, *end;
+    HRESULT hr;
+
+    memset(blob, 0, sizeof(*blob));
+
+    if (data_size < sizeof(header))
     {
-        case D3D12_FILL_MODE_WIREFRAME:
-            return VK_POLYGON_MODE_LINE;
-        case D3D12_FILL_MODE_SOLID:
-            return VK_POLYGON_MODE_FILL;
-        default:
-            FIXME("Unhandled fill mode %#x.\n", mode);
-            return VK_POLYGON_MODE_FILL;
+        WARN("Invalid pipeline blob size %zu.\n", data_size);
+        return E_INVALIDARG;
     }
-}
 
-static enum VkCullModeFlagBits vk_cull_mode_from_d3d12(D3D12_CULL_MODE mode)
-{
-    switch (mode)
+    memcpy(&header, data, sizeof(header));
+    if (header.magic != VKD3D_PIPELINE_BLOB_MAGIC)
     {
-        case D3D12_CULL_MODE_NONE:
-            return VK_CULL_MODE_NONE;
-        case D3D12_CULL_MODE_FRONT:
-            return VK_CULL_MODE_FRONT_BIT;
+        WARN("Invalid pipeline blob magic %#x.\n", header.magic);
+        return E_INVALIDARG;
+    }
+    if (header.version != VKD3D_PIPELINE_BLOB_VERSION)
+    {
+        WARN("Pipeline blob version %u does not match version %u.\n", header.version, VKD3D_PIPELINE_BLOB_VERSION);
+        return D3D12_ERROR_DRIVER_VERSION_MISMATCH;
+    }
+    if (FAILED(hr = vkd3d_pipeline_blob_check_device_info(&header.device_info, device)))
+        return hr;
+    if (header.desc_hash != desc_hash)
+    {
+        WARN("Pipeline description does not match the pipeline blob.\n");
+        return E_INVALIDARG;
+    }
+    if (header.data_size != data_size - sizeof(header))
+    {
+        WARN("Pipeline blob data size %"PRIu64" does not match blob size %zu.\n", header.data_size, data_size);
+        return E_INVALIDARG;
+    }
+
+    ptr = (const uint8_t *)data + sizeof(header);
+    end = ptr + header.data_size;
+
+    while (ptr < end)
+    {
+        if ((size_t)(end - ptr) < sizeof(chunk))
+            goto corrupt;
+        memcpy(&chunk, ptr, sizeof(chunk));
+        ptr += sizeof(chunk);
+
+        if (chunk.size > (size_t)(end - ptr)
+                || align(chunk.size, VKD3D_PIPELINE_BLOB_ALIGNMENT) > (size_t)(end - ptr)
+                || vkd3d_hash_fnv1a_data(VKD3D_HASH_FNV1A_INIT, ptr, chunk.size) != chunk.data_hash)
+            goto corrupt;
+
+        switch (chunk.type)
+        {
+            case VKD3D_PIPELINE_BLOB_CHUNK_TYPE_PIPELINE_CACHE:
+                blob->cache_data = ptr;
+                blob->cache_data_size = chunk.size;
+                break;
+
+            case VKD3D_PIPELINE_BLOB_CHUNK_TYPE_SPIRV:
+                if (blob->spirv_count == ARRAY_SIZE(blob->spirv))
+                    goto corrupt;
+                blob->spirv[blob->spirv_count].stage = chunk.stage;
+                blob->spirv[blob->spirv_count].code.code = ptr;
+                blob->spirv[blob->spirv_count].code.size = chunk.size;
+                ++blob->spirv_count;
+                break;
+
+            default:
+                WARN("Ignoring unknown pipeline blob chunk type %#x.\n", chunk.type);
+                break;
+        }
+
+        ptr += align(chunk.size, VKD3D_PIPELINE_BLOB_ALIGNMENT);
+    }
+
+    return S_OK;
+
+corrupt:
+    WARN("Corrupt pipeline blob.\n");
+    return E_INVALIDARG;
+}
+
+static const struct vkd3d_shader_code *vkd3d_pipeline_blob_find_spirv(const struct vkd3d_pipeline_blob *blob,
+        VkShaderStageFlagBits stage)
+{
+    unsigned int i;
+
+    if (!blob)
+        return NULL;
+
+    for (i = 0; i < blob->spirv_count; ++i)
+    {
+        if (blob->spirv[i].stage == stage)
+            return &blob->spirv[i].code;
+    }
+
+    return NULL;
+}
+
+static uint8_t *vkd3d_pipeline_blob_write_chunk(uint8_t *ptr, enum vkd3d_pipeline_blob_chunk_type type,
+        VkShaderStageFlagBits stage, const void *data, size_t size)
+{
+    struct vkd3d_pipeline_blob_chunk chunk;
+
+    chunk.type = type;
+    chunk.stage = stage;
+    chunk.size = size;
+    chunk.data_hash = vkd3d_hash_fnv1a_data(VKD3D_HASH_FNV1A_INIT, data, size);
+    memcpy(ptr, &chunk, sizeof(chunk));
+    ptr += sizeof(chunk);
+
+    if (data != ptr)
+        memcpy(ptr, data, size);
+    memset(ptr + size, 0, align(size, VKD3D_PIPELINE_BLOB_ALIGNMENT) - size);
+    return ptr + align(size, VKD3D_PIPELINE_BLOB_ALIGNMENT);
+}
+
+/* Returns the SPIR-V of the module, either its own copy or the record in the
+ * shader cache. */
+static bool vkd3d_shader_module_get_spirv(const struct vkd3d_shader_module *module,
+        struct d3d12_device *device, struct vkd3d_shader_code *spirv)
+{
+    if (module->spirv.code)
+    {
+        *spirv = module->spirv;
+        return true;
+    }
+
+    return vkd3d_shader_cache_find(&device->shader_cache, &module->key, spirv);
+}
+
+static bool d3d12_pipeline_state_get_spirv(const struct d3d12_pipeline_state *state,
+        VkShaderStageFlagBits *stages, struct vkd3d_shader_code *code, unsigned int *stage_count)
+{
+    const struct d3d12_graphics_pipeline_state *graphics = &state->graphics;
+    unsigned int i;
+
+    if (d3d12_pipeline_state_is_compute(state))
+    {
+        stages[0] = VK_SHADER_STAGE_COMPUTE_BIT;
+        *stage_count = 1;
+        return vkd3d_shader_module_get_spirv(state->compute.module, state->device, &code[0]);
+    }
+
+    for (i = 0; i < graphics->stage_count; ++i)
+    {
+        stages[i] = graphics->stages[i].stage;
+        if (!vkd3d_shader_module_get_spirv(graphics->modules[i], state->device, &code[i]))
+            return false;
+    }
+
+    *stage_count = graphics->stage_count;
+    return true;
+}
+
+/* Waits for queued speculative compiles, so that the pipeline cache data
+ * covers them. */
+static void d3d12_pipeline_state_wait_speculative_variants(struct d3d12_pipeline_state *state)
+{
+    struct d3d12_graphics_pipeline_state *graphics = &state->graphics;
+    struct vkd3d_compiled_pipeline *current;
+    unsigned int i;
+    int rc;
+
+    if (!d3d12_pipeline_state_is_graphics(state) || !graphics->has_speculative_pipeline)
+        return;
+
+    if ((rc = pthread_mutex_lock(&graphics->pipeline_mutex)))
+    {
+        ERR("Failed to lock mutex, error %d.\n", rc);
+        return;
+    }
+
+    for (i = 0; i < ARRAY_SIZE(graphics->compiled_pipelines); ++i)
+    {
+        for (current = graphics->compiled_pipelines[i]; current; current = current->next)
+        {
+            while (current->status == VKD3D_COMPILED_PIPELINE_PENDING)
+            {
+                if ((rc = pthread_cond_wait(&graphics->pipeline_cond, &graphics->pipeline_mutex)))
+                {
+                    ERR("Failed to wait on condition variable, error %d.\n", rc);
+                    pthread_mutex_unlock(&graphics->pipeline_mutex);
+                    return;
+                }
+            }
+        }
+    }
+
+    pthread_mutex_unlock(&graphics->pipeline_mutex);
+}
+
+/* Compiles the pipelines of the pipeline state again into an empty Vulkan
+ * pipeline cache, so that the cache data only covers this pipeline state.
+ * Pipelines are found in the driver cache most of the time. */
+static VkPipelineCache d3d12_pipeline_state_create_serialized_cache(struct d3d12_pipeline_state *state)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &state->device->vk_procs;
+    struct d3d12_graphics_pipeline_state *graphics = &state->graphics;
+    struct d3d12_device *device = state->device;
+    struct vkd3d_compiled_pipeline *current;
+    struct vkd3d_pipeline_key *keys = NULL;
+    size_t keys_size = 0, key_count = 0;
+    VkPipelineCacheCreateInfo cache_info;
+    VkRenderPass vk_render_pass;
+    VkPipelineCache vk_cache;
+    VkPipeline vk_pipeline;
+    unsigned int i;
+    VkResult vr;
+
+    cache_info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    cache_info.pNext = NULL;
+    cache_info.flags = 0;
+    cache_info.initialDataSize = 0;
+    cache_info.pInitialData = NULL;
+    if ((vr = VK_CALL(vkCreatePipelineCache(device->vk_device, &cache_info, NULL, &vk_cache))) < 0)
+    {
+        WARN("Failed to create Vulkan pipeline cache, vr %d.\n", vr);
+        return VK_NULL_HANDLE;
+    }
+
+    if (d3d12_pipeline_state_is_compute(state))
+    {
+        if (SUCCEEDED(vkd3d_create_compute_pipeline_from_module(device, state->compute.module,
+                state->compute.vk_pipeline_layout, vk_cache, &vk_pipeline)))
+            VK_CALL(vkDestroyPipeline(device->vk_device, vk_pipeline, NULL));
+        return vk_cache;
+    }
+
+    /* Variants are compiled without holding the lock. */
+    pthread_mutex_lock(&graphics->pipeline_mutex);
+    for (i = 0; i < ARRAY_SIZE(graphics->compiled_pipelines); ++i)
+    {
+        for (current = graphics->compiled_pipelines[i]; current; current = current->next)
+        {
+            if (current->status != VKD3D_COMPILED_PIPELINE_READY
+                    && current->status != VKD3D_COMPILED_PIPELINE_EVICTED)
+                continue;
+            if (!vkd3d_array_reserve((void **)&keys, &keys_size, key_count + 1, sizeof(*keys)))
+                break;
+            keys[key_count++] = current->key;
+        }
+    }
+    pthread_mutex_unlock(&graphics->pipeline_mutex);
+
+    for (i = 0; i < key_count; ++i)
+    {
+        if ((vk_pipeline = d3d12_pipeline_state_create_variant(state, &keys[i], vk_cache, &vk_render_pass)))
+            VK_CALL(vkDestroyPipeline(device->vk_device, vk_pipeline, NULL));
+    }
+    vkd3d_free(keys);
+
+    return vk_cache;
+}
+
+/* Serializes the pipeline state into a newly allocated pipeline blob. */
+static HRESULT d3d12_pipeline_state_serialize(struct d3d12_pipeline_state *state, void **blob, size_t *blob_size)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &state->device->vk_procs;
+    VkShaderStageFlagBits stages[VKD3D_MAX_SHADER_STAGES];
+    struct vkd3d_shader_code spirv[VKD3D_MAX_SHADER_STAGES];
+    struct vkd3d_pipeline_blob_header header;
+    size_t cache_data_size = 0, size;
+    void *cache_data = NULL;
+    VkPipelineCache vk_cache;
+    unsigned int stage_count, i;
+    uint8_t *data, *ptr;
+    VkResult vr;
+
+    if (!d3d12_pipeline_state_get_spirv(state, stages, spirv, &stage_count))
+    {
+        ERR("Failed to get SPIR-V for pipeline state %p.\n", state);
+        return E_FAIL;
+    }
+
+    d3d12_pipeline_state_wait_speculative_variants(state);
+
+    if ((vk_cache = d3d12_pipeline_state_create_serialized_cache(state)))
+    {
+        if ((vr = VK_CALL(vkGetPipelineCacheData(state->device->vk_device, vk_cache, &cache_data_size, NULL))) >= 0
+                && cache_data_size && (cache_data = vkd3d_malloc(cache_data_size)))
+        {
+            vr = VK_CALL(vkGetPipelineCacheData(state->device->vk_device, vk_cache, &cache_data_size, cache_data));
+        }
+        if (vr < 0 || !cache_data)
+        {
+            if (vr < 0)
+                WARN("Failed to get pipeline cache data, vr %d.\n", vr);
+            cache_data_size = 0;
+        }
+        VK_CALL(vkDestroyPipelineCache(state->device->vk_device, vk_cache, NULL));
+    }
+
+    size = sizeof(header);
+    if (cache_data_size)
+        size += sizeof(struct vkd3d_pipeline_blob_chunk) + align(cache_data_size, VKD3D_PIPELINE_BLOB_ALIGNMENT);
+    for (i = 0; i < stage_count; ++i)
+        size += sizeof(struct vkd3d_pipeline_blob_chunk) + align(spirv[i].size, VKD3D_PIPELINE_BLOB_ALIGNMENT);
+
+    if (!(data = vkd3d_malloc(size)))
+    {
+        vkd3d_free(cache_data);
+        return E_OUTOFMEMORY;
+    }
+
+    ptr = data + sizeof(header);
+    for (i = 0; i < stage_count; ++i)
+    {
+        ptr = vkd3d_pipeline_blob_write_chunk(ptr, VKD3D_PIPELINE_BLOB_CHUNK_TYPE_SPIRV,
+                stages[i], spirv[i].code, spirv[i].size);
+    }
+
+    if (cache_data_size)
+    {
+        ptr = vkd3d_pipeline_blob_write_chunk(ptr, VKD3D_PIPELINE_BLOB_CHUNK_TYPE_PIPELINE_CACHE,
+                0, cache_data, cache_data_size);
+    }
+    vkd3d_free(cache_data);
+
+    memset(&header, 0, sizeof(header));
+    header.magic = VKD3D_PIPELINE_BLOB_MAGIC;
+    header.version = VKD3D_PIPELINE_BLOB_VERSION;
+    vkd3d_pipeline_blob_init_device_info(&header.device_info, state->device);
+    header.desc_hash = state->desc_hash;
+    header.data_size = ptr - (data + sizeof(header));
+    memcpy(data, &header, sizeof(header));
+
+    *blob = data;
+    *blob_size = ptr - data;
+    return S_OK;
+}
+
+static void d3d12_pipeline_state_init_pipeline_cache(struct d3d12_pipeline_state *state,
+        struct d3d12_device *device, const struct vkd3d_pipeline_blob *cached_blob)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    VkPipelineCacheCreateInfo cache_info;
+    VkResult vr;
+
+    state->vk_pso_cache = VK_NULL_HANDLE;
+
+    /* Pipelines go to the device cache unless the blob has data to seed a
+     * cache with. The device cache cannot be merged into while other threads
+     * compile pipelines. */
+    if (!cached_blob || !cached_blob->cache_data_size)
+        return;
+
+    cache_info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    cache_info.pNext = NULL;
+    cache_info.flags = 0;
+    cache_info.initialDataSize = cached_blob->cache_data_size;
+    cache_info.pInitialData = cached_blob->cache_data;
+    if ((vr = VK_CALL(vkCreatePipelineCache(device->vk_device, &cache_info, NULL, &state->vk_pso_cache))) < 0)
+    {
+        WARN("Failed to create Vulkan pipeline cache from pipeline blob, vr %d.\n", vr);
+        state->vk_pso_cache = VK_NULL_HANDLE;
+    }
+}
+
+static VkPipelineCache d3d12_pipeline_state_get_pipeline_cache(const struct d3d12_pipeline_state *state,
+        const struct d3d12_device *device)
+{
+    return state->vk_pso_cache ? state->vk_pso_cache : device->vk_pipeline_cache;
+}
+
+static HRESULT vkd3d_shader_code_copy(struct vkd3d_shader_code *dst, const struct vkd3d_shader_code *src)
+{
+    void *code;
+
+    if (!(code = vkd3d_malloc(src->size)))
+        return E_OUTOFMEMORY;
+    memcpy(code, src->code, src->size);
+
+    dst->code = code;
+    dst->size = src->size;
+    return S_OK;
+}
+
+/* vkd3d_shader_module_cache */
+static int vkd3d_shader_module_cache_compare_key(const void *key, const struct rb_entry *entry)
+{
+    const struct vkd3d_shader_module *e = RB_ENTRY_VALUE(entry, const struct vkd3d_shader_module, entry);
+    const struct vkd3d_shader_cache_key *k = key;
+
+    if (k->dxbc_hash != e->key.dxbc_hash)
+        return k->dxbc_hash < e->key.dxbc_hash ? -1 : 1;
+    if (k->args_hash != e->key.args_hash)
+        return k->args_hash < e->key.args_hash ? -1 : 1;
+    return 0;
+}
+
+HRESULT vkd3d_shader_module_cache_init(struct vkd3d_shader_module_cache *cache)
+{
+    int rc;
+
+    rb_init(&cache->tree, vkd3d_shader_module_cache_compare_key);
+
+    if ((rc = pthread_mutex_init(&cache->mutex, NULL)))
+    {
+        ERR("Failed to initialize mutex, error %d.\n", rc);
+        return hresult_from_errno(rc);
+    }
+
+    return S_OK;
+}
+
+void vkd3d_shader_module_cache_cleanup(struct vkd3d_shader_module_cache *cache)
+{
+    /* Every pipeline state releases its modules on destruction. */
+    assert(!cache->tree.root);
+    pthread_mutex_destroy(&cache->mutex);
+}
+
+static struct vkd3d_shader_module *vkd3d_shader_module_cache_find(struct vkd3d_shader_module_cache *cache,
+        const struct vkd3d_shader_cache_key *key)
+{
+    struct vkd3d_shader_module *module = NULL;
+    struct rb_entry *entry;
+
+    pthread_mutex_lock(&cache->mutex);
+    if ((entry = rb_get(&cache->tree, key)))
+    {
+        module = RB_ENTRY_VALUE(entry, struct vkd3d_shader_module, entry);
+        InterlockedIncrement(&module->refcount);
+    }
+    pthread_mutex_unlock(&cache->mutex);
+
+    return module;
+}
+
+static void vkd3d_shader_module_destroy(struct vkd3d_shader_module *module, struct d3d12_device *device)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+
+    VK_CALL(vkDestroyShaderModule(device->vk_device, module->vk_module, NULL));
+    vkd3d_shader_free_shader_code(&module->spirv);
+    vkd3d_free(module);
+}
+
+void vkd3d_shader_module_release(struct vkd3d_shader_module *module, struct d3d12_device *device)
+{
+    struct vkd3d_shader_module_cache *cache = &device->shader_module_cache;
+    LONG refcount;
+
+    /* Lookups take their reference with the lock held. */
+    if (module->cached)
+    {
+        pthread_mutex_lock(&cache->mutex);
+        if (!(refcount = InterlockedDecrement(&module->refcount)))
+            rb_remove(&cache->tree, &module->entry);
+        pthread_mutex_unlock(&cache->mutex);
+    }
+    else
+    {
+        refcount = InterlockedDecrement(&module->refcount);
+    }
+
+    if (!refcount)
+        vkd3d_shader_module_destroy(module, device);
+}
+
+/* Returns the module to use, which is "module" unless another thread
+ * inserted the same one first. */
+static struct vkd3d_shader_module *vkd3d_shader_module_cache_insert(struct vkd3d_shader_module_cache *cache,
+        struct vkd3d_shader_module *module, struct d3d12_device *device)
+{
+    struct vkd3d_shader_module *existing = NULL;
+    struct rb_entry *entry;
+
+    pthread_mutex_lock(&cache->mutex);
+    if ((entry = rb_get(&cache->tree, &module->key)))
+    {
+        existing = RB_ENTRY_VALUE(entry, struct vkd3d_shader_module, entry);
+        InterlockedIncrement(&existing->refcount);
+    }
+    else
+    {
+        rb_put(&cache->tree, &module->key, &module->entry);
+        module->cached = true;
+    }
+    pthread_mutex_unlock(&cache->mutex);
+
+    if (!existing)
+        return module;
+
+    vkd3d_shader_module_destroy(module, device);
+    return existing;
+}
+
+static uint32_t vkd3d_shader_compiler_options(const struct d3d12_device *device)
+{
+    if (device->vkd3d_instance->config_flags & VKD3D_CONFIG_FLAG_OPTIMIZE_SHADERS)
+        return VKD3D_SHADER_OPTIMIZE;
+    return 0;
+}
+
+/* Translates the DXBC, unless "cached_spirv" is not NULL, and creates the
+ * Vulkan shader module. The SPIR-V is only kept in the module if the shader
+ * cache cannot provide it when the pipeline state is serialized. */
+static HRESULT vkd3d_shader_module_create(struct d3d12_device *device, const struct vkd3d_shader_code *dxbc,
+        const struct vkd3d_shader_interface_info *shader_interface,
+        const struct vkd3d_shader_compile_arguments *compile_args, const struct vkd3d_shader_code *cached_spirv,
+        const struct vkd3d_shader_cache_key *key, struct vkd3d_shader_module **module)
+{
+    struct vkd3d_pipeline_stats *stats = &device->pipeline_stats;
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    struct vkd3d_shader_interface_info timed_shader_interface;
+    struct vkd3d_shader_compile_timing_info timing_info;
+    struct vkd3d_shader_cache *cache = &device->shader_cache;
+    uint64_t parse_time = 0, emit_time = 0, start_time;
+    struct VkShaderModuleCreateInfo shader_desc;
+    struct vkd3d_shader_code spirv = {0};
+    struct vkd3d_shader_code cached_code;
+    struct vkd3d_shader_module *object;
+    bool in_shader_cache = false;
+    VkResult vr;
+    HRESULT hr;
+    int ret;
+
+    if (!(object = vkd3d_calloc(1, sizeof(*object))))
+        return E_OUTOFMEMORY;
+
+    object->refcount = 1;
+    if (key)
+        object->key = *key;
+
+    if (cached_spirv)
+    {
+        TRACE("Using SPIR-V from pipeline blob.\n");
+        if (key && cache->enabled)
+            vkd3d_shader_cache_put(cache, key, cached_spirv);
+        cached_code = *cached_spirv;
+    }
+    else if (key && cache->enabled && vkd3d_shader_cache_find(cache, key, &cached_code))
+    {
+        in_shader_cache = true;
+    }
+    else
+    {
+        timed_shader_interface = *shader_interface;
+        timed_shader_interface.next = &timing_info;
+        timing_info.type = VKD3D_SHADER_STRUCTURE_TYPE_COMPILE_TIMING_INFO;
+        timing_info.next = shader_interface->next;
+        timing_info.parse_time_ns = &parse_time;
+        timing_info.emit_time_ns = &emit_time;
+        timing_info.scan_time_ns = NULL;
+
+        start_time = vkd3d_get_current_time_ns();
+        if ((ret = vkd3d_shader_compile_dxbc(dxbc, &spirv,
+                vkd3d_shader_compiler_options(device), &timed_shader_interface, compile_args)) < 0)
+        {
+            WARN("Failed to compile shader, vkd3d result %d.\n", ret);
+            hr = hresult_from_vkd3d_result(ret);
+            goto fail;
+        }
+
+        /* The DXIL front-end does not report a breakdown. */
+        if (!parse_time && !emit_time)
+            emit_time = vkd3d_get_current_time_ns() - start_time;
+        vkd3d_pipeline_stats_add_timing(stats, VKD3D_PIPELINE_TIMING_DXBC_PARSE, parse_time);
+        vkd3d_pipeline_stats_add_timing(stats, VKD3D_PIPELINE_TIMING_SPIRV_EMIT, emit_time);
+
+        if (key && cache->enabled)
+            vkd3d_shader_cache_put(cache, key, &spirv);
+        cached_code = spirv;
+    }
+
+    /* Records put into the shader cache stay there until the device is
+     * destroyed, so the module does not need a copy of its own. */
+    if (!in_shader_cache && key && cache->enabled)
+        in_shader_cache = vkd3d_shader_cache_find(cache, key, &cached_code);
+
+    if (!in_shader_cache)
+    {
+        if (spirv.code)
+            object->spirv = spirv;
+        else if (FAILED(hr = vkd3d_shader_code_copy(&object->spirv, &cached_code)))
+            goto fail;
+        cached_code = object->spirv;
+    }
+    else
+    {
+        vkd3d_shader_free_shader_code(&spirv);
+    }
+    object->spirv_size = cached_code.size;
+
+    shader_desc.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    shader_desc.pNext = NULL;
+    shader_desc.flags = 0;
+    shader_desc.codeSize = cached_code.size;
+    shader_desc.pCode = cached_code.code;
+
+    start_time = vkd3d_get_current_time_ns();
+    vr = VK_CALL(vkCreateShaderModule(device->vk_device, &shader_desc, NULL, &object->vk_module));
+    vkd3d_pipeline_stats_add_timing(stats, VKD3D_PIPELINE_TIMING_SHADER_MODULE_CREATE,
+            vkd3d_get_current_time_ns() - start_time);
+    if (vr < 0)
+    {
+        WARN("Failed to create Vulkan shader module, vr %d.\n", vr);
+        hr = hresult_from_vk_result(vr);
+        goto fail;
+    }
+
+    *module = object;
+    return S_OK;
+
+fail:
+    vkd3d_shader_free_shader_code(&object->spirv);
+    vkd3d_free(object);
+    return hr;
+}
+
+/* Returns a reference to the shader module in "module", to be released with
+ * vkd3d_shader_module_release(). If "cached_spirv" is not NULL, it is used
+ * instead of compiling the DXBC. */
+static HRESULT create_shader_stage(struct d3d12_device *device,
+        struct VkPipelineShaderStageCreateInfo *stage_desc, enum VkShaderStageFlagBits stage,
+        const D3D12_SHADER_BYTECODE *code, const struct vkd3d_shader_interface_info *shader_interface,
+        const struct vkd3d_shader_compile_arguments *compile_args, const struct vkd3d_shader_code *cached_spirv,
+        struct vkd3d_shader_module **module)
+{
+    struct vkd3d_shader_module_cache *cache = &device->shader_module_cache;
+    struct vkd3d_shader_code dxbc = {code->pShaderBytecode, code->BytecodeLength};
+    struct vkd3d_shader_cache_key cache_key;
+    bool use_cache;
+    HRESULT hr;
+
+    stage_desc->sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    stage_desc->pNext = NULL;
+    stage_desc->flags = 0;
+    stage_desc->stage = stage;
+    stage_desc->module = VK_NULL_HANDLE;
+    stage_desc->pName = "main";
+    stage_desc->pSpecializationInfo = NULL;
+
+    use_cache = vkd3d_shader_cache_key_init(&cache_key, &dxbc,
+            vkd3d_shader_compiler_options(device), shader_interface, compile_args);
+
+    if (use_cache && (*module = vkd3d_shader_module_cache_find(cache, &cache_key)))
+    {
+        TRACE("Reusing shader module %p.\n", *module);
+    }
+    else
+    {
+        if (FAILED(hr = vkd3d_shader_module_create(device, &dxbc, shader_interface, compile_args,
+                cached_spirv, use_cache ? &cache_key : NULL, module)))
+        {
+            *module = NULL;
+            return hr;
+        }
+
+        if (use_cache)
+            *module = vkd3d_shader_module_cache_insert(cache, *module, device);
+    }
+
+    stage_desc->module = (*module)->vk_module;
+    return S_OK;
+}
+
+struct vkd3d_shader_stage_task
+{
+    struct d3d12_device *device;
+    VkPipelineShaderStageCreateInfo *stage_desc;
+    VkShaderStageFlagBits stage;
+    const D3D12_SHADER_BYTECODE *code;
+    struct vkd3d_shader_interface_info shader_interface;
+    const struct vkd3d_shader_compile_arguments *compile_args;
+    const struct vkd3d_shader_code *cached_spirv;
+    struct vkd3d_shader_module **module;
+    HRESULT hr;
+};
+
+static void create_shader_stage_task(void *userdata)
+{
+    struct vkd3d_shader_stage_task *task = userdata;
+
+    task->hr = create_shader_stage(task->device, task->stage_desc, task->stage, task->code,
+            &task->shader_interface, task->compile_args, task->cached_spirv, task->module);
+}
+
+static HRESULT vkd3d_create_compute_pipeline_from_module(struct d3d12_device *device,
+        const struct vkd3d_shader_module *module, VkPipelineLayout vk_pipeline_layout,
+        VkPipelineCache vk_cache, VkPipeline *vk_pipeline)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    VkComputePipelineCreateInfo pipeline_info;
+    uint64_t start_time;
+    VkResult vr;
+
+    pipeline_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipeline_info.pNext = NULL;
+    pipeline_info.flags = 0;
+    pipeline_info.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipeline_info.stage.pNext = NULL;
+    pipeline_info.stage.flags = 0;
+    pipeline_info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipeline_info.stage.module = module->vk_module;
+    pipeline_info.stage.pName = "main";
+    pipeline_info.stage.pSpecializationInfo = NULL;
+    pipeline_info.layout = vk_pipeline_layout;
+    pipeline_info.basePipelineHandle = VK_NULL_HANDLE;
+    pipeline_info.basePipelineIndex = -1;
+
+    start_time = vkd3d_get_current_time_ns();
+    vr = VK_CALL(vkCreateComputePipelines(device->vk_device,
+            vk_cache, 1, &pipeline_info, NULL, vk_pipeline));
+    vkd3d_pipeline_stats_add_timing(&device->pipeline_stats, VKD3D_PIPELINE_TIMING_PIPELINE_CREATE,
+            vkd3d_get_current_time_ns() - start_time);
+    if (vr < 0)
+    {
+        WARN("Failed to create Vulkan compute pipeline, vr %d.\n", vr);
+        return hresult_from_vk_result(vr);
+    }
+
+    return S_OK;
+}
+
+static HRESULT vkd3d_create_compute_pipeline(struct d3d12_device *device,
+        const D3D12_SHADER_BYTECODE *code, const struct vkd3d_shader_interface_info *shader_interface,
+        VkPipelineLayout vk_pipeline_layout, VkPipelineCache vk_cache, const struct vkd3d_shader_code *cached_spirv,
+        VkPipeline *vk_pipeline, struct vkd3d_shader_module **module)
+{
+    VkPipelineShaderStageCreateInfo stage_desc;
+    HRESULT hr;
+
+    if (FAILED(hr = create_shader_stage(device, &stage_desc,
+            VK_SHADER_STAGE_COMPUTE_BIT, code, shader_interface, NULL, cached_spirv, module)))
+        return hr;
+
+    if (FAILED(hr = vkd3d_create_compute_pipeline_from_module(device, *module,
+            vk_pipeline_layout, vk_cache, vk_pipeline)))
+    {
+        vkd3d_shader_module_release(*module, device);
+        *module = NULL;
+        return hr;
+    }
+
+    return S_OK;
+}
+
+static HRESULT d3d12_pipeline_state_init_compute(struct d3d12_pipeline_state *state,
+        struct d3d12_device *device, const struct d3d12_pipeline_state_desc *desc,
+        const struct vkd3d_pipeline_blob *cached_blob)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    struct vkd3d_shader_interface_info shader_interface;
+    const struct vkd3d_shader_code *cached_spirv = NULL;
+    const struct d3d12_root_signature *root_signature;
+    HRESULT hr;
+
+    state->ID3D12PipelineState_iface.lpVtbl = &d3d12_pipeline_state_vtbl;
+    state->refcount = 1;
+
+    if (!(root_signature = unsafe_impl_from_ID3D12RootSignature(desc->root_signature)))
+    {
+        WARN("Root signature is NULL.\n");
+        return E_INVALIDARG;
+    }
+
+    if (cached_blob && !(cached_spirv = vkd3d_pipeline_blob_find_spirv(cached_blob, VK_SHADER_STAGE_COMPUTE_BIT)))
+    {
+        WARN("Pipeline blob does not contain compute shader SPIR-V.\n");
+        return E_INVALIDARG;
+    }
+
+    shader_interface.type = VKD3D_SHADER_STRUCTURE_TYPE_SHADER_INTERFACE_INFO;
+    shader_interface.next = NULL;
+    shader_interface.flags = d3d12_root_signature_get_shader_interface_flags(root_signature);
+    shader_interface.descriptor_tables.offset = root_signature->descriptor_table_offset;
+    shader_interface.descriptor_tables.count = root_signature->descriptor_table_count;
+    shader_interface.bindings = root_signature->bindings;
+    shader_interface.binding_count = root_signature->binding_count;
+    shader_interface.push_constant_buffers = root_signature->root_constants;
+    shader_interface.push_constant_buffer_count = root_signature->root_constant_count;
+    shader_interface.push_constant_ubo_binding = &root_signature->push_constant_ubo_binding;
+
+    if (FAILED(hr = vkd3d_create_compute_pipeline(device, &desc->cs, &shader_interface,
+            root_signature->vk_pipeline_layout, d3d12_pipeline_state_get_pipeline_cache(state, device),
+            cached_spirv, &state->compute.vk_pipeline, &state->compute.module)))
+    {
+        WARN("Failed to create Vulkan compute pipeline, hr %#x.\n", hr);
+        return hr;
+    }
+
+    if (FAILED(hr = vkd3d_private_store_init(&state->private_store)))
+    {
+        VK_CALL(vkDestroyPipeline(device->vk_device, state->compute.vk_pipeline, NULL));
+        vkd3d_shader_module_release(state->compute.module, device);
+        return hr;
+    }
+
+    state->compute.vk_pipeline_layout = root_signature->vk_pipeline_layout;
+    state->vk_bind_point = VK_PIPELINE_BIND_POINT_COMPUTE;
+    d3d12_device_add_ref(state->device = device);
+
+    return S_OK;
+}
+
+static enum VkPolygonMode vk_polygon_mode_from_d3d12(D3D12_FILL_MODE mode)
+{
+    switch (mode)
+    {
+        case D3D12_FILL_MODE_WIREFRAME:
+            return VK_POLYGON_MODE_LINE;
+        case D3D12_FILL_MODE_SOLID:
+            return VK_POLYGON_MODE_FILL;
+        default:
+            FIXME("Unhandled fill mode %#x.\n", mode);
+            return VK_POLYGON_MODE_FILL;
+    }
+}
+
+static enum VkCullModeFlagBits vk_cull_mode_from_d3d12(D3D12_CULL_MODE mode)
+{
+    switch (mode)
+    {
+        case D3D12_CULL_MODE_NONE:
+            return VK_CULL_MODE_NONE;
+        case D3D12_CULL_MODE_FRONT:
+            return VK_CULL_MODE_FRONT_BIT;
         case D3D12_CULL_MODE_BACK:
             return VK_CULL_MODE_BACK_BIT;
         default:
@@ -2108,7 +3310,8 @@ static bool vk_blend_attachment_needs_blend_constants(const VkPipelineColorBlend
             vk_blend_factor_needs_blend_constants(attachment->dstAlphaBlendFactor));
 }
 
-static void d3d12_graphics_pipeline_state_init_dynamic_state(struct d3d12_graphics_pipeline_state *graphics)
+static void d3d12_graphics_pipeline_state_init_dynamic_state(struct d3d12_graphics_pipeline_state *graphics,
+        struct d3d12_device *device)
 {
     VkPipelineDynamicStateCreateInfo *dynamic_desc = &graphics->dynamic_desc;
     unsigned int i, j;
@@ -2120,11 +3323,15 @@ static void d3d12_graphics_pipeline_state_init_dynamic_state(struct d3d12_graphi
     }
     dynamic_state_list[] =
     {
-        { VKD3D_DYNAMIC_STATE_VIEWPORT,           VK_DYNAMIC_STATE_VIEWPORT           },
-        { VKD3D_DYNAMIC_STATE_SCISSOR,            VK_DYNAMIC_STATE_SCISSOR            },
-        { VKD3D_DYNAMIC_STATE_BLEND_CONSTANTS,    VK_DYNAMIC_STATE_BLEND_CONSTANTS    },
-        { VKD3D_DYNAMIC_STATE_STENCIL_REFERENCE,  VK_DYNAMIC_STATE_STENCIL_REFERENCE  },
-        { VKD3D_DYNAMIC_STATE_DEPTH_BOUNDS,       VK_DYNAMIC_STATE_DEPTH_BOUNDS       },
+        { VKD3D_DYNAMIC_STATE_VIEWPORT,             VK_DYNAMIC_STATE_VIEWPORT                         },
+        { VKD3D_DYNAMIC_STATE_SCISSOR,              VK_DYNAMIC_STATE_SCISSOR                          },
+        { VKD3D_DYNAMIC_STATE_BLEND_CONSTANTS,      VK_DYNAMIC_STATE_BLEND_CONSTANTS                  },
+        { VKD3D_DYNAMIC_STATE_STENCIL_REFERENCE,    VK_DYNAMIC_STATE_STENCIL_REFERENCE                },
+        { VKD3D_DYNAMIC_STATE_DEPTH_BOUNDS,         VK_DYNAMIC_STATE_DEPTH_BOUNDS                     },
+        { VKD3D_DYNAMIC_STATE_TOPOLOGY,             VK_DYNAMIC_STATE_PRIMITIVE_TOPOLOGY_EXT           },
+        { VKD3D_DYNAMIC_STATE_VERTEX_BUFFER_STRIDE, VK_DYNAMIC_STATE_VERTEX_INPUT_BINDING_STRIDE_EXT  },
+        { VKD3D_DYNAMIC_STATE_VIEWPORT_COUNT,       VK_DYNAMIC_STATE_VIEWPORT_WITH_COUNT_EXT          },
+        { VKD3D_DYNAMIC_STATE_VIEWPORT_COUNT,       VK_DYNAMIC_STATE_SCISSOR_WITH_COUNT_EXT           },
     };
 
     /* Enable dynamic states as necessary */
@@ -2142,11 +3349,26 @@ static void d3d12_graphics_pipeline_state_init_dynamic_state(struct d3d12_graphi
             graphics->dynamic_state_flags |= VKD3D_DYNAMIC_STATE_BLEND_CONSTANTS;
     }
 
+    /* Keeps states which D3D12 sets on the command list out of the pipeline
+     * key, so that most pipeline states only need a single Vulkan pipeline. */
+    if (device->vk_info.EXT_extended_dynamic_state)
+    {
+        graphics->dynamic_state_flags |= VKD3D_DYNAMIC_STATE_TOPOLOGY |
+                VKD3D_DYNAMIC_STATE_VERTEX_BUFFER_STRIDE | VKD3D_DYNAMIC_STATE_VIEWPORT_COUNT;
+    }
+
     /* Build dynamic state create info */
     for (i = 0, j = 0; i < ARRAY_SIZE(dynamic_state_list); i++)
     {
-        if (graphics->dynamic_state_flags & dynamic_state_list[i].flag)
-            graphics->dynamic_states[j++] = dynamic_state_list[i].vk_state;
+        if (!(graphics->dynamic_state_flags & dynamic_state_list[i].flag))
+            continue;
+
+        /* Viewports and scissors with count replace the plain ones. */
+        if ((graphics->dynamic_state_flags & VKD3D_DYNAMIC_STATE_VIEWPORT_COUNT) &&
+                (dynamic_state_list[i].flag & (VKD3D_DYNAMIC_STATE_VIEWPORT | VKD3D_DYNAMIC_STATE_SCISSOR)))
+            continue;
+
+        graphics->dynamic_states[j++] = dynamic_state_list[i].vk_state;
     }
 
     dynamic_desc->sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
@@ -2157,7 +3379,8 @@ static void d3d12_graphics_pipeline_state_init_dynamic_state(struct d3d12_graphi
 }
 
 static HRESULT d3d12_pipeline_state_init_graphics(struct d3d12_pipeline_state *state,
-        struct d3d12_device *device, const struct d3d12_pipeline_state_desc *desc)
+        struct d3d12_device *device, const struct d3d12_pipeline_state_desc *desc,
+        const struct vkd3d_pipeline_blob *cached_blob)
 {
     const VkPhysicalDeviceFeatures *features = &device->device_info.features2.features;
     unsigned int ps_output_swizzle[D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT];
@@ -2175,6 +3398,10 @@ static HRESULT d3d12_pipeline_state_init_graphics(struct d3d12_pipeline_state *s
     struct vkd3d_shader_interface_info shader_interface;
     const struct d3d12_root_signature *root_signature;
     struct vkd3d_shader_signature input_signature;
+    struct vkd3d_shader_stage_task stage_tasks[VKD3D_MAX_SHADER_STAGES];
+    struct vkd3d_pipeline_task tasks[VKD3D_MAX_SHADER_STAGES];
+    struct vkd3d_shader_stage_task *stage_task;
+    const struct vkd3d_shader_code *cached_spirv;
     bool have_attachment, is_dsv_format_unknown;
     VkShaderStageFlagBits xfb_stage = 0;
     VkSampleCountFlagBits sample_count;
@@ -2453,13 +3680,45 @@ static HRESULT d3d12_pipeline_state_init_graphics(struct d3d12_pipeline_state *s
 
         shader_interface.next = shader_stages[i].stage == xfb_stage ? &xfb_info : NULL;
 
-        if (FAILED(hr = create_shader_stage(device, &graphics->stages[graphics->stage_count],
-                shader_stages[i].stage, b, &shader_interface, compile_args)))
+        cached_spirv = NULL;
+        if (cached_blob && !(cached_spirv = vkd3d_pipeline_blob_find_spirv(cached_blob, shader_stages[i].stage)))
+        {
+            WARN("Pipeline blob does not contain SPIR-V for stage %#x.\n", shader_stages[i].stage);
+            hr = E_INVALIDARG;
             goto fail;
+        }
 
+        /* Stages are translated below, possibly in parallel. Failed stages
+         * are left without a shader module and SPIR-V. */
+        stage_task = &stage_tasks[graphics->stage_count];
+        stage_task->device = device;
+        stage_task->stage_desc = &graphics->stages[graphics->stage_count];
+        stage_task->stage = shader_stages[i].stage;
+        stage_task->code = b;
+        stage_task->shader_interface = shader_interface;
+        stage_task->compile_args = compile_args;
+        stage_task->cached_spirv = cached_spirv;
+        stage_task->module = &graphics->modules[graphics->stage_count];
+        stage_task->hr = S_OK;
+
+        tasks[graphics->stage_count].callback = create_shader_stage_task;
+        tasks[graphics->stage_count].userdata = stage_task;
+
+        graphics->stages[graphics->stage_count].module = VK_NULL_HANDLE;
+        graphics->modules[graphics->stage_count] = NULL;
         ++graphics->stage_count;
     }
 
+    vkd3d_pipeline_compiler_run_tasks(&device->pipeline_compiler, tasks, graphics->stage_count);
+
+    /* Report the first failing stage in pipeline order, regardless of
+     * which stage happened to finish first. */
+    for (i = 0; i < graphics->stage_count; ++i)
+    {
+        if (FAILED(hr = stage_tasks[i].hr))
+            goto fail;
+    }
+
     graphics->attribute_count = desc->input_layout.NumElements;
     if (graphics->attribute_count > ARRAY_SIZE(graphics->attributes))
     {
@@ -2480,6 +3739,7 @@ static HRESULT d3d12_pipeline_state_init_graphics(struct d3d12_pipeline_state *s
         goto fail;
 
     graphics->instance_divisor_count = 0;
+    memset(graphics->min_vertex_strides, 0, sizeof(graphics->min_vertex_strides));
     for (i = 0, j = 0, mask = 0; i < graphics->attribute_count; ++i)
     {
         const D3D12_INPUT_ELEMENT_DESC *e = &desc->input_layout.pInputElementDescs[i];
@@ -2514,6 +3774,8 @@ static HRESULT d3d12_pipeline_state_init_graphics(struct d3d12_pipeline_state *s
             graphics->attributes[j].offset = e->AlignedByteOffset;
         else
             graphics->attributes[j].offset = aligned_offsets[i];
+        graphics->min_vertex_strides[e->InputSlot] = max(graphics->min_vertex_strides[e->InputSlot],
+                graphics->attributes[j].offset + format->byte_count);
         ++j;
 
         switch (e->InputSlotClass)
@@ -2621,14 +3883,34 @@ static HRESULT d3d12_pipeline_state_init_graphics(struct d3d12_pipeline_state *s
             device, 0, &graphics->render_pass, &graphics->dsv_layout)))
         goto fail;
 
-    d3d12_graphics_pipeline_state_init_dynamic_state(graphics);
+    d3d12_graphics_pipeline_state_init_dynamic_state(graphics, device);
 
     graphics->root_signature = root_signature;
 
-    list_init(&graphics->compiled_pipelines);
+    memset(graphics->compiled_pipelines, 0, sizeof(graphics->compiled_pipelines));
+    graphics->has_speculative_pipeline = false;
+
+    if ((ret = pthread_mutex_init(&graphics->pipeline_mutex, NULL)))
+    {
+        ERR("Failed to initialize mutex, error %d.\n", ret);
+        hr = hresult_from_errno(ret);
+        goto fail;
+    }
+
+    if ((ret = pthread_cond_init(&graphics->pipeline_cond, NULL)))
+    {
+        ERR("Failed to initialize condition variable, error %d.\n", ret);
+        pthread_mutex_destroy(&graphics->pipeline_mutex);
+        hr = hresult_from_errno(ret);
+        goto fail;
+    }
 
     if (FAILED(hr = vkd3d_private_store_init(&state->private_store)))
+    {
+        pthread_cond_destroy(&graphics->pipeline_cond);
+        pthread_mutex_destroy(&graphics->pipeline_mutex);
         goto fail;
+    }
 
     state->vk_bind_point = VK_PIPELINE_BIND_POINT_GRAPHICS;
     d3d12_device_add_ref(state->device = device);
@@ -2638,30 +3920,248 @@ static HRESULT d3d12_pipeline_state_init_graphics(struct d3d12_pipeline_state *s
 fail:
     for (i = 0; i < graphics->stage_count; ++i)
     {
-        VK_CALL(vkDestroyShaderModule(device->vk_device, state->graphics.stages[i].module, NULL));
+        if (graphics->modules[i])
+            vkd3d_shader_module_release(graphics->modules[i], device);
     }
     vkd3d_shader_free_shader_signature(&input_signature);
 
     return hr;
 }
 
+static void d3d12_promote_depth_stencil_desc(D3D12_DEPTH_STENCIL_DESC1 *out, const D3D12_DEPTH_STENCIL_DESC *in)
+{
+    out->DepthEnable = in->DepthEnable;
+    out->DepthWriteMask = in->DepthWriteMask;
+    out->DepthFunc = in->DepthFunc;
+    out->StencilEnable = in->StencilEnable;
+    out->StencilReadMask = in->StencilReadMask;
+    out->StencilWriteMask = in->StencilWriteMask;
+    out->FrontFace = in->FrontFace;
+    out->BackFace = in->BackFace;
+    out->DepthBoundsTestEnable = FALSE;
+}
+
+void d3d12_pipeline_state_desc_from_d3d12_graphics_desc(struct d3d12_pipeline_state_desc *desc,
+        const D3D12_GRAPHICS_PIPELINE_STATE_DESC *d3d12_desc)
+{
+    unsigned int i;
+
+    memset(desc, 0, sizeof(*desc));
+    desc->root_signature = d3d12_desc->pRootSignature;
+    desc->vs = d3d12_desc->VS;
+    desc->ps = d3d12_desc->PS;
+    desc->ds = d3d12_desc->DS;
+    desc->hs = d3d12_desc->HS;
+    desc->gs = d3d12_desc->GS;
+    desc->stream_output = d3d12_desc->StreamOutput;
+    desc->blend_state = d3d12_desc->BlendState;
+    desc->sample_mask = d3d12_desc->SampleMask;
+    desc->rasterizer_state = d3d12_desc->RasterizerState;
+    d3d12_promote_depth_stencil_desc(&desc->depth_stencil_state, &d3d12_desc->DepthStencilState);
+    desc->input_layout = d3d12_desc->InputLayout;
+    desc->strip_cut_value = d3d12_desc->IBStripCutValue;
+    desc->primitive_topology_type = d3d12_desc->PrimitiveTopologyType;
+    desc->rtv_formats.NumRenderTargets = d3d12_desc->NumRenderTargets;
+    for (i = 0; i < ARRAY_SIZE(d3d12_desc->RTVFormats); i++)
+        desc->rtv_formats.RTFormats[i] = d3d12_desc->RTVFormats[i];
+    desc->dsv_format = d3d12_desc->DSVFormat;
+    desc->sample_desc = d3d12_desc->SampleDesc;
+    desc->node_mask = d3d12_desc->NodeMask;
+    desc->cached_pso = d3d12_desc->CachedPSO;
+    desc->flags = d3d12_desc->Flags;
+}
+
+void d3d12_pipeline_state_desc_from_d3d12_compute_desc(struct d3d12_pipeline_state_desc *desc,
+        const D3D12_COMPUTE_PIPELINE_STATE_DESC *d3d12_desc)
+{
+    memset(desc, 0, sizeof(*desc));
+    desc->root_signature = d3d12_desc->pRootSignature;
+    desc->cs = d3d12_desc->CS;
+    desc->node_mask = d3d12_desc->NodeMask;
+    desc->cached_pso = d3d12_desc->CachedPSO;
+    desc->flags = d3d12_desc->Flags;
+}
+
+static void d3d12_init_pipeline_state_desc(struct d3d12_pipeline_state_desc *desc)
+{
+    D3D12_DEPTH_STENCIL_DESC1 *ds_state = &desc->depth_stencil_state;
+    D3D12_RASTERIZER_DESC *rs_state = &desc->rasterizer_state;
+    D3D12_BLEND_DESC *blend_state = &desc->blend_state;
+    DXGI_SAMPLE_DESC *sample_desc = &desc->sample_desc;
+
+    memset(desc, 0, sizeof(*desc));
+    ds_state->DepthEnable = TRUE;
+    ds_state->DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ALL;
+    ds_state->DepthFunc = D3D12_COMPARISON_FUNC_LESS;
+    ds_state->StencilReadMask = D3D12_DEFAULT_STENCIL_READ_MASK;
+    ds_state->StencilWriteMask = D3D12_DEFAULT_STENCIL_WRITE_MASK;
+    ds_state->FrontFace.StencilFunc = ds_state->BackFace.StencilFunc = D3D12_COMPARISON_FUNC_ALWAYS;
+    ds_state->FrontFace.StencilDepthFailOp = ds_state->BackFace.StencilDepthFailOp = D3D12_STENCIL_OP_KEEP;
+    ds_state->FrontFace.StencilPassOp = ds_state->BackFace.StencilPassOp = D3D12_STENCIL_OP_KEEP;
+    ds_state->FrontFace.StencilFailOp = ds_state->BackFace.StencilFailOp = D3D12_STENCIL_OP_KEEP;
+
+    rs_state->FillMode = D3D12_FILL_MODE_SOLID;
+    rs_state->CullMode = D3D12_CULL_MODE_BACK;
+    rs_state->DepthClipEnable = TRUE;
+    rs_state->ConservativeRaster = D3D12_CONSERVATIVE_RASTERIZATION_MODE_OFF;
+
+    blend_state->RenderTarget[0].RenderTargetWriteMask = D3D12_COLOR_WRITE_ENABLE_ALL;
+
+    sample_desc->Count = 1;
+    sample_desc->Quality = 0;
+
+    desc->sample_mask = D3D12_DEFAULT_SAMPLE_MASK;
+}
+
+#define VKD3D_HANDLE_SUBOBJECT_EXPLICIT(type_enum, type_name, assignment) \
+    case D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_ ## type_enum: \
+    {\
+        const struct {\
+            D3D12_PIPELINE_STATE_SUBOBJECT_TYPE type; \
+            type_name data; \
+        } *subobject = (void *)stream_ptr; \
+        if (stream_ptr + sizeof(*subobject) > stream_end) \
+        { \
+            ERR("Invalid pipeline state stream.\n"); \
+            return E_INVALIDARG; \
+        } \
+        stream_ptr += align(sizeof(*subobject), sizeof(void*)); \
+        assignment; \
+        break;\
+    }
+
+#define VKD3D_HANDLE_SUBOBJECT(type_enum, type, left_side) \
+    VKD3D_HANDLE_SUBOBJECT_EXPLICIT(type_enum, type, left_side = subobject->data)
+
+HRESULT d3d12_pipeline_state_desc_from_d3d12_stream_desc(struct d3d12_pipeline_state_desc *desc,
+        const D3D12_PIPELINE_STATE_STREAM_DESC *d3d12_desc, VkPipelineBindPoint *vk_bind_point)
+{
+    D3D12_PIPELINE_STATE_SUBOBJECT_TYPE subobject_type;
+    const char *stream_ptr, *stream_end;
+    uint64_t defined_subobjects = 0;
+    bool is_graphics, is_compute;
+    uint64_t subobject_bit;
+
+    /* Initialize defaults for undefined subobjects */
+    d3d12_init_pipeline_state_desc(desc);
+
+    /* Structs are packed, but padded so that their size
+     * is always a multiple of the size of a pointer. */
+    stream_ptr = d3d12_desc->pPipelineStateSubobjectStream;
+    stream_end = stream_ptr + d3d12_desc->SizeInBytes;
+
+    while (stream_ptr < stream_end)
+    {
+        if (stream_ptr + sizeof(subobject_type) > stream_end)
+        {
+            ERR("Invalid pipeline state stream.\n");
+            return E_INVALIDARG;
+        }
+
+        subobject_type = *(const D3D12_PIPELINE_STATE_SUBOBJECT_TYPE *)stream_ptr;
+        subobject_bit = 1ull << subobject_type;
+
+        if (defined_subobjects & subobject_bit)
+        {
+            ERR("Duplicate pipeline subobject type %u.\n", subobject_type);
+            return E_INVALIDARG;
+        }
+
+        defined_subobjects |= subobject_bit;
+
+        switch (subobject_type)
+        {
+            VKD3D_HANDLE_SUBOBJECT(ROOT_SIGNATURE, ID3D12RootSignature*, desc->root_signature);
+            VKD3D_HANDLE_SUBOBJECT(VS, D3D12_SHADER_BYTECODE, desc->vs);
+            VKD3D_HANDLE_SUBOBJECT(PS, D3D12_SHADER_BYTECODE, desc->ps);
+            VKD3D_HANDLE_SUBOBJECT(DS, D3D12_SHADER_BYTECODE, desc->ds);
+            VKD3D_HANDLE_SUBOBJECT(HS, D3D12_SHADER_BYTECODE, desc->hs);
+            VKD3D_HANDLE_SUBOBJECT(GS, D3D12_SHADER_BYTECODE, desc->gs);
+            VKD3D_HANDLE_SUBOBJECT(CS, D3D12_SHADER_BYTECODE, desc->cs);
+            VKD3D_HANDLE_SUBOBJECT(STREAM_OUTPUT, D3D12_STREAM_OUTPUT_DESC, desc->stream_output);
+            VKD3D_HANDLE_SUBOBJECT(BLEND, D3D12_BLEND_DESC, desc->blend_state);
+            VKD3D_HANDLE_SUBOBJECT(SAMPLE_MASK, UINT, desc->sample_mask);
+            VKD3D_HANDLE_SUBOBJECT(RASTERIZER, D3D12_RASTERIZER_DESC, desc->rasterizer_state);
+            VKD3D_HANDLE_SUBOBJECT_EXPLICIT(DEPTH_STENCIL, D3D12_DEPTH_STENCIL_DESC,
+                    d3d12_promote_depth_stencil_desc(&desc->depth_stencil_state, &subobject->data));
+            VKD3D_HANDLE_SUBOBJECT(INPUT_LAYOUT, D3D12_INPUT_LAYOUT_DESC, desc->input_layout);
+            VKD3D_HANDLE_SUBOBJECT(IB_STRIP_CUT_VALUE, D3D12_INDEX_BUFFER_STRIP_CUT_VALUE, desc->strip_cut_value);
+            VKD3D_HANDLE_SUBOBJECT(PRIMITIVE_TOPOLOGY, D3D12_PRIMITIVE_TOPOLOGY_TYPE, desc->primitive_topology_type);
+            VKD3D_HANDLE_SUBOBJECT(RENDER_TARGET_FORMATS, D3D12_RT_FORMAT_ARRAY, desc->rtv_formats);
+            VKD3D_HANDLE_SUBOBJECT(DEPTH_STENCIL_FORMAT, DXGI_FORMAT, desc->dsv_format);
+            VKD3D_HANDLE_SUBOBJECT(SAMPLE_DESC, DXGI_SAMPLE_DESC, desc->sample_desc);
+            VKD3D_HANDLE_SUBOBJECT(NODE_MASK, UINT, desc->node_mask);
+            VKD3D_HANDLE_SUBOBJECT(CACHED_PSO, D3D12_CACHED_PIPELINE_STATE, desc->cached_pso);
+            VKD3D_HANDLE_SUBOBJECT(FLAGS, D3D12_PIPELINE_STATE_FLAGS, desc->flags);
+            VKD3D_HANDLE_SUBOBJECT(DEPTH_STENCIL1, D3D12_DEPTH_STENCIL_DESC1, desc->depth_stencil_state);
+            VKD3D_HANDLE_SUBOBJECT(VIEW_INSTANCING, D3D12_VIEW_INSTANCING_DESC, desc->view_instancing_desc);
+
+            default:
+                ERR("Unhandled pipeline subobject type %u.\n", subobject_type);
+                return E_INVALIDARG;
+        }
+    }
+
+    /* Deduce pipeline type from specified shaders */
+    is_graphics = desc->vs.pShaderBytecode && desc->vs.BytecodeLength;
+    is_compute = desc->cs.pShaderBytecode && desc->cs.BytecodeLength;
+
+    if (is_graphics == is_compute)
+    {
+        ERR("Cannot deduce pipeline type.\n");
+        return E_INVALIDARG;
+    }
+
+    *vk_bind_point = is_graphics
+        ? VK_PIPELINE_BIND_POINT_GRAPHICS
+        : VK_PIPELINE_BIND_POINT_COMPUTE;
+
+    return S_OK;
+}
+
+#undef VKD3D_HANDLE_SUBOBJECT
+#undef VKD3D_HANDLE_SUBOBJECT_EXPLICIT
+
+static void d3d12_pipeline_state_compile_speculative_variant(struct d3d12_pipeline_state *state,
+        const struct d3d12_pipeline_state_desc *desc);
+
 HRESULT d3d12_pipeline_state_create(struct d3d12_device *device, VkPipelineBindPoint bind_point,
         const struct d3d12_pipeline_state_desc *desc, struct d3d12_pipeline_state **state)
 {
+    const D3D12_CACHED_PIPELINE_STATE *cached_state = &desc->cached_pso;
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    const struct vkd3d_pipeline_blob *cached_blob = NULL;
+    struct d3d12_root_signature *root_signature;
     struct d3d12_pipeline_state *object;
+    struct vkd3d_pipeline_blob blob;
     HRESULT hr;
 
     if (!(object = vkd3d_malloc(sizeof(*object))))
         return E_OUTOFMEMORY;
 
+    object->desc_hash = d3d12_pipeline_state_desc_get_hash(desc, bind_point);
+
+    if (cached_state->pCachedBlob && cached_state->CachedBlobSizeInBytes)
+    {
+        if (FAILED(hr = vkd3d_pipeline_blob_parse(&blob, device, cached_state->pCachedBlob,
+                cached_state->CachedBlobSizeInBytes, object->desc_hash)))
+        {
+            vkd3d_free(object);
+            return hr;
+        }
+        cached_blob = &blob;
+    }
+
+    d3d12_pipeline_state_init_pipeline_cache(object, device, cached_blob);
+
     switch (bind_point)
     {
         case VK_PIPELINE_BIND_POINT_COMPUTE:
-            hr = d3d12_pipeline_state_init_compute(object, device, desc);
+            hr = d3d12_pipeline_state_init_compute(object, device, desc, cached_blob);
             break;
 
         case VK_PIPELINE_BIND_POINT_GRAPHICS:
-            hr = d3d12_pipeline_state_init_graphics(object, device, desc);
+            hr = d3d12_pipeline_state_init_graphics(object, device, desc, cached_blob);
             break;
 
         default:
@@ -2671,10 +4171,24 @@ HRESULT d3d12_pipeline_state_create(struct d3d12_device *device, VkPipelineBindP
 
     if (FAILED(hr))
     {
+        if (object->vk_pso_cache)
+            VK_CALL(vkDestroyPipelineCache(device->vk_device, object->vk_pso_cache, NULL));
         vkd3d_free(object);
         return hr;
     }
 
+    if (d3d12_pipeline_state_is_graphics(object))
+        d3d12_pipeline_state_compile_speculative_variant(object, desc);
+
+    if (device->pipeline_recorder.enabled || device->pipeline_index.enabled)
+    {
+        root_signature = unsafe_impl_from_ID3D12RootSignature(desc->root_signature);
+        vkd3d_pipeline_recorder_record_pipeline(&device->pipeline_recorder, bind_point,
+                desc, root_signature ? root_signature->blob_hash : 0);
+        vkd3d_pipeline_index_add_pipeline(&device->pipeline_index, bind_point,
+                desc, root_signature ? root_signature->blob_hash : 0);
+    }
+
     TRACE("Created pipeline state %p.\n", object);
 
     *state = object;
@@ -2698,7 +4212,7 @@ static bool vkd3d_topology_can_restart(VkPrimitiveTopology topology)
     }
 }
 
-static enum VkPrimitiveTopology vk_topology_from_d3d12_topology(D3D12_PRIMITIVE_TOPOLOGY topology)
+VkPrimitiveTopology vk_topology_from_d3d12_topology(D3D12_PRIMITIVE_TOPOLOGY topology)
 {
     switch (topology)
     {
@@ -2751,104 +4265,609 @@ static enum VkPrimitiveTopology vk_topology_from_d3d12_topology(D3D12_PRIMITIVE_
     }
 }
 
-static VkPipeline d3d12_pipeline_state_find_compiled_pipeline(const struct d3d12_pipeline_state *state,
-        const struct vkd3d_pipeline_key *key, VkRenderPass *vk_render_pass)
+static uint32_t vkd3d_pipeline_key_hash(const struct vkd3d_pipeline_key *key)
 {
-    const struct d3d12_graphics_pipeline_state *graphics = &state->graphics;
-    struct d3d12_device *device = state->device;
+    return vkd3d_hash_fnv1a_data(VKD3D_HASH_FNV1A_INIT, key, sizeof(*key));
+}
+
+static struct vkd3d_compiled_pipeline **d3d12_graphics_pipeline_state_get_bucket(
+        struct d3d12_graphics_pipeline_state *graphics, const struct vkd3d_pipeline_key *key)
+{
+    return &graphics->compiled_pipelines[vkd3d_pipeline_key_hash(key) % ARRAY_SIZE(graphics->compiled_pipelines)];
+}
+
+/* Safe to call without locks. Entries are fully initialised before being
+ * published at the head of a bucket, and are never removed before the
+ * pipeline state is destroyed. */
+static struct vkd3d_compiled_pipeline *d3d12_graphics_pipeline_state_find_variant(
+        struct vkd3d_compiled_pipeline **bucket, const struct vkd3d_pipeline_key *key)
+{
+    struct vkd3d_compiled_pipeline *current;
+
+    for (current = vkd3d_atomic_ptr_load_explicit((void **)bucket, vkd3d_memory_order_acquire);
+            current; current = current->next)
+    {
+        if (!memcmp(&current->key, key, sizeof(*key)))
+            return current;
+    }
+
+    return NULL;
+}
+
+/* Must be called with the pipeline mutex held. */
+static void d3d12_graphics_pipeline_state_publish_variant_locked(struct vkd3d_compiled_pipeline **bucket,
+        struct vkd3d_compiled_pipeline *pipeline)
+{
+    pipeline->next = *bucket;
+    vkd3d_atomic_ptr_store_explicit((void **)bucket, pipeline, vkd3d_memory_order_release);
+}
+
+/* Drivers keep compiled code for every stage of a pipeline, which roughly
+ * scales with the SPIR-V size, in addition to some fixed state. */
+#define VKD3D_PIPELINE_VARIANT_BASE_SIZE 0x1000
+
+static uint64_t d3d12_graphics_pipeline_state_get_variant_size(const struct d3d12_graphics_pipeline_state *graphics)
+{
+    uint64_t size = VKD3D_PIPELINE_VARIANT_BASE_SIZE;
+    unsigned int i;
+
+    for (i = 0; i < graphics->stage_count; ++i)
+        size += graphics->modules[i]->spirv_size;
+
+    return size;
+}
+
+HRESULT vkd3d_pipeline_variant_budget_init(struct vkd3d_pipeline_variant_budget *budget)
+{
+    const char *limit;
+    int rc;
+
+    memset(budget, 0, sizeof(*budget));
+    list_init(&budget->lru);
+
+    if ((limit = getenv("VKD3D_PIPELINE_VARIANT_LIMIT")))
+        budget->max_count = strtoul(limit, NULL, 0);
+    if ((limit = getenv("VKD3D_PIPELINE_VARIANT_MEMORY_LIMIT")))
+        budget->max_size = (uint64_t)strtoull(limit, NULL, 0) << 20;
+
+    if ((budget->enabled = budget->max_count || budget->max_size))
+        TRACE("Limiting pipeline variants to %u variants, %"PRIu64" bytes.\n",
+                budget->max_count, budget->max_size);
+
+    if ((rc = pthread_mutex_init(&budget->mutex, NULL)))
+    {
+        ERR("Failed to initialize mutex, error %d.\n", rc);
+        return hresult_from_errno(rc);
+    }
+
+    return S_OK;
+}
+
+void vkd3d_pipeline_variant_budget_cleanup(struct vkd3d_pipeline_variant_budget *budget)
+{
+    /* Pipeline states and command allocators hold a device reference, so the
+     * budget is empty by now. */
+    assert(list_empty(&budget->lru));
+
+    pthread_mutex_destroy(&budget->mutex);
+}
+
+void vkd3d_pipeline_variant_budget_get_usage(struct vkd3d_pipeline_variant_budget *budget,
+        uint64_t *count, uint64_t *size)
+{
+    *count = *size = 0;
+
+    if (!budget->enabled)
+        return;
+
+    pthread_mutex_lock(&budget->mutex);
+    *count = budget->count;
+    *size = budget->size;
+    pthread_mutex_unlock(&budget->mutex);
+}
+
+uint64_t vkd3d_pipeline_variant_budget_get_owner(struct vkd3d_pipeline_variant_budget *budget)
+{
+    return vkd3d_atomic_uint64_add(&budget->owner_count, 1, vkd3d_memory_order_relaxed);
+}
+
+/* Takes a reference unless the Vulkan pipeline was already destroyed. */
+static bool vkd3d_compiled_pipeline_try_incref(struct vkd3d_compiled_pipeline *pipeline)
+{
+    uint32_t refcount = vkd3d_atomic_uint32_load_explicit(&pipeline->refcount, vkd3d_memory_order_relaxed);
+
+    do
+    {
+        if (!refcount)
+            return false;
+    }
+    while (!vkd3d_atomic_uint32_compare_exchange(&pipeline->refcount, &refcount, refcount + 1,
+            vkd3d_memory_order_acquire, vkd3d_memory_order_relaxed));
+
+    return true;
+}
+
+/* Must be called with the variant budget mutex held. */
+static void vkd3d_compiled_pipeline_decref_locked(struct vkd3d_compiled_pipeline *pipeline,
+        struct d3d12_device *device)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+
+    if (vkd3d_atomic_uint32_decrement(&pipeline->refcount, vkd3d_memory_order_acq_rel))
+        return;
+
+    VK_CALL(vkDestroyPipeline(device->vk_device, pipeline->vk_pipeline, NULL));
+    pipeline->vk_pipeline = VK_NULL_HANDLE;
+
+    if (pipeline->orphaned)
+        vkd3d_free(pipeline);
+}
+
+void vkd3d_compiled_pipeline_release(struct vkd3d_compiled_pipeline *pipeline,
+        struct d3d12_device *device)
+{
+    vkd3d_compiled_pipelines_release(&pipeline, 1, device);
+}
+
+void vkd3d_compiled_pipelines_release(struct vkd3d_compiled_pipeline **pipelines, size_t count,
+        struct d3d12_device *device)
+{
+    struct vkd3d_pipeline_variant_budget *budget = &device->pipeline_variant_budget;
+    size_t i;
+
+    if (!count)
+        return;
+
+    pthread_mutex_lock(&budget->mutex);
+    for (i = 0; i < count; ++i)
+        vkd3d_compiled_pipeline_decref_locked(pipelines[i], device);
+    pthread_mutex_unlock(&budget->mutex);
+}
+
+void vkd3d_compiled_pipeline_set_owner(struct vkd3d_compiled_pipeline *pipeline, uint64_t owner)
+{
+    vkd3d_atomic_uint64_store_explicit(&pipeline->owner, owner, vkd3d_memory_order_relaxed);
+}
+
+/* Only writes the stamp when the clock moved, to keep the cache line of a
+ * variant bound by many threads shared. */
+static void vkd3d_compiled_pipeline_mark_used(struct vkd3d_compiled_pipeline *pipeline,
+        struct vkd3d_pipeline_variant_budget *budget)
+{
+    uint64_t time = vkd3d_atomic_uint64_load_explicit(&budget->time, vkd3d_memory_order_relaxed);
+
+    if (vkd3d_atomic_uint64_load_explicit(&pipeline->last_used, vkd3d_memory_order_relaxed) != time)
+        vkd3d_atomic_uint64_store_explicit(&pipeline->last_used, time, vkd3d_memory_order_relaxed);
+}
+
+/* Must be called with the variant budget mutex held. */
+static void vkd3d_pipeline_variant_budget_remove_locked(struct vkd3d_pipeline_variant_budget *budget,
+        struct vkd3d_compiled_pipeline *pipeline)
+{
+    list_remove(&pipeline->budget_entry);
+    --budget->count;
+    budget->size -= pipeline->size;
+}
+
+/* Must be called with the variant budget mutex held. Evicts variants until
+ * the new variant fits, and takes the budget reference to it. Variants used
+ * since they were queued get a second chance at the tail of the list, which
+ * approximates least recently used order without touching the list on every
+ * use. A variant larger than the whole budget is kept on its own. */
+static void vkd3d_pipeline_variant_budget_insert_locked(struct d3d12_device *device,
+        struct vkd3d_compiled_pipeline *pipeline)
+{
+    struct vkd3d_pipeline_variant_budget *budget = &device->pipeline_variant_budget;
+    uint32_t second_chance_count = budget->count;
+    struct vkd3d_compiled_pipeline *victim;
+    struct list *head;
+    uint64_t time;
+
+    time = vkd3d_atomic_uint64_add(&budget->time, 1, vkd3d_memory_order_relaxed);
+
+    while ((head = list_head(&budget->lru))
+            && ((budget->max_count && budget->count >= budget->max_count)
+            || (budget->max_size && budget->size + pipeline->size > budget->max_size)))
+    {
+        victim = LIST_ENTRY(head, struct vkd3d_compiled_pipeline, budget_entry);
+        list_remove(&victim->budget_entry);
+
+        if (second_chance_count && vkd3d_atomic_uint64_load_explicit(&victim->last_used,
+                vkd3d_memory_order_relaxed) >= victim->queued_time)
+        {
+            --second_chance_count;
+            victim->queued_time = time;
+            list_add_tail(&budget->lru, &victim->budget_entry);
+            continue;
+        }
+
+        list_add_head(&budget->lru, &victim->budget_entry);
+        vkd3d_pipeline_variant_budget_remove_locked(budget, victim);
+        vkd3d_atomic_uint32_store_explicit(&victim->status,
+                VKD3D_COMPILED_PIPELINE_EVICTED, vkd3d_memory_order_relaxed);
+        vkd3d_pipeline_stats_add_pipeline_eviction(&device->pipeline_stats);
+        vkd3d_compiled_pipeline_decref_locked(victim, device);
+    }
+
+    /* New variants only get a second chance if used again. */
+    pipeline->queued_time = time;
+    vkd3d_atomic_uint64_store_explicit(&pipeline->last_used, time - 1, vkd3d_memory_order_relaxed);
+    list_add_tail(&budget->lru, &pipeline->budget_entry);
+    ++budget->count;
+    budget->size += pipeline->size;
+    vkd3d_atomic_uint32_increment(&pipeline->refcount, vkd3d_memory_order_release);
+}
+
+/* Returns the Vulkan pipeline of a variant, and a reference to it in
+ * "variant" unless the command allocator identified by "owner" already holds
+ * one. Evicted variants still used by a command allocator are brought back
+ * into the budget. */
+static VkPipeline vkd3d_pipeline_variant_budget_acquire(struct d3d12_device *device,
+        struct vkd3d_compiled_pipeline *pipeline, uint64_t owner, struct vkd3d_compiled_pipeline **variant)
+{
+    struct vkd3d_pipeline_variant_budget *budget = &device->pipeline_variant_budget;
     VkPipeline vk_pipeline = VK_NULL_HANDLE;
+
+    if (vkd3d_atomic_uint32_load_explicit(&pipeline->status,
+            vkd3d_memory_order_acquire) == VKD3D_COMPILED_PIPELINE_READY)
+    {
+        vkd3d_compiled_pipeline_mark_used(pipeline, budget);
+
+        if (vkd3d_atomic_uint64_load_explicit(&pipeline->owner, vkd3d_memory_order_relaxed) == owner)
+            return pipeline->vk_pipeline;
+
+        if (!vkd3d_compiled_pipeline_try_incref(pipeline))
+            return VK_NULL_HANDLE;
+
+        *variant = pipeline;
+        return pipeline->vk_pipeline;
+    }
+
+    pthread_mutex_lock(&budget->mutex);
+
+    if (vkd3d_compiled_pipeline_try_incref(pipeline))
+    {
+        if (pipeline->status == VKD3D_COMPILED_PIPELINE_EVICTED)
+        {
+            vkd3d_pipeline_variant_budget_insert_locked(device, pipeline);
+            vkd3d_atomic_uint32_store_explicit(&pipeline->status,
+                    VKD3D_COMPILED_PIPELINE_READY, vkd3d_memory_order_relaxed);
+        }
+        vk_pipeline = pipeline->vk_pipeline;
+        *variant = pipeline;
+    }
+
+    pthread_mutex_unlock(&budget->mutex);
+
+    return vk_pipeline;
+}
+
+static void vkd3d_compiled_pipeline_destroy(struct vkd3d_compiled_pipeline *pipeline,
+        struct d3d12_device *device)
+{
+    struct vkd3d_pipeline_variant_budget *budget = &device->pipeline_variant_budget;
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+
+    if (!budget->enabled)
+    {
+        VK_CALL(vkDestroyPipeline(device->vk_device, pipeline->vk_pipeline, NULL));
+        vkd3d_free(pipeline);
+        return;
+    }
+
+    pthread_mutex_lock(&budget->mutex);
+
+    if (pipeline->status == VKD3D_COMPILED_PIPELINE_READY)
+    {
+        vkd3d_pipeline_variant_budget_remove_locked(budget, pipeline);
+        vkd3d_compiled_pipeline_decref_locked(pipeline, device);
+    }
+
+    /* Variants still used by command allocators are freed by the last
+     * vkd3d_compiled_pipeline_release(). The pipeline state is gone, so no
+     * reference can be taken concurrently. */
+    if (pipeline->refcount)
+        pipeline->orphaned = true;
+    else
+        vkd3d_free(pipeline);
+
+    pthread_mutex_unlock(&budget->mutex);
+}
+
+/* Must be called with the pipeline mutex held. Stores a compiled Vulkan
+ * pipeline in a pending, failed or evicted entry, and returns false if the
+ * entry still holds a Vulkan pipeline. */
+static bool d3d12_pipeline_state_set_variant_ready_locked(struct d3d12_pipeline_state *state,
+        struct vkd3d_compiled_pipeline *pipeline, VkPipeline vk_pipeline, VkRenderPass vk_render_pass,
+        struct vkd3d_compiled_pipeline **variant)
+{
+    struct vkd3d_pipeline_variant_budget *budget = &state->device->pipeline_variant_budget;
+
+    if (!budget->enabled)
+    {
+        if (pipeline->status == VKD3D_COMPILED_PIPELINE_READY)
+            return false;
+
+        pipeline->vk_pipeline = vk_pipeline;
+        pipeline->vk_render_pass = vk_render_pass;
+        vkd3d_atomic_uint32_store_explicit(&pipeline->status,
+                VKD3D_COMPILED_PIPELINE_READY, vkd3d_memory_order_release);
+        return true;
+    }
+
+    pthread_mutex_lock(&budget->mutex);
+
+    if (pipeline->status == VKD3D_COMPILED_PIPELINE_READY
+            || (pipeline->status == VKD3D_COMPILED_PIPELINE_EVICTED && pipeline->refcount))
+    {
+        pthread_mutex_unlock(&budget->mutex);
+        return false;
+    }
+
+    pipeline->vk_pipeline = vk_pipeline;
+    pipeline->vk_render_pass = vk_render_pass;
+    pipeline->size = d3d12_graphics_pipeline_state_get_variant_size(&state->graphics);
+    vkd3d_pipeline_variant_budget_insert_locked(state->device, pipeline);
+    if (variant)
+    {
+        vkd3d_atomic_uint32_increment(&pipeline->refcount, vkd3d_memory_order_relaxed);
+        *variant = pipeline;
+    }
+    vkd3d_atomic_uint32_store_explicit(&pipeline->status,
+            VKD3D_COMPILED_PIPELINE_READY, vkd3d_memory_order_release);
+
+    pthread_mutex_unlock(&budget->mutex);
+    return true;
+}
+
+static void vkd3d_compiled_pipeline_init(struct vkd3d_compiled_pipeline *pipeline,
+        const struct vkd3d_pipeline_key *key, bool speculative)
+{
+    pipeline->key = *key;
+    pipeline->speculative = speculative;
+    pipeline->vk_pipeline = VK_NULL_HANDLE;
+    pipeline->vk_render_pass = VK_NULL_HANDLE;
+    pipeline->status = VKD3D_COMPILED_PIPELINE_PENDING;
+    pipeline->used = 0;
+    pipeline->refcount = 0;
+    pipeline->last_used = 0;
+    pipeline->owner = 0;
+    pipeline->size = 0;
+    pipeline->queued_time = 0;
+    pipeline->orphaned = false;
+}
+
+static VkPipeline d3d12_pipeline_state_find_compiled_pipeline(struct d3d12_pipeline_state *state,
+        const struct vkd3d_pipeline_key *key, uint64_t owner, VkRenderPass *vk_render_pass,
+        struct vkd3d_compiled_pipeline **variant)
+{
+    struct vkd3d_pipeline_compiler *compiler = &state->device->pipeline_compiler;
+    struct d3d12_graphics_pipeline_state *graphics = &state->graphics;
     struct vkd3d_compiled_pipeline *current;
+    VkPipeline vk_pipeline;
+    uint32_t status;
     int rc;
 
     *vk_render_pass = VK_NULL_HANDLE;
+    *variant = NULL;
+
+    if (!(current = d3d12_graphics_pipeline_state_find_variant(
+            d3d12_graphics_pipeline_state_get_bucket(graphics, key), key)))
+        return VK_NULL_HANDLE;
 
-    if (!(rc = pthread_mutex_lock(&device->mutex)))
+    /* Pick up an in-flight speculative compile instead of compiling the same
+     * variant twice. */
+    if ((status = vkd3d_atomic_uint32_load_explicit(&current->status,
+            vkd3d_memory_order_acquire)) == VKD3D_COMPILED_PIPELINE_PENDING)
     {
-        LIST_FOR_EACH_ENTRY(current, &graphics->compiled_pipelines, struct vkd3d_compiled_pipeline, entry)
+        if ((rc = pthread_mutex_lock(&graphics->pipeline_mutex)))
+        {
+            ERR("Failed to lock mutex, error %d.\n", rc);
+            return VK_NULL_HANDLE;
+        }
+
+        while ((status = current->status) == VKD3D_COMPILED_PIPELINE_PENDING)
         {
-            if (!memcmp(&current->key, key, sizeof(*key)))
+            if ((rc = pthread_cond_wait(&graphics->pipeline_cond, &graphics->pipeline_mutex)))
             {
-                vk_pipeline = current->vk_pipeline;
-                *vk_render_pass = current->vk_render_pass;
+                ERR("Failed to wait on condition variable, error %d.\n", rc);
                 break;
             }
         }
-        pthread_mutex_unlock(&device->mutex);
+
+        pthread_mutex_unlock(&graphics->pipeline_mutex);
+
+        if (status == VKD3D_COMPILED_PIPELINE_READY)
+            vkd3d_atomic_uint32_increment(&compiler->wait_count, vkd3d_memory_order_relaxed);
+    }
+
+    if (state->device->pipeline_variant_budget.enabled)
+    {
+        if (!(vk_pipeline = vkd3d_pipeline_variant_budget_acquire(state->device, current, owner, variant)))
+            return VK_NULL_HANDLE;
     }
     else
     {
-        ERR("Failed to lock mutex, error %d.\n", rc);
+        if (status != VKD3D_COMPILED_PIPELINE_READY)
+            return VK_NULL_HANDLE;
+        vk_pipeline = current->vk_pipeline;
     }
 
+    if (current->speculative && !vkd3d_atomic_uint32_exchange_explicit(&current->used, 1, vkd3d_memory_order_relaxed))
+        vkd3d_atomic_uint32_increment(&compiler->hit_count, vkd3d_memory_order_relaxed);
+
+    *vk_render_pass = current->vk_render_pass;
     return vk_pipeline;
 }
 
 static bool d3d12_pipeline_state_put_pipeline_to_cache(struct d3d12_pipeline_state *state,
-        const struct vkd3d_pipeline_key *key, VkPipeline vk_pipeline, VkRenderPass vk_render_pass)
+        const struct vkd3d_pipeline_key *key, VkPipeline vk_pipeline, VkRenderPass vk_render_pass,
+        struct vkd3d_compiled_pipeline **variant)
 {
     struct d3d12_graphics_pipeline_state *graphics = &state->graphics;
     struct vkd3d_compiled_pipeline *compiled_pipeline, *current;
-    struct d3d12_device *device = state->device;
+    struct vkd3d_compiled_pipeline **bucket;
+    bool ret = true;
     int rc;
 
+    *variant = NULL;
+
     if (!(compiled_pipeline = vkd3d_malloc(sizeof(*compiled_pipeline))))
         return false;
 
-    compiled_pipeline->key = *key;
-    compiled_pipeline->vk_pipeline = vk_pipeline;
-    compiled_pipeline->vk_render_pass = vk_render_pass;
+    vkd3d_compiled_pipeline_init(compiled_pipeline, key, false);
 
-    if ((rc = pthread_mutex_lock(&device->mutex)))
+    bucket = d3d12_graphics_pipeline_state_get_bucket(graphics, key);
+
+    /* Only writers to this pipeline state are serialised. */
+    if ((rc = pthread_mutex_lock(&graphics->pipeline_mutex)))
     {
         ERR("Failed to lock mutex, error %d.\n", rc);
         vkd3d_free(compiled_pipeline);
         return false;
     }
 
-    LIST_FOR_EACH_ENTRY(current, &graphics->compiled_pipelines, struct vkd3d_compiled_pipeline, entry)
+    if (!(current = d3d12_graphics_pipeline_state_find_variant(bucket, key)))
     {
-        if (!memcmp(&current->key, key, sizeof(*key)))
-        {
-            vkd3d_free(compiled_pipeline);
-            compiled_pipeline = NULL;
-            break;
-        }
+        d3d12_pipeline_state_set_variant_ready_locked(state, compiled_pipeline,
+                vk_pipeline, vk_render_pass, variant);
+        d3d12_graphics_pipeline_state_publish_variant_locked(bucket, compiled_pipeline);
+        compiled_pipeline = NULL;
+    }
+    else if (current->status == VKD3D_COMPILED_PIPELINE_PENDING)
+    {
+        ret = false;
+    }
+    else
+    {
+        /* Take over the entry of a failed speculative compile or of an
+         * evicted variant. */
+        ret = d3d12_pipeline_state_set_variant_ready_locked(state, current,
+                vk_pipeline, vk_render_pass, variant);
     }
 
-    if (compiled_pipeline)
-        list_add_tail(&graphics->compiled_pipelines, &compiled_pipeline->entry);
+    pthread_mutex_unlock(&graphics->pipeline_mutex);
 
-    pthread_mutex_unlock(&device->mutex);
-    return compiled_pipeline;
+    vkd3d_free(compiled_pipeline);
+    return ret;
 }
 
-VkPipeline d3d12_pipeline_state_get_or_create_pipeline(struct d3d12_pipeline_state *state,
-        const struct vkd3d_dynamic_state *dyn_state, VkFormat dsv_format, VkRenderPass *vk_render_pass)
+/* With a dynamic primitive topology, only the topology class, the patch
+ * control point count and primitive restart are baked into the pipeline. */
+D3D12_PRIMITIVE_TOPOLOGY d3d12_pipeline_state_get_static_topology(const struct d3d12_pipeline_state *state,
+        D3D12_PRIMITIVE_TOPOLOGY topology)
+{
+    const struct d3d12_graphics_pipeline_state *graphics = &state->graphics;
+    bool restart;
+
+    if (!(graphics->dynamic_state_flags & VKD3D_DYNAMIC_STATE_TOPOLOGY))
+        return topology;
+
+    restart = graphics->index_buffer_strip_cut_value &&
+            (topology == D3D_PRIMITIVE_TOPOLOGY_LINESTRIP || topology == D3D_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+
+    switch (topology)
+    {
+        case D3D_PRIMITIVE_TOPOLOGY_LINELIST:
+        case D3D_PRIMITIVE_TOPOLOGY_LINESTRIP:
+            return restart ? D3D_PRIMITIVE_TOPOLOGY_LINESTRIP : D3D_PRIMITIVE_TOPOLOGY_LINELIST;
+        case D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST:
+        case D3D_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP:
+            return restart ? D3D_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP : D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+        default:
+            return topology;
+    }
+}
+
+bool d3d12_pipeline_state_has_dynamic_vertex_strides(const struct d3d12_pipeline_state *state,
+        const uint32_t *vertex_strides)
+{
+    const struct d3d12_graphics_pipeline_state *graphics;
+    uint32_t binding;
+    unsigned int i;
+
+    if (!d3d12_pipeline_state_is_graphics(state))
+        return false;
+
+    graphics = &state->graphics;
+    if (!(graphics->dynamic_state_flags & VKD3D_DYNAMIC_STATE_VERTEX_BUFFER_STRIDE))
+        return false;
+
+    /* Unlike D3D12 and static strides, dynamic strides must be 0 or cover
+     * all attributes read from the binding. Other strides are compiled into
+     * the pipeline instead. */
+    for (i = 0; i < graphics->attribute_count; ++i)
+    {
+        binding = graphics->attributes[i].binding;
+        if (vertex_strides[binding] && vertex_strides[binding] < graphics->min_vertex_strides[binding])
+            return false;
+    }
+
+    return true;
+}
+
+/* Vertex strides are indexed by input slot. States which are dynamic in
+ * the pipeline state are left out of the key. */
+static void d3d12_pipeline_state_init_pipeline_key(const struct d3d12_pipeline_state *state,
+        D3D12_PRIMITIVE_TOPOLOGY topology, uint32_t viewport_count, const uint32_t *vertex_strides,
+        VkFormat dsv_format, struct vkd3d_pipeline_key *key)
+{
+    const struct d3d12_graphics_pipeline_state *graphics = &state->graphics;
+    size_t binding_count = 0;
+    uint32_t binding, mask;
+    unsigned int i;
+
+    memset(key, 0, sizeof(*key));
+    key->topology = d3d12_pipeline_state_get_static_topology(state, topology);
+    key->dsv_format = dsv_format;
+
+    if (!(graphics->dynamic_state_flags & VKD3D_DYNAMIC_STATE_VIEWPORT_COUNT))
+        key->viewport_count = max(viewport_count, 1);
+
+    if (graphics->dynamic_state_flags & VKD3D_DYNAMIC_STATE_VERTEX_BUFFER_STRIDE)
+    {
+        if (d3d12_pipeline_state_has_dynamic_vertex_strides(state, vertex_strides))
+            return;
+        key->static_strides = 1;
+    }
+
+    for (i = 0, mask = 0; i < graphics->attribute_count; ++i)
+    {
+        binding = graphics->attributes[i].binding;
+        if (mask & (1u << binding))
+            continue;
+
+        if (binding_count == ARRAY_SIZE(key->strides))
+            break;
+
+        mask |= 1u << binding;
+        key->strides[binding_count++] = vertex_strides[binding];
+    }
+}
+
+static VkPipeline d3d12_pipeline_state_create_variant(struct d3d12_pipeline_state *state,
+        const struct vkd3d_pipeline_key *key, VkPipelineCache vk_cache, VkRenderPass *vk_render_pass)
 {
     VkVertexInputBindingDescription bindings[D3D12_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT];
     const struct vkd3d_vk_device_procs *vk_procs = &state->device->vk_procs;
     struct d3d12_graphics_pipeline_state *graphics = &state->graphics;
     VkPipelineVertexInputDivisorStateCreateInfoEXT input_divisor_info;
+    VkDynamicState dynamic_states[VKD3D_MAX_DYNAMIC_STATE_COUNT];
     VkPipelineTessellationStateCreateInfo tessellation_info;
     VkPipelineVertexInputStateCreateInfo input_desc;
     VkPipelineInputAssemblyStateCreateInfo ia_desc;
+    VkPipelineDynamicStateCreateInfo dynamic_desc;
     struct d3d12_device *device = state->device;
     VkGraphicsPipelineCreateInfo pipeline_desc;
     VkPipelineViewportStateCreateInfo vp_desc;
-    struct vkd3d_pipeline_key pipeline_key;
     size_t binding_count = 0;
+    uint64_t start_time;
     VkPipeline vk_pipeline;
-    unsigned int i;
+    unsigned int i, j;
     uint32_t mask;
     VkResult vr;
     HRESULT hr;
 
-    assert(d3d12_pipeline_state_is_graphics(state));
-
-    memset(&pipeline_key, 0, sizeof(pipeline_key));
-    pipeline_key.topology = dyn_state->primitive_topology;
-    pipeline_key.viewport_count = max(dyn_state->viewport_count, 1);
-
     for (i = 0, mask = 0; i < graphics->attribute_count; ++i)
     {
         struct VkVertexInputBindingDescription *b;
@@ -2867,19 +4886,12 @@ VkPipeline d3d12_pipeline_state_get_or_create_pipeline(struct d3d12_pipeline_sta
         mask |= 1u << binding;
         b = &bindings[binding_count];
         b->binding = binding;
-        b->stride = dyn_state->vertex_strides[binding];
+        b->stride = key->strides[binding_count];
         b->inputRate = graphics->input_rates[binding];
 
-        pipeline_key.strides[binding_count] = b->stride;
-
         ++binding_count;
     }
 
-    pipeline_key.dsv_format = dsv_format;
-
-    if ((vk_pipeline = d3d12_pipeline_state_find_compiled_pipeline(state, &pipeline_key, vk_render_pass)))
-        return vk_pipeline;
-
     input_desc.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
     input_desc.pNext = NULL;
     input_desc.flags = 0;
@@ -2900,7 +4912,7 @@ VkPipeline d3d12_pipeline_state_get_or_create_pipeline(struct d3d12_pipeline_sta
     ia_desc.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
     ia_desc.pNext = NULL;
     ia_desc.flags = 0;
-    ia_desc.topology = vk_topology_from_d3d12_topology(dyn_state->primitive_topology);
+    ia_desc.topology = vk_topology_from_d3d12_topology(key->topology);
     ia_desc.primitiveRestartEnable = graphics->index_buffer_strip_cut_value &&
                                      vkd3d_topology_can_restart(ia_desc.topology);
 
@@ -2908,16 +4920,28 @@ VkPipeline d3d12_pipeline_state_get_or_create_pipeline(struct d3d12_pipeline_sta
     tessellation_info.pNext = NULL;
     tessellation_info.flags = 0;
     tessellation_info.patchControlPoints
-            = max(dyn_state->primitive_topology - D3D_PRIMITIVE_TOPOLOGY_1_CONTROL_POINT_PATCHLIST + 1, 1);
+            = max(key->topology - D3D_PRIMITIVE_TOPOLOGY_1_CONTROL_POINT_PATCHLIST + 1, 1);
 
     vp_desc.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
     vp_desc.pNext = NULL;
     vp_desc.flags = 0;
-    vp_desc.viewportCount = pipeline_key.viewport_count;
+    vp_desc.viewportCount = key->viewport_count;
     vp_desc.pViewports = NULL;
-    vp_desc.scissorCount = pipeline_key.viewport_count;
+    vp_desc.scissorCount = key->viewport_count;
     vp_desc.pScissors = NULL;
 
+    dynamic_desc = graphics->dynamic_desc;
+    if (key->static_strides)
+    {
+        for (i = 0, j = 0; i < graphics->dynamic_desc.dynamicStateCount; ++i)
+        {
+            if (graphics->dynamic_states[i] != VK_DYNAMIC_STATE_VERTEX_INPUT_BINDING_STRIDE_EXT)
+                dynamic_states[j++] = graphics->dynamic_states[i];
+        }
+        dynamic_desc.dynamicStateCount = j;
+        dynamic_desc.pDynamicStates = dynamic_states;
+    }
+
     pipeline_desc.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
     pipeline_desc.pNext = NULL;
     pipeline_desc.flags = 0;
@@ -2931,7 +4955,7 @@ VkPipeline d3d12_pipeline_state_get_or_create_pipeline(struct d3d12_pipeline_sta
     pipeline_desc.pMultisampleState = &graphics->ms_desc;
     pipeline_desc.pDepthStencilState = &graphics->ds_desc;
     pipeline_desc.pColorBlendState = &graphics->blend_desc;
-    pipeline_desc.pDynamicState = &graphics->dynamic_desc;
+    pipeline_desc.pDynamicState = &dynamic_desc;
     pipeline_desc.layout = graphics->root_signature->vk_pipeline_layout;
     pipeline_desc.subpass = 0;
     pipeline_desc.basePipelineHandle = VK_NULL_HANDLE;
@@ -2941,28 +4965,164 @@ VkPipeline d3d12_pipeline_state_get_or_create_pipeline(struct d3d12_pipeline_sta
     if (!(pipeline_desc.renderPass = graphics->render_pass))
     {
         if (graphics->null_attachment_mask & dsv_attachment_mask(graphics))
-            TRACE("Compiling %p with DSV format %#x.\n", state, dsv_format);
+            TRACE("Compiling %p with DSV format %#x.\n", state, key->dsv_format);
 
-        if (FAILED(hr = d3d12_graphics_pipeline_state_create_render_pass(graphics, device, dsv_format,
+        if (FAILED(hr = d3d12_graphics_pipeline_state_create_render_pass(graphics, device, key->dsv_format,
                 &pipeline_desc.renderPass, &graphics->dsv_layout)))
             return VK_NULL_HANDLE;
     }
 
     *vk_render_pass = pipeline_desc.renderPass;
 
-    if ((vr = VK_CALL(vkCreateGraphicsPipelines(device->vk_device, device->vk_pipeline_cache,
-            1, &pipeline_desc, NULL, &vk_pipeline))) < 0)
+    start_time = vkd3d_get_current_time_ns();
+    vr = VK_CALL(vkCreateGraphicsPipelines(device->vk_device,
+            vk_cache, 1, &pipeline_desc, NULL, &vk_pipeline));
+    vkd3d_pipeline_stats_add_timing(&device->pipeline_stats, VKD3D_PIPELINE_TIMING_PIPELINE_CREATE,
+            vkd3d_get_current_time_ns() - start_time);
+    if (vr < 0)
     {
         WARN("Failed to create Vulkan graphics pipeline, vr %d.\n", vr);
         return VK_NULL_HANDLE;
     }
 
-    if (d3d12_pipeline_state_put_pipeline_to_cache(state, &pipeline_key, vk_pipeline, pipeline_desc.renderPass))
+    return vk_pipeline;
+}
+
+void d3d12_pipeline_state_compile_variant(struct d3d12_pipeline_state *state,
+        struct vkd3d_compiled_pipeline *pipeline)
+{
+    struct d3d12_graphics_pipeline_state *graphics = &state->graphics;
+    VkRenderPass vk_render_pass;
+    VkPipeline vk_pipeline;
+
+    vk_pipeline = d3d12_pipeline_state_create_variant(state, &pipeline->key,
+            d3d12_pipeline_state_get_pipeline_cache(state, state->device), &vk_render_pass);
+
+    pthread_mutex_lock(&graphics->pipeline_mutex);
+    /* A draw which finds a failed entry compiles the variant itself. */
+    if (vk_pipeline)
+        d3d12_pipeline_state_set_variant_ready_locked(state, pipeline, vk_pipeline, vk_render_pass, NULL);
+    else
+        vkd3d_atomic_uint32_store_explicit(&pipeline->status,
+                VKD3D_COMPILED_PIPELINE_FAILED, vkd3d_memory_order_release);
+    pthread_cond_broadcast(&graphics->pipeline_cond);
+    pthread_mutex_unlock(&graphics->pipeline_mutex);
+}
+
+/* Guesses the variant the first draw is most likely to use: a list topology
+ * of the declared type, tightly packed vertex buffers, a single viewport and
+ * the declared DSV format. */
+static void d3d12_pipeline_state_compile_speculative_variant(struct d3d12_pipeline_state *state,
+        const struct d3d12_pipeline_state_desc *desc)
+{
+    uint32_t vertex_strides[D3D12_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT] = {0};
+    struct d3d12_graphics_pipeline_state *graphics = &state->graphics;
+    uint32_t aligned_offsets[D3D12_VS_INPUT_REGISTER_COUNT];
+    struct d3d12_device *device = state->device;
+    struct vkd3d_compiled_pipeline **bucket;
+    struct vkd3d_compiled_pipeline *pipeline;
+    struct vkd3d_pipeline_key pipeline_key;
+    const D3D12_INPUT_ELEMENT_DESC *e;
+    const struct vkd3d_format *format;
+    D3D12_PRIMITIVE_TOPOLOGY topology;
+    unsigned int i;
+
+    if (!device->pipeline_compiler.thread_started)
+        return;
+
+    switch (desc->primitive_topology_type)
+    {
+        case D3D12_PRIMITIVE_TOPOLOGY_TYPE_POINT:
+            topology = D3D_PRIMITIVE_TOPOLOGY_POINTLIST;
+            break;
+        case D3D12_PRIMITIVE_TOPOLOGY_TYPE_LINE:
+            topology = D3D_PRIMITIVE_TOPOLOGY_LINELIST;
+            break;
+        case D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE:
+            topology = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+            break;
+        default:
+            /* The patch control point count is only known at draw time. */
+            return;
+    }
+
+    /* DSV format is taken from the bound DSV. */
+    if (graphics->null_attachment_mask & dsv_attachment_mask(graphics))
+        return;
+
+    /* Vertex strides are not part of the key if they are dynamic. */
+    if (!(graphics->dynamic_state_flags & VKD3D_DYNAMIC_STATE_VERTEX_BUFFER_STRIDE))
+    {
+        if (FAILED(compute_input_layout_offsets(device, &desc->input_layout, aligned_offsets)))
+            return;
+
+        for (i = 0; i < min(desc->input_layout.NumElements, D3D12_VS_INPUT_REGISTER_COUNT); ++i)
+        {
+            e = &desc->input_layout.pInputElementDescs[i];
+            if (!(format = vkd3d_get_format(device, e->Format, false)))
+                return;
+            vertex_strides[e->InputSlot] = max(vertex_strides[e->InputSlot],
+                    align(aligned_offsets[i] + format->byte_count, 4));
+        }
+    }
+
+    if (!(pipeline = vkd3d_malloc(sizeof(*pipeline))))
+        return;
+
+    d3d12_pipeline_state_init_pipeline_key(state, topology, 1,
+            vertex_strides, graphics->dsv_format, &pipeline_key);
+    vkd3d_compiled_pipeline_init(pipeline, &pipeline_key, true);
+
+    /* The pipeline state is not visible to the application yet, so the entry
+     * can still be unlinked if the job cannot be queued. */
+    bucket = d3d12_graphics_pipeline_state_get_bucket(graphics, &pipeline->key);
+    pthread_mutex_lock(&graphics->pipeline_mutex);
+    d3d12_graphics_pipeline_state_publish_variant_locked(bucket, pipeline);
+    pthread_mutex_unlock(&graphics->pipeline_mutex);
+
+    if (!vkd3d_pipeline_compiler_enqueue(&device->pipeline_compiler, state, pipeline))
+    {
+        *bucket = pipeline->next;
+        vkd3d_free(pipeline);
+        return;
+    }
+
+    graphics->has_speculative_pipeline = true;
+}
+
+VkPipeline d3d12_pipeline_state_get_or_create_pipeline(struct d3d12_pipeline_state *state,
+        const struct vkd3d_dynamic_state *dyn_state, VkFormat dsv_format, uint64_t owner,
+        VkRenderPass *vk_render_pass, struct vkd3d_compiled_pipeline **variant)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &state->device->vk_procs;
+    struct d3d12_graphics_pipeline_state *graphics = &state->graphics;
+    struct d3d12_device *device = state->device;
+    struct vkd3d_pipeline_key pipeline_key;
+    VkPipeline vk_pipeline;
+
+    assert(d3d12_pipeline_state_is_graphics(state));
+
+    d3d12_pipeline_state_init_pipeline_key(state, dyn_state->primitive_topology,
+            dyn_state->viewport_count, dyn_state->vertex_strides, dsv_format, &pipeline_key);
+
+    vk_pipeline = d3d12_pipeline_state_find_compiled_pipeline(state, &pipeline_key, owner, vk_render_pass, variant);
+    vkd3d_pipeline_stats_add_pipeline_lookup(&device->pipeline_stats, !!vk_pipeline);
+    if (vk_pipeline)
+        return vk_pipeline;
+
+    if (graphics->has_speculative_pipeline)
+        vkd3d_atomic_uint32_increment(&device->pipeline_compiler.miss_count, vkd3d_memory_order_relaxed);
+
+    if (!(vk_pipeline = d3d12_pipeline_state_create_variant(state, &pipeline_key,
+            d3d12_pipeline_state_get_pipeline_cache(state, device), vk_render_pass)))
+        return VK_NULL_HANDLE;
+
+    if (d3d12_pipeline_state_put_pipeline_to_cache(state, &pipeline_key, vk_pipeline, *vk_render_pass, variant))
         return vk_pipeline;
 
     /* Other thread compiled the pipeline before us. */
     VK_CALL(vkDestroyPipeline(device->vk_device, vk_pipeline, NULL));
-    vk_pipeline = d3d12_pipeline_state_find_compiled_pipeline(state, &pipeline_key, vk_render_pass);
+    vk_pipeline = d3d12_pipeline_state_find_compiled_pipeline(state, &pipeline_key, owner, vk_render_pass, variant);
     if (!vk_pipeline)
         ERR("Could not get the pipeline compiled by other thread from the cache.\n");
     return vk_pipeline;
@@ -3180,6 +5340,61 @@ bool vkd3d_bindless_state_find_binding(const struct vkd3d_bindless_state *bindle
 }
 
 /* ID3D12PipelineLibrary */
+#define VKD3D_PIPELINE_LIBRARY_MAGIC    MAKE_MAGIC('V', 'K', 'P', 'L')
+#define VKD3D_PIPELINE_LIBRARY_VERSION  1
+
+struct vkd3d_pipeline_library_header
+{
+    uint32_t magic;
+    uint32_t version;
+    struct vkd3d_pipeline_blob_device_info device_info;
+    uint32_t entry_count;
+    uint32_t padding;
+    /* struct vkd3d_pipeline_library_entry_header entries[]; */
+};
+
+struct vkd3d_pipeline_library_entry_header
+{
+    uint32_t name_size; /* including the terminator */
+    uint32_t padding;
+    uint64_t blob_size;
+    /* char name[]; padded to VKD3D_PIPELINE_BLOB_ALIGNMENT */
+    /* uint8_t blob[]; padded to VKD3D_PIPELINE_BLOB_ALIGNMENT */
+};
+
+STATIC_ASSERT(sizeof(struct vkd3d_pipeline_library_header) % VKD3D_PIPELINE_BLOB_ALIGNMENT == 0);
+STATIC_ASSERT(sizeof(struct vkd3d_pipeline_library_entry_header) % VKD3D_PIPELINE_BLOB_ALIGNMENT == 0);
+
+/* Entries loaded from the library blob point into it. Entries added with
+ * StorePipeline() hold a reference to the pipeline state, and own their name
+ * and their blob, which is only created when the library is serialized. */
+struct vkd3d_pipeline_library_entry
+{
+    struct rb_entry entry;
+    const char *name;
+    const void *blob;
+    size_t blob_size;
+    struct d3d12_pipeline_state *state;
+};
+
+static int vkd3d_pipeline_library_compare_entry(const void *key, const struct rb_entry *entry)
+{
+    return strcmp(key, RB_ENTRY_VALUE(entry, const struct vkd3d_pipeline_library_entry, entry)->name);
+}
+
+static void vkd3d_pipeline_library_free_entry(struct rb_entry *entry, void *context)
+{
+    struct vkd3d_pipeline_library_entry *e = RB_ENTRY_VALUE(entry, struct vkd3d_pipeline_library_entry, entry);
+
+    if (e->state)
+    {
+        ID3D12PipelineState_Release(&e->state->ID3D12PipelineState_iface);
+        vkd3d_free((void *)e->name);
+        vkd3d_free((void *)e->blob);
+    }
+    vkd3d_free(e);
+}
+
 static inline struct d3d12_pipeline_library *impl_from_ID3D12PipelineLibrary(d3d12_pipeline_library_iface *iface)
 {
     return CONTAINING_RECORD(iface, struct d3d12_pipeline_library, ID3D12PipelineLibrary_iface);
@@ -3228,6 +5443,8 @@ static ULONG STDMETHODCALLTYPE d3d12_pipeline_library_Release(d3d12_pipeline_lib
     {
         struct d3d12_device *device = pipeline_library->device;
         vkd3d_private_store_destroy(&pipeline_library->private_store);
+        rb_destroy(&pipeline_library->entries, vkd3d_pipeline_library_free_entry, NULL);
+        pthread_mutex_destroy(&pipeline_library->mutex);
         vkd3d_free(pipeline_library);
         d3d12_device_release(device);
     }
@@ -3284,65 +5501,383 @@ static HRESULT STDMETHODCALLTYPE d3d12_pipeline_library_GetDevice(d3d12_pipeline
     return d3d12_device_query_interface(pipeline_library->device, iid, device);
 }
 
+/* Builds the name index of the blob the library was created from. This is
+ * deferred until the library is actually used, since applications commonly
+ * create a library and only ever look up a handful of pipelines from it. */
+static void d3d12_pipeline_library_index_blob(struct d3d12_pipeline_library *pipeline_library)
+{
+    struct vkd3d_pipeline_library_entry_header entry_header;
+    struct vkd3d_pipeline_library_header header;
+    struct vkd3d_pipeline_library_entry *entry;
+    const uint8_t *ptr, *end;
+    const char *name;
+    unsigned int i;
+
+    if (pipeline_library->blob_indexed)
+        return;
+    pipeline_library->blob_indexed = true;
+
+    if (!pipeline_library->blob_length)
+        return;
+
+    memcpy(&header, pipeline_library->blob, sizeof(header));
+    ptr = (const uint8_t *)pipeline_library->blob + sizeof(header);
+    end = (const uint8_t *)pipeline_library->blob + pipeline_library->blob_length;
+
+    for (i = 0; i < header.entry_count; ++i)
+    {
+        if ((size_t)(end - ptr) < sizeof(entry_header))
+            goto corrupt;
+        memcpy(&entry_header, ptr, sizeof(entry_header));
+        ptr += sizeof(entry_header);
+
+        if (!entry_header.name_size
+                || align(entry_header.name_size, VKD3D_PIPELINE_BLOB_ALIGNMENT) > (size_t)(end - ptr))
+            goto corrupt;
+        name = (const char *)ptr;
+        if (name[entry_header.name_size - 1])
+            goto corrupt;
+        ptr += align(entry_header.name_size, VKD3D_PIPELINE_BLOB_ALIGNMENT);
+
+        if (entry_header.blob_size > (size_t)(end - ptr)
+                || align(entry_header.blob_size, VKD3D_PIPELINE_BLOB_ALIGNMENT) > (size_t)(end - ptr))
+            goto corrupt;
+
+        if (!(entry = vkd3d_malloc(sizeof(*entry))))
+            return;
+        entry->name = name;
+        entry->blob = ptr;
+        entry->blob_size = entry_header.blob_size;
+        entry->state = NULL;
+        ptr += align(entry_header.blob_size, VKD3D_PIPELINE_BLOB_ALIGNMENT);
+
+        if (rb_put(&pipeline_library->entries, entry->name, &entry->entry) == -1)
+        {
+            WARN("Ignoring duplicate pipeline %s.\n", debugstr_a(entry->name));
+            vkd3d_free(entry);
+        }
+    }
+
+    TRACE("Indexed %u pipelines.\n", header.entry_count);
+    return;
+
+corrupt:
+    ERR("Corrupt pipeline library blob, ignoring entries after %u.\n", i);
+}
+
 static HRESULT STDMETHODCALLTYPE d3d12_pipeline_library_StorePipeline(d3d12_pipeline_library_iface *iface,
         LPCWSTR name, ID3D12PipelineState *pipeline)
 {
     struct d3d12_pipeline_library *pipeline_library = impl_from_ID3D12PipelineLibrary(iface);
+    struct d3d12_pipeline_state *state = unsafe_impl_from_ID3D12PipelineState(pipeline);
+    struct vkd3d_pipeline_library_entry *entry;
+    char *name_utf8;
+    HRESULT hr;
+    int rc;
+
+    TRACE("iface %p, name %s, pipeline %p.\n", iface, debugstr_w(name, pipeline_library->device->wchar_size), pipeline);
+
+    if (!name || !state)
+        return E_INVALIDARG;
+
+    if (!(name_utf8 = vkd3d_strdup_w_utf8(name, pipeline_library->device->wchar_size, 0)))
+        return E_OUTOFMEMORY;
+
+    if ((rc = pthread_mutex_lock(&pipeline_library->mutex)))
+    {
+        ERR("Failed to lock mutex, error %d.\n", rc);
+        vkd3d_free(name_utf8);
+        return hresult_from_errno(rc);
+    }
+
+    d3d12_pipeline_library_index_blob(pipeline_library);
+
+    if (rb_get(&pipeline_library->entries, name_utf8))
+    {
+        WARN("Pipeline %s already exists.\n", debugstr_a(name_utf8));
+        hr = E_INVALIDARG;
+        goto fail;
+    }
+
+    if (!(entry = vkd3d_malloc(sizeof(*entry))))
+    {
+        hr = E_OUTOFMEMORY;
+        goto fail;
+    }
 
-    FIXME("iface %p, name %s, pipeline %p stub!\n", iface, debugstr_w(name, pipeline_library->device->wchar_size), pipeline);
+    entry->name = name_utf8;
+    entry->blob = NULL;
+    entry->blob_size = 0;
+    entry->state = state;
+    ID3D12PipelineState_AddRef(pipeline);
+    rb_put(&pipeline_library->entries, entry->name, &entry->entry);
 
+    pthread_mutex_unlock(&pipeline_library->mutex);
     return S_OK;
+
+fail:
+    pthread_mutex_unlock(&pipeline_library->mutex);
+    vkd3d_free(name_utf8);
+    return hr;
+}
+
+static HRESULT d3d12_pipeline_library_load_pipeline(struct d3d12_pipeline_library *pipeline_library,
+        LPCWSTR name, VkPipelineBindPoint bind_point, struct d3d12_pipeline_state_desc *desc,
+        struct d3d12_pipeline_state **state)
+{
+    const struct vkd3d_pipeline_library_entry *entry;
+    struct rb_entry *rb_entry;
+    char *name_utf8;
+    HRESULT hr;
+    int rc;
+
+    if (!name)
+        return E_INVALIDARG;
+
+    if (!(name_utf8 = vkd3d_strdup_w_utf8(name, pipeline_library->device->wchar_size, 0)))
+        return E_OUTOFMEMORY;
+
+    if ((rc = pthread_mutex_lock(&pipeline_library->mutex)))
+    {
+        ERR("Failed to lock mutex, error %d.\n", rc);
+        vkd3d_free(name_utf8);
+        return hresult_from_errno(rc);
+    }
+
+    d3d12_pipeline_library_index_blob(pipeline_library);
+
+    if (!(rb_entry = rb_get(&pipeline_library->entries, name_utf8)))
+    {
+        TRACE("Pipeline %s not found.\n", debugstr_a(name_utf8));
+        pthread_mutex_unlock(&pipeline_library->mutex);
+        vkd3d_free(name_utf8);
+        return E_INVALIDARG;
+    }
+    vkd3d_free(name_utf8);
+
+    entry = RB_ENTRY_VALUE(rb_entry, const struct vkd3d_pipeline_library_entry, entry);
+
+    /* Pipelines stored in this session are still alive, just hand them out. */
+    if (entry->state)
+    {
+        if (entry->state->vk_bind_point != bind_point
+                || entry->state->desc_hash != d3d12_pipeline_state_desc_get_hash(desc, bind_point))
+        {
+            WARN("Pipeline description does not match the stored pipeline.\n");
+            hr = E_INVALIDARG;
+        }
+        else
+        {
+            ID3D12PipelineState_AddRef(&entry->state->ID3D12PipelineState_iface);
+            *state = entry->state;
+            hr = S_OK;
+        }
+
+        pthread_mutex_unlock(&pipeline_library->mutex);
+        return hr;
+    }
+
+    /* Entries backed by the library blob are immutable and never removed,
+     * so there is no need to hold the lock while creating the pipeline. */
+    desc->cached_pso.pCachedBlob = entry->blob;
+    desc->cached_pso.CachedBlobSizeInBytes = entry->blob_size;
+    pthread_mutex_unlock(&pipeline_library->mutex);
+
+    return d3d12_pipeline_state_create(pipeline_library->device, bind_point, desc, state);
 }
 
 static HRESULT STDMETHODCALLTYPE d3d12_pipeline_library_LoadGraphicsPipeline(d3d12_pipeline_library_iface *iface,
         LPCWSTR name, const D3D12_GRAPHICS_PIPELINE_STATE_DESC *desc, REFIID iid, void **pipeline_state)
 {
     struct d3d12_pipeline_library *pipeline_library = impl_from_ID3D12PipelineLibrary(iface);
+    struct d3d12_pipeline_state_desc pipeline_desc;
+    struct d3d12_pipeline_state *object;
+    HRESULT hr;
 
-    FIXME("iface %p, name %s, desc %p, iid %s, pipeline_state %p stub!\n", iface,
+    TRACE("iface %p, name %s, desc %p, iid %s, pipeline_state %p.\n", iface,
             debugstr_w(name, pipeline_library->device->wchar_size),
             desc, debugstr_guid(iid), pipeline_state);
 
-    return E_INVALIDARG;
+    d3d12_pipeline_state_desc_from_d3d12_graphics_desc(&pipeline_desc, desc);
+
+    if (FAILED(hr = d3d12_pipeline_library_load_pipeline(pipeline_library, name,
+            VK_PIPELINE_BIND_POINT_GRAPHICS, &pipeline_desc, &object)))
+        return hr;
+
+    return return_interface(&object->ID3D12PipelineState_iface,
+            &IID_ID3D12PipelineState, iid, pipeline_state);
 }
 
 static HRESULT STDMETHODCALLTYPE d3d12_pipeline_library_LoadComputePipeline(d3d12_pipeline_library_iface *iface,
         LPCWSTR name, const D3D12_COMPUTE_PIPELINE_STATE_DESC *desc, REFIID iid, void **pipeline_state)
 {
     struct d3d12_pipeline_library *pipeline_library = impl_from_ID3D12PipelineLibrary(iface);
+    struct d3d12_pipeline_state_desc pipeline_desc;
+    struct d3d12_pipeline_state *object;
+    HRESULT hr;
 
-    FIXME("iface %p, name %s, desc %p, iid %s, pipeline_state %p stub!\n", iface,
+    TRACE("iface %p, name %s, desc %p, iid %s, pipeline_state %p.\n", iface,
             debugstr_w(name, pipeline_library->device->wchar_size),
             desc, debugstr_guid(iid), pipeline_state);
 
-    return E_INVALIDARG;
+    d3d12_pipeline_state_desc_from_d3d12_compute_desc(&pipeline_desc, desc);
+
+    if (FAILED(hr = d3d12_pipeline_library_load_pipeline(pipeline_library, name,
+            VK_PIPELINE_BIND_POINT_COMPUTE, &pipeline_desc, &object)))
+        return hr;
+
+    return return_interface(&object->ID3D12PipelineState_iface,
+            &IID_ID3D12PipelineState, iid, pipeline_state);
+}
+
+static size_t vkd3d_pipeline_library_entry_get_serialized_size(const struct vkd3d_pipeline_library_entry *entry)
+{
+    return sizeof(struct vkd3d_pipeline_library_entry_header)
+            + align(strlen(entry->name) + 1, VKD3D_PIPELINE_BLOB_ALIGNMENT)
+            + align(entry->blob_size, VKD3D_PIPELINE_BLOB_ALIGNMENT);
+}
+
+/* Serializes stored pipelines, and returns the size of the library blob. The
+ * pipeline blobs are kept around, so that a following Serialize() call writes
+ * exactly as many bytes as we report here, even if more pipelines end up in
+ * the driver caches in the meantime. */
+static size_t d3d12_pipeline_library_update_blobs(struct d3d12_pipeline_library *pipeline_library,
+        bool only_missing)
+{
+    struct vkd3d_pipeline_library_entry *entry;
+    size_t size, blob_size;
+    void *blob;
+    HRESULT hr;
+
+    d3d12_pipeline_library_index_blob(pipeline_library);
+
+    size = sizeof(struct vkd3d_pipeline_library_header);
+    rb_FOR_EACH_ENTRY(entry, &pipeline_library->entries, struct vkd3d_pipeline_library_entry, entry)
+    {
+        if (entry->state && (!only_missing || !entry->blob))
+        {
+            if (SUCCEEDED(hr = d3d12_pipeline_state_serialize(entry->state, &blob, &blob_size)))
+            {
+                vkd3d_free((void *)entry->blob);
+                entry->blob = blob;
+                entry->blob_size = blob_size;
+            }
+            else
+            {
+                ERR("Failed to serialize pipeline %s, hr %#x.\n", debugstr_a(entry->name), hr);
+            }
+        }
+
+        if (entry->blob)
+            size += vkd3d_pipeline_library_entry_get_serialized_size(entry);
+    }
+
+    return size;
 }
 
 static SIZE_T STDMETHODCALLTYPE d3d12_pipeline_library_GetSerializedSize(d3d12_pipeline_library_iface *iface)
 {
-    FIXME("iface %p stub!\n", iface);
+    struct d3d12_pipeline_library *pipeline_library = impl_from_ID3D12PipelineLibrary(iface);
+    size_t size;
+    int rc;
 
-    return 0;
+    TRACE("iface %p.\n", iface);
+
+    if ((rc = pthread_mutex_lock(&pipeline_library->mutex)))
+    {
+        ERR("Failed to lock mutex, error %d.\n", rc);
+        return 0;
+    }
+
+    size = d3d12_pipeline_library_update_blobs(pipeline_library, false);
+
+    pthread_mutex_unlock(&pipeline_library->mutex);
+    return size;
 }
 
 static HRESULT STDMETHODCALLTYPE d3d12_pipeline_library_Serialize(d3d12_pipeline_library_iface *iface,
         void *data, SIZE_T data_size)
 {
-    FIXME("iface %p, data %p, data_size %lu stub!\n", iface, data, data_size);
+    struct d3d12_pipeline_library *pipeline_library = impl_from_ID3D12PipelineLibrary(iface);
+    struct vkd3d_pipeline_library_entry_header entry_header;
+    struct vkd3d_pipeline_library_header header;
+    struct vkd3d_pipeline_library_entry *entry;
+    uint8_t *ptr = data;
+    size_t size;
+    int rc;
+
+    TRACE("iface %p, data %p, data_size %lu.\n", iface, data, data_size);
+
+    if ((rc = pthread_mutex_lock(&pipeline_library->mutex)))
+    {
+        ERR("Failed to lock mutex, error %d.\n", rc);
+        return hresult_from_errno(rc);
+    }
+
+    if ((size = d3d12_pipeline_library_update_blobs(pipeline_library, true)) > data_size)
+    {
+        WARN("Buffer size %lu is too small, %zu bytes required.\n", data_size, size);
+        pthread_mutex_unlock(&pipeline_library->mutex);
+        return E_INVALIDARG;
+    }
+
+    memset(&header, 0, sizeof(header));
+    header.magic = VKD3D_PIPELINE_LIBRARY_MAGIC;
+    header.version = VKD3D_PIPELINE_LIBRARY_VERSION;
+    vkd3d_pipeline_blob_init_device_info(&header.device_info, pipeline_library->device);
+    ptr += sizeof(header);
+
+    rb_FOR_EACH_ENTRY(entry, &pipeline_library->entries, struct vkd3d_pipeline_library_entry, entry)
+    {
+        if (!entry->blob)
+            continue;
+
+        memset(&entry_header, 0, sizeof(entry_header));
+        entry_header.name_size = strlen(entry->name) + 1;
+        entry_header.blob_size = entry->blob_size;
+        memcpy(ptr, &entry_header, sizeof(entry_header));
+        ptr += sizeof(entry_header);
+
+        memcpy(ptr, entry->name, entry_header.name_size);
+        memset(ptr + entry_header.name_size, 0,
+                align(entry_header.name_size, VKD3D_PIPELINE_BLOB_ALIGNMENT) - entry_header.name_size);
+        ptr += align(entry_header.name_size, VKD3D_PIPELINE_BLOB_ALIGNMENT);
+
+        memcpy(ptr, entry->blob, entry->blob_size);
+        memset(ptr + entry->blob_size, 0, align(entry->blob_size, VKD3D_PIPELINE_BLOB_ALIGNMENT) - entry->blob_size);
+        ptr += align(entry->blob_size, VKD3D_PIPELINE_BLOB_ALIGNMENT);
+
+        ++header.entry_count;
+    }
+
+    memcpy(data, &header, sizeof(header));
 
-    return E_NOTIMPL;
+    pthread_mutex_unlock(&pipeline_library->mutex);
+    return S_OK;
 }
 
 static HRESULT STDMETHODCALLTYPE d3d12_pipeline_library_LoadPipeline(d3d12_pipeline_library_iface *iface,
         LPCWSTR name, const D3D12_PIPELINE_STATE_STREAM_DESC *desc, REFIID iid, void **pipeline_state)
 {
     struct d3d12_pipeline_library *pipeline_library = impl_from_ID3D12PipelineLibrary(iface);
+    struct d3d12_pipeline_state_desc pipeline_desc;
+    struct d3d12_pipeline_state *object;
+    VkPipelineBindPoint pipeline_type;
+    HRESULT hr;
 
-    FIXME("iface %p, name %s, desc %p, iid %s, pipeline_state %p stub!\n", iface,
+    TRACE("iface %p, name %s, desc %p, iid %s, pipeline_state %p.\n", iface,
             debugstr_w(name, pipeline_library->device->wchar_size),
             desc, debugstr_guid(iid), pipeline_state);
 
-    return E_INVALIDARG;
+    if (FAILED(hr = d3d12_pipeline_state_desc_from_d3d12_stream_desc(&pipeline_desc, desc, &pipeline_type)))
+        return hr;
+
+    if (FAILED(hr = d3d12_pipeline_library_load_pipeline(pipeline_library, name,
+            pipeline_type, &pipeline_desc, &object)))
+        return hr;
+
+    return return_interface(&object->ID3D12PipelineState_iface,
+            &IID_ID3D12PipelineState, iid, pipeline_state);
 }
 
 static CONST_VTBL struct ID3D12PipelineLibrary1Vtbl d3d12_pipeline_library_vtbl =
@@ -3368,15 +5903,56 @@ static CONST_VTBL struct ID3D12PipelineLibrary1Vtbl d3d12_pipeline_library_vtbl
     d3d12_pipeline_library_LoadPipeline,
 };
 
+static HRESULT d3d12_pipeline_library_validate_blob(struct d3d12_device *device,
+        const void *blob, size_t blob_length)
+{
+    struct vkd3d_pipeline_library_header header;
+
+    if (blob_length < sizeof(header))
+    {
+        WARN("Invalid pipeline library blob size %zu.\n", blob_length);
+        return E_INVALIDARG;
+    }
+
+    memcpy(&header, blob, sizeof(header));
+    if (header.magic != VKD3D_PIPELINE_LIBRARY_MAGIC)
+    {
+        WARN("Invalid pipeline library magic %#x.\n", header.magic);
+        return E_INVALIDARG;
+    }
+    if (header.version != VKD3D_PIPELINE_LIBRARY_VERSION)
+    {
+        WARN("Pipeline library version %u does not match version %u.\n",
+                header.version, VKD3D_PIPELINE_LIBRARY_VERSION);
+        return D3D12_ERROR_DRIVER_VERSION_MISMATCH;
+    }
+
+    return vkd3d_pipeline_blob_check_device_info(&header.device_info, device);
+}
+
 static HRESULT d3d12_pipeline_library_init(struct d3d12_pipeline_library *pipeline_library,
         struct d3d12_device *device, const void *blob, size_t blob_length)
 {
     HRESULT hr;
+    int rc;
 
     memset(pipeline_library, 0, sizeof(*pipeline_library));
     pipeline_library->ID3D12PipelineLibrary_iface.lpVtbl = &d3d12_pipeline_library_vtbl;
     pipeline_library->refcount = 1;
 
+    if (blob_length && FAILED(hr = d3d12_pipeline_library_validate_blob(device, blob, blob_length)))
+        return hr;
+
+    pipeline_library->blob = blob;
+    pipeline_library->blob_length = blob_length;
+    rb_init(&pipeline_library->entries, vkd3d_pipeline_library_compare_entry);
+
+    if ((rc = pthread_mutex_init(&pipeline_library->mutex, NULL)))
+    {
+        ERR("Failed to initialize mutex, error %d.\n", rc);
+        return hresult_from_errno(rc);
+    }
+
     if (FAILED(hr = vkd3d_private_store_init(&pipeline_library->private_store)))
         goto fail;
 
@@ -3384,6 +5960,7 @@ static HRESULT d3d12_pipeline_library_init(struct d3d12_pipeline_library *pipeli
     return S_OK;
 
 fail:
+    pthread_mutex_destroy(&pipeline_library->mutex);
     return hr;
 }
 
@@ -1175,6 +1175,12 @@ HRESULT vkd3d_set_vk_object_name(struct d3d12_device *device, uint64_t vk_object
     return hresult_from_vk_result(vr);
 }
 
+/* Identifies the vkd3d build in on-disk caches. */
+uint64_t vkd3d_get_build_hash(void)
+{
+    return vkd3d_hash_fnv1a_string(VKD3D_HASH_FNV1A_INIT, vkd3d_build);
+}
+
 static struct d3d_blob *impl_from_ID3DBlob(ID3DBlob *iface)
 {
     return CONTAINING_RECORD(iface, struct d3d_blob, ID3DBlob_iface);
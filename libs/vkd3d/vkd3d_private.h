@@ -124,6 +124,7 @@ struct vkd3d_vulkan_info
     bool EXT_custom_border_color;
     bool EXT_depth_clip_enable;
     bool EXT_descriptor_indexing;
+    bool EXT_extended_dynamic_state;
     bool EXT_inline_uniform_block;
     bool EXT_robustness2;
     bool EXT_sampler_filter_minmax;
@@ -160,6 +161,8 @@ struct vkd3d_vulkan_info
 enum vkd3d_config_flags
 {
     VKD3D_CONFIG_FLAG_VULKAN_DEBUG = 0x00000001,
+    VKD3D_CONFIG_FLAG_NO_PIPELINE_PRECOMPILE = 0x00000002,
+    VKD3D_CONFIG_FLAG_OPTIMIZE_SHADERS = 0x00000004,
 };
 
 struct vkd3d_instance
@@ -281,11 +284,14 @@ struct vkd3d_render_pass_key
 
 struct vkd3d_render_pass_entry;
 
+#define VKD3D_RENDER_PASS_CACHE_BUCKET_COUNT 64
+
 struct vkd3d_render_pass_cache
 {
-    struct vkd3d_render_pass_entry *render_passes;
+    /* Lookups walk the buckets without locking, the mutex serialises inserts. */
+    struct vkd3d_render_pass_entry *buckets[VKD3D_RENDER_PASS_CACHE_BUCKET_COUNT];
+    pthread_mutex_t mutex;
     size_t render_pass_count;
-    size_t render_passes_size;
 };
 
 void vkd3d_render_pass_cache_cleanup(struct vkd3d_render_pass_cache *cache,
@@ -293,7 +299,87 @@ void vkd3d_render_pass_cache_cleanup(struct vkd3d_render_pass_cache *cache,
 HRESULT vkd3d_render_pass_cache_find(struct vkd3d_render_pass_cache *cache,
         struct d3d12_device *device, const struct vkd3d_render_pass_key *key,
         VkRenderPass *vk_render_pass) DECLSPEC_HIDDEN;
-void vkd3d_render_pass_cache_init(struct vkd3d_render_pass_cache *cache) DECLSPEC_HIDDEN;
+HRESULT vkd3d_render_pass_cache_init(struct vkd3d_render_pass_cache *cache) DECLSPEC_HIDDEN;
+void vkd3d_render_pass_cache_prepopulate(struct vkd3d_render_pass_cache *cache,
+        struct d3d12_device *device) DECLSPEC_HIDDEN;
+
+struct vkd3d_shader_cache_key
+{
+    uint64_t dxbc_hash;
+    uint64_t args_hash;
+};
+
+/* Persistent DXBC -> SPIR-V cache, enabled with VKD3D_SHADER_CACHE_PATH. */
+struct vkd3d_shader_cache
+{
+    pthread_mutex_t mutex;
+    struct rb_tree tree;
+    struct vkd3d_memory_mapped_file mapped_file;
+    FILE *file;
+    uint64_t max_size;
+    bool enabled;
+};
+
+HRESULT vkd3d_shader_cache_init(struct vkd3d_shader_cache *cache) DECLSPEC_HIDDEN;
+void vkd3d_shader_cache_cleanup(struct vkd3d_shader_cache *cache) DECLSPEC_HIDDEN;
+bool vkd3d_shader_cache_key_init(struct vkd3d_shader_cache_key *key, const struct vkd3d_shader_code *dxbc,
+        uint32_t compiler_options, const struct vkd3d_shader_interface_info *shader_interface,
+        const struct vkd3d_shader_compile_arguments *compile_args) DECLSPEC_HIDDEN;
+/* Returned code is owned by the cache and stays valid until cleanup. */
+bool vkd3d_shader_cache_find(struct vkd3d_shader_cache *cache, const struct vkd3d_shader_cache_key *key,
+        struct vkd3d_shader_code *spirv) DECLSPEC_HIDDEN;
+void vkd3d_shader_cache_put(struct vkd3d_shader_cache *cache, const struct vkd3d_shader_cache_key *key,
+        const struct vkd3d_shader_code *spirv) DECLSPEC_HIDDEN;
+
+/* Shader modules shared by all pipeline states which use the same DXBC with
+ * the same shader interface and compile arguments. */
+struct vkd3d_shader_module
+{
+    struct rb_entry entry;
+    struct vkd3d_shader_cache_key key;
+    bool cached;
+    LONG refcount;
+
+    VkShaderModule vk_module;
+    /* Empty when the shader cache holds the SPIR-V. */
+    struct vkd3d_shader_code spirv;
+    size_t spirv_size;
+};
+
+struct vkd3d_shader_module_cache
+{
+    pthread_mutex_t mutex;
+    struct rb_tree tree;
+};
+
+HRESULT vkd3d_shader_module_cache_init(struct vkd3d_shader_module_cache *cache) DECLSPEC_HIDDEN;
+void vkd3d_shader_module_cache_cleanup(struct vkd3d_shader_module_cache *cache) DECLSPEC_HIDDEN;
+void vkd3d_shader_module_release(struct vkd3d_shader_module *module, struct d3d12_device *device) DECLSPEC_HIDDEN;
+
+/* Keeps the device VkPipelineCache on disk, see VKD3D_PIPELINE_CACHE_PATH. */
+struct vkd3d_persistent_pipeline_cache
+{
+    char path[VKD3D_PATH_MAX];
+    bool enabled;
+
+    union vkd3d_thread_handle thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    bool thread_started;
+    bool should_exit;
+
+    uint64_t disk_data_hash;
+    size_t written_size;
+    struct d3d12_device *device;
+};
+
+/* Returns the initial cache data, to be freed by the caller, or NULL. */
+void *vkd3d_persistent_pipeline_cache_init(struct vkd3d_persistent_pipeline_cache *cache,
+        struct d3d12_device *device, const char *cache_dir, size_t *initial_data_size) DECLSPEC_HIDDEN;
+void vkd3d_persistent_pipeline_cache_start(struct vkd3d_persistent_pipeline_cache *cache,
+        struct d3d12_device *device) DECLSPEC_HIDDEN;
+void vkd3d_persistent_pipeline_cache_cleanup(struct vkd3d_persistent_pipeline_cache *cache,
+        struct d3d12_device *device) DECLSPEC_HIDDEN;
 
 struct vkd3d_private_store
 {
@@ -636,6 +722,23 @@ void d3d12_desc_write_atomic(struct d3d12_desc *dst, const struct d3d12_desc *sr
 
 bool vkd3d_create_raw_buffer_view(struct d3d12_device *device,
         D3D12_GPU_VIRTUAL_ADDRESS gpu_address, VkBufferView *vk_buffer_view) DECLSPEC_HIDDEN;
+
+/* Samplers shared by all descriptor heaps and root signatures which use
+ * equivalent descriptors. Entries are looked up both by descriptor and by
+ * Vulkan handle, which is what descriptors and root signatures keep. */
+struct vkd3d_sampler_cache
+{
+    pthread_mutex_t mutex;
+    struct rb_tree desc_tree;
+    struct rb_tree handle_tree;
+};
+
+HRESULT vkd3d_sampler_cache_init(struct vkd3d_sampler_cache *cache) DECLSPEC_HIDDEN;
+void vkd3d_sampler_cache_cleanup(struct vkd3d_sampler_cache *cache) DECLSPEC_HIDDEN;
+void vkd3d_sampler_cache_release(struct vkd3d_sampler_cache *cache, struct d3d12_device *device,
+        VkSampler vk_sampler) DECLSPEC_HIDDEN;
+
+/* Returns a reference to a cached sampler, see vkd3d_sampler_cache_release(). */
 HRESULT d3d12_create_static_sampler(struct d3d12_device *device,
         const D3D12_STATIC_SAMPLER_DESC *desc, VkSampler *vk_sampler) DECLSPEC_HIDDEN;
 
@@ -864,6 +967,12 @@ struct d3d12_root_signature
     unsigned int static_sampler_count;
     VkSampler *static_samplers;
 
+    /* Identical blobs share one root signature, see vkd3d_root_signature_cache. */
+    struct rb_entry cache_entry;
+    uint64_t blob_hash;
+    void *blob;
+    size_t blob_size;
+
     struct d3d12_device *device;
 
     struct vkd3d_private_store private_store;
@@ -871,29 +980,52 @@ struct d3d12_root_signature
 
 HRESULT d3d12_root_signature_create(struct d3d12_device *device, const void *bytecode,
         size_t bytecode_length, struct d3d12_root_signature **root_signature) DECLSPEC_HIDDEN;
+
+/* Root signatures by serialized blob. An entry is removed under the lock when
+ * its refcount drops to zero, so entries found in the tree are always alive. */
+struct vkd3d_root_signature_cache
+{
+    pthread_mutex_t mutex;
+    struct rb_tree tree;
+};
+
+HRESULT vkd3d_root_signature_cache_init(struct vkd3d_root_signature_cache *cache) DECLSPEC_HIDDEN;
+void vkd3d_root_signature_cache_cleanup(struct vkd3d_root_signature_cache *cache) DECLSPEC_HIDDEN;
 struct d3d12_root_signature *unsafe_impl_from_ID3D12RootSignature(ID3D12RootSignature *iface) DECLSPEC_HIDDEN;
 
 int vkd3d_parse_root_signature_v_1_0(const struct vkd3d_shader_code *dxbc,
         struct vkd3d_versioned_root_signature_desc *desc) DECLSPEC_HIDDEN;
 
-#define VKD3D_MAX_DYNAMIC_STATE_COUNT (5)
+#define VKD3D_MAX_DYNAMIC_STATE_COUNT (9)
 
 enum vkd3d_dynamic_state_flag
 {
-    VKD3D_DYNAMIC_STATE_VIEWPORT          = (1 << 0),
-    VKD3D_DYNAMIC_STATE_SCISSOR           = (1 << 1),
-    VKD3D_DYNAMIC_STATE_BLEND_CONSTANTS   = (1 << 2),
-    VKD3D_DYNAMIC_STATE_STENCIL_REFERENCE = (1 << 3),
-    VKD3D_DYNAMIC_STATE_DEPTH_BOUNDS      = (1 << 4),
+    VKD3D_DYNAMIC_STATE_VIEWPORT              = (1 << 0),
+    VKD3D_DYNAMIC_STATE_SCISSOR               = (1 << 1),
+    VKD3D_DYNAMIC_STATE_BLEND_CONSTANTS       = (1 << 2),
+    VKD3D_DYNAMIC_STATE_STENCIL_REFERENCE     = (1 << 3),
+    VKD3D_DYNAMIC_STATE_DEPTH_BOUNDS          = (1 << 4),
+    VKD3D_DYNAMIC_STATE_TOPOLOGY              = (1 << 5),
+    VKD3D_DYNAMIC_STATE_VERTEX_BUFFER_STRIDE  = (1 << 6),
+    /* Viewport and scissor counts are set along with the viewports and scissors. */
+    VKD3D_DYNAMIC_STATE_VIEWPORT_COUNT        = (1 << 7),
 };
 
+#define VKD3D_COMPILED_PIPELINE_BUCKET_COUNT 16
+
+struct vkd3d_compiled_pipeline;
+
 struct d3d12_graphics_pipeline_state
 {
     VkPipelineShaderStageCreateInfo stages[VKD3D_MAX_SHADER_STAGES];
+    struct vkd3d_shader_module *modules[VKD3D_MAX_SHADER_STAGES];
     size_t stage_count;
 
     VkVertexInputAttributeDescription attributes[D3D12_VS_INPUT_REGISTER_COUNT];
     VkVertexInputRate input_rates[D3D12_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT];
+    /* The extent of the attributes read from each input slot, which dynamic
+     * strides other than 0 must cover. */
+    uint32_t min_vertex_strides[D3D12_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT];
     VkVertexInputBindingDivisorDescriptionEXT instance_divisors[D3D12_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT];
     size_t instance_divisor_count;
     size_t attribute_count;
@@ -923,7 +1055,12 @@ struct d3d12_graphics_pipeline_state
 
     const struct d3d12_root_signature *root_signature;
 
-    struct list compiled_pipelines;
+    /* Compiled pipeline variants, hashed by key. Lookups walk the buckets
+     * without locking; entries are only prepended, under pipeline_mutex. */
+    struct vkd3d_compiled_pipeline *compiled_pipelines[VKD3D_COMPILED_PIPELINE_BUCKET_COUNT];
+    pthread_mutex_t pipeline_mutex;
+    pthread_cond_t pipeline_cond;
+    bool has_speculative_pipeline;
 
     bool xfb_enabled;
 };
@@ -936,6 +1073,8 @@ static inline unsigned int dsv_attachment_mask(const struct d3d12_graphics_pipel
 struct d3d12_compute_pipeline_state
 {
     VkPipeline vk_pipeline;
+    VkPipelineLayout vk_pipeline_layout;
+    struct vkd3d_shader_module *module;
 };
 
 /* ID3D12PipelineState */
@@ -951,6 +1090,11 @@ struct d3d12_pipeline_state
     };
     VkPipelineBindPoint vk_bind_point;
 
+    /* Seeded from the cached blob the pipeline state was created from.
+     * VK_NULL_HANDLE when the device-wide cache is used instead. */
+    VkPipelineCache vk_pso_cache;
+    uint64_t desc_hash;
+
     struct d3d12_device *device;
 
     struct vkd3d_private_store private_store;
@@ -1004,11 +1148,184 @@ struct d3d12_pipeline_state_desc
     D3D12_PIPELINE_STATE_FLAGS flags;
 };
 
+void d3d12_pipeline_state_desc_from_d3d12_graphics_desc(struct d3d12_pipeline_state_desc *desc,
+        const D3D12_GRAPHICS_PIPELINE_STATE_DESC *d3d12_desc) DECLSPEC_HIDDEN;
+void d3d12_pipeline_state_desc_from_d3d12_compute_desc(struct d3d12_pipeline_state_desc *desc,
+        const D3D12_COMPUTE_PIPELINE_STATE_DESC *d3d12_desc) DECLSPEC_HIDDEN;
+HRESULT d3d12_pipeline_state_desc_from_d3d12_stream_desc(struct d3d12_pipeline_state_desc *desc,
+        const D3D12_PIPELINE_STATE_STREAM_DESC *d3d12_desc, VkPipelineBindPoint *vk_bind_point) DECLSPEC_HIDDEN;
+
 HRESULT d3d12_pipeline_state_create(struct d3d12_device *device, VkPipelineBindPoint bind_point,
         const struct d3d12_pipeline_state_desc *desc, struct d3d12_pipeline_state **state) DECLSPEC_HIDDEN;
+/* If the returned variant is not NULL, the caller owns a reference to it,
+ * see vkd3d_compiled_pipeline_release(). No reference is returned for
+ * variants already referenced by the given owner, see
+ * vkd3d_compiled_pipeline_set_owner(). */
 VkPipeline d3d12_pipeline_state_get_or_create_pipeline(struct d3d12_pipeline_state *state,
-        const struct vkd3d_dynamic_state *dyn_state, VkFormat dsv_format, VkRenderPass *vk_render_pass) DECLSPEC_HIDDEN;
+        const struct vkd3d_dynamic_state *dyn_state, VkFormat dsv_format, uint64_t owner,
+        VkRenderPass *vk_render_pass, struct vkd3d_compiled_pipeline **variant) DECLSPEC_HIDDEN;
+D3D12_PRIMITIVE_TOPOLOGY d3d12_pipeline_state_get_static_topology(const struct d3d12_pipeline_state *state,
+        D3D12_PRIMITIVE_TOPOLOGY topology) DECLSPEC_HIDDEN;
+VkPrimitiveTopology vk_topology_from_d3d12_topology(D3D12_PRIMITIVE_TOPOLOGY topology) DECLSPEC_HIDDEN;
+bool d3d12_pipeline_state_has_dynamic_vertex_strides(const struct d3d12_pipeline_state *state,
+        const uint32_t *vertex_strides) DECLSPEC_HIDDEN;
+void d3d12_pipeline_state_compile_variant(struct d3d12_pipeline_state *state,
+        struct vkd3d_compiled_pipeline *pipeline) DECLSPEC_HIDDEN;
 struct d3d12_pipeline_state *unsafe_impl_from_ID3D12PipelineState(ID3D12PipelineState *iface) DECLSPEC_HIDDEN;
+void vkd3d_compiled_pipeline_release(struct vkd3d_compiled_pipeline *pipeline,
+        struct d3d12_device *device) DECLSPEC_HIDDEN;
+void vkd3d_compiled_pipelines_release(struct vkd3d_compiled_pipeline **pipelines, size_t count,
+        struct d3d12_device *device) DECLSPEC_HIDDEN;
+void vkd3d_compiled_pipeline_set_owner(struct vkd3d_compiled_pipeline *pipeline, uint64_t owner) DECLSPEC_HIDDEN;
+
+/* Bounds the number and estimated size of compiled graphics pipeline
+ * variants, see VKD3D_PIPELINE_VARIANT_LIMIT. Variants are evicted in
+ * approximately least recently used order: uses only stamp the variant with
+ * the budget clock, and the mutex is only taken to insert or evict variants.
+ * Command allocators hold references to the variants recorded into them, so
+ * that the Vulkan pipeline of an evicted variant is only destroyed once no
+ * command buffer uses it. */
+struct vkd3d_pipeline_variant_budget
+{
+    pthread_mutex_t mutex;
+    struct list lru;
+    bool enabled;
+
+    uint32_t max_count;
+    uint64_t max_size;
+    uint32_t count;
+    uint64_t size;
+
+    uint64_t time;
+    uint64_t owner_count;
+};
+
+HRESULT vkd3d_pipeline_variant_budget_init(struct vkd3d_pipeline_variant_budget *budget) DECLSPEC_HIDDEN;
+void vkd3d_pipeline_variant_budget_cleanup(struct vkd3d_pipeline_variant_budget *budget) DECLSPEC_HIDDEN;
+void vkd3d_pipeline_variant_budget_get_usage(struct vkd3d_pipeline_variant_budget *budget,
+        uint64_t *count, uint64_t *size) DECLSPEC_HIDDEN;
+uint64_t vkd3d_pipeline_variant_budget_get_owner(struct vkd3d_pipeline_variant_budget *budget) DECLSPEC_HIDDEN;
+
+#define VKD3D_MAX_PIPELINE_WORKER_COUNT 8
+
+/* Independent unit of work, e.g. translating one shader stage. Tasks are
+ * owned by the caller of vkd3d_pipeline_compiler_run_tasks(). */
+struct vkd3d_pipeline_task
+{
+    struct list entry;
+    void (*callback)(void *userdata);
+    void *userdata;
+
+    /* Internal to the worker pool. */
+    bool queued;
+    unsigned int *pending_count;
+};
+
+/* Compiles the most likely graphics pipeline variant of new pipeline states on
+ * a worker thread, so that the first draw does not have to. */
+struct vkd3d_pipeline_compiler
+{
+    union vkd3d_thread_handle thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    bool thread_started;
+    bool should_exit;
+
+    struct list jobs;
+    const struct d3d12_pipeline_state *active_state;
+
+    uint32_t speculative_count;
+    uint32_t hit_count;
+    uint32_t miss_count;
+    uint32_t wait_count;
+
+    /* Worker pool for tasks which pipeline creation waits on. */
+    union vkd3d_thread_handle workers[VKD3D_MAX_PIPELINE_WORKER_COUNT];
+    unsigned int worker_count;
+    pthread_mutex_t task_mutex;
+    pthread_cond_t task_cond;
+    pthread_cond_t task_done_cond;
+    struct list tasks;
+    bool workers_should_exit;
+
+    struct d3d12_device *device;
+};
+
+HRESULT vkd3d_pipeline_compiler_init(struct vkd3d_pipeline_compiler *compiler,
+        struct d3d12_device *device) DECLSPEC_HIDDEN;
+void vkd3d_pipeline_compiler_cleanup(struct vkd3d_pipeline_compiler *compiler,
+        struct d3d12_device *device) DECLSPEC_HIDDEN;
+bool vkd3d_pipeline_compiler_enqueue(struct vkd3d_pipeline_compiler *compiler,
+        struct d3d12_pipeline_state *state, struct vkd3d_compiled_pipeline *pipeline) DECLSPEC_HIDDEN;
+void vkd3d_pipeline_compiler_cancel(struct vkd3d_pipeline_compiler *compiler,
+        const struct d3d12_pipeline_state *state) DECLSPEC_HIDDEN;
+void vkd3d_pipeline_compiler_run_tasks(struct vkd3d_pipeline_compiler *compiler,
+        struct vkd3d_pipeline_task *tasks, unsigned int task_count) DECLSPEC_HIDDEN;
+
+/* Pipeline creation statistics, see vkd3d_get_pipeline_statistics() and
+ * VKD3D_PIPELINE_STATS_FILE. */
+struct vkd3d_pipeline_stats
+{
+    /* Counters are updated atomically, the lock only serializes updates of
+     * the maximum durations. */
+    spinlock_t lock;
+    struct vkd3d_pipeline_statistics data;
+
+    char dump_path[VKD3D_PATH_MAX];
+    bool dump_enabled;
+
+    union vkd3d_thread_handle thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    bool thread_started;
+    bool should_exit;
+};
+
+void vkd3d_pipeline_stats_init(struct vkd3d_pipeline_stats *stats) DECLSPEC_HIDDEN;
+void vkd3d_pipeline_stats_start(struct vkd3d_pipeline_stats *stats, struct d3d12_device *device) DECLSPEC_HIDDEN;
+void vkd3d_pipeline_stats_cleanup(struct vkd3d_pipeline_stats *stats, struct d3d12_device *device) DECLSPEC_HIDDEN;
+void vkd3d_pipeline_stats_get(struct vkd3d_pipeline_stats *stats,
+        struct vkd3d_pipeline_statistics *data) DECLSPEC_HIDDEN;
+void vkd3d_pipeline_stats_add_timing(struct vkd3d_pipeline_stats *stats,
+        enum vkd3d_pipeline_timing timing, uint64_t duration_ns) DECLSPEC_HIDDEN;
+void vkd3d_pipeline_stats_add_pipeline_lookup(struct vkd3d_pipeline_stats *stats, bool hit) DECLSPEC_HIDDEN;
+void vkd3d_pipeline_stats_add_render_pass_lookup(struct vkd3d_pipeline_stats *stats, bool hit) DECLSPEC_HIDDEN;
+void vkd3d_pipeline_stats_add_sampler_lookup(struct vkd3d_pipeline_stats *stats, bool hit) DECLSPEC_HIDDEN;
+void vkd3d_pipeline_stats_add_pipeline_eviction(struct vkd3d_pipeline_stats *stats) DECLSPEC_HIDDEN;
+
+/* Appends created pipeline states to the archive named by
+ * VKD3D_PIPELINE_RECORD_PATH, for replay by vkd3d-replay. */
+struct vkd3d_pipeline_recorder
+{
+    pthread_mutex_t mutex;
+    FILE *file;
+    struct rb_tree records;
+    bool enabled;
+};
+
+void vkd3d_pipeline_recorder_init(struct vkd3d_pipeline_recorder *recorder) DECLSPEC_HIDDEN;
+void vkd3d_pipeline_recorder_cleanup(struct vkd3d_pipeline_recorder *recorder) DECLSPEC_HIDDEN;
+void vkd3d_pipeline_recorder_record_root_signature(struct vkd3d_pipeline_recorder *recorder,
+        uint64_t hash, const void *bytecode, size_t bytecode_length) DECLSPEC_HIDDEN;
+void vkd3d_pipeline_recorder_record_pipeline(struct vkd3d_pipeline_recorder *recorder,
+        VkPipelineBindPoint bind_point, const struct d3d12_pipeline_state_desc *desc,
+        uint64_t root_signature_hash) DECLSPEC_HIDDEN;
+
+/* Lists created pipeline states in the directory named by
+ * VKD3D_SHADER_DUMP_PATH, by the hashes of their dumped shaders. */
+struct vkd3d_pipeline_index
+{
+    pthread_mutex_t mutex;
+    FILE *file;
+    struct rb_tree pipelines;
+    bool enabled;
+};
+
+void vkd3d_pipeline_index_init(struct vkd3d_pipeline_index *index) DECLSPEC_HIDDEN;
+void vkd3d_pipeline_index_cleanup(struct vkd3d_pipeline_index *index) DECLSPEC_HIDDEN;
+void vkd3d_pipeline_index_add_pipeline(struct vkd3d_pipeline_index *index,
+        VkPipelineBindPoint bind_point, const struct d3d12_pipeline_state_desc *desc,
+        uint64_t root_signature_hash) DECLSPEC_HIDDEN;
 
 /* ID3D12PipelineLibrary */
 typedef ID3D12PipelineLibrary1 d3d12_pipeline_library_iface;
@@ -1018,6 +1335,16 @@ struct d3d12_pipeline_library
     d3d12_pipeline_library_iface ID3D12PipelineLibrary_iface;
     LONG refcount;
 
+    pthread_mutex_t mutex;
+    struct rb_tree entries;
+
+    /* The blob passed at creation time is owned by the application and must
+     * outlive the library, so entries point into it and it is only indexed
+     * on first use. */
+    const void *blob;
+    size_t blob_length;
+    bool blob_indexed;
+
     struct d3d12_device *device;
     struct vkd3d_private_store private_store;
 };
@@ -1076,6 +1403,11 @@ struct d3d12_command_allocator
     size_t views_size;
     size_t view_count;
 
+    struct vkd3d_compiled_pipeline **pipelines;
+    size_t pipelines_size;
+    size_t pipeline_count;
+    uint64_t pipeline_owner;
+
     VkBufferView *buffer_views;
     size_t buffer_views_size;
     size_t buffer_view_count;
@@ -1165,6 +1497,16 @@ struct vkd3d_dynamic_state
 
     uint32_t vertex_strides[D3D12_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT];
     D3D12_PRIMITIVE_TOPOLOGY primitive_topology;
+
+    /* Only used with VK_EXT_extended_dynamic_state, where vertex buffers
+     * are bound along with their strides before each draw. */
+    VkBuffer vertex_buffers[D3D12_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT];
+    VkDeviceSize vertex_offsets[D3D12_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT];
+    uint32_t vertex_buffer_mask;
+    uint32_t dirty_vertex_buffers;
+    /* Whether the bound pipeline takes its strides from vertex buffer
+     * bindings rather than from the pipeline. */
+    bool dynamic_vertex_strides;
 };
 
 /* ID3D12CommandList */
@@ -1637,6 +1979,7 @@ struct vkd3d_physical_device_info
     VkPhysicalDeviceFloat16Int8FeaturesKHR float16_int8_features;
     VkPhysicalDeviceShaderSubgroupExtendedTypesFeaturesKHR subgroup_extended_types_features;
     VkPhysicalDeviceRobustness2FeaturesEXT robustness2_features;
+    VkPhysicalDeviceExtendedDynamicStateFeaturesEXT extended_dynamic_state_features;
 
     VkPhysicalDeviceFeatures2 features2;
 };
@@ -1685,7 +2028,17 @@ struct d3d12_device
 
     pthread_mutex_t mutex;
     struct vkd3d_render_pass_cache render_pass_cache;
+    struct vkd3d_root_signature_cache root_signature_cache;
     VkPipelineCache vk_pipeline_cache;
+    struct vkd3d_persistent_pipeline_cache persistent_pipeline_cache;
+    struct vkd3d_shader_cache shader_cache;
+    struct vkd3d_shader_module_cache shader_module_cache;
+    struct vkd3d_sampler_cache sampler_cache;
+    struct vkd3d_pipeline_variant_budget pipeline_variant_budget;
+    struct vkd3d_pipeline_compiler pipeline_compiler;
+    struct vkd3d_pipeline_stats pipeline_stats;
+    struct vkd3d_pipeline_recorder pipeline_recorder;
+    struct vkd3d_pipeline_index pipeline_index;
 
     VkPhysicalDeviceMemoryProperties memory_properties;
 
@@ -1925,6 +2278,8 @@ HRESULT vkd3d_load_vk_device_procs(struct vkd3d_vk_device_procs *procs,
 
 extern const char vkd3d_build[];
 
+uint64_t vkd3d_get_build_hash(void) DECLSPEC_HIDDEN;
+
 VkResult vkd3d_set_vk_object_name_utf8(struct d3d12_device *device, uint64_t vk_object,
         VkObjectType vk_object_type, const char *name) DECLSPEC_HIDDEN;
 HRESULT vkd3d_set_vk_object_name(struct d3d12_device *device, uint64_t vk_object,
@@ -206,6 +206,12 @@ VK_DEVICE_EXT_PFN(vkCmdBeginDebugUtilsLabelEXT)
 VK_DEVICE_EXT_PFN(vkCmdEndDebugUtilsLabelEXT)
 VK_DEVICE_EXT_PFN(vkCmdInsertDebugUtilsLabelEXT)
 
+/* VK_EXT_extended_dynamic_state */
+VK_DEVICE_EXT_PFN(vkCmdBindVertexBuffers2EXT)
+VK_DEVICE_EXT_PFN(vkCmdSetPrimitiveTopologyEXT)
+VK_DEVICE_EXT_PFN(vkCmdSetScissorWithCountEXT)
+VK_DEVICE_EXT_PFN(vkCmdSetViewportWithCountEXT)
+
 /* VK_EXT_transform_feedback */
 VK_DEVICE_EXT_PFN(vkCmdBeginQueryIndexedEXT)
 VK_DEVICE_EXT_PFN(vkCmdBeginTransformFeedbackEXT)
@@ -17,6 +17,7 @@
  */
 
 #include <fcntl.h>
+#include <inttypes.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -24,6 +25,17 @@
 
 #include "vkd3d_common.h"
 #include "vkd3d_shader.h"
+#include "vkd3d_threads.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#define MAX_THREAD_COUNT 64
 
 static bool read_shader(struct vkd3d_shader_code *shader, const char *filename)
 {
@@ -91,6 +103,7 @@ static const struct
 compiler_options[] =
 {
     {"--strip-debug", VKD3D_SHADER_STRIP_DEBUG},
+    {"--optimize",    VKD3D_SHADER_OPTIMIZE},
 };
 
 static void print_usage(const char *program_name)
@@ -101,34 +114,127 @@ static void print_usage(const char *program_name)
     for (i = 0; i < ARRAY_SIZE(compiler_options); ++i)
         fprintf(stderr, " [%s]", compiler_options[i].name);
     fprintf(stderr, " [-o <out_spirv_filename>] <dxbc_filename>\n");
+    fprintf(stderr, "       %s --batch", program_name);
+    for (i = 0; i < ARRAY_SIZE(compiler_options); ++i)
+        fprintf(stderr, " [%s]", compiler_options[i].name);
+    fprintf(stderr, " [--threads <count>] [--output-dir <spirv_directory>] [--report <report_filename>]"
+            " [--report-format csv|json] <dxbc_directory|list_filename>\n");
 }
 
+enum report_format
+{
+    REPORT_FORMAT_CSV,
+    REPORT_FORMAT_JSON,
+};
+
 struct options
 {
     const char *filename;
     const char *output_filename;
     unsigned int compiler_options;
+
+    bool batch;
+    unsigned int thread_count;
+    const char *output_dir;
+    const char *report_filename;
+    enum report_format report_format;
 };
 
+static unsigned int get_cpu_count(void)
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+
+    return count > 0 ? count : 1;
+#endif
+}
+
+static uint64_t get_time_ns(void)
+{
+#ifdef _WIN32
+    LARGE_INTEGER counter, frequency;
+
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return (uint64_t)((double)counter.QuadPart * 1000000000.0 / (double)frequency.QuadPart);
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+#endif
+}
+
 static bool parse_command_line(int argc, char **argv, struct options *options)
 {
-    unsigned int i, j;
+    unsigned int i, j, last_arg;
 
     if (argc < 2)
         return false;
+    last_arg = argc - 1;
 
     memset(options, 0, sizeof(*options));
+    options->thread_count = get_cpu_count();
 
-    for (i = 1; i < argc - 1; ++i)
+    for (i = 1; i < last_arg; ++i)
     {
         if (!strcmp(argv[i], "-o"))
         {
-            if (i + 1 >= argc - 1)
+            if (i + 1 >= last_arg)
                 return false;
             options->output_filename = argv[++i];
             continue;
         }
 
+        if (!strcmp(argv[i], "--batch"))
+        {
+            options->batch = true;
+            continue;
+        }
+
+        if (!strcmp(argv[i], "--threads"))
+        {
+            if (i + 1 >= last_arg)
+                return false;
+            options->thread_count = atoi(argv[++i]);
+            continue;
+        }
+
+        if (!strcmp(argv[i], "--output-dir"))
+        {
+            if (i + 1 >= last_arg)
+                return false;
+            options->output_dir = argv[++i];
+            continue;
+        }
+
+        if (!strcmp(argv[i], "--report"))
+        {
+            if (i + 1 >= last_arg)
+                return false;
+            options->report_filename = argv[++i];
+            continue;
+        }
+
+        if (!strcmp(argv[i], "--report-format"))
+        {
+            if (i + 1 >= last_arg)
+                return false;
+            ++i;
+            if (!strcmp(argv[i], "csv"))
+                options->report_format = REPORT_FORMAT_CSV;
+            else if (!strcmp(argv[i], "json"))
+                options->report_format = REPORT_FORMAT_JSON;
+            else
+                return false;
+            continue;
+        }
+
         for (j = 0; j < ARRAY_SIZE(compiler_options); ++j)
         {
             if (!strcmp(argv[i], compiler_options[j].name))
@@ -141,8 +247,479 @@ static bool parse_command_line(int argc, char **argv, struct options *options)
             return false;
     }
 
-    options->filename = argv[argc - 1];
+    /* Batch options only make sense together with --batch, and the single
+     * shader output file only without it. */
+    if (options->batch ? !!options->output_filename
+            : options->output_dir || options->report_filename || options->report_format)
+        return false;
+
+    options->thread_count = max(min(options->thread_count, MAX_THREAD_COUNT), 1);
+    options->filename = argv[last_arg];
+    return true;
+}
+
+struct batch_shader
+{
+    char *filename;
+    int ret;
+    size_t dxbc_size;
+    size_t spirv_size;
+    uint64_t compile_time_ns;
+    uint64_t parse_time_ns;
+    uint64_t emit_time_ns;
+};
+
+struct batch
+{
+    const struct options *options;
+
+    struct batch_shader *shaders;
+    size_t shader_count;
+    size_t shader_capacity;
+
+    pthread_mutex_t mutex;
+    size_t next_shader;
+};
+
+struct batch_totals
+{
+    size_t shader_count;
+    size_t failure_count;
+    uint64_t dxbc_size;
+    uint64_t spirv_size;
+    uint64_t compile_time_ns;
+    uint64_t parse_time_ns;
+    uint64_t emit_time_ns;
+};
+
+static bool array_reserve(void **elements, size_t *capacity, size_t count, size_t element_size)
+{
+    size_t new_capacity;
+    void *new_elements;
+
+    if (count <= *capacity)
+        return true;
+
+    new_capacity = max(*capacity * 2, 64);
+    if (!(new_elements = realloc(*elements, new_capacity * element_size)))
+        return false;
+
+    *elements = new_elements;
+    *capacity = new_capacity;
+    return true;
+}
+
+static bool batch_add_shader(struct batch *batch, const char *directory, const char *name)
+{
+    struct batch_shader *shader;
+    size_t size;
+    char *filename;
+
+    size = (directory ? strlen(directory) + 1 : 0) + strlen(name) + 1;
+    if (!(filename = malloc(size)))
+        return false;
+    if (directory)
+        sprintf(filename, "%s/%s", directory, name);
+    else
+        strcpy(filename, name);
+
+    if (!array_reserve((void **)&batch->shaders, &batch->shader_capacity,
+            batch->shader_count + 1, sizeof(*batch->shaders)))
+    {
+        free(filename);
+        return false;
+    }
+
+    shader = &batch->shaders[batch->shader_count++];
+    memset(shader, 0, sizeof(*shader));
+    shader->filename = filename;
+    return true;
+}
+
+static bool has_dxbc_extension(const char *name)
+{
+    size_t length = strlen(name);
+
+    return length > 5 && !strcmp(name + length - 5, ".dxbc");
+}
+
+/* Adds the .dxbc files of a directory, for example a VKD3D_SHADER_DUMP_PATH. */
+static bool batch_add_directory(struct batch *batch, const char *directory)
+{
+#ifdef _WIN32
+    char pattern[MAX_PATH];
+    WIN32_FIND_DATAA data;
+    HANDLE handle;
+
+    snprintf(pattern, sizeof(pattern), "%s\\*.dxbc", directory);
+    if ((handle = FindFirstFileA(pattern, &data)) == INVALID_HANDLE_VALUE)
+        return true;
+
+    do
+    {
+        if ((data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) || !has_dxbc_extension(data.cFileName))
+            continue;
+        if (!batch_add_shader(batch, directory, data.cFileName))
+        {
+            FindClose(handle);
+            return false;
+        }
+    } while (FindNextFileA(handle, &data));
+
+    FindClose(handle);
+    return true;
+#else
+    struct dirent *entry;
+    DIR *dir;
+
+    if (!(dir = opendir(directory)))
+    {
+        fprintf(stderr, "Cannot open directory: '%s'.\n", directory);
+        return false;
+    }
+
+    while ((entry = readdir(dir)))
+    {
+        if (entry->d_name[0] == '.' || !has_dxbc_extension(entry->d_name))
+            continue;
+        if (!batch_add_shader(batch, directory, entry->d_name))
+        {
+            closedir(dir);
+            return false;
+        }
+    }
+
+    closedir(dir);
     return true;
+#endif
+}
+
+/* Adds the files listed one per line in a list file. Empty lines and lines
+ * starting with '#' are ignored. */
+static bool batch_add_list_file(struct batch *batch, const char *filename)
+{
+    char line[4096];
+    size_t length;
+    FILE *fd;
+
+    if (!(fd = fopen(filename, "r")))
+    {
+        fprintf(stderr, "Cannot open file for reading: '%s'.\n", filename);
+        return false;
+    }
+
+    while (fgets(line, sizeof(line), fd))
+    {
+        length = strlen(line);
+        while (length && (line[length - 1] == '\n' || line[length - 1] == '\r'
+                || line[length - 1] == ' ' || line[length - 1] == '\t'))
+            line[--length] = '\0';
+
+        if (!length || line[0] == '#')
+            continue;
+
+        if (!batch_add_shader(batch, NULL, line))
+        {
+            fclose(fd);
+            return false;
+        }
+    }
+
+    fclose(fd);
+    return true;
+}
+
+static int compare_batch_shader(const void *a, const void *b)
+{
+    const struct batch_shader *shader_a = a, *shader_b = b;
+
+    return strcmp(shader_a->filename, shader_b->filename);
+}
+
+static char *get_output_filename(const char *output_dir, const char *filename)
+{
+    const char *name, *separator;
+    char *output_filename;
+    size_t length;
+
+    name = filename;
+    if ((separator = strrchr(name, '/')))
+        name = separator + 1;
+#ifdef _WIN32
+    if ((separator = strrchr(name, '\\')))
+        name = separator + 1;
+#endif
+
+    length = strlen(name);
+    if (has_dxbc_extension(name))
+        length -= 5;
+
+    if (!(output_filename = malloc(strlen(output_dir) + 1 + length + sizeof(".spv"))))
+        return NULL;
+    sprintf(output_filename, "%s/%.*s.spv", output_dir, (int)length, name);
+    return output_filename;
+}
+
+static void batch_compile_shader(const struct batch *batch, struct batch_shader *shader)
+{
+    struct vkd3d_shader_compile_timing_info timing_info;
+    struct vkd3d_shader_interface_info shader_interface;
+    const struct options *options = batch->options;
+    struct vkd3d_shader_code dxbc, spirv;
+    char *output_filename;
+    uint64_t start_time;
+
+    memset(&timing_info, 0, sizeof(timing_info));
+    timing_info.type = VKD3D_SHADER_STRUCTURE_TYPE_COMPILE_TIMING_INFO;
+    timing_info.parse_time_ns = &shader->parse_time_ns;
+    timing_info.emit_time_ns = &shader->emit_time_ns;
+
+    memset(&shader_interface, 0, sizeof(shader_interface));
+    shader_interface.type = VKD3D_SHADER_STRUCTURE_TYPE_SHADER_INTERFACE_INFO;
+    shader_interface.next = &timing_info;
+
+    if (!read_shader(&dxbc, shader->filename))
+    {
+        shader->ret = VKD3D_ERROR;
+        return;
+    }
+    shader->dxbc_size = dxbc.size;
+
+    start_time = get_time_ns();
+    shader->ret = vkd3d_shader_compile_dxbc(&dxbc, &spirv, options->compiler_options, &shader_interface, NULL);
+    shader->compile_time_ns = get_time_ns() - start_time;
+    vkd3d_shader_free_shader_code(&dxbc);
+
+    if (shader->ret < 0)
+    {
+        fprintf(stderr, "Failed to compile DXBC shader '%s', ret %d.\n", shader->filename, shader->ret);
+        return;
+    }
+    shader->spirv_size = spirv.size;
+
+    if (options->output_dir)
+    {
+        if (!(output_filename = get_output_filename(options->output_dir, shader->filename)))
+        {
+            fprintf(stderr, "Out of memory.\n");
+            shader->ret = VKD3D_ERROR_OUT_OF_MEMORY;
+        }
+        else
+        {
+            if (!write_shader(&spirv, output_filename))
+                shader->ret = VKD3D_ERROR;
+            free(output_filename);
+        }
+    }
+
+    vkd3d_shader_free_shader_code(&spirv);
+}
+
+static void *batch_thread_main(void *arg)
+{
+    struct batch *batch = arg;
+    struct batch_shader *shader;
+
+    for (;;)
+    {
+        pthread_mutex_lock(&batch->mutex);
+        if (batch->next_shader == batch->shader_count)
+        {
+            pthread_mutex_unlock(&batch->mutex);
+            break;
+        }
+        shader = &batch->shaders[batch->next_shader++];
+        pthread_mutex_unlock(&batch->mutex);
+
+        batch_compile_shader(batch, shader);
+    }
+
+    return NULL;
+}
+
+static void write_json_string(FILE *f, const char *string)
+{
+    fputc('"', f);
+    for (; *string; ++string)
+    {
+        if (*string == '"' || *string == '\\')
+            fprintf(f, "\\%c", *string);
+        else if ((unsigned char)*string < 0x20)
+            fprintf(f, "\\u%04x", (unsigned char)*string);
+        else
+            fputc(*string, f);
+    }
+    fputc('"', f);
+}
+
+static void write_csv_string(FILE *f, const char *string)
+{
+    if (!strpbrk(string, ",\"\r\n"))
+    {
+        fputs(string, f);
+        return;
+    }
+
+    fputc('"', f);
+    for (; *string; ++string)
+    {
+        if (*string == '"')
+            fputc('"', f);
+        fputc(*string, f);
+    }
+    fputc('"', f);
+}
+
+/* One row per shader, followed by a row with the sums of all columns. */
+static void write_csv_report(FILE *f, const struct batch *batch, const struct batch_totals *totals)
+{
+    const struct batch_shader *shader;
+    size_t i;
+
+    fprintf(f, "file,shaders,failures,dxbc_size,spirv_size,compile_ns,parse_ns,emit_ns\n");
+    for (i = 0; i < batch->shader_count; ++i)
+    {
+        shader = &batch->shaders[i];
+        write_csv_string(f, shader->filename);
+        fprintf(f, ",1,%u,%zu,%zu,%"PRIu64",%"PRIu64",%"PRIu64"\n", shader->ret < 0,
+                shader->dxbc_size, shader->spirv_size, shader->compile_time_ns,
+                shader->parse_time_ns, shader->emit_time_ns);
+    }
+    fprintf(f, "total,%zu,%zu,%"PRIu64",%"PRIu64",%"PRIu64",%"PRIu64",%"PRIu64"\n",
+            totals->shader_count, totals->failure_count, totals->dxbc_size, totals->spirv_size,
+            totals->compile_time_ns, totals->parse_time_ns, totals->emit_time_ns);
+}
+
+static void write_json_report(FILE *f, const struct batch *batch, const struct batch_totals *totals,
+        unsigned int thread_count, uint64_t wall_time_ns)
+{
+    const struct batch_shader *shader;
+    size_t i;
+
+    fprintf(f, "{\n");
+    fprintf(f, "  \"threads\": %u,\n", thread_count);
+    fprintf(f, "  \"wall_time_ns\": %"PRIu64",\n", wall_time_ns);
+    fprintf(f, "  \"total\": {\"shaders\": %zu, \"failures\": %zu, \"dxbc_size\": %"PRIu64", "
+            "\"spirv_size\": %"PRIu64", \"compile_ns\": %"PRIu64", \"parse_ns\": %"PRIu64", "
+            "\"emit_ns\": %"PRIu64"},\n",
+            totals->shader_count, totals->failure_count, totals->dxbc_size, totals->spirv_size,
+            totals->compile_time_ns, totals->parse_time_ns, totals->emit_time_ns);
+    fprintf(f, "  \"shaders\": [");
+    for (i = 0; i < batch->shader_count; ++i)
+    {
+        shader = &batch->shaders[i];
+        fprintf(f, "%s\n    {\"file\": ", i ? "," : "");
+        write_json_string(f, shader->filename);
+        fprintf(f, ", \"result\": %d, \"dxbc_size\": %zu, \"spirv_size\": %zu, \"compile_ns\": %"PRIu64", "
+                "\"parse_ns\": %"PRIu64", \"emit_ns\": %"PRIu64"}",
+                shader->ret, shader->dxbc_size, shader->spirv_size, shader->compile_time_ns,
+                shader->parse_time_ns, shader->emit_time_ns);
+    }
+    fprintf(f, "%s]\n}\n", batch->shader_count ? "\n  " : "");
+}
+
+static int run_batch(const struct options *options)
+{
+    pthread_t threads[MAX_THREAD_COUNT];
+    const struct batch_shader *shader;
+    struct batch_totals totals;
+    unsigned int thread_count;
+    uint64_t wall_time_ns;
+    struct batch batch;
+    struct stat st;
+    FILE *report;
+    bool success;
+    int ret = 1;
+    size_t i;
+
+    memset(&batch, 0, sizeof(batch));
+    batch.options = options;
+
+    if (stat(options->filename, &st) == -1)
+    {
+        fprintf(stderr, "Could not stat file: '%s'.\n", options->filename);
+        return 1;
+    }
+
+    if (S_ISDIR(st.st_mode))
+        success = batch_add_directory(&batch, options->filename);
+    else
+        success = batch_add_list_file(&batch, options->filename);
+    if (!success)
+    {
+        fprintf(stderr, "Failed to collect DXBC shaders.\n");
+        goto done;
+    }
+
+    /* Reports list the shaders in a stable order, independently of the
+     * directory order and of the thread count. */
+    qsort(batch.shaders, batch.shader_count, sizeof(*batch.shaders), compare_batch_shader);
+
+    pthread_mutex_init(&batch.mutex, NULL);
+
+    wall_time_ns = get_time_ns();
+    for (thread_count = 0; thread_count < min(options->thread_count, max(batch.shader_count, 1)); ++thread_count)
+    {
+        if (pthread_create(&threads[thread_count], NULL, batch_thread_main, &batch))
+            break;
+    }
+
+    /* Compile on the main thread if no thread could be created. */
+    if (!thread_count)
+        batch_thread_main(&batch);
+
+    for (i = 0; i < thread_count; ++i)
+        pthread_join(threads[i], NULL);
+    wall_time_ns = get_time_ns() - wall_time_ns;
+
+    pthread_mutex_destroy(&batch.mutex);
+
+    memset(&totals, 0, sizeof(totals));
+    for (i = 0; i < batch.shader_count; ++i)
+    {
+        shader = &batch.shaders[i];
+        ++totals.shader_count;
+        if (shader->ret < 0)
+            ++totals.failure_count;
+        totals.dxbc_size += shader->dxbc_size;
+        totals.spirv_size += shader->spirv_size;
+        totals.compile_time_ns += shader->compile_time_ns;
+        totals.parse_time_ns += shader->parse_time_ns;
+        totals.emit_time_ns += shader->emit_time_ns;
+    }
+    thread_count = max(thread_count, 1);
+
+    if (options->report_filename)
+    {
+        if (!strcmp(options->report_filename, "-"))
+            report = stdout;
+        else if (!(report = fopen(options->report_filename, "w")))
+            fprintf(stderr, "Cannot open file for writing: '%s'.\n", options->report_filename);
+
+        if (report)
+        {
+            if (options->report_format == REPORT_FORMAT_JSON)
+                write_json_report(report, &batch, &totals, thread_count, wall_time_ns);
+            else
+                write_csv_report(report, &batch, &totals);
+            if (report != stdout)
+                fclose(report);
+        }
+    }
+
+    fprintf(stderr, "Compiled %zu shaders, %zu failed, using %u threads in %.3f s, %.1f shaders/s, "
+            "%"PRIu64" bytes of DXBC to %"PRIu64" bytes of SPIR-V.\n",
+            totals.shader_count, totals.failure_count, thread_count, wall_time_ns / 1e9,
+            wall_time_ns ? totals.shader_count * 1e9 / wall_time_ns : 0.0,
+            totals.dxbc_size, totals.spirv_size);
+
+    ret = totals.failure_count ? 1 : 0;
+
+done:
+    for (i = 0; i < batch.shader_count; ++i)
+        free(batch.shaders[i].filename);
+    free(batch.shaders);
+    return ret;
 }
 
 int main(int argc, char **argv)
@@ -157,6 +734,9 @@ int main(int argc, char **argv)
         return 1;
     }
 
+    if (options.batch)
+        return run_batch(&options);
+
     if (!read_shader(&dxbc, options.filename))
     {
         fprintf(stderr, "Failed to read DXBC shader.\n");
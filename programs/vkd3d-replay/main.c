@@ -0,0 +1,712 @@
+/*
+ * Copyright 2020 VKD3D contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/* Replays a pipeline archive recorded with VKD3D_PIPELINE_RECORD_PATH, which
+ * populates the shader cache and the pipeline cache ahead of the application. */
+
+#define COBJMACROS
+#define INITGUID
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "vkd3d_pipeline_archive.h"
+#include "vkd3d_threads.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#define MAX_THREAD_COUNT 64
+
+struct blob
+{
+    uint64_t hash;
+    const void *data;
+    size_t size;
+    ID3D12RootSignature *root_signature;
+};
+
+struct blob_array
+{
+    struct blob *blobs;
+    size_t count;
+    size_t capacity;
+};
+
+struct pipeline_record
+{
+    uint32_t type;
+    const void *data;
+    size_t size;
+};
+
+struct archive
+{
+    void *data;
+    size_t size;
+
+    struct blob_array shaders;
+    struct blob_array root_signatures;
+
+    struct pipeline_record *pipelines;
+    size_t pipeline_count;
+    size_t pipeline_capacity;
+};
+
+struct replay_context
+{
+    ID3D12Device2 *device;
+    struct archive *archive;
+
+    pthread_mutex_t mutex;
+    size_t next_pipeline;
+    unsigned int success_count;
+    unsigned int failure_count;
+};
+
+#define DECLARE_SUBOBJECT(name, type_name) \
+    typedef union \
+    { \
+        struct \
+        { \
+            D3D12_PIPELINE_STATE_SUBOBJECT_TYPE type; \
+            type_name data; \
+        }; \
+        void *dummy_align; \
+    } name
+
+/* Subobjects are padded to the size of a pointer, see D3D12_PIPELINE_STATE_STREAM_DESC. */
+DECLARE_SUBOBJECT(root_signature_subobject, ID3D12RootSignature *);
+DECLARE_SUBOBJECT(shader_subobject, D3D12_SHADER_BYTECODE);
+DECLARE_SUBOBJECT(stream_output_subobject, D3D12_STREAM_OUTPUT_DESC);
+DECLARE_SUBOBJECT(blend_subobject, D3D12_BLEND_DESC);
+DECLARE_SUBOBJECT(uint_subobject, UINT);
+DECLARE_SUBOBJECT(rasterizer_subobject, D3D12_RASTERIZER_DESC);
+DECLARE_SUBOBJECT(depth_stencil_subobject, D3D12_DEPTH_STENCIL_DESC1);
+DECLARE_SUBOBJECT(input_layout_subobject, D3D12_INPUT_LAYOUT_DESC);
+DECLARE_SUBOBJECT(rtv_formats_subobject, D3D12_RT_FORMAT_ARRAY);
+DECLARE_SUBOBJECT(sample_desc_subobject, DXGI_SAMPLE_DESC);
+DECLARE_SUBOBJECT(view_instancing_subobject, D3D12_VIEW_INSTANCING_DESC);
+
+#undef DECLARE_SUBOBJECT
+
+struct graphics_pipeline_stream
+{
+    root_signature_subobject root_signature;
+    shader_subobject vs;
+    shader_subobject hs;
+    shader_subobject ds;
+    shader_subobject gs;
+    shader_subobject ps;
+    stream_output_subobject stream_output;
+    blend_subobject blend;
+    uint_subobject sample_mask;
+    rasterizer_subobject rasterizer;
+    depth_stencil_subobject depth_stencil;
+    input_layout_subobject input_layout;
+    uint_subobject strip_cut_value;
+    uint_subobject primitive_topology;
+    rtv_formats_subobject rtv_formats;
+    uint_subobject dsv_format;
+    sample_desc_subobject sample_desc;
+    uint_subobject flags;
+    view_instancing_subobject view_instancing;
+};
+
+struct compute_pipeline_stream
+{
+    root_signature_subobject root_signature;
+    shader_subobject cs;
+    uint_subobject flags;
+};
+
+static bool read_archive(struct archive *archive, const char *filename)
+{
+    long size;
+    FILE *fd;
+
+    if (!(fd = fopen(filename, "rb")))
+    {
+        fprintf(stderr, "Cannot open file for reading: '%s'.\n", filename);
+        return false;
+    }
+
+    if (fseek(fd, 0, SEEK_END) || (size = ftell(fd)) < 0 || fseek(fd, 0, SEEK_SET))
+    {
+        fprintf(stderr, "Could not get size of file: '%s'.\n", filename);
+        fclose(fd);
+        return false;
+    }
+
+    archive->size = size;
+    if (!(archive->data = malloc(archive->size ? archive->size : 1)))
+    {
+        fprintf(stderr, "Out of memory.\n");
+        fclose(fd);
+        return false;
+    }
+
+    if (fread(archive->data, 1, archive->size, fd) != archive->size)
+    {
+        fprintf(stderr, "Could not read pipeline archive from file: '%s'.\n", filename);
+        free(archive->data);
+        fclose(fd);
+        return false;
+    }
+
+    fclose(fd);
+    return true;
+}
+
+static bool array_reserve(void **elements, size_t *capacity, size_t count, size_t element_size)
+{
+    size_t new_capacity;
+    void *new_elements;
+
+    if (count <= *capacity)
+        return true;
+
+    new_capacity = max(*capacity * 2, 64);
+    if (!(new_elements = realloc(*elements, new_capacity * element_size)))
+        return false;
+
+    *elements = new_elements;
+    *capacity = new_capacity;
+    return true;
+}
+
+static bool blob_array_add(struct blob_array *array, uint64_t hash, const void *data, size_t size)
+{
+    struct blob *blob;
+
+    if (!array_reserve((void **)&array->blobs, &array->capacity, array->count + 1, sizeof(*array->blobs)))
+        return false;
+
+    blob = &array->blobs[array->count++];
+    blob->hash = hash;
+    blob->data = data;
+    blob->size = size;
+    blob->root_signature = NULL;
+    return true;
+}
+
+static int compare_blob(const void *a, const void *b)
+{
+    const struct blob *blob_a = a, *blob_b = b;
+
+    if (blob_a->hash != blob_b->hash)
+        return blob_a->hash < blob_b->hash ? -1 : 1;
+    return 0;
+}
+
+static struct blob *blob_array_find(const struct blob_array *array, uint64_t hash)
+{
+    struct blob key;
+
+    key.hash = hash;
+    return bsearch(&key, array->blobs, array->count, sizeof(*array->blobs), compare_blob);
+}
+
+static bool parse_archive(struct archive *archive)
+{
+    const struct vkd3d_pipeline_archive_header *header = archive->data;
+    const struct vkd3d_pipeline_archive_record *record;
+    struct pipeline_record *pipeline;
+    size_t offset = sizeof(*header);
+    const void *payload;
+
+    if (archive->size < sizeof(*header) || header->magic != VKD3D_PIPELINE_ARCHIVE_MAGIC)
+    {
+        fprintf(stderr, "Not a pipeline archive.\n");
+        return false;
+    }
+
+    if (header->version != VKD3D_PIPELINE_ARCHIVE_VERSION)
+    {
+        fprintf(stderr, "Unsupported pipeline archive version %u.\n", header->version);
+        return false;
+    }
+
+    while (offset + sizeof(*record) <= archive->size)
+    {
+        record = (const void *)((const uint8_t *)archive->data + offset);
+        payload = record + 1;
+        offset += sizeof(*record) + vkd3d_pipeline_archive_align(record->size);
+        if (offset > archive->size)
+        {
+            fprintf(stderr, "Pipeline archive is truncated.\n");
+            break;
+        }
+
+        switch (record->type)
+        {
+            case VKD3D_PIPELINE_ARCHIVE_RECORD_SHADER:
+                if (!blob_array_add(&archive->shaders, record->hash, payload, record->size))
+                    return false;
+                break;
+
+            case VKD3D_PIPELINE_ARCHIVE_RECORD_ROOT_SIGNATURE:
+                if (!blob_array_add(&archive->root_signatures, record->hash, payload, record->size))
+                    return false;
+                break;
+
+            case VKD3D_PIPELINE_ARCHIVE_RECORD_GRAPHICS_PIPELINE:
+            case VKD3D_PIPELINE_ARCHIVE_RECORD_COMPUTE_PIPELINE:
+                if (!array_reserve((void **)&archive->pipelines, &archive->pipeline_capacity,
+                        archive->pipeline_count + 1, sizeof(*archive->pipelines)))
+                    return false;
+                pipeline = &archive->pipelines[archive->pipeline_count++];
+                pipeline->type = record->type;
+                pipeline->data = payload;
+                pipeline->size = record->size;
+                break;
+
+            default:
+                fprintf(stderr, "Skipping unknown record type %u.\n", record->type);
+                break;
+        }
+    }
+
+    qsort(archive->shaders.blobs, archive->shaders.count, sizeof(*archive->shaders.blobs), compare_blob);
+    qsort(archive->root_signatures.blobs, archive->root_signatures.count,
+            sizeof(*archive->root_signatures.blobs), compare_blob);
+    return true;
+}
+
+static void free_archive(struct archive *archive)
+{
+    size_t i;
+
+    for (i = 0; i < archive->root_signatures.count; ++i)
+    {
+        if (archive->root_signatures.blobs[i].root_signature)
+            ID3D12RootSignature_Release(archive->root_signatures.blobs[i].root_signature);
+    }
+
+    free(archive->shaders.blobs);
+    free(archive->root_signatures.blobs);
+    free(archive->pipelines);
+    free(archive->data);
+}
+
+static bool get_shader(const struct archive *archive, uint64_t hash, D3D12_SHADER_BYTECODE *code)
+{
+    const struct blob *blob;
+
+    code->pShaderBytecode = NULL;
+    code->BytecodeLength = 0;
+
+    if (!hash)
+        return true;
+
+    if (!(blob = blob_array_find(&archive->shaders, hash)))
+        return false;
+
+    code->pShaderBytecode = blob->data;
+    code->BytecodeLength = blob->size;
+    return true;
+}
+
+static const char *get_string(const char *strings, size_t strings_size, uint32_t offset, bool *valid)
+{
+    if (offset == UINT32_MAX)
+        return NULL;
+
+    if (offset >= strings_size || !memchr(strings + offset, 0, strings_size - offset))
+    {
+        *valid = false;
+        return NULL;
+    }
+
+    return strings + offset;
+}
+
+static HRESULT replay_pipeline(struct replay_context *context, const struct pipeline_record *record)
+{
+    const struct vkd3d_pipeline_archive_input_element *input_elements;
+    const struct vkd3d_pipeline_archive_pipeline *pipeline;
+    const struct vkd3d_pipeline_archive_so_entry *so_entries;
+    const D3D12_VIEW_INSTANCE_LOCATION *view_instances;
+    D3D12_SO_DECLARATION_ENTRY *d3d12_so_entries = NULL;
+    D3D12_INPUT_ELEMENT_DESC *d3d12_elements = NULL;
+    struct compute_pipeline_stream compute_stream;
+    struct graphics_pipeline_stream graphics_stream;
+    struct archive *archive = context->archive;
+    D3D12_PIPELINE_STATE_STREAM_DESC stream_desc;
+    ID3D12PipelineState *pipeline_state;
+    ID3D12RootSignature *root_signature;
+    const uint32_t *so_strides;
+    const struct blob *blob;
+    size_t offset, size;
+    const char *strings;
+    bool valid = true;
+    ID3DBlob *cache;
+    unsigned int i;
+    HRESULT hr;
+
+    pipeline = record->data;
+    if (record->size < sizeof(*pipeline))
+        return E_INVALIDARG;
+
+    size = sizeof(*pipeline)
+            + pipeline->input_element_count * (size_t)sizeof(*input_elements)
+            + pipeline->so_entry_count * (size_t)sizeof(*so_entries)
+            + pipeline->so_stride_count * (size_t)sizeof(*so_strides)
+            + pipeline->view_instance_count * (size_t)sizeof(*view_instances);
+    if (size > record->size)
+        return E_INVALIDARG;
+
+    offset = sizeof(*pipeline);
+    input_elements = (const void *)((const uint8_t *)pipeline + offset);
+    offset += pipeline->input_element_count * sizeof(*input_elements);
+    so_entries = (const void *)((const uint8_t *)pipeline + offset);
+    offset += pipeline->so_entry_count * sizeof(*so_entries);
+    so_strides = (const void *)((const uint8_t *)pipeline + offset);
+    offset += pipeline->so_stride_count * sizeof(*so_strides);
+    view_instances = (const void *)((const uint8_t *)pipeline + offset);
+    offset += pipeline->view_instance_count * sizeof(*view_instances);
+    strings = (const char *)pipeline + offset;
+
+    if (!(blob = blob_array_find(&archive->root_signatures, pipeline->root_signature_hash))
+            || !(root_signature = blob->root_signature))
+        return E_INVALIDARG;
+
+    if (record->type == VKD3D_PIPELINE_ARCHIVE_RECORD_COMPUTE_PIPELINE)
+    {
+        memset(&compute_stream, 0, sizeof(compute_stream));
+        compute_stream.root_signature.type = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_ROOT_SIGNATURE;
+        compute_stream.root_signature.data = root_signature;
+        compute_stream.cs.type = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_CS;
+        if (!get_shader(archive, pipeline->shader_hashes[VKD3D_PIPELINE_ARCHIVE_CS], &compute_stream.cs.data))
+            return E_INVALIDARG;
+        compute_stream.flags.type = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_FLAGS;
+        compute_stream.flags.data = pipeline->flags;
+
+        stream_desc.SizeInBytes = sizeof(compute_stream);
+        stream_desc.pPipelineStateSubobjectStream = &compute_stream;
+
+        if (FAILED(hr = ID3D12Device2_CreatePipelineState(context->device, &stream_desc,
+                &IID_ID3D12PipelineState, (void **)&pipeline_state)))
+            return hr;
+
+        ID3D12PipelineState_Release(pipeline_state);
+        return S_OK;
+    }
+
+    if ((pipeline->input_element_count && !(d3d12_elements = calloc(pipeline->input_element_count,
+            sizeof(*d3d12_elements))))
+            || (pipeline->so_entry_count && !(d3d12_so_entries = calloc(pipeline->so_entry_count,
+            sizeof(*d3d12_so_entries)))))
+    {
+        free(d3d12_elements);
+        return E_OUTOFMEMORY;
+    }
+
+    for (i = 0; i < pipeline->input_element_count; ++i)
+    {
+        d3d12_elements[i].SemanticName = get_string(strings, record->size - offset,
+                input_elements[i].semantic_name, &valid);
+        d3d12_elements[i].SemanticIndex = input_elements[i].semantic_index;
+        d3d12_elements[i].Format = input_elements[i].format;
+        d3d12_elements[i].InputSlot = input_elements[i].input_slot;
+        d3d12_elements[i].AlignedByteOffset = input_elements[i].aligned_byte_offset;
+        d3d12_elements[i].InputSlotClass = input_elements[i].input_slot_class;
+        d3d12_elements[i].InstanceDataStepRate = input_elements[i].instance_data_step_rate;
+    }
+
+    for (i = 0; i < pipeline->so_entry_count; ++i)
+    {
+        d3d12_so_entries[i].Stream = so_entries[i].stream;
+        d3d12_so_entries[i].SemanticName = get_string(strings, record->size - offset,
+                so_entries[i].semantic_name, &valid);
+        d3d12_so_entries[i].SemanticIndex = so_entries[i].semantic_index;
+        d3d12_so_entries[i].StartComponent = so_entries[i].start_component;
+        d3d12_so_entries[i].ComponentCount = so_entries[i].component_count;
+        d3d12_so_entries[i].OutputSlot = so_entries[i].output_slot;
+    }
+
+    memset(&graphics_stream, 0, sizeof(graphics_stream));
+    graphics_stream.root_signature.type = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_ROOT_SIGNATURE;
+    graphics_stream.root_signature.data = root_signature;
+    graphics_stream.vs.type = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_VS;
+    graphics_stream.hs.type = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_HS;
+    graphics_stream.ds.type = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_DS;
+    graphics_stream.gs.type = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_GS;
+    graphics_stream.ps.type = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_PS;
+    valid = valid && get_shader(archive, pipeline->shader_hashes[VKD3D_PIPELINE_ARCHIVE_VS], &graphics_stream.vs.data)
+            && get_shader(archive, pipeline->shader_hashes[VKD3D_PIPELINE_ARCHIVE_HS], &graphics_stream.hs.data)
+            && get_shader(archive, pipeline->shader_hashes[VKD3D_PIPELINE_ARCHIVE_DS], &graphics_stream.ds.data)
+            && get_shader(archive, pipeline->shader_hashes[VKD3D_PIPELINE_ARCHIVE_GS], &graphics_stream.gs.data)
+            && get_shader(archive, pipeline->shader_hashes[VKD3D_PIPELINE_ARCHIVE_PS], &graphics_stream.ps.data);
+    graphics_stream.stream_output.type = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_STREAM_OUTPUT;
+    graphics_stream.stream_output.data.pSODeclaration = d3d12_so_entries;
+    graphics_stream.stream_output.data.NumEntries = pipeline->so_entry_count;
+    graphics_stream.stream_output.data.pBufferStrides = so_strides;
+    graphics_stream.stream_output.data.NumStrides = pipeline->so_stride_count;
+    graphics_stream.stream_output.data.RasterizedStream = pipeline->so_rasterized_stream;
+    graphics_stream.blend.type = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_BLEND;
+    graphics_stream.blend.data = pipeline->blend_state;
+    graphics_stream.sample_mask.type = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_SAMPLE_MASK;
+    graphics_stream.sample_mask.data = pipeline->sample_mask;
+    graphics_stream.rasterizer.type = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_RASTERIZER;
+    graphics_stream.rasterizer.data = pipeline->rasterizer_state;
+    graphics_stream.depth_stencil.type = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_DEPTH_STENCIL1;
+    graphics_stream.depth_stencil.data = pipeline->depth_stencil_state;
+    graphics_stream.input_layout.type = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_INPUT_LAYOUT;
+    graphics_stream.input_layout.data.pInputElementDescs = d3d12_elements;
+    graphics_stream.input_layout.data.NumElements = pipeline->input_element_count;
+    graphics_stream.strip_cut_value.type = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_IB_STRIP_CUT_VALUE;
+    graphics_stream.strip_cut_value.data = pipeline->strip_cut_value;
+    graphics_stream.primitive_topology.type = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_PRIMITIVE_TOPOLOGY;
+    graphics_stream.primitive_topology.data = pipeline->primitive_topology_type;
+    graphics_stream.rtv_formats.type = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_RENDER_TARGET_FORMATS;
+    graphics_stream.rtv_formats.data = pipeline->rtv_formats;
+    graphics_stream.dsv_format.type = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_DEPTH_STENCIL_FORMAT;
+    graphics_stream.dsv_format.data = pipeline->dsv_format;
+    graphics_stream.sample_desc.type = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_SAMPLE_DESC;
+    graphics_stream.sample_desc.data = pipeline->sample_desc;
+    graphics_stream.flags.type = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_FLAGS;
+    graphics_stream.flags.data = pipeline->flags;
+    graphics_stream.view_instancing.type = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_VIEW_INSTANCING;
+    graphics_stream.view_instancing.data.ViewInstanceCount = pipeline->view_instance_count;
+    graphics_stream.view_instancing.data.pViewInstanceLocations = view_instances;
+    graphics_stream.view_instancing.data.Flags = pipeline->view_instancing_flags;
+
+    hr = E_INVALIDARG;
+    if (valid)
+    {
+        stream_desc.SizeInBytes = sizeof(graphics_stream);
+        stream_desc.pPipelineStateSubobjectStream = &graphics_stream;
+
+        if (SUCCEEDED(hr = ID3D12Device2_CreatePipelineState(context->device, &stream_desc,
+                &IID_ID3D12PipelineState, (void **)&pipeline_state)))
+        {
+            /* Waits for the speculatively compiled pipeline variant, which
+             * would otherwise be cancelled when the pipeline state is released. */
+            if (SUCCEEDED(ID3D12PipelineState_GetCachedBlob(pipeline_state, &cache)))
+                ID3D10Blob_Release(cache);
+            ID3D12PipelineState_Release(pipeline_state);
+        }
+    }
+
+    free(d3d12_so_entries);
+    free(d3d12_elements);
+    return hr;
+}
+
+static void *replay_thread_main(void *arg)
+{
+    struct replay_context *context = arg;
+    const struct pipeline_record *record;
+    HRESULT hr;
+
+    for (;;)
+    {
+        pthread_mutex_lock(&context->mutex);
+        if (context->next_pipeline == context->archive->pipeline_count)
+        {
+            pthread_mutex_unlock(&context->mutex);
+            break;
+        }
+        record = &context->archive->pipelines[context->next_pipeline++];
+        pthread_mutex_unlock(&context->mutex);
+
+        hr = replay_pipeline(context, record);
+
+        pthread_mutex_lock(&context->mutex);
+        if (SUCCEEDED(hr))
+            ++context->success_count;
+        else
+            ++context->failure_count;
+        pthread_mutex_unlock(&context->mutex);
+    }
+
+    return NULL;
+}
+
+static unsigned int create_root_signatures(ID3D12Device2 *device, struct archive *archive)
+{
+    unsigned int failure_count = 0;
+    struct blob *blob;
+    size_t i;
+
+    for (i = 0; i < archive->root_signatures.count; ++i)
+    {
+        blob = &archive->root_signatures.blobs[i];
+        if (FAILED(ID3D12Device2_CreateRootSignature(device, 0, blob->data, blob->size,
+                &IID_ID3D12RootSignature, (void **)&blob->root_signature)))
+        {
+            blob->root_signature = NULL;
+            ++failure_count;
+        }
+    }
+
+    return failure_count;
+}
+
+static unsigned int get_cpu_count(void)
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+
+    return count > 0 ? count : 1;
+#endif
+}
+
+static HRESULT signal_event(HANDLE event)
+{
+    return S_OK;
+}
+
+static ID3D12Device2 *create_device(void)
+{
+    struct vkd3d_instance_create_info instance_create_info;
+    struct vkd3d_device_create_info device_create_info;
+    ID3D12Device2 *device;
+
+    memset(&instance_create_info, 0, sizeof(instance_create_info));
+    instance_create_info.type = VKD3D_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+    instance_create_info.pfn_signal_event = signal_event;
+    instance_create_info.wchar_size = sizeof(WCHAR);
+
+    memset(&device_create_info, 0, sizeof(device_create_info));
+    device_create_info.type = VKD3D_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    device_create_info.minimum_feature_level = D3D_FEATURE_LEVEL_11_0;
+    device_create_info.instance_create_info = &instance_create_info;
+
+    if (FAILED(vkd3d_create_device(&device_create_info, &IID_ID3D12Device2, (void **)&device)))
+        return NULL;
+    return device;
+}
+
+static void print_usage(const char *program_name)
+{
+    fprintf(stderr, "usage: %s [--threads <count>] <archive_filename>\n", program_name);
+}
+
+struct options
+{
+    const char *filename;
+    unsigned int thread_count;
+};
+
+static bool parse_command_line(int argc, char **argv, struct options *options)
+{
+    unsigned int i;
+
+    if (argc < 2)
+        return false;
+
+    memset(options, 0, sizeof(*options));
+    options->thread_count = get_cpu_count();
+
+    for (i = 1; i < argc - 1; ++i)
+    {
+        if (!strcmp(argv[i], "--threads"))
+        {
+            if (i + 1 >= argc - 1)
+                return false;
+            options->thread_count = atoi(argv[++i]);
+            continue;
+        }
+
+        return false;
+    }
+
+    options->thread_count = max(min(options->thread_count, MAX_THREAD_COUNT), 1);
+    options->filename = argv[argc - 1];
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    pthread_t threads[MAX_THREAD_COUNT];
+    struct replay_context context;
+    unsigned int thread_count, i;
+    struct archive archive;
+    struct options options;
+    int ret = 1;
+
+    if (!parse_command_line(argc, argv, &options))
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    memset(&archive, 0, sizeof(archive));
+    if (!read_archive(&archive, options.filename))
+        return 1;
+
+    if (!parse_archive(&archive))
+    {
+        fprintf(stderr, "Failed to parse pipeline archive.\n");
+        goto done;
+    }
+
+    memset(&context, 0, sizeof(context));
+    context.archive = &archive;
+
+    if (!(context.device = create_device()))
+    {
+        fprintf(stderr, "Failed to create device.\n");
+        goto done;
+    }
+
+    if ((i = create_root_signatures(context.device, &archive)))
+        fprintf(stderr, "Failed to create %u root signatures.\n", i);
+
+    pthread_mutex_init(&context.mutex, NULL);
+
+    for (thread_count = 0; thread_count < options.thread_count; ++thread_count)
+    {
+        if (pthread_create(&threads[thread_count], NULL, replay_thread_main, &context))
+            break;
+    }
+
+    /* Replay on the main thread if no thread could be created. */
+    if (!thread_count)
+        replay_thread_main(&context);
+
+    for (i = 0; i < thread_count; ++i)
+        pthread_join(threads[i], NULL);
+
+    pthread_mutex_destroy(&context.mutex);
+
+    printf("Replayed %u pipelines, %u failed, using %u threads.\n",
+            context.success_count, context.failure_count, max(thread_count, 1));
+
+    ret = context.failure_count ? 1 : 0;
+
+    /* Releases the root signatures before the device, which writes the
+     * pipeline cache on destruction. */
+    free_archive(&archive);
+    ID3D12Device2_Release(context.device);
+    return ret;
+
+done:
+    free_archive(&archive);
+    return ret;
+}
@@ -2807,7 +2807,7 @@ static void test_create_root_signature(void)
     D3D12_ROOT_SIGNATURE_DESC root_signature_desc;
     D3D12_DESCRIPTOR_RANGE descriptor_ranges[2];
     D3D12_ROOT_PARAMETER root_parameters[3];
-    ID3D12RootSignature *root_signature;
+    ID3D12RootSignature *root_signature, *root_signature2;
     ID3D12Device *device, *tmp_device;
     ULONG refcount;
     HRESULT hr;
@@ -2879,6 +2879,15 @@ static void test_create_root_signature(void)
     root_signature_desc.Flags = D3D12_ROOT_SIGNATURE_FLAG_NONE;
     hr = create_root_signature(device, &root_signature_desc, &root_signature);
     ok(hr == S_OK, "Failed to create root signature, hr %#x.\n", hr);
+
+    /* Identical blobs return the same object. */
+    hr = create_root_signature(device, &root_signature_desc, &root_signature2);
+    ok(hr == S_OK, "Failed to create root signature, hr %#x.\n", hr);
+    ok(root_signature2 == root_signature, "Got different root signatures %p, %p.\n",
+            root_signature, root_signature2);
+    refcount = ID3D12RootSignature_Release(root_signature2);
+    ok(refcount == 1, "Got unexpected refcount %u.\n", (unsigned int)refcount);
+
     refcount = ID3D12RootSignature_Release(root_signature);
     ok(!refcount, "ID3D12RootSignature has %u references left.\n", (unsigned int)refcount);
 
@@ -3767,6 +3776,224 @@ static void test_create_pipeline_state(void)
     ok(!refcount, "ID3D12Device has %u references left.\n", (unsigned int)refcount);
 }
 
+/* Creates the objects shared by the pipeline library and cached pipeline
+ * state tests: a compute pipeline description using an empty shader and
+ * root signature, and a second root signature which only differs in its
+ * flags, with which stored pipelines must not be reused. */
+static void init_cached_pipeline_test(ID3D12Device *device, D3D12_COMPUTE_PIPELINE_STATE_DESC *compute_desc,
+        ID3D12RootSignature **root_signature, ID3D12RootSignature **root_signature2)
+{
+    static const DWORD cs_code[] =
+    {
+#if 0
+        [numthreads(1, 1, 1)]
+        void main() { }
+#endif
+        0x43425844, 0x1acc3ad0, 0x71c7b057, 0xc72c4306, 0xf432cb57, 0x00000001, 0x00000074, 0x00000003,
+        0x0000002c, 0x0000003c, 0x0000004c, 0x4e475349, 0x00000008, 0x00000000, 0x00000008, 0x4e47534f,
+        0x00000008, 0x00000000, 0x00000008, 0x58454853, 0x00000020, 0x00050050, 0x00000008, 0x0100086a,
+        0x0400009b, 0x00000001, 0x00000001, 0x00000001, 0x0100003e,
+    };
+
+    *root_signature = create_empty_root_signature(device, 0);
+    *root_signature2 = create_empty_root_signature(device,
+            D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
+
+    memset(compute_desc, 0, sizeof(*compute_desc));
+    compute_desc->pRootSignature = *root_signature;
+    compute_desc->CS = shader_bytecode(cs_code, sizeof(cs_code));
+}
+
+static void test_pipeline_library(void)
+{
+    D3D12_COMPUTE_PIPELINE_STATE_DESC compute_desc;
+    D3D12_GRAPHICS_PIPELINE_STATE_DESC graphics_desc;
+    ID3D12RootSignature *root_signature, *root_signature2;
+    ID3D12PipelineState *compute_state, *graphics_state;
+    ID3D12PipelineLibrary *pipeline_library;
+    ID3D12PipelineState *pipeline_state;
+    ID3D12Device1 *device1;
+    ID3D12Device *device;
+    SIZE_T blob_size;
+    ULONG refcount;
+    void *blob;
+    HRESULT hr;
+
+    static const WCHAR computeW[] = {'c', 'o', 'm', 'p', 'u', 't', 'e', 0};
+    static const WCHAR graphicsW[] = {'g', 'r', 'a', 'p', 'h', 'i', 'c', 's', 0};
+    static const WCHAR missingW[] = {'m', 'i', 's', 's', 'i', 'n', 'g', 0};
+
+    if (!(device = create_device()))
+    {
+        skip("Failed to create device.\n");
+        return;
+    }
+
+    if (FAILED(hr = ID3D12Device_QueryInterface(device, &IID_ID3D12Device1, (void **)&device1)))
+    {
+        skip("ID3D12Device1 not supported.\n");
+        ID3D12Device_Release(device);
+        return;
+    }
+
+    init_cached_pipeline_test(device, &compute_desc, &root_signature, &root_signature2);
+    hr = ID3D12Device_CreateComputePipelineState(device, &compute_desc,
+            &IID_ID3D12PipelineState, (void **)&compute_state);
+    ok(hr == S_OK, "Failed to create compute pipeline, hr %#x.\n", hr);
+
+    init_pipeline_state_desc(&graphics_desc, root_signature, DXGI_FORMAT_R8G8B8A8_UNORM, NULL, NULL, NULL);
+    hr = ID3D12Device_CreateGraphicsPipelineState(device, &graphics_desc,
+            &IID_ID3D12PipelineState, (void **)&graphics_state);
+    ok(hr == S_OK, "Failed to create graphics pipeline, hr %#x.\n", hr);
+
+    hr = ID3D12Device1_CreatePipelineLibrary(device1, NULL, 0,
+            &IID_ID3D12PipelineLibrary, (void **)&pipeline_library);
+    ok(hr == S_OK, "Failed to create pipeline library, hr %#x.\n", hr);
+
+    hr = ID3D12PipelineLibrary_StorePipeline(pipeline_library, computeW, compute_state);
+    ok(hr == S_OK, "Failed to store pipeline, hr %#x.\n", hr);
+    hr = ID3D12PipelineLibrary_StorePipeline(pipeline_library, computeW, graphics_state);
+    ok(hr == E_INVALIDARG, "Got unexpected hr %#x.\n", hr);
+    hr = ID3D12PipelineLibrary_StorePipeline(pipeline_library, graphicsW, graphics_state);
+    ok(hr == S_OK, "Failed to store pipeline, hr %#x.\n", hr);
+
+    hr = ID3D12PipelineLibrary_LoadComputePipeline(pipeline_library, computeW, &compute_desc,
+            &IID_ID3D12PipelineState, (void **)&pipeline_state);
+    ok(hr == S_OK, "Failed to load pipeline, hr %#x.\n", hr);
+    ID3D12PipelineState_Release(pipeline_state);
+    hr = ID3D12PipelineLibrary_LoadComputePipeline(pipeline_library, missingW, &compute_desc,
+            &IID_ID3D12PipelineState, (void **)&pipeline_state);
+    ok(hr == E_INVALIDARG, "Got unexpected hr %#x.\n", hr);
+    hr = ID3D12PipelineLibrary_LoadGraphicsPipeline(pipeline_library, computeW, &graphics_desc,
+            &IID_ID3D12PipelineState, (void **)&pipeline_state);
+    ok(hr == E_INVALIDARG, "Got unexpected hr %#x.\n", hr);
+
+    blob_size = ID3D12PipelineLibrary_GetSerializedSize(pipeline_library);
+    ok(blob_size, "Got unexpected serialized size %lu.\n", (unsigned long)blob_size);
+    blob = malloc(blob_size);
+    hr = ID3D12PipelineLibrary_Serialize(pipeline_library, blob, blob_size - 1);
+    ok(hr == E_INVALIDARG, "Got unexpected hr %#x.\n", hr);
+    hr = ID3D12PipelineLibrary_Serialize(pipeline_library, blob, blob_size);
+    ok(hr == S_OK, "Failed to serialize pipeline library, hr %#x.\n", hr);
+
+    refcount = ID3D12PipelineLibrary_Release(pipeline_library);
+    ok(!refcount, "ID3D12PipelineLibrary has %u references left.\n", (unsigned int)refcount);
+    ID3D12PipelineState_Release(compute_state);
+    ID3D12PipelineState_Release(graphics_state);
+
+    hr = ID3D12Device1_CreatePipelineLibrary(device1, blob, blob_size,
+            &IID_ID3D12PipelineLibrary, (void **)&pipeline_library);
+    ok(hr == S_OK, "Failed to create pipeline library, hr %#x.\n", hr);
+
+    hr = ID3D12PipelineLibrary_LoadComputePipeline(pipeline_library, computeW, &compute_desc,
+            &IID_ID3D12PipelineState, (void **)&pipeline_state);
+    ok(hr == S_OK, "Failed to load pipeline, hr %#x.\n", hr);
+    ID3D12PipelineState_Release(pipeline_state);
+    hr = ID3D12PipelineLibrary_LoadGraphicsPipeline(pipeline_library, graphicsW, &graphics_desc,
+            &IID_ID3D12PipelineState, (void **)&pipeline_state);
+    ok(hr == S_OK, "Failed to load pipeline, hr %#x.\n", hr);
+    ID3D12PipelineState_Release(pipeline_state);
+    hr = ID3D12PipelineLibrary_LoadComputePipeline(pipeline_library, missingW, &compute_desc,
+            &IID_ID3D12PipelineState, (void **)&pipeline_state);
+    ok(hr == E_INVALIDARG, "Got unexpected hr %#x.\n", hr);
+
+    compute_desc.pRootSignature = root_signature2;
+    hr = ID3D12PipelineLibrary_LoadComputePipeline(pipeline_library, computeW, &compute_desc,
+            &IID_ID3D12PipelineState, (void **)&pipeline_state);
+    ok(hr == E_INVALIDARG, "Got unexpected hr %#x.\n", hr);
+
+    refcount = ID3D12PipelineLibrary_Release(pipeline_library);
+    ok(!refcount, "ID3D12PipelineLibrary has %u references left.\n", (unsigned int)refcount);
+
+    ((BYTE *)blob)[0] ^= 0xff;
+    hr = ID3D12Device1_CreatePipelineLibrary(device1, blob, blob_size,
+            &IID_ID3D12PipelineLibrary, (void **)&pipeline_library);
+    ok(FAILED(hr), "Got unexpected hr %#x.\n", hr);
+
+    free(blob);
+    ID3D12RootSignature_Release(root_signature2);
+    ID3D12RootSignature_Release(root_signature);
+    ID3D12Device1_Release(device1);
+    refcount = ID3D12Device_Release(device);
+    ok(!refcount, "ID3D12Device has %u references left.\n", (unsigned int)refcount);
+}
+
+static void test_cached_pipeline_state(void)
+{
+    ID3D12RootSignature *root_signature, *root_signature2;
+    D3D12_GRAPHICS_PIPELINE_STATE_DESC graphics_desc;
+    D3D12_COMPUTE_PIPELINE_STATE_DESC compute_desc;
+    ID3D12PipelineState *pipeline_state, *tmp;
+    ID3DBlob *blob, *blob2;
+    ID3D12Device *device;
+    ULONG refcount;
+    HRESULT hr;
+
+    if (!(device = create_device()))
+    {
+        skip("Failed to create device.\n");
+        return;
+    }
+
+    init_cached_pipeline_test(device, &compute_desc, &root_signature, &root_signature2);
+    hr = ID3D12Device_CreateComputePipelineState(device, &compute_desc,
+            &IID_ID3D12PipelineState, (void **)&pipeline_state);
+    ok(hr == S_OK, "Failed to create compute pipeline, hr %#x.\n", hr);
+    hr = ID3D12PipelineState_GetCachedBlob(pipeline_state, &blob);
+    ok(hr == S_OK, "Failed to get cached blob, hr %#x.\n", hr);
+    ok(ID3D10Blob_GetBufferSize(blob), "Got empty cached blob.\n");
+    ID3D12PipelineState_Release(pipeline_state);
+
+    compute_desc.CachedPSO.pCachedBlob = ID3D10Blob_GetBufferPointer(blob);
+    compute_desc.CachedPSO.CachedBlobSizeInBytes = ID3D10Blob_GetBufferSize(blob);
+    hr = ID3D12Device_CreateComputePipelineState(device, &compute_desc,
+            &IID_ID3D12PipelineState, (void **)&pipeline_state);
+    ok(hr == S_OK, "Failed to create compute pipeline from cached blob, hr %#x.\n", hr);
+    hr = ID3D12PipelineState_GetCachedBlob(pipeline_state, &blob2);
+    ok(hr == S_OK, "Failed to get cached blob, hr %#x.\n", hr);
+    ok(ID3D10Blob_GetBufferSize(blob2), "Got empty cached blob.\n");
+    ID3D10Blob_Release(blob2);
+    ID3D12PipelineState_Release(pipeline_state);
+
+    compute_desc.pRootSignature = root_signature2;
+    hr = ID3D12Device_CreateComputePipelineState(device, &compute_desc,
+            &IID_ID3D12PipelineState, (void **)&pipeline_state);
+    ok(hr == E_INVALIDARG, "Got unexpected hr %#x.\n", hr);
+    ID3D10Blob_Release(blob);
+
+    init_pipeline_state_desc(&graphics_desc, root_signature, DXGI_FORMAT_R8G8B8A8_UNORM, NULL, NULL, NULL);
+    hr = ID3D12Device_CreateGraphicsPipelineState(device, &graphics_desc,
+            &IID_ID3D12PipelineState, (void **)&pipeline_state);
+    ok(hr == S_OK, "Failed to create graphics pipeline, hr %#x.\n", hr);
+    hr = ID3D12PipelineState_GetCachedBlob(pipeline_state, &blob);
+    ok(hr == S_OK, "Failed to get cached blob, hr %#x.\n", hr);
+    ID3D12PipelineState_Release(pipeline_state);
+
+    graphics_desc.CachedPSO.pCachedBlob = ID3D10Blob_GetBufferPointer(blob);
+    graphics_desc.CachedPSO.CachedBlobSizeInBytes = ID3D10Blob_GetBufferSize(blob);
+    hr = ID3D12Device_CreateGraphicsPipelineState(device, &graphics_desc,
+            &IID_ID3D12PipelineState, (void **)&pipeline_state);
+    ok(hr == S_OK, "Failed to create graphics pipeline from cached blob, hr %#x.\n", hr);
+    ID3D12PipelineState_Release(pipeline_state);
+
+    graphics_desc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
+    hr = ID3D12Device_CreateGraphicsPipelineState(device, &graphics_desc,
+            &IID_ID3D12PipelineState, (void **)&tmp);
+    ok(hr == E_INVALIDARG, "Got unexpected hr %#x.\n", hr);
+
+    graphics_desc.RasterizerState.CullMode = D3D12_CULL_MODE_BACK;
+    ((BYTE *)ID3D10Blob_GetBufferPointer(blob))[0] ^= 0xff;
+    hr = ID3D12Device_CreateGraphicsPipelineState(device, &graphics_desc,
+            &IID_ID3D12PipelineState, (void **)&tmp);
+    ok(FAILED(hr), "Got unexpected hr %#x.\n", hr);
+    ID3D10Blob_Release(blob);
+
+    ID3D12RootSignature_Release(root_signature2);
+    ID3D12RootSignature_Release(root_signature);
+    refcount = ID3D12Device_Release(device);
+    ok(!refcount, "ID3D12Device has %u references left.\n", (unsigned int)refcount);
+}
+
 static void test_create_fence(void)
 {
     ID3D12Device *device, *tmp_device;
@@ -44672,6 +44899,8 @@ START_TEST(d3d12)
     run_test(test_create_compute_pipeline_state);
     run_test(test_create_graphics_pipeline_state);
     run_test(test_create_pipeline_state);
+    run_test(test_pipeline_library);
+    run_test(test_cached_pipeline_state);
     run_test(test_create_fence);
     run_test(test_object_interface);
     run_test(test_multithread_private_data);
@@ -0,0 +1,118 @@
+#!/usr/bin/env python3
+#
+# Copyright 2020 VKD3D contributors
+#
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Lesser General Public
+# License as published by the Free Software Foundation; either
+# version 2.1 of the License, or (at your option) any later version.
+#
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# Lesser General Public License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public
+# License along with this library; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+
+# Writes the DXBC blobs embedded in the given test sources and demo shader
+# headers to a directory, as the corpus of vkd3d_shader_bench. Blobs are the
+# const DWORD or BYTE arrays which start with a DXBC header of the matching
+# size, and are named <test>-<array>.dxbc after the enclosing test function,
+# or after the source file outside of functions. Blobs embedded more than
+# once are written once.
+
+import hashlib
+import os
+import re
+import struct
+import sys
+
+TAG_DXBC = 0x43425844
+TAG_DXIL = 0x4c495844
+
+function_re = re.compile(r'^static [^;(]*\b(\w+)\((?:void|[^)]*)\)\s*$', re.M)
+array_re = re.compile(r'(?:static )?const (DWORD|uint32_t|BYTE)\s+(\w+)\[\]\s*=\s*\{(.*?)\};', re.S)
+
+def parse_blob(element_type, body):
+    body = re.sub(r'#if 0.*?#endif', '', body, flags=re.S)
+    body = re.sub(r'/\*.*?\*/', '', body, flags=re.S)
+    body = re.sub(r'//[^\n]*', '', body)
+    if element_type == 'BYTE':
+        values = [int(v, 0) for v in re.findall(r'\b(?:0x[0-9a-fA-F]+|[1-9][0-9]*|0)\b', body)]
+        if any(v > 0xff for v in values):
+            return None
+        data = bytes(values)
+    else:
+        words = [int(w, 16) for w in re.findall(r'0x[0-9a-fA-F]+', body)]
+        data = struct.pack('<%uI' % len(words), *words)
+    if len(data) < 32:
+        return None
+    tag, size = struct.unpack_from('<I', data, 0)[0], struct.unpack_from('<I', data, 24)[0]
+    if tag != TAG_DXBC or size != len(data):
+        return None
+    # vkd3d_shader_bench only compiles DXBC shaders.
+    chunk_count = struct.unpack_from('<I', data, 28)[0]
+    if 32 + 4 * chunk_count > len(data):
+        return None
+    for offset in struct.unpack_from('<%uI' % chunk_count, data, 32):
+        if offset + 4 > len(data) or struct.unpack_from('<I', data, offset)[0] == TAG_DXIL:
+            return None
+    return data
+
+def extract(source, blobs, names):
+    text = open(source).read()
+    functions = [(m.start(), m.group(1)) for m in function_re.finditer(text)]
+    default_function = os.path.splitext(os.path.basename(source))[0]
+
+    for m in array_re.finditer(text):
+        data = parse_blob(m.group(1), m.group(3))
+        if data is None:
+            continue
+        digest = hashlib.sha1(data).digest()
+        if digest in blobs:
+            continue
+
+        function = default_function
+        for position, name in functions:
+            if position < m.start():
+                function = name
+        if function.startswith('test_'):
+            function = function[5:]
+        array = m.group(2)
+        if array.endswith('_code'):
+            array = array[:-5]
+
+        name = '%s-%s.dxbc' % (function, array)
+        i = 2
+        while name in names:
+            name = '%s-%s-%u.dxbc' % (function, array, i)
+            i += 1
+        names.add(name)
+        blobs[digest] = (name, data)
+
+def main():
+    if len(sys.argv) < 3:
+        sys.stderr.write('usage: %s <output_directory> <source>...\n' % sys.argv[0])
+        return 1
+
+    output_dir = sys.argv[1]
+    blobs = {}
+    names = set()
+    for source in sys.argv[2:]:
+        extract(source, blobs, names)
+
+    os.makedirs(output_dir, exist_ok=True)
+    for name in os.listdir(output_dir):
+        if name.endswith('.dxbc') and name not in names:
+            os.remove(os.path.join(output_dir, name))
+    for name, data in blobs.values():
+        with open(os.path.join(output_dir, name), 'wb') as f:
+            f.write(data)
+    # Make the directory newer than the sources for make and ninja.
+    os.utime(output_dir)
+    return 0
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -23,6 +23,11 @@
 #include <vkd3d.h>
 
 #include "d3d12_test_utils.h"
+#include "vkd3d_pipeline_archive.h"
+
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 HRESULT WINAPI D3D12SerializeRootSignature(const D3D12_ROOT_SIGNATURE_DESC *root_signature_desc,
         D3D_ROOT_SIGNATURE_VERSION version, ID3DBlob **blob, ID3DBlob **error_blob)
@@ -1107,6 +1112,475 @@ static void test_application_info(void)
     ok(!refcount, "Instance has %u references left.\n", refcount);
 }
 
+static void get_pipeline_statistics(ID3D12Device *device, struct vkd3d_pipeline_statistics *statistics)
+{
+    HRESULT hr;
+
+    memset(statistics, 0, sizeof(*statistics));
+    statistics->type = VKD3D_STRUCTURE_TYPE_PIPELINE_STATISTICS;
+    hr = vkd3d_get_pipeline_statistics(device, statistics);
+    ok(hr == S_OK, "Failed to get pipeline statistics, hr %#x.\n", hr);
+}
+
+static void test_pipeline_statistics(void)
+{
+    const struct vkd3d_pipeline_timing_statistics *timing;
+    struct vkd3d_pipeline_statistics before, after;
+    D3D12_COMPUTE_PIPELINE_STATE_DESC desc;
+    ID3D12RootSignature *root_signature;
+    ID3D12PipelineState *pipeline_state, *pipeline_state2;
+    ID3D12Device *device;
+    unsigned int i, j;
+    uint64_t count;
+    ULONG refcount;
+    HRESULT hr;
+
+    static const DWORD cs_code[] =
+    {
+#if 0
+        [numthreads(1, 1, 1)]
+        void main() { }
+#endif
+        0x43425844, 0x1acc3ad0, 0x71c7b057, 0xc72c4306, 0xf432cb57, 0x00000001, 0x00000074, 0x00000003,
+        0x0000002c, 0x0000003c, 0x0000004c, 0x4e475349, 0x00000008, 0x00000000, 0x00000008, 0x4e47534f,
+        0x00000008, 0x00000000, 0x00000008, 0x58454853, 0x00000020, 0x00050050, 0x00000008, 0x0100086a,
+        0x0400009b, 0x00000001, 0x00000001, 0x00000001, 0x0100003e,
+    };
+
+    device = create_device();
+    ok(device, "Failed to create device.\n");
+
+    root_signature = create_empty_root_signature(device, D3D12_ROOT_SIGNATURE_FLAG_NONE);
+
+    memset(&desc, 0, sizeof(desc));
+    desc.pRootSignature = root_signature;
+    desc.CS.pShaderBytecode = cs_code;
+    desc.CS.BytecodeLength = sizeof(cs_code);
+
+    memset(&before, 0, sizeof(before));
+    hr = vkd3d_get_pipeline_statistics(device, &before);
+    ok(hr == E_INVALIDARG, "Got unexpected hr %#x.\n", hr);
+
+    get_pipeline_statistics(device, &before);
+    hr = ID3D12Device_CreateComputePipelineState(device, &desc,
+            &IID_ID3D12PipelineState, (void **)&pipeline_state);
+    ok(hr == S_OK, "Failed to create compute pipeline state, hr %#x.\n", hr);
+    get_pipeline_statistics(device, &after);
+
+    timing = &after.timings[VKD3D_PIPELINE_TIMING_SHADER_MODULE_CREATE];
+    ok(timing->count == before.timings[VKD3D_PIPELINE_TIMING_SHADER_MODULE_CREATE].count + 1,
+            "Got unexpected shader module count %"PRIu64".\n", timing->count);
+    timing = &after.timings[VKD3D_PIPELINE_TIMING_PIPELINE_CREATE];
+    ok(timing->count == before.timings[VKD3D_PIPELINE_TIMING_PIPELINE_CREATE].count + 1,
+            "Got unexpected pipeline count %"PRIu64".\n", timing->count);
+
+    /* The shader module is shared with the first pipeline state. */
+    before = after;
+    hr = ID3D12Device_CreateComputePipelineState(device, &desc,
+            &IID_ID3D12PipelineState, (void **)&pipeline_state2);
+    ok(hr == S_OK, "Failed to create compute pipeline state, hr %#x.\n", hr);
+    get_pipeline_statistics(device, &after);
+
+    timing = &after.timings[VKD3D_PIPELINE_TIMING_SHADER_MODULE_CREATE];
+    ok(timing->count == before.timings[VKD3D_PIPELINE_TIMING_SHADER_MODULE_CREATE].count,
+            "Got unexpected shader module count %"PRIu64".\n", timing->count);
+    timing = &after.timings[VKD3D_PIPELINE_TIMING_PIPELINE_CREATE];
+    ok(timing->count == before.timings[VKD3D_PIPELINE_TIMING_PIPELINE_CREATE].count + 1,
+            "Got unexpected pipeline count %"PRIu64".\n", timing->count);
+
+    for (i = 0; i < VKD3D_PIPELINE_TIMING_COUNT; ++i)
+    {
+        timing = &after.timings[i];
+        ok(timing->max_ns <= timing->total_ns, "Got max %"PRIu64", total %"PRIu64".\n",
+                timing->max_ns, timing->total_ns);
+
+        for (j = 0, count = 0; j < VKD3D_PIPELINE_TIMING_HISTOGRAM_SIZE; ++j)
+            count += timing->histogram[j];
+        ok(count == timing->count, "Got histogram sum %"PRIu64", count %"PRIu64".\n", count, timing->count);
+    }
+
+    ID3D12PipelineState_Release(pipeline_state2);
+    ID3D12PipelineState_Release(pipeline_state);
+    ID3D12RootSignature_Release(root_signature);
+    refcount = ID3D12Device_Release(device);
+    ok(!refcount, "Device has %u references left.\n", refcount);
+}
+
+static void test_sampler_cache(void)
+{
+    struct vkd3d_pipeline_statistics before, after;
+    D3D12_STATIC_SAMPLER_DESC static_sampler_desc;
+    D3D12_ROOT_SIGNATURE_DESC root_signature_desc;
+    D3D12_CPU_DESCRIPTOR_HANDLE cpu_handle;
+    ID3D12RootSignature *root_signature;
+    D3D12_SAMPLER_DESC sampler_desc;
+    ID3D12DescriptorHeap *heap;
+    unsigned int descriptor_size;
+    ID3D12Device *device;
+    ULONG refcount;
+    HRESULT hr;
+
+    device = create_device();
+    ok(device, "Failed to create device.\n");
+
+    heap = create_cpu_descriptor_heap(device, D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER, 4);
+    cpu_handle = ID3D12DescriptorHeap_GetCPUDescriptorHandleForHeapStart(heap);
+    descriptor_size = ID3D12Device_GetDescriptorHandleIncrementSize(device, D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER);
+
+    memset(&sampler_desc, 0, sizeof(sampler_desc));
+    sampler_desc.Filter = D3D12_FILTER_MIN_MAG_MIP_LINEAR;
+    sampler_desc.AddressU = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
+    sampler_desc.AddressV = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
+    sampler_desc.AddressW = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
+    sampler_desc.MaxLOD = D3D12_FLOAT32_MAX;
+
+    get_pipeline_statistics(device, &before);
+    ID3D12Device_CreateSampler(device, &sampler_desc, cpu_handle);
+
+    /* Fields which are not used by the filter and address modes are ignored. */
+    sampler_desc.MaxAnisotropy = 16;
+    sampler_desc.ComparisonFunc = D3D12_COMPARISON_FUNC_LESS;
+    sampler_desc.BorderColor[3] = 1.0f;
+    cpu_handle.ptr += descriptor_size;
+    ID3D12Device_CreateSampler(device, &sampler_desc, cpu_handle);
+
+    sampler_desc.AddressU = D3D12_TEXTURE_ADDRESS_MODE_BORDER;
+    cpu_handle.ptr += descriptor_size;
+    ID3D12Device_CreateSampler(device, &sampler_desc, cpu_handle);
+    get_pipeline_statistics(device, &after);
+
+    ok(after.sampler_misses == before.sampler_misses + 2, "Got %"PRIu64" sampler misses, expected %"PRIu64".\n",
+            after.sampler_misses, before.sampler_misses + 2);
+    ok(after.sampler_hits == before.sampler_hits + 1, "Got %"PRIu64" sampler hits, expected %"PRIu64".\n",
+            after.sampler_hits, before.sampler_hits + 1);
+
+    /* Static samplers share the cache with sampler descriptors. */
+    memset(&static_sampler_desc, 0, sizeof(static_sampler_desc));
+    static_sampler_desc.Filter = D3D12_FILTER_MIN_MAG_MIP_LINEAR;
+    static_sampler_desc.AddressU = D3D12_TEXTURE_ADDRESS_MODE_BORDER;
+    static_sampler_desc.AddressV = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
+    static_sampler_desc.AddressW = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
+    static_sampler_desc.BorderColor = D3D12_STATIC_BORDER_COLOR_OPAQUE_BLACK;
+    static_sampler_desc.MaxLOD = D3D12_FLOAT32_MAX;
+    static_sampler_desc.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+
+    memset(&root_signature_desc, 0, sizeof(root_signature_desc));
+    root_signature_desc.NumStaticSamplers = 1;
+    root_signature_desc.pStaticSamplers = &static_sampler_desc;
+
+    before = after;
+    hr = create_root_signature(device, &root_signature_desc, &root_signature);
+    ok(hr == S_OK, "Failed to create root signature, hr %#x.\n", hr);
+    get_pipeline_statistics(device, &after);
+
+    ok(after.sampler_misses == before.sampler_misses, "Got %"PRIu64" sampler misses, expected %"PRIu64".\n",
+            after.sampler_misses, before.sampler_misses);
+    ok(after.sampler_hits == before.sampler_hits + 1, "Got %"PRIu64" sampler hits, expected %"PRIu64".\n",
+            after.sampler_hits, before.sampler_hits + 1);
+
+    ID3D12RootSignature_Release(root_signature);
+    ID3D12DescriptorHeap_Release(heap);
+    refcount = ID3D12Device_Release(device);
+    ok(!refcount, "Device has %u references left.\n", refcount);
+}
+
+static void test_pipeline_variant_budget(void)
+{
+    static const float white[] = {1.0f, 1.0f, 1.0f, 1.0f};
+
+    struct vkd3d_pipeline_statistics before, after;
+    ID3D12GraphicsCommandList *command_list;
+    ID3D12PipelineState *pipeline_state;
+    struct test_context_desc desc;
+    struct test_context context;
+    ID3D12CommandQueue *queue;
+
+    /* The budget is configured when the device is created. */
+    setenv("VKD3D_PIPELINE_VARIANT_LIMIT", "1", 1);
+    memset(&desc, 0, sizeof(desc));
+    desc.rt_width = desc.rt_height = 32;
+    if (!init_test_context(&context, &desc))
+    {
+        unsetenv("VKD3D_PIPELINE_VARIANT_LIMIT");
+        return;
+    }
+    unsetenv("VKD3D_PIPELINE_VARIANT_LIMIT");
+    command_list = context.list;
+    queue = context.queue;
+
+    pipeline_state = create_pipeline_state(context.device, context.root_signature,
+            context.render_target_desc.Format, NULL, NULL, NULL);
+
+    get_pipeline_statistics(context.device, &before);
+
+    /* Each pipeline state evicts the variant of the other one, which the
+     * command list still uses. */
+    ID3D12GraphicsCommandList_ClearRenderTargetView(command_list, context.rtv, white, 0, NULL);
+    ID3D12GraphicsCommandList_OMSetRenderTargets(command_list, 1, &context.rtv, false, NULL);
+    ID3D12GraphicsCommandList_SetGraphicsRootSignature(command_list, context.root_signature);
+    ID3D12GraphicsCommandList_IASetPrimitiveTopology(command_list, D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    ID3D12GraphicsCommandList_RSSetViewports(command_list, 1, &context.viewport);
+    ID3D12GraphicsCommandList_RSSetScissorRects(command_list, 1, &context.scissor_rect);
+    ID3D12GraphicsCommandList_SetPipelineState(command_list, context.pipeline_state);
+    ID3D12GraphicsCommandList_DrawInstanced(command_list, 3, 1, 0, 0);
+    ID3D12GraphicsCommandList_SetPipelineState(command_list, pipeline_state);
+    ID3D12GraphicsCommandList_DrawInstanced(command_list, 3, 1, 0, 0);
+    ID3D12GraphicsCommandList_SetPipelineState(command_list, context.pipeline_state);
+    ID3D12GraphicsCommandList_DrawInstanced(command_list, 3, 1, 0, 0);
+
+    get_pipeline_statistics(context.device, &after);
+    ok(after.pipeline_variant_evictions >= before.pipeline_variant_evictions + 2,
+            "Got unexpected eviction count %"PRIu64".\n", after.pipeline_variant_evictions);
+    ok(after.pipeline_variant_count == 1, "Got unexpected variant count %"PRIu64".\n",
+            after.pipeline_variant_count);
+    ok(after.pipeline_variant_size, "Got unexpected variant size %"PRIu64".\n",
+            after.pipeline_variant_size);
+
+    transition_resource_state(command_list, context.render_target,
+            D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_COPY_SOURCE);
+    check_sub_resource_uint(context.render_target, 0, queue, command_list, 0xff00ff00, 0);
+
+    /* Variants still referenced by the command allocator outlive the
+     * pipeline state. */
+    ID3D12PipelineState_Release(pipeline_state);
+    destroy_test_context(&context);
+}
+
+static void create_cached_compute_pipeline_state(const D3D12_SHADER_BYTECODE *cs)
+{
+    D3D12_COMPUTE_PIPELINE_STATE_DESC desc;
+    ID3D12RootSignature *root_signature;
+    ID3D12PipelineState *pipeline_state;
+    ID3D12Device *device;
+    ULONG refcount;
+    HRESULT hr;
+
+    device = create_device();
+    ok(device, "Failed to create device.\n");
+
+    root_signature = create_empty_root_signature(device, D3D12_ROOT_SIGNATURE_FLAG_NONE);
+
+    memset(&desc, 0, sizeof(desc));
+    desc.pRootSignature = root_signature;
+    desc.CS = *cs;
+
+    hr = ID3D12Device_CreateComputePipelineState(device, &desc,
+            &IID_ID3D12PipelineState, (void **)&pipeline_state);
+    ok(hr == S_OK, "Failed to create compute pipeline state, hr %#x.\n", hr);
+
+    ID3D12PipelineState_Release(pipeline_state);
+    ID3D12RootSignature_Release(root_signature);
+    refcount = ID3D12Device_Release(device);
+    ok(!refcount, "Device has %u references left.\n", refcount);
+}
+
+static bool get_shader_cache_file(const char *cache_dir, char *path, size_t path_size)
+{
+    struct dirent *entry;
+    bool found = false;
+    DIR *dir;
+
+    if (!(dir = opendir(cache_dir)))
+        return false;
+    while (!found && (entry = readdir(dir)))
+    {
+        if ((found = strstr(entry->d_name, ".vkd3d-shader-cache")))
+            snprintf(path, path_size, "%s/%s", cache_dir, entry->d_name);
+    }
+    closedir(dir);
+
+    return found;
+}
+
+static uint64_t get_file_size(const char *path)
+{
+    struct stat st;
+
+    return stat(path, &st) ? 0 : st.st_size;
+}
+
+static void test_shader_cache(void)
+{
+    char cache_dir[] = "/tmp/vkd3d-shader-cache-XXXXXX";
+    D3D12_SHADER_BYTECODE cs;
+    uint64_t size, new_size;
+    char path[256];
+    bool ret;
+
+    static const DWORD cs_code[] =
+    {
+#if 0
+        [numthreads(1, 1, 1)]
+        void main() { }
+#endif
+        0x43425844, 0x1acc3ad0, 0x71c7b057, 0xc72c4306, 0xf432cb57, 0x00000001, 0x00000074, 0x00000003,
+        0x0000002c, 0x0000003c, 0x0000004c, 0x4e475349, 0x00000008, 0x00000000, 0x00000008, 0x4e47534f,
+        0x00000008, 0x00000000, 0x00000008, 0x58454853, 0x00000020, 0x00050050, 0x00000008, 0x0100086a,
+        0x0400009b, 0x00000001, 0x00000001, 0x00000001, 0x0100003e,
+    };
+
+    if (!mkdtemp(cache_dir))
+    {
+        skip("Failed to create shader cache directory.\n");
+        return;
+    }
+
+    cs.pShaderBytecode = cs_code;
+    cs.BytecodeLength = sizeof(cs_code);
+
+    /* The cache is opened when the device is created. A record is appended
+     * for each missed shader, and nothing is written on a hit. */
+    setenv("VKD3D_SHADER_CACHE_PATH", cache_dir, 1);
+
+    create_cached_compute_pipeline_state(&cs);
+    ret = get_shader_cache_file(cache_dir, path, sizeof(path));
+    ok(ret, "Failed to find shader cache file.\n");
+    size = get_file_size(path);
+    ok(size > 16, "Got unexpected shader cache size %"PRIu64".\n", size);
+    create_cached_compute_pipeline_state(&cs);
+    new_size = get_file_size(path);
+    ok(new_size == size, "Got unexpected shader cache size %"PRIu64", expected %"PRIu64".\n", new_size, size);
+
+    /* A truncated trailing record is skipped, and the shader is written
+     * again after it. */
+    ret = !truncate(path, size - 6);
+    ok(ret, "Failed to truncate shader cache file.\n");
+    create_cached_compute_pipeline_state(&cs);
+    new_size = get_file_size(path);
+    ok(new_size > size, "Got unexpected shader cache size %"PRIu64".\n", new_size);
+    size = new_size;
+    create_cached_compute_pipeline_state(&cs);
+    new_size = get_file_size(path);
+    ok(new_size == size, "Got unexpected shader cache size %"PRIu64", expected %"PRIu64".\n", new_size, size);
+
+    /* Nothing but the file header is written to a full cache. */
+    ret = !unlink(path);
+    ok(ret, "Failed to delete shader cache file.\n");
+    setenv("VKD3D_SHADER_CACHE_MAX_SIZE", "0", 1);
+    create_cached_compute_pipeline_state(&cs);
+    create_cached_compute_pipeline_state(&cs);
+    size = get_file_size(path);
+    ok(size == 16, "Got unexpected shader cache size %"PRIu64".\n", size);
+    unsetenv("VKD3D_SHADER_CACHE_MAX_SIZE");
+
+    unsetenv("VKD3D_SHADER_CACHE_PATH");
+    unlink(path);
+    rmdir(cache_dir);
+}
+
+/* Returns the number of records of each type, or false if the archive does
+ * not end with a complete record. */
+static bool get_pipeline_archive_records(const char *path, unsigned int *counts, size_t count_size)
+{
+    const struct vkd3d_pipeline_archive_record *record;
+    const struct vkd3d_pipeline_archive_header *header;
+    size_t offset, size;
+    uint8_t *data = NULL;
+    bool ret;
+    FILE *f;
+
+    memset(counts, 0, count_size * sizeof(*counts));
+
+    if (!(f = fopen(path, "rb")))
+        return false;
+    ret = !fseek(f, 0, SEEK_END) && (size = ftell(f)) != (size_t)-1 && !fseek(f, 0, SEEK_SET)
+            && (data = malloc(size)) && fread(data, 1, size, f) == size;
+    fclose(f);
+    if (!ret)
+    {
+        free(data);
+        return false;
+    }
+
+    header = (const void *)data;
+    ret = size >= sizeof(*header) && header->magic == VKD3D_PIPELINE_ARCHIVE_MAGIC
+            && header->version == VKD3D_PIPELINE_ARCHIVE_VERSION;
+    for (offset = sizeof(*header); ret && offset < size;)
+    {
+        record = (const void *)(data + offset);
+        if (!(ret = size - offset >= sizeof(*record)
+                && size - offset - sizeof(*record) >= vkd3d_pipeline_archive_align(record->size)))
+            break;
+        if (record->type < count_size)
+            ++counts[record->type];
+        offset += sizeof(*record) + vkd3d_pipeline_archive_align(record->size);
+    }
+
+    free(data);
+    return ret;
+}
+
+static void test_pipeline_recorder(void)
+{
+    char archive_dir[] = "/tmp/vkd3d-pipeline-archive-XXXXXX";
+    unsigned int counts[VKD3D_PIPELINE_ARCHIVE_RECORD_COMPUTE_PIPELINE + 1];
+    D3D12_SHADER_BYTECODE cs;
+    uint64_t size, new_size;
+    char path[256];
+    bool ret;
+
+    static const DWORD cs_code[] =
+    {
+#if 0
+        [numthreads(1, 1, 1)]
+        void main() { }
+#endif
+        0x43425844, 0x1acc3ad0, 0x71c7b057, 0xc72c4306, 0xf432cb57, 0x00000001, 0x00000074, 0x00000003,
+        0x0000002c, 0x0000003c, 0x0000004c, 0x4e475349, 0x00000008, 0x00000000, 0x00000008, 0x4e47534f,
+        0x00000008, 0x00000000, 0x00000008, 0x58454853, 0x00000020, 0x00050050, 0x00000008, 0x0100086a,
+        0x0400009b, 0x00000001, 0x00000001, 0x00000001, 0x0100003e,
+    };
+
+    if (!mkdtemp(archive_dir))
+    {
+        skip("Failed to create pipeline archive directory.\n");
+        return;
+    }
+
+    cs.pShaderBytecode = cs_code;
+    cs.BytecodeLength = sizeof(cs_code);
+    snprintf(path, sizeof(path), "%s/archive", archive_dir);
+
+    /* The archive is opened when the device is created. */
+    setenv("VKD3D_PIPELINE_RECORD_PATH", path, 1);
+
+    create_cached_compute_pipeline_state(&cs);
+    ret = get_pipeline_archive_records(path, counts, ARRAY_SIZE(counts));
+    ok(ret, "Failed to read pipeline archive.\n");
+    ok(counts[VKD3D_PIPELINE_ARCHIVE_RECORD_SHADER] == 1, "Got %u shader records.\n",
+            counts[VKD3D_PIPELINE_ARCHIVE_RECORD_SHADER]);
+    ok(counts[VKD3D_PIPELINE_ARCHIVE_RECORD_ROOT_SIGNATURE] == 1, "Got %u root signature records.\n",
+            counts[VKD3D_PIPELINE_ARCHIVE_RECORD_ROOT_SIGNATURE]);
+    ok(counts[VKD3D_PIPELINE_ARCHIVE_RECORD_COMPUTE_PIPELINE] == 1, "Got %u compute pipeline records.\n",
+            counts[VKD3D_PIPELINE_ARCHIVE_RECORD_COMPUTE_PIPELINE]);
+    size = get_file_size(path);
+
+    /* Records from earlier runs are not written again. */
+    create_cached_compute_pipeline_state(&cs);
+    new_size = get_file_size(path);
+    ok(new_size == size, "Got unexpected archive size %"PRIu64", expected %"PRIu64".\n", new_size, size);
+
+    /* A torn record at the end of the archive is truncated, and the records
+     * appended after it can be read back. */
+    ret = !truncate(path, size - 4);
+    ok(ret, "Failed to truncate pipeline archive.\n");
+    create_cached_compute_pipeline_state(&cs);
+    new_size = get_file_size(path);
+    ok(new_size == size, "Got unexpected archive size %"PRIu64", expected %"PRIu64".\n", new_size, size);
+    ret = get_pipeline_archive_records(path, counts, ARRAY_SIZE(counts));
+    ok(ret, "Failed to read pipeline archive.\n");
+    ok(counts[VKD3D_PIPELINE_ARCHIVE_RECORD_SHADER] == 1, "Got %u shader records.\n",
+            counts[VKD3D_PIPELINE_ARCHIVE_RECORD_SHADER]);
+    ok(counts[VKD3D_PIPELINE_ARCHIVE_RECORD_ROOT_SIGNATURE] == 1, "Got %u root signature records.\n",
+            counts[VKD3D_PIPELINE_ARCHIVE_RECORD_ROOT_SIGNATURE]);
+    ok(counts[VKD3D_PIPELINE_ARCHIVE_RECORD_COMPUTE_PIPELINE] == 1, "Got %u compute pipeline records.\n",
+            counts[VKD3D_PIPELINE_ARCHIVE_RECORD_COMPUTE_PIPELINE]);
+
+    unsetenv("VKD3D_PIPELINE_RECORD_PATH");
+    unlink(path);
+    rmdir(archive_dir);
+}
+
 static bool have_d3d12_device(void)
 {
     ID3D12Device *device;
@@ -1139,4 +1613,9 @@ START_TEST(vkd3d_api)
     run_test(test_external_resource_present_state);
     run_test(test_formats);
     run_test(test_application_info);
+    run_test(test_pipeline_statistics);
+    run_test(test_sampler_cache);
+    run_test(test_pipeline_variant_budget);
+    run_test(test_shader_cache);
+    run_test(test_pipeline_recorder);
 }
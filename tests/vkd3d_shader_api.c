@@ -18,8 +18,10 @@
 
 #include "vkd3d_test.h"
 #include <vkd3d_shader.h>
+#include "spirv/unified1/spirv.h"
 
 #include <locale.h>
+#include <time.h>
 
 static void test_invalid_shaders(void)
 {
@@ -64,6 +66,7 @@ static void test_vkd3d_shader_pfns(void)
     PFN_vkd3d_shader_free_root_signature pfn_vkd3d_shader_free_root_signature;
     PFN_vkd3d_shader_free_shader_code pfn_vkd3d_shader_free_shader_code;
     PFN_vkd3d_shader_compile_dxbc pfn_vkd3d_shader_compile_dxbc;
+    PFN_vkd3d_shader_hash_data pfn_vkd3d_shader_hash_data;
     PFN_vkd3d_shader_scan_dxbc pfn_vkd3d_shader_scan_dxbc;
 
     struct vkd3d_versioned_root_signature_desc root_signature_desc;
@@ -103,6 +106,7 @@ static void test_vkd3d_shader_pfns(void)
     pfn_vkd3d_shader_free_root_signature = vkd3d_shader_free_root_signature;
     pfn_vkd3d_shader_free_shader_code = vkd3d_shader_free_shader_code;
     pfn_vkd3d_shader_compile_dxbc = vkd3d_shader_compile_dxbc;
+    pfn_vkd3d_shader_hash_data = vkd3d_shader_hash_data;
     pfn_vkd3d_shader_scan_dxbc = vkd3d_shader_scan_dxbc;
 
     rc = pfn_vkd3d_shader_serialize_root_signature(&empty_rs_desc, &dxbc);
@@ -126,6 +130,586 @@ static void test_vkd3d_shader_pfns(void)
     scan_info.type = VKD3D_SHADER_STRUCTURE_TYPE_SCAN_INFO;
     rc = pfn_vkd3d_shader_scan_dxbc(&vs, &scan_info);
     ok(rc == VKD3D_OK, "Got unexpected error code %d.\n", rc);
+
+    ok(pfn_vkd3d_shader_hash_data(vs.code, vs.size, 0) == vkd3d_shader_hash_data(vs.code, vs.size, 0),
+            "Got different hashes.\n");
+}
+
+static void test_compile_dxbc_repeated(void)
+{
+    struct vkd3d_shader_code spirv, reference, invalid;
+    unsigned int i;
+    int rc;
+
+    static const DWORD vs_code[] =
+    {
+#if 0
+        float4 main(int4 p : POSITION) : SV_Position
+        {
+            return p;
+        }
+#endif
+        0x43425844, 0x3fd50ab1, 0x580a1d14, 0x28f5f602, 0xd1083e3a, 0x00000001, 0x000000d8, 0x00000003,
+        0x0000002c, 0x00000060, 0x00000094, 0x4e475349, 0x0000002c, 0x00000001, 0x00000008, 0x00000020,
+        0x00000000, 0x00000000, 0x00000002, 0x00000000, 0x00000f0f, 0x49534f50, 0x4e4f4954, 0xababab00,
+        0x4e47534f, 0x0000002c, 0x00000001, 0x00000008, 0x00000020, 0x00000000, 0x00000001, 0x00000003,
+        0x00000000, 0x0000000f, 0x505f5653, 0x7469736f, 0x006e6f69, 0x52444853, 0x0000003c, 0x00010040,
+        0x0000000f, 0x0300005f, 0x001010f2, 0x00000000, 0x04000067, 0x001020f2, 0x00000000, 0x00000001,
+        0x0500002b, 0x001020f2, 0x00000000, 0x00101e46, 0x00000000, 0x0100003e,
+    };
+    static const DWORD ps_break_code[] =
+    {
+        0x43425844, 0x1316702a, 0xb1a7ebfc, 0xf477753e, 0x72605647, 0x00000001, 0x000000f8, 0x00000003,
+        0x0000002c, 0x0000003c, 0x00000070, 0x4e475349, 0x00000008, 0x00000000, 0x00000008, 0x4e47534f,
+        0x0000002c, 0x00000001, 0x00000008, 0x00000020, 0x00000000, 0x00000000, 0x00000001, 0x00000000,
+        0x0000000f, 0x545f5653, 0x65677261, 0xabab0074, 0x52444853, 0x00000080, 0x00000040, 0x00000020,
+        0x04000059, 0x00208e46, 0x00000000, 0x00000001, 0x03000065, 0x001020f2, 0x00000000, 0x0400001f,
+        0x0020800a, 0x00000000, 0x00000000, 0x08000036, 0x001020f2, 0x00000000, 0x00004002, 0x3f800000,
+        0x3f800000, 0x3f800000, 0x3f800000, 0x01000002, 0x01000015, 0x08000036, 0x001020f2, 0x00000000,
+        0x00004002, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x0100003e,
+    };
+    static const struct vkd3d_shader_code vs = {vs_code, sizeof(vs_code)};
+    static const struct vkd3d_shader_code ps_break = {ps_break_code, sizeof(ps_break_code)};
+
+    rc = vkd3d_shader_compile_dxbc(&vs, &reference, 0, NULL, NULL);
+    ok(rc == VKD3D_OK, "Got unexpected error code %d.\n", rc);
+    if (rc != VKD3D_OK)
+        return;
+
+    /* Compiler state must not leak from one compilation to the next, even
+     * when a compilation fails half-way. */
+    for (i = 0; i < 4; ++i)
+    {
+        rc = vkd3d_shader_compile_dxbc(&ps_break, &invalid, 0, NULL, NULL);
+        ok(rc == VKD3D_ERROR_INVALID_SHADER, "Got unexpected error code %d.\n", rc);
+
+        rc = vkd3d_shader_compile_dxbc(&vs, &spirv, 0, NULL, NULL);
+        ok(rc == VKD3D_OK, "Got unexpected error code %d.\n", rc);
+        if (rc != VKD3D_OK)
+            continue;
+
+        ok(spirv.size == reference.size && !memcmp(spirv.code, reference.code, spirv.size),
+                "Got different SPIR-V for iteration %u.\n", i);
+        vkd3d_shader_free_shader_code(&spirv);
+    }
+
+    vkd3d_shader_free_shader_code(&reference);
+}
+
+/* Returns the first instruction with the given opcode following "prev", or
+ * NULL. */
+static const uint32_t *find_spirv_instruction(const struct vkd3d_shader_code *spirv, SpvOp op,
+        const uint32_t *prev)
+{
+    const uint32_t *words = spirv->code;
+    size_t i, count = spirv->size / sizeof(*words);
+    unsigned int word_count;
+
+    i = prev ? prev - words + (*prev >> SpvWordCountShift) : 5;
+    for (; i < count; i += word_count)
+    {
+        if (!(word_count = words[i] >> SpvWordCountShift) || word_count > count - i)
+            return NULL;
+        if ((words[i] & SpvOpCodeMask) == op)
+            return &words[i];
+    }
+
+    return NULL;
+}
+
+static unsigned int get_spirv_entry_point_interface(const uint32_t *entry_point, const uint32_t **ids)
+{
+    unsigned int word_count = entry_point[0] >> SpvWordCountShift;
+    unsigned int name_word_count = strlen((const char *)&entry_point[3]) / sizeof(*entry_point) + 1;
+
+    *ids = &entry_point[3 + name_word_count];
+    return word_count - 3 - name_word_count;
+}
+
+static void test_compile_dxbc_optimize(void)
+{
+    struct vkd3d_shader_code spirv, optimized, reference;
+    const uint32_t *words, *ids, *reference_ids;
+    unsigned int count, reference_count;
+    int rc;
+
+    static const DWORD ps_code[] =
+    {
+#if 0
+        uint4 src0;
+        uint4 src1;
+
+        void main(out uint4 dst : SV_Target)
+        {
+            dst = 0;
+            dst.x = src0.x * src1.x;
+        }
+#endif
+        0x43425844, 0x55ebfe14, 0xc9834c14, 0x5f89388a, 0x523be7e0, 0x00000001, 0x000000ec, 0x00000003,
+        0x0000002c, 0x0000003c, 0x00000070, 0x4e475349, 0x00000008, 0x00000000, 0x00000008, 0x4e47534f,
+        0x0000002c, 0x00000001, 0x00000008, 0x00000020, 0x00000000, 0x00000000, 0x00000001, 0x00000000,
+        0x0000000f, 0x545f5653, 0x65677261, 0xabab0074, 0x58454853, 0x00000074, 0x00000050, 0x0000001d,
+        0x0100086a, 0x04000059, 0x00208e46, 0x00000000, 0x00000002, 0x03000065, 0x001020f2, 0x00000000,
+        0x0a000026, 0x0000d000, 0x00102012, 0x00000000, 0x0020800a, 0x00000000, 0x00000000, 0x0020800a,
+        0x00000000, 0x00000001, 0x08000036, 0x001020e2, 0x00000000, 0x00004002, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x0100003e,
+    };
+    static const struct vkd3d_shader_code ps = {ps_code, sizeof(ps_code)};
+    static const DWORD ps_fold_code[] =
+    {
+#if 0
+        ps_4_0
+        dcl_input_ps linear v0.x
+        dcl_output o0.x
+        ishl o0.x, l(1), l(4)
+        ret
+#endif
+        0x43425844, 0x7a2c449f, 0x7a88f5ab, 0x884008d7, 0x5ce89c5c, 0x00000001, 0x000000dc, 0x00000003,
+        0x0000002c, 0x00000060, 0x00000094, 0x4e475349, 0x0000002c, 0x00000001, 0x00000008, 0x00000020,
+        0x00000000, 0x00000000, 0x00000003, 0x00000000, 0x00000001, 0x43584554, 0x44524f4f, 0xababab00,
+        0x4e47534f, 0x0000002c, 0x00000001, 0x00000008, 0x00000020, 0x00000000, 0x00000000, 0x00000001,
+        0x00000000, 0x00000001, 0x545f5653, 0x65677261, 0xabab0074, 0x52444853, 0x00000040, 0x00000040,
+        0x00000010, 0x03001062, 0x00101012, 0x00000000, 0x03000065, 0x00102012, 0x00000000, 0x07000029,
+        0x00102012, 0x00000000, 0x00004001, 0x00000001, 0x00004001, 0x00000004, 0x0100003e,
+    };
+    static const struct vkd3d_shader_code ps_fold = {ps_fold_code, sizeof(ps_fold_code)};
+
+    rc = vkd3d_shader_compile_dxbc(&ps, &reference, 0, NULL, NULL);
+    ok(rc == VKD3D_OK, "Got unexpected error code %d.\n", rc);
+    if (rc != VKD3D_OK)
+        return;
+
+    rc = vkd3d_shader_compile_dxbc(&ps, &optimized, VKD3D_SHADER_OPTIMIZE, NULL, NULL);
+    ok(rc == VKD3D_OK, "Got unexpected error code %d.\n", rc);
+    if (rc != VKD3D_OK)
+    {
+        vkd3d_shader_free_shader_code(&reference);
+        return;
+    }
+
+    words = optimized.code;
+    ok(optimized.size > 5 * sizeof(*words) && !(optimized.size % sizeof(*words)),
+            "Got unexpected size %zu.\n", optimized.size);
+    ok(words[0] == 0x07230203, "Got unexpected magic %#x.\n", words[0]);
+    ok(words[3] == ((const uint32_t *)reference.code)[3], "Got id bound %u, expected %u.\n",
+            words[3], ((const uint32_t *)reference.code)[3]);
+    ok(optimized.size < reference.size, "Got size %zu, unoptimized size %zu.\n", optimized.size, reference.size);
+
+    /* The optimizer is deterministic. */
+    rc = vkd3d_shader_compile_dxbc(&ps, &spirv, VKD3D_SHADER_OPTIMIZE, NULL, NULL);
+    ok(rc == VKD3D_OK, "Got unexpected error code %d.\n", rc);
+    if (rc == VKD3D_OK)
+    {
+        ok(spirv.size == optimized.size && !memcmp(spirv.code, optimized.code, spirv.size),
+                "Got different SPIR-V.\n");
+        vkd3d_shader_free_shader_code(&spirv);
+    }
+
+    vkd3d_shader_free_shader_code(&optimized);
+    vkd3d_shader_free_shader_code(&reference);
+
+    /* The shift is folded into a constant, and the unused input is dropped
+     * from the entry point interface. */
+    rc = vkd3d_shader_compile_dxbc(&ps_fold, &reference, 0, NULL, NULL);
+    ok(rc == VKD3D_OK, "Got unexpected error code %d.\n", rc);
+    if (rc != VKD3D_OK)
+        return;
+
+    rc = vkd3d_shader_compile_dxbc(&ps_fold, &optimized, VKD3D_SHADER_OPTIMIZE, NULL, NULL);
+    ok(rc == VKD3D_OK, "Got unexpected error code %d.\n", rc);
+    if (rc != VKD3D_OK)
+    {
+        vkd3d_shader_free_shader_code(&reference);
+        return;
+    }
+
+    ok(find_spirv_instruction(&reference, SpvOpShiftLeftLogical, NULL), "Expected a shift.\n");
+    ok(!find_spirv_instruction(&optimized, SpvOpShiftLeftLogical, NULL), "Got unexpected shift.\n");
+    for (words = NULL; (words = find_spirv_instruction(&optimized, SpvOpConstant, words));)
+    {
+        if ((words[0] >> SpvWordCountShift) == 4 && words[3] == 16)
+            break;
+    }
+    ok(!!words, "Expected a folded constant.\n");
+
+    words = find_spirv_instruction(&reference, SpvOpEntryPoint, NULL);
+    ok(!!words, "Expected an entry point.\n");
+    reference_count = get_spirv_entry_point_interface(words, &reference_ids);
+    ok(reference_count == 2, "Got interface size %u.\n", reference_count);
+    words = find_spirv_instruction(&optimized, SpvOpEntryPoint, NULL);
+    ok(!!words, "Expected an entry point.\n");
+    count = get_spirv_entry_point_interface(words, &ids);
+    ok(count == 1, "Got interface size %u.\n", count);
+    /* Ids are not renumbered, and only the output is left. */
+    if (reference_count == 2 && count == 1)
+        ok(ids[0] == reference_ids[1], "Got interface id %u, expected %u.\n",
+                ids[0], reference_ids[1]);
+
+    vkd3d_shader_free_shader_code(&optimized);
+    vkd3d_shader_free_shader_code(&reference);
+}
+
+static void test_scan_dxbc_long_shader(void)
+{
+    struct vkd3d_shader_scan_info scan_info;
+    unsigned int token_count, code_size, i;
+    struct vkd3d_shader_code dxbc;
+    DWORD *code, *ptr;
+    int rc;
+
+    static const unsigned int repeat_count = 1024;
+    static const DWORD header[] =
+    {
+        0x00000050,             /* ps_5_0 */
+        0x00000000,             /* token count */
+        0x02000068, 0x00000002, /* dcl_temps 2 */
+        /* dcl_uav_typed_texture2d (float,float,float,float) u1 */
+        0x0400189c, 0x0011e000, 0x00000001, 0x00005555,
+    };
+    static const DWORD body[] =
+    {
+        /* mov r0.xyzw, r1.xyzw */
+        0x05000036, 0x001000f2, 0x00000000, 0x00100e46, 0x00000001,
+        /* add r0.xyzw, r0.xyzw, r1.xyzw */
+        0x07000000, 0x001000f2, 0x00000000, 0x00100e46, 0x00000000, 0x00100e46, 0x00000001,
+        /* mul r1.xyzw, r0.xyzw, r1.xyzw */
+        0x07000038, 0x001000f2, 0x00000001, 0x00100e46, 0x00000000, 0x00100e46, 0x00000001,
+        /* mad r0.xyzw, r0.xyzw, r1.xyzw, r0.xyzw */
+        0x09000032, 0x001000f2, 0x00000000, 0x00100e46, 0x00000000, 0x00100e46, 0x00000001,
+        0x00100e46, 0x00000000,
+    };
+    static const DWORD footer[] =
+    {
+        /* ld_uav_typed r0.xyzw, r0.xyyy, u1.xyzw */
+        0x070000a3, 0x001000f2, 0x00000000, 0x00100546, 0x00000000, 0x0011ee46, 0x00000001,
+        0x0100003e, /* ret */
+    };
+
+    /* The UAV read is only found if all preceding instructions are decoded. */
+    token_count = ARRAY_SIZE(header) + repeat_count * ARRAY_SIZE(body) + ARRAY_SIZE(footer);
+    /* DXBC header, one chunk offset, chunk header. */
+    code_size = (8 + 1 + 2 + token_count) * sizeof(*code);
+    code = malloc(code_size);
+    ok(code, "Failed to allocate memory.\n");
+    if (!code)
+        return;
+
+    ptr = code;
+    *ptr++ = 0x43425844; /* DXBC */
+    for (i = 0; i < 4; ++i)
+        *ptr++ = 0; /* checksum */
+    *ptr++ = 0x00000001;
+    *ptr++ = code_size;
+    *ptr++ = 1;
+    *ptr++ = (8 + 1) * sizeof(*code);
+    *ptr++ = 0x58454853; /* SHEX */
+    *ptr++ = token_count * sizeof(*code);
+    memcpy(ptr, header, sizeof(header));
+    ptr[1] = token_count;
+    ptr += ARRAY_SIZE(header);
+    for (i = 0; i < repeat_count; ++i)
+    {
+        memcpy(ptr, body, sizeof(body));
+        ptr += ARRAY_SIZE(body);
+    }
+    memcpy(ptr, footer, sizeof(footer));
+    ptr += ARRAY_SIZE(footer);
+    ok(ptr == code + code_size / sizeof(*code), "Got unexpected size %u.\n", (unsigned int)(ptr - code));
+
+    dxbc.code = code;
+    dxbc.size = code_size;
+
+    memset(&scan_info, 0, sizeof(scan_info));
+    scan_info.type = VKD3D_SHADER_STRUCTURE_TYPE_SCAN_INFO;
+    rc = vkd3d_shader_scan_dxbc(&dxbc, &scan_info);
+    ok(rc == VKD3D_OK, "Got unexpected error code %d.\n", rc);
+    for (i = 0; i < ARRAY_SIZE(scan_info.uav_flags); ++i)
+    {
+        ok(scan_info.uav_flags[i] == (i == 1 ? VKD3D_SHADER_UAV_FLAG_READ_ACCESS : 0),
+                "Got unexpected flags %#x for UAV %u.\n", scan_info.uav_flags[i], i);
+    }
+    ok(!scan_info.sampler_comparison_mode_mask, "Got unexpected sampler comparison mode mask %#x.\n",
+            scan_info.sampler_comparison_mode_mask);
+    ok(!scan_info.use_vocp, "Got unexpected use_vocp %#x.\n", scan_info.use_vocp);
+
+    free(code);
+}
+
+static void test_compile_dxbc_large_root_signature(void)
+{
+    struct vkd3d_shader_resource_binding *bindings, *expected_bindings, *b;
+    struct vkd3d_shader_interface_info shader_interface;
+    unsigned int i, j, binding_count, token_count;
+    struct vkd3d_shader_code dxbc, spirv, reference;
+    size_t code_size;
+    double seconds;
+    DWORD *code, *ptr;
+    clock_t start;
+    int rc;
+
+    static const unsigned int texture_count = 128;
+    static const unsigned int space_count = 16;
+    static const unsigned int range_count = 256;
+    static const unsigned int iteration_count = 100;
+
+    /* ps_5_0, dcl_resource_texture2d (float,float,float,float) t0 ... tN, ret */
+    token_count = 2 + texture_count * 4 + 1;
+    /* DXBC header, one chunk offset, chunk header. */
+    code_size = (8 + 1 + 2 + token_count) * sizeof(*code);
+    code = malloc(code_size);
+    ok(code, "Failed to allocate memory.\n");
+    if (!code)
+        return;
+
+    ptr = code;
+    *ptr++ = 0x43425844; /* DXBC */
+    for (i = 0; i < 4; ++i)
+        *ptr++ = 0; /* checksum */
+    *ptr++ = 0x00000001;
+    *ptr++ = code_size;
+    *ptr++ = 1;
+    *ptr++ = (8 + 1) * sizeof(*code);
+    *ptr++ = 0x58454853; /* SHEX */
+    *ptr++ = token_count * sizeof(*code);
+    *ptr++ = 0x00000050;
+    *ptr++ = token_count;
+    for (i = 0; i < texture_count; ++i)
+    {
+        *ptr++ = 0x04001858;
+        *ptr++ = 0x00107000;
+        *ptr++ = i;
+        *ptr++ = 0x00005555;
+    }
+    *ptr++ = 0x0100003e; /* ret */
+    ok(ptr == code + code_size / sizeof(*code), "Got unexpected size %u.\n", (unsigned int)(ptr - code));
+
+    dxbc.code = code;
+    dxbc.size = code_size;
+
+    /* Many ranges which don't match the shader registers, because of their
+     * descriptor type, register space, register range, binding flags or
+     * shader visibility, followed by the bindings which do. */
+    binding_count = space_count * range_count * 2 + texture_count;
+    bindings = calloc(binding_count, sizeof(*bindings));
+    ok(bindings, "Failed to allocate memory.\n");
+    if (!bindings)
+    {
+        free(code);
+        return;
+    }
+
+    b = bindings;
+    for (i = 0; i < space_count; ++i)
+    {
+        for (j = 0; j < range_count; ++j, b += 2)
+        {
+            b[0].type = VKD3D_SHADER_DESCRIPTOR_TYPE_SRV;
+            b[0].register_space = i;
+            b[0].register_index = i ? j * 4 : texture_count + j * 4;
+            b[0].register_count = j == range_count - 1 ? VKD3D_SHADER_DESCRIPTOR_RANGE_UNBOUNDED : 4;
+            b[0].shader_visibility = VKD3D_SHADER_VISIBILITY_ALL;
+            b[0].flags = VKD3D_SHADER_BINDING_FLAG_IMAGE;
+            b[0].binding.binding = j;
+
+            b[1].type = j % 2 ? VKD3D_SHADER_DESCRIPTOR_TYPE_UAV : VKD3D_SHADER_DESCRIPTOR_TYPE_SRV;
+            b[1].register_space = i;
+            b[1].register_index = j * 4;
+            b[1].register_count = 4;
+            b[1].shader_visibility = i % 2 ? VKD3D_SHADER_VISIBILITY_ALL : VKD3D_SHADER_VISIBILITY_VERTEX;
+            b[1].flags = i % 2 ? VKD3D_SHADER_BINDING_FLAG_BUFFER : VKD3D_SHADER_BINDING_FLAG_IMAGE;
+            b[1].binding.set = 1;
+            b[1].binding.binding = j;
+        }
+    }
+    expected_bindings = b;
+    for (i = 0; i < texture_count; ++i, ++b)
+    {
+        b->type = VKD3D_SHADER_DESCRIPTOR_TYPE_SRV;
+        b->register_index = texture_count - i - 1;
+        b->register_count = 1;
+        b->shader_visibility = i % 2 ? VKD3D_SHADER_VISIBILITY_ALL : VKD3D_SHADER_VISIBILITY_PIXEL;
+        b->flags = VKD3D_SHADER_BINDING_FLAG_IMAGE;
+        b->binding.set = 3;
+        b->binding.binding = 1000 + i;
+    }
+
+    memset(&shader_interface, 0, sizeof(shader_interface));
+    shader_interface.type = VKD3D_SHADER_STRUCTURE_TYPE_SHADER_INTERFACE_INFO;
+    shader_interface.bindings = expected_bindings;
+    shader_interface.binding_count = texture_count;
+
+    rc = vkd3d_shader_compile_dxbc(&dxbc, &reference, 0, &shader_interface, NULL);
+    ok(rc == VKD3D_OK, "Got unexpected error code %d.\n", rc);
+    if (rc != VKD3D_OK)
+    {
+        free(bindings);
+        free(code);
+        return;
+    }
+
+    shader_interface.bindings = bindings;
+    shader_interface.binding_count = binding_count;
+
+    start = clock();
+    for (i = 0; i < iteration_count; ++i)
+    {
+        rc = vkd3d_shader_compile_dxbc(&dxbc, &spirv, 0, &shader_interface, NULL);
+        ok(rc == VKD3D_OK, "Got unexpected error code %d.\n", rc);
+        if (rc != VKD3D_OK)
+            break;
+        ok(spirv.size == reference.size && !memcmp(spirv.code, reference.code, spirv.size),
+                "Got unexpected SPIR-V for iteration %u.\n", i);
+        vkd3d_shader_free_shader_code(&spirv);
+    }
+    seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    if (seconds > 0.0)
+        trace("Compiled %u shaders with %u bindings in %.3f s, %.0f shaders/s.\n",
+                i, binding_count, seconds, i / seconds);
+
+    vkd3d_shader_free_shader_code(&reference);
+    free(bindings);
+    free(code);
+}
+
+static void test_hash(void)
+{
+    struct vkd3d_shader_transform_feedback_info xfb_info;
+    struct vkd3d_shader_compile_timing_info timing_info;
+    struct vkd3d_shader_compile_arguments compile_args;
+    struct vkd3d_shader_resource_binding bindings[2];
+    struct vkd3d_shader_interface_info shader_interface;
+    struct vkd3d_shader_hash_state state;
+    uint64_t hash, expected;
+    unsigned int i, j;
+    uint8_t data[300];
+    int rc;
+
+    static const struct
+    {
+        const char *data;
+        uint64_t seed;
+        uint64_t hash;
+    }
+    tests[] =
+    {
+        {"",    0, 0xef46db3751d8e999ull},
+        {"abc", 0, 0x44bc2cf5ad770999ull},
+    };
+    static const unsigned int chunk_sizes[] = {1, 3, 8, 31, 32, 33, 100};
+
+    for (i = 0; i < ARRAY_SIZE(tests); ++i)
+    {
+        hash = vkd3d_shader_hash_data(tests[i].data, strlen(tests[i].data), tests[i].seed);
+        ok(hash == tests[i].hash, "Test %u: Got hash %#"PRIx64", expected %#"PRIx64".\n",
+                i, hash, tests[i].hash);
+    }
+
+    for (i = 0; i < ARRAY_SIZE(data); ++i)
+        data[i] = i * 7 + 3;
+
+    /* The result must not depend on how the input is split. */
+    for (i = 0; i < ARRAY_SIZE(chunk_sizes); ++i)
+    {
+        expected = vkd3d_shader_hash_data(data, sizeof(data), 42);
+        vkd3d_shader_hash_init(&state, 42);
+        for (j = 0; j < sizeof(data); j += chunk_sizes[i])
+            vkd3d_shader_hash_update(&state, &data[j], min(chunk_sizes[i], sizeof(data) - j));
+        hash = vkd3d_shader_hash_digest(&state);
+        ok(hash == expected, "Chunk size %u: Got hash %#"PRIx64", expected %#"PRIx64".\n",
+                chunk_sizes[i], hash, expected);
+    }
+    ok(vkd3d_shader_hash_data(data, sizeof(data), 0) != expected, "Seed is ignored.\n");
+
+    memset(bindings, 0, sizeof(bindings));
+    bindings[0].type = VKD3D_SHADER_DESCRIPTOR_TYPE_SRV;
+    bindings[0].register_count = 1;
+    bindings[0].shader_visibility = VKD3D_SHADER_VISIBILITY_ALL;
+    bindings[1] = bindings[0];
+    bindings[1].register_index = 1;
+    bindings[1].binding.binding = 1;
+
+    memset(&shader_interface, 0, sizeof(shader_interface));
+    shader_interface.type = VKD3D_SHADER_STRUCTURE_TYPE_SHADER_INTERFACE_INFO;
+    shader_interface.bindings = bindings;
+    shader_interface.binding_count = ARRAY_SIZE(bindings);
+
+    vkd3d_shader_hash_init(&state, 0);
+    rc = vkd3d_shader_hash_shader_interface(&state, &shader_interface);
+    ok(rc == VKD3D_OK, "Got unexpected error code %d.\n", rc);
+    expected = vkd3d_shader_hash_digest(&state);
+
+    vkd3d_shader_hash_init(&state, 0);
+    rc = vkd3d_shader_hash_shader_interface(&state, NULL);
+    ok(rc == VKD3D_OK, "Got unexpected error code %d.\n", rc);
+    ok(vkd3d_shader_hash_digest(&state) != expected, "Got identical hashes.\n");
+
+    /* Timing info does not affect the generated code. */
+    memset(&timing_info, 0, sizeof(timing_info));
+    timing_info.type = VKD3D_SHADER_STRUCTURE_TYPE_COMPILE_TIMING_INFO;
+    shader_interface.next = &timing_info;
+    vkd3d_shader_hash_init(&state, 0);
+    rc = vkd3d_shader_hash_shader_interface(&state, &shader_interface);
+    ok(rc == VKD3D_OK, "Got unexpected error code %d.\n", rc);
+    hash = vkd3d_shader_hash_digest(&state);
+    ok(hash == expected, "Got hash %#"PRIx64", expected %#"PRIx64".\n", hash, expected);
+
+    memset(&xfb_info, 0, sizeof(xfb_info));
+    xfb_info.type = VKD3D_SHADER_STRUCTURE_TYPE_TRANSFORM_FEEDBACK_INFO;
+    shader_interface.next = &xfb_info;
+    vkd3d_shader_hash_init(&state, 0);
+    rc = vkd3d_shader_hash_shader_interface(&state, &shader_interface);
+    ok(rc == VKD3D_OK, "Got unexpected error code %d.\n", rc);
+    ok(vkd3d_shader_hash_digest(&state) != expected, "Got identical hashes.\n");
+
+    shader_interface.next = NULL;
+    bindings[1].binding.binding = 2;
+    vkd3d_shader_hash_init(&state, 0);
+    rc = vkd3d_shader_hash_shader_interface(&state, &shader_interface);
+    ok(rc == VKD3D_OK, "Got unexpected error code %d.\n", rc);
+    ok(vkd3d_shader_hash_digest(&state) != expected, "Got identical hashes.\n");
+
+    /* Unknown extension structures cannot be hashed. */
+    xfb_info.type = VKD3D_SHADER_STRUCTURE_TYPE_SCAN_INFO;
+    shader_interface.next = &xfb_info;
+    vkd3d_shader_hash_init(&state, 0);
+    rc = vkd3d_shader_hash_shader_interface(&state, &shader_interface);
+    ok(rc == VKD3D_ERROR_INVALID_ARGUMENT, "Got unexpected error code %d.\n", rc);
+    memset(&compile_args, 0, sizeof(compile_args));
+    compile_args.type = VKD3D_SHADER_STRUCTURE_TYPE_COMPILE_ARGUMENTS;
+    compile_args.next = &xfb_info;
+    rc = vkd3d_shader_hash_compile_arguments(&state, &compile_args);
+    ok(rc == VKD3D_ERROR_INVALID_ARGUMENT, "Got unexpected error code %d.\n", rc);
+}
+
+static void test_serialize_root_signature_checksum(void)
+{
+    struct vkd3d_shader_code dxbc;
+    int rc;
+
+    static const struct vkd3d_versioned_root_signature_desc empty_rs_desc =
+    {
+        .version = VKD3D_ROOT_SIGNATURE_VERSION_1_0,
+    };
+    /* /T rootsig_1_0 /E RS */
+    static const DWORD empty_rootsig[] =
+    {
+        0x43425844, 0xd64afc1d, 0x5dc27735, 0x9edacb4a, 0x6bd8a7fa, 0x00000001, 0x00000044, 0x00000001,
+        0x00000024, 0x30535452, 0x00000018, 0x00000001, 0x00000000, 0x00000018, 0x00000000, 0x00000018,
+        0x00000000,
+    };
+
+    rc = vkd3d_shader_serialize_root_signature(&empty_rs_desc, &dxbc);
+    ok(rc == VKD3D_OK, "Got unexpected error code %d.\n", rc);
+    if (rc != VKD3D_OK)
+        return;
+
+    ok(dxbc.size == sizeof(empty_rootsig), "Got unexpected size %zu.\n", dxbc.size);
+    if (dxbc.size == sizeof(empty_rootsig))
+        ok(!memcmp(dxbc.code, empty_rootsig, dxbc.size), "Got checksum {%#x, %#x, %#x, %#x}.\n",
+                ((const uint32_t *)dxbc.code)[1], ((const uint32_t *)dxbc.code)[2],
+                ((const uint32_t *)dxbc.code)[3], ((const uint32_t *)dxbc.code)[4]);
+    vkd3d_shader_free_shader_code(&dxbc);
 }
 
 START_TEST(vkd3d_shader_api)
@@ -134,4 +718,10 @@ START_TEST(vkd3d_shader_api)
 
     run_test(test_invalid_shaders);
     run_test(test_vkd3d_shader_pfns);
+    run_test(test_compile_dxbc_repeated);
+    run_test(test_compile_dxbc_optimize);
+    run_test(test_scan_dxbc_long_shader);
+    run_test(test_compile_dxbc_large_root_signature);
+    run_test(test_hash);
+    run_test(test_serialize_root_signature_checksum);
 }
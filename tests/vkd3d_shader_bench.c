@@ -0,0 +1,718 @@
+/*
+ * Copyright 2020 VKD3D contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/* Measures the shader compiler over a directory of DXBC blobs, by default
+ * tests/shader_corpus, which tests/extract_shader_corpus.py fills with the
+ * shaders and root signatures embedded in tests/d3d12.c. Shader blobs go
+ * through DXBC parsing, instruction scanning and SPIR-V emission, root
+ * signature blobs through parsing and serialization. A generated shader of
+ * several thousand instructions measures scanning throughput on its own.
+ * Each stage is timed over several iterations, keeping the fastest run of
+ * each blob. */
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vkd3d_common.h"
+#include "vkd3d_shader.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <time.h>
+#endif
+
+#define MAKE_TAG(ch0, ch1, ch2, ch3) \
+    ((uint32_t)(ch0) | ((uint32_t)(ch1) << 8) | ((uint32_t)(ch2) << 16) | ((uint32_t)(ch3) << 24))
+#define TAG_DXBC MAKE_TAG('D', 'X', 'B', 'C')
+#define TAG_RTS0 MAKE_TAG('R', 'T', 'S', '0')
+#define TAG_SHDR MAKE_TAG('S', 'H', 'D', 'R')
+#define TAG_SHEX MAKE_TAG('S', 'H', 'E', 'X')
+
+static uint64_t allocation_count;
+static bool allocation_count_available;
+
+#if defined(__GLIBC__) && !defined(__SANITIZE_ADDRESS__)
+/* Counts the allocations made by the shader compiler by interposing the
+ * allocator, which also covers a shared libvkd3d-shader. */
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void __libc_free(void *ptr);
+
+void *malloc(size_t size)
+{
+    ++allocation_count;
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size)
+{
+    ++allocation_count;
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    ++allocation_count;
+    return __libc_realloc(ptr, size);
+}
+
+void free(void *ptr)
+{
+    __libc_free(ptr);
+}
+
+static void init_allocation_count(void)
+{
+    allocation_count_available = true;
+}
+#else
+static void init_allocation_count(void)
+{
+    allocation_count_available = false;
+}
+#endif
+
+static uint64_t get_time_ns(void)
+{
+#ifdef _WIN32
+    LARGE_INTEGER counter, frequency;
+
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return (uint64_t)((double)counter.QuadPart * 1000000000.0 / (double)frequency.QuadPart);
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+#endif
+}
+
+enum stage
+{
+    STAGE_PARSE,
+    STAGE_SCAN,
+    STAGE_EMIT,
+    STAGE_COMPILE,
+    STAGE_ROOT_SIGNATURE_PARSE,
+    STAGE_ROOT_SIGNATURE_SERIALIZE,
+    STAGE_SCAN_LONG_SHADER,
+    STAGE_COUNT,
+};
+
+static const char * const stage_names[] =
+{
+    [STAGE_PARSE]                    = "parse",
+    [STAGE_SCAN]                     = "scan",
+    [STAGE_EMIT]                     = "emit",
+    [STAGE_COMPILE]                  = "compile",
+    [STAGE_ROOT_SIGNATURE_PARSE]     = "root_signature_parse",
+    [STAGE_ROOT_SIGNATURE_SERIALIZE] = "root_signature_serialize",
+    [STAGE_SCAN_LONG_SHADER]         = "scan_long_shader",
+};
+
+struct stage_result
+{
+    unsigned int blob_count;
+    unsigned int failure_count;
+    uint64_t instruction_count;
+    uint64_t time_ns;
+    uint64_t allocation_count;
+};
+
+struct options
+{
+    const char *corpus_dir;
+    unsigned int iteration_count;
+    bool csv;
+    bool verbose;
+};
+
+static bool read_blob(const char *filename, struct vkd3d_shader_code *blob)
+{
+    long size;
+    void *code;
+    FILE *f;
+
+    memset(blob, 0, sizeof(*blob));
+
+    if (!(f = fopen(filename, "rb")))
+    {
+        fprintf(stderr, "Cannot open file for reading: '%s'.\n", filename);
+        return false;
+    }
+
+    if (fseek(f, 0, SEEK_END) || (size = ftell(f)) < 0 || fseek(f, 0, SEEK_SET)
+            || !(code = malloc(size ? size : 1)))
+    {
+        fclose(f);
+        return false;
+    }
+
+    if (fread(code, 1, size, f) != (size_t)size)
+    {
+        fprintf(stderr, "Could not read file: '%s'.\n", filename);
+        free(code);
+        fclose(f);
+        return false;
+    }
+
+    fclose(f);
+    blob->code = code;
+    blob->size = size;
+    return true;
+}
+
+static const uint32_t *find_chunk(const struct vkd3d_shader_code *blob, uint32_t tag, uint32_t *size)
+{
+    const uint32_t *data = blob->code;
+    uint32_t i, count, offset;
+
+    if (blob->size < 32 || data[0] != TAG_DXBC)
+        return NULL;
+
+    count = data[7];
+    if (count > (blob->size - 32) / sizeof(*data))
+        return NULL;
+
+    for (i = 0; i < count; ++i)
+    {
+        offset = data[8 + i];
+        if (offset % sizeof(*data) || offset > blob->size - 8)
+            continue;
+        if (data[offset / sizeof(*data)] != tag)
+            continue;
+        *size = data[offset / sizeof(*data) + 1];
+        if (*size > blob->size - offset - 8)
+            return NULL;
+        return &data[offset / sizeof(*data) + 2];
+    }
+
+    return NULL;
+}
+
+/* Counts the instructions of the SHDR or SHEX chunk, including custom data
+ * blocks, without decoding them. */
+static unsigned int count_instructions(const struct vkd3d_shader_code *blob)
+{
+    const uint32_t *tokens, *end;
+    unsigned int count = 0;
+    uint32_t size, length;
+
+    if (!(tokens = find_chunk(blob, TAG_SHEX, &size)) && !(tokens = find_chunk(blob, TAG_SHDR, &size)))
+        return 0;
+    if (size < 2 * sizeof(*tokens))
+        return 0;
+
+    end = tokens + min(tokens[1], size / sizeof(*tokens));
+    tokens += 2;
+    while (tokens < end)
+    {
+        /* VKD3D_SM4_OP_CUSTOMDATA stores its length in the next token. */
+        if ((*tokens & 0x7ff) == 0x35)
+            length = tokens + 1 < end ? tokens[1] : 0;
+        else
+            length = (*tokens >> 24) & 0x7f;
+        if (!length || length > end - tokens)
+            break;
+        tokens += length;
+        ++count;
+    }
+
+    return count;
+}
+
+static void bench_shader(const struct options *options, const char *filename,
+        const struct vkd3d_shader_code *dxbc, struct stage_result *results, uint64_t *best_ns)
+{
+    uint64_t parse_time, scan_time, emit_time, start_time, compile_time;
+    struct vkd3d_shader_compile_timing_info timing_info;
+    struct vkd3d_shader_interface_info shader_interface;
+    struct vkd3d_shader_code spirv;
+    uint64_t allocations = 0;
+    unsigned int i, j;
+    int ret;
+
+    memset(&timing_info, 0, sizeof(timing_info));
+    timing_info.type = VKD3D_SHADER_STRUCTURE_TYPE_COMPILE_TIMING_INFO;
+    timing_info.parse_time_ns = &parse_time;
+    timing_info.emit_time_ns = &emit_time;
+    timing_info.scan_time_ns = &scan_time;
+
+    memset(&shader_interface, 0, sizeof(shader_interface));
+    shader_interface.type = VKD3D_SHADER_STRUCTURE_TYPE_SHADER_INTERFACE_INFO;
+    shader_interface.next = &timing_info;
+
+    for (i = 0; i < STAGE_ROOT_SIGNATURE_PARSE; ++i)
+        best_ns[i] = UINT64_MAX;
+
+    for (i = 0; i < options->iteration_count; ++i)
+    {
+        allocations = allocation_count;
+        start_time = get_time_ns();
+        ret = vkd3d_shader_compile_dxbc(dxbc, &spirv, 0, &shader_interface, NULL);
+        compile_time = get_time_ns() - start_time;
+        allocations = allocation_count - allocations;
+        if (ret < 0)
+        {
+            fprintf(stderr, "Failed to compile shader '%s', ret %d.\n", filename, ret);
+            for (j = 0; j < STAGE_ROOT_SIGNATURE_PARSE; ++j)
+            {
+                ++results[j].failure_count;
+                best_ns[j] = 0;
+            }
+            return;
+        }
+        vkd3d_shader_free_shader_code(&spirv);
+
+        best_ns[STAGE_PARSE] = min(best_ns[STAGE_PARSE], parse_time - scan_time);
+        best_ns[STAGE_SCAN] = min(best_ns[STAGE_SCAN], scan_time);
+        best_ns[STAGE_EMIT] = min(best_ns[STAGE_EMIT], emit_time);
+        best_ns[STAGE_COMPILE] = min(best_ns[STAGE_COMPILE], compile_time);
+    }
+
+    for (i = 0; i < STAGE_ROOT_SIGNATURE_PARSE; ++i)
+    {
+        ++results[i].blob_count;
+        results[i].instruction_count += count_instructions(dxbc);
+        results[i].time_ns += best_ns[i];
+    }
+    results[STAGE_COMPILE].allocation_count += allocations;
+}
+
+static void bench_root_signature(const struct options *options, const char *filename,
+        const struct vkd3d_shader_code *dxbc, struct stage_result *results, uint64_t *best_ns)
+{
+    uint64_t start_time, parse_time, serialize_time, parse_allocations = 0, serialize_allocations = 0;
+    struct vkd3d_versioned_root_signature_desc desc;
+    struct vkd3d_shader_code serialized;
+    unsigned int i;
+    int ret;
+
+    best_ns[STAGE_ROOT_SIGNATURE_PARSE] = UINT64_MAX;
+    best_ns[STAGE_ROOT_SIGNATURE_SERIALIZE] = UINT64_MAX;
+
+    for (i = 0; i < options->iteration_count; ++i)
+    {
+        parse_allocations = allocation_count;
+        start_time = get_time_ns();
+        ret = vkd3d_shader_parse_root_signature(dxbc, &desc);
+        parse_time = get_time_ns() - start_time;
+        parse_allocations = allocation_count - parse_allocations;
+        if (ret < 0)
+        {
+            fprintf(stderr, "Failed to parse root signature '%s', ret %d.\n", filename, ret);
+            ++results[STAGE_ROOT_SIGNATURE_PARSE].failure_count;
+            best_ns[STAGE_ROOT_SIGNATURE_PARSE] = best_ns[STAGE_ROOT_SIGNATURE_SERIALIZE] = 0;
+            return;
+        }
+
+        serialize_allocations = allocation_count;
+        start_time = get_time_ns();
+        ret = vkd3d_shader_serialize_root_signature(&desc, &serialized);
+        serialize_time = get_time_ns() - start_time;
+        serialize_allocations = allocation_count - serialize_allocations;
+        vkd3d_shader_free_root_signature(&desc);
+        if (ret < 0)
+        {
+            fprintf(stderr, "Failed to serialize root signature '%s', ret %d.\n", filename, ret);
+            ++results[STAGE_ROOT_SIGNATURE_SERIALIZE].failure_count;
+            best_ns[STAGE_ROOT_SIGNATURE_PARSE] = best_ns[STAGE_ROOT_SIGNATURE_SERIALIZE] = 0;
+            return;
+        }
+        vkd3d_shader_free_shader_code(&serialized);
+
+        best_ns[STAGE_ROOT_SIGNATURE_PARSE] = min(best_ns[STAGE_ROOT_SIGNATURE_PARSE], parse_time);
+        best_ns[STAGE_ROOT_SIGNATURE_SERIALIZE] = min(best_ns[STAGE_ROOT_SIGNATURE_SERIALIZE], serialize_time);
+    }
+
+    for (i = STAGE_ROOT_SIGNATURE_PARSE; i <= STAGE_ROOT_SIGNATURE_SERIALIZE; ++i)
+    {
+        ++results[i].blob_count;
+        results[i].time_ns += best_ns[i];
+    }
+    results[STAGE_ROOT_SIGNATURE_PARSE].allocation_count += parse_allocations;
+    results[STAGE_ROOT_SIGNATURE_SERIALIZE].allocation_count += serialize_allocations;
+}
+
+/* Builds a ps_5_0 shader of a few thousand arithmetic instructions. */
+static bool create_long_shader(struct vkd3d_shader_code *dxbc)
+{
+    unsigned int token_count, code_size, i;
+    uint32_t *code, *ptr;
+
+    static const unsigned int repeat_count = 1024;
+    static const uint32_t header[] =
+    {
+        0x00000050,             /* ps_5_0 */
+        0x00000000,             /* token count */
+        0x02000068, 0x00000002, /* dcl_temps 2 */
+    };
+    static const uint32_t body[] =
+    {
+        /* mov r0.xyzw, r1.xyzw */
+        0x05000036, 0x001000f2, 0x00000000, 0x00100e46, 0x00000001,
+        /* add r0.xyzw, r0.xyzw, r1.xyzw */
+        0x07000000, 0x001000f2, 0x00000000, 0x00100e46, 0x00000000, 0x00100e46, 0x00000001,
+        /* mul r1.xyzw, r0.xyzw, r1.xyzw */
+        0x07000038, 0x001000f2, 0x00000001, 0x00100e46, 0x00000000, 0x00100e46, 0x00000001,
+        /* mad r0.xyzw, r0.xyzw, r1.xyzw, r0.xyzw */
+        0x09000032, 0x001000f2, 0x00000000, 0x00100e46, 0x00000000, 0x00100e46, 0x00000001,
+        0x00100e46, 0x00000000,
+    };
+
+    token_count = ARRAY_SIZE(header) + repeat_count * ARRAY_SIZE(body) + 1;
+    /* DXBC header, one chunk offset, chunk header. */
+    code_size = (8 + 1 + 2 + token_count) * sizeof(*code);
+    if (!(code = malloc(code_size)))
+        return false;
+
+    ptr = code;
+    *ptr++ = TAG_DXBC;
+    for (i = 0; i < 4; ++i)
+        *ptr++ = 0; /* checksum */
+    *ptr++ = 0x00000001;
+    *ptr++ = code_size;
+    *ptr++ = 1;
+    *ptr++ = (8 + 1) * sizeof(*code);
+    *ptr++ = TAG_SHEX;
+    *ptr++ = token_count * sizeof(*code);
+    memcpy(ptr, header, sizeof(header));
+    ptr[1] = token_count;
+    ptr += ARRAY_SIZE(header);
+    for (i = 0; i < repeat_count; ++i)
+    {
+        memcpy(ptr, body, sizeof(body));
+        ptr += ARRAY_SIZE(body);
+    }
+    *ptr++ = 0x0100003e; /* ret */
+
+    dxbc->code = code;
+    dxbc->size = code_size;
+    return true;
+}
+
+static void bench_long_shader(const struct options *options, struct stage_result *results)
+{
+    struct stage_result *result = &results[STAGE_SCAN_LONG_SHADER];
+    uint64_t start_time, scan_time, best_ns = UINT64_MAX, allocations = 0;
+    struct vkd3d_shader_scan_info scan_info;
+    struct vkd3d_shader_code dxbc;
+    unsigned int i;
+    int ret;
+
+    if (!create_long_shader(&dxbc))
+    {
+        ++result->failure_count;
+        return;
+    }
+
+    for (i = 0; i < options->iteration_count; ++i)
+    {
+        memset(&scan_info, 0, sizeof(scan_info));
+        scan_info.type = VKD3D_SHADER_STRUCTURE_TYPE_SCAN_INFO;
+
+        allocations = allocation_count;
+        start_time = get_time_ns();
+        ret = vkd3d_shader_scan_dxbc(&dxbc, &scan_info);
+        scan_time = get_time_ns() - start_time;
+        allocations = allocation_count - allocations;
+        if (ret < 0)
+        {
+            fprintf(stderr, "Failed to scan the generated long shader, ret %d.\n", ret);
+            ++result->failure_count;
+            free((void *)dxbc.code);
+            return;
+        }
+
+        best_ns = min(best_ns, scan_time);
+    }
+
+    ++result->blob_count;
+    result->instruction_count += count_instructions(&dxbc);
+    result->time_ns += best_ns;
+    result->allocation_count += allocations;
+
+    if (options->verbose)
+        printf("<long shader>: %u instructions, scan %"PRIu64" ns.\n", count_instructions(&dxbc), best_ns);
+
+    free((void *)dxbc.code);
+}
+
+static void bench_file(const struct options *options, const char *filename, struct stage_result *results)
+{
+    uint64_t best_ns[STAGE_COUNT] = {0};
+    struct vkd3d_shader_code dxbc;
+    uint32_t size;
+
+    if (!read_blob(filename, &dxbc))
+    {
+        ++results[STAGE_COMPILE].failure_count;
+        return;
+    }
+
+    if (find_chunk(&dxbc, TAG_SHEX, &size) || find_chunk(&dxbc, TAG_SHDR, &size))
+    {
+        bench_shader(options, filename, &dxbc, results, best_ns);
+        if (options->verbose)
+            printf("%s: %u instructions, compile %"PRIu64" ns (parse %"PRIu64", scan %"PRIu64", emit %"PRIu64").\n",
+                    filename, count_instructions(&dxbc), best_ns[STAGE_COMPILE], best_ns[STAGE_PARSE],
+                    best_ns[STAGE_SCAN], best_ns[STAGE_EMIT]);
+    }
+    else if (find_chunk(&dxbc, TAG_RTS0, &size))
+    {
+        bench_root_signature(options, filename, &dxbc, results, best_ns);
+        if (options->verbose)
+            printf("%s: root signature parse %"PRIu64" ns, serialize %"PRIu64" ns.\n",
+                    filename, best_ns[STAGE_ROOT_SIGNATURE_PARSE], best_ns[STAGE_ROOT_SIGNATURE_SERIALIZE]);
+    }
+    else if (options->verbose)
+    {
+        fprintf(stderr, "Skipping '%s', which is neither a shader nor a root signature.\n", filename);
+    }
+
+    free((void *)dxbc.code);
+}
+
+struct file_list
+{
+    char **filenames;
+    size_t count;
+    size_t capacity;
+};
+
+static bool file_list_add(struct file_list *list, const char *directory, const char *name)
+{
+    char **new_filenames;
+    size_t new_capacity;
+    char *filename;
+
+    if (list->count == list->capacity)
+    {
+        new_capacity = max(list->capacity * 2, 64);
+        if (!(new_filenames = realloc(list->filenames, new_capacity * sizeof(*list->filenames))))
+            return false;
+        list->filenames = new_filenames;
+        list->capacity = new_capacity;
+    }
+
+    if (!(filename = malloc(strlen(directory) + strlen(name) + 2)))
+        return false;
+    sprintf(filename, "%s/%s", directory, name);
+    list->filenames[list->count++] = filename;
+    return true;
+}
+
+static bool has_dxbc_extension(const char *name)
+{
+    size_t length = strlen(name);
+
+    return length > 5 && !strcmp(name + length - 5, ".dxbc");
+}
+
+static bool list_corpus(struct file_list *list, const char *directory)
+{
+#ifdef _WIN32
+    char pattern[MAX_PATH];
+    WIN32_FIND_DATAA data;
+    HANDLE handle;
+
+    snprintf(pattern, sizeof(pattern), "%s\\*.dxbc", directory);
+    if ((handle = FindFirstFileA(pattern, &data)) == INVALID_HANDLE_VALUE)
+    {
+        fprintf(stderr, "Cannot open directory: '%s'.\n", directory);
+        return false;
+    }
+
+    do
+    {
+        if ((data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) || !has_dxbc_extension(data.cFileName))
+            continue;
+        if (!file_list_add(list, directory, data.cFileName))
+        {
+            FindClose(handle);
+            return false;
+        }
+    } while (FindNextFileA(handle, &data));
+
+    FindClose(handle);
+    return true;
+#else
+    struct dirent *entry;
+    DIR *dir;
+
+    if (!(dir = opendir(directory)))
+    {
+        fprintf(stderr, "Cannot open directory: '%s'.\n", directory);
+        return false;
+    }
+
+    while ((entry = readdir(dir)))
+    {
+        if (entry->d_name[0] == '.' || !has_dxbc_extension(entry->d_name))
+            continue;
+        if (!file_list_add(list, directory, entry->d_name))
+        {
+            closedir(dir);
+            return false;
+        }
+    }
+
+    closedir(dir);
+    return true;
+#endif
+}
+
+static int compare_filename(const void *a, const void *b)
+{
+    return strcmp(*(char * const *)a, *(char * const *)b);
+}
+
+static void print_results(const struct options *options, const struct stage_result *results)
+{
+    const struct stage_result *result;
+    double ns_per_instruction;
+    unsigned int i;
+
+    if (options->csv)
+        printf("stage,blobs,failures,instructions,ns,ns_per_instruction,ns_per_blob,allocations_per_blob\n");
+    else
+        printf("%-26s %7s %8s %12s %12s %10s %12s\n", "stage", "blobs", "failures",
+                "instructions", "ns/instr", "ns/blob", "allocs/blob");
+
+    for (i = 0; i < STAGE_COUNT; ++i)
+    {
+        result = &results[i];
+        ns_per_instruction = result->instruction_count ? (double)result->time_ns / result->instruction_count : 0.0;
+
+        if (options->csv)
+        {
+            printf("%s,%u,%u,%"PRIu64",%"PRIu64",", stage_names[i], result->blob_count,
+                    result->failure_count, result->instruction_count, result->time_ns);
+            if (result->instruction_count)
+                printf("%.2f", ns_per_instruction);
+            printf(",%.0f,", result->blob_count ? (double)result->time_ns / result->blob_count : 0.0);
+            if (allocation_count_available && (i == STAGE_COMPILE || i >= STAGE_ROOT_SIGNATURE_PARSE))
+                printf("%.1f", result->blob_count ? (double)result->allocation_count / result->blob_count : 0.0);
+            printf("\n");
+            continue;
+        }
+
+        printf("%-26s %7u %8u %12"PRIu64" ", stage_names[i], result->blob_count, result->failure_count,
+                result->instruction_count);
+        if (result->instruction_count)
+            printf("%12.2f ", ns_per_instruction);
+        else
+            printf("%12s ", "-");
+        printf("%10.0f ", result->blob_count ? (double)result->time_ns / result->blob_count : 0.0);
+        /* Allocations are only attributed to whole API calls. */
+        if (allocation_count_available && (i == STAGE_COMPILE || i >= STAGE_ROOT_SIGNATURE_PARSE))
+            printf("%12.1f\n", result->blob_count ? (double)result->allocation_count / result->blob_count : 0.0);
+        else
+            printf("%12s\n", "-");
+    }
+}
+
+static void print_usage(const char *program_name)
+{
+    fprintf(stderr, "usage: %s [--iterations <count>] [--csv] [--verbose] [<corpus_directory>]\n", program_name);
+}
+
+static bool parse_command_line(int argc, char **argv, struct options *options)
+{
+    int i;
+
+    memset(options, 0, sizeof(*options));
+    options->corpus_dir = "tests/shader_corpus";
+    options->iteration_count = 10;
+
+    for (i = 1; i < argc; ++i)
+    {
+        if (!strcmp(argv[i], "--iterations"))
+        {
+            if (i + 1 >= argc)
+                return false;
+            options->iteration_count = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--csv"))
+        {
+            options->csv = true;
+        }
+        else if (!strcmp(argv[i], "--verbose"))
+        {
+            options->verbose = true;
+        }
+        else if (argv[i][0] == '-' || i != argc - 1)
+        {
+            return false;
+        }
+        else
+        {
+            options->corpus_dir = argv[i];
+        }
+    }
+
+    options->iteration_count = max(options->iteration_count, 1);
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    struct stage_result results[STAGE_COUNT];
+    struct file_list list = {0};
+    struct options options;
+    unsigned int i;
+    int ret = 1;
+
+    if (!parse_command_line(argc, argv, &options))
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    init_allocation_count();
+
+    if (!list_corpus(&list, options.corpus_dir))
+        goto done;
+    if (!list.count)
+    {
+        fprintf(stderr, "No DXBC blobs found in '%s'.\n", options.corpus_dir);
+        goto done;
+    }
+    qsort(list.filenames, list.count, sizeof(*list.filenames), compare_filename);
+
+    memset(results, 0, sizeof(results));
+    for (i = 0; i < list.count; ++i)
+        bench_file(&options, list.filenames[i], results);
+    bench_long_shader(&options, results);
+
+    print_results(&options, results);
+    ret = 0;
+
+done:
+    for (i = 0; i < list.count; ++i)
+        free(list.filenames[i]);
+    free(list.filenames);
+    return ret;
+}